@@ -0,0 +1,229 @@
+/*! \file arcTube.cxx
+ *  \brief breastPhantom arcTube
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "arcTube.hxx"
+
+#include <cmath>
+#include <boost/math/constants/constants.hpp>
+
+using namespace std;
+
+arcTube::arcTube(const double* spos, const double* sdir, const double* curv, double len, const double* s){
+  radCurv = 0.0;
+  for(int i=0; i<3; i++){
+    startPos[i] = spos[i];
+    center[i] = curv[i];
+    radCurv += (curv[i]-spos[i])*(curv[i]-spos[i]);
+  }
+  radCurv = sqrt(radCurv);
+  length = len;
+  for(int i=0; i<4; i++){
+    shape[i] = s[i];
+  }
+
+  for(int i=0; i<3; i++){
+    basis1[i] = sdir[i];
+    basis2[i] = (center[i] - startPos[i])/radCurv;
+  }
+  basis3[0] = basis1[1]*basis2[2] - basis1[2]*basis2[1];
+  basis3[1] = basis1[2]*basis2[0] - basis1[0]*basis2[2];
+  basis3[2] = basis1[0]*basis2[1] - basis1[1]*basis2[0];
+
+  // largest radius is at an end or where the profile derivative vanishes
+  double r0 = shape[3];
+  double r1 = ((shape[0]*length + shape[1])*length + shape[2])*length + shape[3];
+  maxRad = (r0 > r1) ? r0 : r1;
+  double a = 3.0*shape[0];
+  double b = 2.0*shape[1];
+  double c = shape[2];
+  double roots[2];
+  int numRoots = 0;
+  if(fabs(a) > 1e-12){
+    double disc = b*b - 4.0*a*c;
+    if(disc >= 0.0){
+      roots[0] = (-b - sqrt(disc))/(2.0*a);
+      roots[1] = (-b + sqrt(disc))/(2.0*a);
+      numRoots = 2;
+    }
+  } else if(fabs(b) > 1e-12){
+    roots[0] = -c/b;
+    numRoots = 1;
+  }
+  for(int k=0; k<numRoots; k++){
+    double t = roots[k];
+    if(t > 0.0 && t < length){
+      double r = ((shape[0]*t + shape[1])*t + shape[2])*t + shape[3];
+      maxRad = (r > maxRad) ? r : maxRad;
+    }
+  }
+}
+
+void arcTube::arcPoint(double theta, double* pos){
+  for(int i=0; i<3; i++){
+    pos[i] = center[i] + radCurv*(-1*cos(theta)*basis2[i] + sin(theta)*basis1[i]);
+  }
+}
+
+void arcTube::setVoxel(unsigned char* p, unsigned char label, const unsigned char* keep, int numKeep,
+		       tissueHistogram* hist){
+  unsigned char old = __atomic_load_n(p, __ATOMIC_RELAXED);
+  while(old != label){
+    for(int l=0; l<numKeep; l++){
+      if(old == keep[l]){
+	return;
+      }
+    }
+    // on failure old is reloaded
+    if(__atomic_compare_exchange_n(p, &old, label, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+      hist->move(old, label);
+      return;
+    }
+  }
+}
+
+void arcTube::rasterize(vtkImageData* img, tissueHistogram* hist, unsigned char label,
+		       const unsigned char* keep, int numKeep){
+  const double pi = boost::math::constants::pi<double>();
+
+  if(length <= 0.0 || radCurv <= 0.0){
+    return;
+  }
+
+  double origin[3];
+  double spacing[3];
+  int extent[6];
+  img->GetOrigin(origin);
+  img->GetSpacing(spacing);
+  img->GetExtent(extent);
+
+  double minSpacing = spacing[0];
+  for(int i=1; i<3; i++){
+    minSpacing = (spacing[i] < minSpacing) ? spacing[i] : minSpacing;
+  }
+
+  // pieces about as long as the tube is wide keep the scanned boxes tight
+  double angle = length/radCurv;
+  double pieceLen = 2.0*maxRad;
+  if(pieceLen < 4.0*minSpacing){
+    pieceLen = 4.0*minSpacing;
+  }
+  int numPiece = (int)ceil(length/pieceLen);
+  double pieceAngle = angle/numPiece;
+
+  if(maxRad > 0.0){
+#pragma omp parallel for schedule(dynamic,1)
+    for(int k=0; k<numPiece; k++){
+      double lo = k*pieceAngle;
+      double hi = (k == numPiece-1) ? angle : (k+1)*pieceAngle;
+
+      // box of arc piece from its ends and any axis extreme inside it
+      double box[6];
+      double pos[3];
+      arcPoint(lo, pos);
+      for(int i=0; i<3; i++){
+	box[2*i] = pos[i];
+	box[2*i+1] = pos[i];
+      }
+      arcPoint(hi, pos);
+      for(int i=0; i<3; i++){
+	box[2*i] = (pos[i] < box[2*i]) ? pos[i] : box[2*i];
+	box[2*i+1] = (pos[i] > box[2*i+1]) ? pos[i] : box[2*i+1];
+      }
+      for(int i=0; i<3; i++){
+	double ext = atan2(-basis1[i], basis2[i]);
+	for(int m=0; m<3; m++){
+	  double t = ext + (m-1)*pi;
+	  if(t > lo && t < hi){
+	    arcPoint(t, pos);
+	    box[2*i] = (pos[i] < box[2*i]) ? pos[i] : box[2*i];
+	    box[2*i+1] = (pos[i] > box[2*i+1]) ? pos[i] : box[2*i+1];
+	  }
+	}
+      }
+
+      // voxel index range of box grown by largest radius, voxel a covers
+      // [a,a+1) in structured coordinates so its center is at a+0.5
+      int first[3];
+      int last[3];
+      bool empty = false;
+      for(int i=0; i<3; i++){
+	first[i] = (int)ceil((box[2*i] - maxRad - origin[i])/spacing[i] - 0.5);
+	last[i] = (int)floor((box[2*i+1] + maxRad - origin[i])/spacing[i] - 0.5);
+	first[i] = (first[i] < extent[2*i]) ? extent[2*i] : first[i];
+	last[i] = (last[i] > extent[2*i+1]) ? extent[2*i+1] : last[i];
+	empty = empty || (first[i] > last[i]);
+      }
+      if(empty){
+	continue;
+      }
+
+      for(int c=first[2]; c<=last[2]; c++){
+	for(int b=first[1]; b<=last[1]; b++){
+	  unsigned char* row = static_cast<unsigned char*>(img->GetScalarPointer(first[0],b,c));
+	  double vy = origin[1] + (b+0.5)*spacing[1] - center[1];
+	  double vz = origin[2] + (c+0.5)*spacing[2] - center[2];
+	  // span of voxels in segment
+	  int spanStart = -1;
+	  for(int a=first[0]; a<=last[0]+1; a++){
+	    bool inside = false;
+	    if(a <= last[0]){
+	      double vx = origin[0] + (a+0.5)*spacing[0] - center[0];
+	      double u = vx*basis1[0] + vy*basis1[1] + vz*basis1[2];
+	      double w = vx*basis2[0] + vy*basis2[1] + vz*basis2[2];
+	      double h = vx*basis3[0] + vy*basis3[1] + vz*basis3[2];
+	      double rho = sqrt(u*u + w*w);
+	      double d2 = (rho-radCurv)*(rho-radCurv) + h*h;
+	      if(d2 < maxRad*maxRad){
+		double theta = atan2(u, -w);
+		if(theta < 0.0){
+		  theta += 2*pi;
+		}
+		if(theta >= lo && (theta < hi || (k == numPiece-1 && theta <= hi))){
+		  double t = radCurv*theta;
+		  double r = ((shape[0]*t + shape[1])*t + shape[2])*t + shape[3];
+		  inside = (d2 < r*r);
+		}
+	      }
+	    }
+	    if(inside && spanStart < 0){
+	      spanStart = a;
+	    } else if(!inside && spanStart >= 0){
+	      // write span
+	      for(int m=spanStart-first[0]; m<a-first[0]; m++){
+		setVoxel(&row[m], label, keep, numKeep, hist);
+	      }
+	      spanStart = -1;
+	    }
+	  }
+	}
+      }
+    }
+  }
+
+  // voxels containing the centerline, at half voxel steps
+  double step = minSpacing/2.0;
+  int numStep = (int)ceil(length/step);
+  for(int j=0; j<=numStep; j++){
+    double t = (j*step < length) ? j*step : length;
+    double pos[3];
+    int ijk[3];
+    double pcoords[3];
+    arcPoint(t/radCurv, pos);
+    if(img->ComputeStructuredCoordinates(pos, ijk, pcoords)){
+      unsigned char* p = static_cast<unsigned char*>(img->GetScalarPointer(ijk));
+      setVoxel(p, label, keep, numKeep, hist);
+    }
+  }
+}
@@ -0,0 +1,81 @@
+/*! \file arcTube.hxx
+ *  \brief breastPhantom curved tube rasterizer header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef ARCTUBE_HXX_
+#define ARCTUBE_HXX_
+
+#ifndef __OMP__
+#define __OMP__
+#include <omp.h>
+#endif
+
+#ifndef __VTKIMAGEDATA__
+#define __VTKIMAGEDATA__
+#include <vtkImageData.h>
+#endif
+
+#include "tissueHistogram.hxx"
+
+/**********************************************
+*
+* Voxelization of a segment swept along a circular arc
+*
+**********************************************/
+
+class arcTube{
+  // the segment centerline is an arc of radius radCurv about center, a
+  // voxel belongs to the segment if its center lies in the disk normal to
+  // the arc at the voxel's own arc angle, with disk radius given by the
+  // cubic profile at that arc length, voxels are the cells found by
+  // ComputeStructuredCoordinates
+  // the arc is cut into short pieces, each piece scans the voxels of its
+  // bounding box and keeps those whose angle falls in the piece, so every
+  // voxel is tested by one piece only and pieces run in parallel
+  // the voxels containing the centerline are set as well so thin segments
+  // stay connected
+
+  // start of arc
+  double startPos[3];
+  // center of curvature
+  double center[3];
+  // radius of curvature (mm)
+  double radCurv;
+  // arc length (mm)
+  double length;
+  // cubic radius profile, radius at arc length t is
+  // shape[0]t^3+shape[1]t^2+shape[2]t+shape[3]
+  double shape[4];
+  // start direction, direction from start to center and arc plane normal
+  double basis1[3];
+  double basis2[3];
+  double basis3[3];
+  // largest radius along arc
+  double maxRad;
+  // position on arc at angle
+  void arcPoint(double, double*);
+  // set voxel to label unless it holds one of the kept labels, the
+  // compare and swap keeps concurrent writers of a voxel consistent
+  static void setVoxel(unsigned char*, unsigned char, const unsigned char*, int, tissueHistogram*);
+public:
+  // set voxels of image covered by the segment to label, voxels holding
+  // one of numKeep kept labels are left alone, histogram records every
+  // change
+  void rasterize(vtkImageData*, tissueHistogram*, unsigned char, const unsigned char*, int);
+  // constructor from start position, start direction, center of
+  // curvature, arc length and radius profile
+  arcTube(const double*, const double*, const double*, double, const double*);
+};
+
+#endif /* ARCTUBE_HXX_ */
@@ -0,0 +1,135 @@
+/*! \file betaTable.cxx
+ *  \brief breastPhantom betaTable
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "betaTable.hxx"
+
+#include <cmath>
+#include <boost/math/distributions/beta.hpp>
+
+using namespace std;
+
+const double betaTable::tolerance = 1e-6;
+
+betaTable* betaTable::first = nullptr;
+
+betaTable::betaTable(double a, double b){
+  alpha = a;
+  beta = b;
+  maxNode = 1024;
+  numNode = 0;
+  prob = new double[maxNode];
+  quant = new double[maxNode];
+  next = nullptr;
+
+  // start from 64 equal intervals so the nodes stay dyadic
+  const int numStart = 64;
+  double x0 = exact(0.0);
+  addNode(0.0, x0);
+  for(int k=0; k<numStart; k++){
+    double u1 = (double)(k+1)/numStart;
+    double x1 = exact(u1);
+    refine((double)k/numStart, x0, u1, x1);
+    x0 = x1;
+  }
+}
+
+double betaTable::exact(double u){
+  boost::math::beta_distribution<> dist(alpha, beta);
+  return boost::math::quantile(dist, u);
+}
+
+void betaTable::addNode(double u, double x){
+  if(numNode == maxNode){
+    double* moreProb = new double[2*maxNode];
+    double* moreQuant = new double[2*maxNode];
+    for(int k=0; k<numNode; k++){
+      moreProb[k] = prob[k];
+      moreQuant[k] = quant[k];
+    }
+    delete[] prob;
+    delete[] quant;
+    prob = moreProb;
+    quant = moreQuant;
+    maxNode *= 2;
+  }
+  prob[numNode] = u;
+  quant[numNode] = x;
+  numNode++;
+}
+
+void betaTable::refine(double u0, double x0, double u1, double x1){
+  // no 32 bit draw lies strictly inside narrower intervals
+  const double minWidth = ldexp(1.0, -32);
+
+  bool split = false;
+  if(u1 - u0 > minWidth){
+    for(int q=1; q<4 && !split; q++){
+      double u = u0 + 0.25*q*(u1 - u0);
+      double interp = x0 + 0.25*q*(x1 - x0);
+      split = (fabs(exact(u) - interp) >= tolerance);
+    }
+  }
+
+  if(split){
+    double um = 0.5*(u0 + u1);
+    double xm = exact(um);
+    refine(u0, x0, um, xm);
+    refine(um, xm, u1, x1);
+  } else {
+    addNode(u1, x1);
+  }
+}
+
+betaTable* betaTable::get(double a, double b){
+  betaTable* table;
+  // trees may be created concurrently
+#pragma omp critical(betaTable)
+  {
+    table = first;
+    while(table != nullptr && !(table->alpha == a && table->beta == b)){
+      table = table->next;
+    }
+    if(table == nullptr){
+      // tables are kept until the program ends
+      table = new betaTable(a, b);
+      table->next = first;
+      first = table;
+    }
+  }
+  return table;
+}
+
+double betaTable::quantile(double u){
+  if(u <= 0.0){
+    return quant[0];
+  }
+  if(u >= 1.0){
+    return quant[numNode-1];
+  }
+
+  // interval with prob[lo] <= u < prob[hi]
+  int lo = 0;
+  int hi = numNode-1;
+  while(hi - lo > 1){
+    int mid = (lo + hi)/2;
+    if(prob[mid] <= u){
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  double w = (u - prob[lo])/(prob[hi] - prob[lo]);
+  return quant[lo] + w*(quant[hi] - quant[lo]);
+}
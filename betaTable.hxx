@@ -0,0 +1,69 @@
+/*! \file betaTable.hxx
+ *  \brief breastPhantom beta distribution quantile table header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef BETATABLE_HXX_
+#define BETATABLE_HXX_
+
+#ifndef __OMP__
+#define __OMP__
+#include <omp.h>
+#endif
+
+/**********************************************
+*
+* Tabulated inverse CDF of a beta distribution
+*
+**********************************************/
+
+class betaTable{
+  // the quantile function is interpolated linearly between exact values
+  // at dyadic probabilities, an interval is halved until the
+  // interpolation is within tolerance of the exact quantile at its
+  // quarter points, or until it is no wider than the 2^-32 resolution of
+  // the uniform generators, whose draws then never fall strictly inside
+  // it, so a draw is off by at most tolerance on the [0,1] scale
+  // one table is built for each distinct parameter pair and shared
+
+  // shape parameters
+  double alpha, beta;
+  // number of nodes
+  int numNode;
+  // nodes allocated
+  int maxNode;
+  // node probabilities and quantiles
+  double* prob;
+  double* quant;
+  // next table in list of built tables
+  betaTable* next;
+  // first built table
+  static betaTable* first;
+  // append node
+  void addNode(double, double);
+  // add nodes strictly inside interval, then its right end
+  void refine(double, double, double, double);
+  // exact quantile
+  double exact(double);
+  // constructor builds table
+  betaTable(double, double);
+public:
+  // largest interpolation error on the [0,1] scale
+  static const double tolerance;
+  // table for shape parameters, built on first request
+  static betaTable* get(double, double);
+  // quantile of probability in [0,1]
+  double quantile(double);
+};
+
+#endif /* BETATABLE_HXX_ */
@@ -19,3254 +19,3330 @@
 
 namespace po = boost::program_options;
 
-unsigned int ductTree::num = 0;
-unsigned int arteryTree::num = 0;
-unsigned int veinTree::num = 0;
+// compartment stage, voxelize the breast, add skin, nipple and muscle and
+// segment the interior into fat and glandular compartments, the state later
+// stages need is returned through the reference arguments
+int compartmentStage(po::variables_map& vm, double pi, tissueStruct& tissue, unsigned char innerVal,
+		     unsigned char boundVal, const unsigned char* compartmentVal, unsigned char compMin,
+		     unsigned char compMax, unsigned char ufat, double imgRes, double skinThick,
+		     double nippleLen, double nippleRad, double areolaRad, double voxelVol, bool leftSide,
+		     double targetFatFrac, int numBreastCompartments, vtkPolyData* innerPoly,
+		     vtkImageData* breast, breastVolume& volume, tissueHistogram* hist,
+		     vtkMinimalStandardRandomSequence* rgen, double* baseBound, int* dim, double* origin,
+		     double* spacing, double* originCoords, int* breastExtent, int* breastDim,
+		     double* nipplePos, vtkIdList* boundaryList, int& numFatSeeds, double& breastVol,
+		     double* nippleNorm, breastComp*& glandCompartments, breastComp*& fatCompartments,
+		     double& fatVol, double& glandVol, double& cooperVol, double& targetGlandVol,
+		     long long int& glandVoxels, long long int& fatVoxels, long long int& cooperVoxels,
+		     int& numBackPlaneSkin, vtkIdType& nBoundary, vtkIdType& remBoundary,
+		     unsigned char*& boundaryDone, unsigned int& densityClass, unsigned int& numKeepComp,
+		     double& currentFatFrac, unsigned int*& keepCompList, unsigned int& keepComp){
 
-int main(int argc, char* argv[]){
 
-  double pi = vtkMath::Pi();
-	
-  // configuration file variables
-  po::options_description baseOpt("base options");
-  baseOpt.add_options()
-    ("base.outputDir",po::value<std::string>()->default_value("."),"output directory")
-    ("base.imgRes",po::value<double>()->default_value(0.25),"phantom resolution (mm)")
-    ("base.skinThick",po::value<double>()->default_value(0.75),"skin thickness (mm)")
-    ("base.nippleLen",po::value<double>()->default_value(4.0),"nipple length (mm)")
-    ("base.nippleRad",po::value<double>()->default_value(4.0),"nipple radius (mm)")
-    ("base.areolaRad",po::value<double>()->default_value(8.0),"areola radius (mm)")
-    ("base.leftBreast",po::value<bool>()->default_value(true),"left side breast (boolean)")
-    ("base.targetFatFrac",po::value<double>()->default_value(0.75),"desired fraction of breast to be fat")
-    ("base.seed",po::value<unsigned int>(),"random number generator seed")
-    ;
+  vtkSmartPointer<vtkIdList> boundaryList1 =
+    vtkSmartPointer<vtkIdList>::New();
 
-  po::options_description shapeOpt("breast shape options");
-  shapeOpt.add_options()
-    ("shape.ures",po::value<double>()->default_value(0.02),"u resolution of base shape")
-    ("shape.vres",po::value<double>()->default_value(0.02),"v resolution of base shape")
-    ("shape.pointSep",po::value<double>()->default_value(0.01),"minimum point separation (mm)")
-    ("shape.ringWidth",po::value<double>()->default_value(10.0),"thickness of back ring (mm)")
-    ("shape.ringSep",po::value<double>()->default_value(0.5),"ring node step size (mm)")
-    ("shape.featureAngle",po::value<double>()->default_value(20.0),"angle to preserve while smoothing (degrees)")
-    ("shape.targetReduction",po::value<double>()->default_value(0.05),"fraction of triangles to decimate")
-    ("shape.a1b",po::value<double>()->default_value(1.0),"bottom size")
-    ("shape.a1t",po::value<double>()->default_value(1.0),"top size")
-    ("shape.a2l",po::value<double>()->default_value(1.0),"left size")
-    ("shape.a2r",po::value<double>()->default_value(1.0),"right size")
-    ("shape.a3",po::value<double>()->default_value(1.0),"outward size")
-    ("shape.eps1",po::value<double>()->default_value(1.0),"u quadric exponent")
-    ("shape.eps2",po::value<double>()->default_value(1.0),"v quadric exponent")
-    ("shape.doPtosis",po::value<bool>()->default_value(false),"ptosis deformation (boolean)")
-    ("shape.ptosisB0",po::value<double>()->default_value(0.4),"ptosis b0")
-    ("shape.ptosisB1",po::value<double>()->default_value(0.3),"ptosis b1")
-    ("shape.doTurn",po::value<bool>()->default_value(false),"turn deformation (boolean)")
-    ("shape.turnC0",po::value<double>()->default_value(-0.4),"turn c0")
-    ("shape.turnC1",po::value<double>()->default_value(0.2),"turn c1")
-    ("shape.doTopShape",po::value<bool>()->default_value(false),"top shape deformation (boolean)")
-    ("shape.topShapeS0",po::value<double>()->default_value(1.54),"top shape s0")
-    ("shape.topShapeS1",po::value<double>()->default_value(1.3),"top shape s1")
-    ("shape.topShapeT0",po::value<double>()->default_value(-3.0),"top shape t0")
-    ("shape.topShapeT1",po::value<double>()->default_value(-1.0),"top shape t1")
-    ("shape.doFlattenSide",po::value<bool>()->default_value(false),"flatten side deformation (boolean)")
-    ("shape.flattenSideG0",po::value<double>()->default_value(-0.4),"flatten side g0")
-    ("shape.flattenSideG1",po::value<double>()->default_value(0.2),"flatten side g1")
-    ("shape.doTurnTop",po::value<bool>()->default_value(false),"turn top deformation (boolean)")
-    ("shape.turnTopH0",po::value<double>()->default_value(-2.7),"turn top h0")
-    ("shape.turnTopH1",po::value<double>()->default_value(-3.7),"turn top h1")
-    ;
+  vtkSmartPointer<vtkIdList> boundaryList2 =
+    vtkSmartPointer<vtkIdList>::New();
 
-  po::options_description compartOpt("breast compartment options");
-  compartOpt.add_options()
-    ("compartments.num",po::value<int>()->default_value(8),"number of breast compartments")
-    ("compartments.seedBaseDist",po::value<double>()->default_value(12.5),"distance along nipple line of compartment seed base (mm)")
-    ("compartments.backFatBufferFrac",po::value<double>()->default_value(0.2),"fraction of phantom in nipple direction forced to be fat")
-    ("compartments.numBackSeeds",po::value<int>()->default_value(100),"number of backplane seed points")
-    ("compartments.angularJitter",po::value<double>()->default_value(0.125),"maximum seed jitter (fraction of subtended angle)")
-    ("compartments.zJitter",po::value<double>()->default_value(5.0),"maximum seed jitter in nipple direction (mm)")
-    ("compartments.maxFracRadialDist",po::value<double>()->default_value(0.5),"maximum radial distance from base seed as a fraction of distance to breast surface")
-    ("compartments.minFracRadialDist",po::value<double>()->default_value(0.25),"minimum radial distance from base seed as a fraction of distance to breast surface")
-    ("compartments.minScaleNippleDir",po::value<double>()->default_value(0.01),"minimum scale in nipple direction")
-    ("compartments.maxScaleNippleDir",po::value<double>()->default_value(0.01),"maximum scale in nipple direction")
-    ("compartments.minScale",po::value<double>()->default_value(50.0),"minimum scale in non-nipple direction")
-    ("compartments.maxScale",po::value<double>()->default_value(60.0),"maximum scale in non-nipple direction")
-    ("compartments.minGlandStrength",po::value<double>()->default_value(20.0),"minimum gland strength")
-    ("compartments.maxGlandStrength",po::value<double>()->default_value(20.0),"maximum gland strength")
-    ("compartments.maxDeflect",po::value<double>()->default_value(0.01),"maximum compartment deflection angle from pointing towards nipple (fraction of pi)")
-    ("compartments.minSkinScaleNippleDir",po::value<double>()->default_value(0.01),"minimum scale skin seeds in nipple direction")
-    ("compartments.maxSkinScaleNippleDir",po::value<double>()->default_value(0.01),"maximum scale skin seeds in nipple direction")
-    ("compartments.minSkinScale",po::value<double>()->default_value(70.0),"minimum scale skin in non-nipple direction")
-    ("compartments.maxSkinScale",po::value<double>()->default_value(70.0),"maximum scale skin in non-nipple direction")
-    ("compartments.skinStrength",po::value<double>()->default_value(20.0),"skin strength")
-    ("compartments.backScale",po::value<double>()->default_value(50.0),"back scale")
-    ("compartments.backStrength",po::value<double>()->default_value(50.0),"back strength")
-    ("compartments.nippleScale",po::value<double>()->default_value(50.0),"nipple scale")
-    ("compartments.nippleStrength",po::value<double>()->default_value(50.0),"nipple strength")
-    ("compartments.voronSeedRadius",po::value<double>()->default_value(40.0),"check all seeds in radius (mm)")
-    ;
-  
-  po::options_description TDLUOpt("TDLU options");
-  TDLUOpt.add_options()
-    ("TDLU.maxLength",po::value<double>()->default_value(4.0),"maximum TDLU length")
-    ("TDLU.minLength",po::value<double>()->default_value(2.0),"minimum TDLU length")
-    ("TDLU.maxWidth",po::value<double>()->default_value(2.0),"maximum TDLU width")
-    ("TDLU.minWidth",po::value<double>()->default_value(1.0),"minimum TDLU width")
-    ;
-  
-  po::options_description perlinOpt("Perlin noise options");
-  perlinOpt.add_options()
-    ("perlin.maxDeviation",po::value<double>()->default_value(0.1),"maximum perlin perturbation fraction of radius")
-    ("perlin.frequency",po::value<double>()->default_value(0.5),"starting frequency")
-    ("perlin.lacunarity",po::value<double>()->default_value(1.5),"octave frequency multiplier")
-    ("perlin.persistence",po::value<double>()->default_value(0.2),"octave signal decay")
-    ("perlin.numOctaves",po::value<int>()->default_value(6),"number of frequency octaves")
-    ("perlin.xNoiseGen",po::value<int>()->default_value(683),"x direction noise generation seed")
-    ("perlin.yNoiseGen",po::value<int>()->default_value(4933),"y direction noise generation seed")
-    ("perlin.zNoiseGen",po::value<int>()->default_value(23),"z direction noise generation seed")
-    ("perlin.seedNoiseGen",po::value<int>()->default_value(3095),"seed noise generation")
-    ("perlin.shiftNoiseGen",po::value<int>()->default_value(11),"shift noise generation seed")
-    ;
+  vtkSmartPointer<vtkIdList> boundaryList3 =
+    vtkSmartPointer<vtkIdList>::New();
 
-  po::options_description boundaryOpt("Boundary noise options");
-  boundaryOpt.add_options()
-    ("boundary.maxDeviation",po::value<double>()->default_value(0.25),"maximum perlin perturbation fraction of radius")
-    ("boundary.frequency",po::value<double>()->default_value(0.2),"starting frequency")
-    ("boundary.lacunarity",po::value<double>()->default_value(1.5),"octave frequency multiplier")
-    ("boundary.persistence",po::value<double>()->default_value(0.5),"octave signal decay")
-    ;
+  int maxThread = omp_get_max_threads();
 
-  po::options_description perturbOpt("Lobule perturbation noise options");
-  perturbOpt.add_options()
-    ("perturb.maxDeviation",po::value<double>()->default_value(0.25),"maximum perlin perturbation fraction of radius")
-    ("perturb.frequency",po::value<double>()->default_value(0.2),"starting frequency")
-    ("perturb.lacunarity",po::value<double>()->default_value(1.5),"octave frequency multiplier")
-    ("perturb.persistence",po::value<double>()->default_value(0.5),"octave signal decay")
-    ;
-	
-  po::options_description bufferOpt("Lobule glandular buffer options");
-  bufferOpt.add_options()
-    ("buffer.maxDeviation",po::value<double>()->default_value(0.1),"maximum perlin buffer fraction of radius")
-    ("buffer.frequency",po::value<double>()->default_value(0.2),"starting frequency")
-    ("buffer.lacunarity",po::value<double>()->default_value(1.5),"octave frequency multiplier")
-    ("buffer.persistence",po::value<double>()->default_value(0.5),"octave signal decay")
-    ;
-	
-  po::options_description voronOpt("Voronoi options");
-  voronOpt.add_options()
-    ("voronoi.fatInFatSeedDensity",po::value<double>()->default_value(0.0),"fat voronoi seed density (mm^-3)")
-    ("voronoi.fatInGlandSeedDensity",po::value<double>()->default_value(0.0),"fat voronoi seed in glandular tissue density (mm^-3)")
-    ("voronoi.glandInGlandSeedDensity",po::value<double>()->default_value(0.0),"glandular voronoi seed density (mm^-3)")
-    ("voronoi.TDLUDeflectMax",po::value<double>()->default_value(0.0),"maximum deflection (fraction of pi)")
-    ("voronoi.minScaleLenTDLU",po::value<double>()->default_value(0.0),"minimum length scale")
-    ("voronoi.maxScaleLenTDLU",po::value<double>()->default_value(0.0),"maximum length scale")
-    ("voronoi.minScaleWidTDLU",po::value<double>()->default_value(0.0),"minimum width scale")
-    ("voronoi.maxScaleWidTDLU",po::value<double>()->default_value(0.0),"maximum width scale")
-    ("voronoi.minStrTDLU",po::value<double>()->default_value(0.0),"minimum strength")
-    ("voronoi.maxStrTDLU",po::value<double>()->default_value(0.0),"maximum strength")
-    ("voronoi.fatInFatDeflectMax",po::value<double>()->default_value(0.15),"maximum deflection (fraction of pi)")
-    ("voronoi.minScaleLenFatInFat",po::value<double>()->default_value(0.0),"minimum length scale")
-    ("voronoi.maxScaleLenFatInFat",po::value<double>()->default_value(0.0),"maximum length scale")
-    ("voronoi.minScaleWidFatInFat",po::value<double>()->default_value(0.0),"minimum width scale")
-    ("voronoi.maxScaleWidFatInFat",po::value<double>()->default_value(0.0),"maximum width scale")
-    ("voronoi.minStrFatInFat",po::value<double>()->default_value(0.0),"minimum strength")
-    ("voronoi.maxStrFatInFat",po::value<double>()->default_value(0.0),"maximum strength")
-    ("voronoi.fatInGlandDeflectMax",po::value<double>()->default_value(0.0),"maximum deflection (fraction of pi)")
-    ("voronoi.minScaleLenFatInGland",po::value<double>()->default_value(0.0),"minimum length scale")
-    ("voronoi.maxScaleLenFatInGland",po::value<double>()->default_value(0.0),"maximum length scale")
-    ("voronoi.minScaleWidFatInGland",po::value<double>()->default_value(0.0),"minimum width scale")
-    ("voronoi.maxScaleWidFatInGland",po::value<double>()->default_value(0.0),"maximum width scale")
-    ("voronoi.minStrFatInGland",po::value<double>()->default_value(0.0),"minimum strength")
-    ("voronoi.maxStrFatInGland",po::value<double>()->default_value(0.0),"maximum strength")
-    ("voronoi.glandInGlandDeflectMax",po::value<double>()->default_value(0.0),"maximum deflection (fraction of pi)")
-    ("voronoi.minScaleLenGlandInGland",po::value<double>()->default_value(0.0),"minimum length scale")
-    ("voronoi.maxScaleLenGlandInGland",po::value<double>()->default_value(0.0),"maximum length scale")
-    ("voronoi.minScaleWidGlandInGland",po::value<double>()->default_value(0.0),"minimum width scale")
-    ("voronoi.maxScaleWidGlandInGland",po::value<double>()->default_value(0.0),"maximum width scale")
-    ("voronoi.minStrGlandInGland",po::value<double>()->default_value(0.0),"minimum strength")
-    ("voronoi.maxStrGlandInGland",po::value<double>()->default_value(0.0),"maximum strength")
-    ("voronoi.seedRadius",po::value<double>()->default_value(10),"check seeds in radius (mm)")
-    ;
+  // boundary sub-lists
+  vtkSmartPointer<vtkIdList> *subList1 = new vtkSmartPointer<vtkIdList>[maxThread];
+  vtkSmartPointer<vtkIdList> *subList2 = new vtkSmartPointer<vtkIdList>[maxThread];
+  vtkSmartPointer<vtkIdList> *subList3 = new vtkSmartPointer<vtkIdList>[maxThread];
+  for(int i=0; i<maxThread; i++){
+    subList1[i] = vtkSmartPointer<vtkIdList>::New();
+    subList2[i] = vtkSmartPointer<vtkIdList>::New();
+    subList3[i] = vtkSmartPointer<vtkIdList>::New();
+  }
 
-  po::options_description fatOpt("Fat lobule options");
-  fatOpt.add_options()
-    ("fat.minLobuleAxis",po::value<double>()->default_value(7.0),"min lobule axis length (mm)")
-    ("fat.maxLobuleAxis",po::value<double>()->default_value(12.0),"max lobule axis length (mm)")
-    ("fat.minAxialRatio",po::value<double>()->default_value(0.33),"min axial ratio")
-    ("fat.maxAxialRatio",po::value<double>()->default_value(0.53),"max axial ratio")
-    ("fat.minLobuleGap",po::value<double>()->default_value(0.2),"minimum ligament separation between lobules")
-    ("fat.maxCoeffStr",po::value<double>()->default_value(0.08),"maximum of absolute value of Fourier coefficient as fraction of main radius")
-    ("fat.minCoeffStr",po::value<double>()->default_value(0.02),"minimum of absolute value of Fourier coefficient as fraction of main radius")
-    ("fat.maxLobuleTry",po::value<int>()->default_value(600),"maximum number of trial lobules")
-    ;
+      #pragma omp parallel num_threads(maxThread)
+  { 
+    int numThread = omp_get_num_threads();
+    int myThread = omp_get_thread_num();
 
-  po::options_description ligOpt("Ligament options");
-  ligOpt.add_options()
-    ("lig.thickness",po::value<double>()->default_value(0.12),"ligament thickness (mm)")
-    ("lig.targetFrac",po::value<double>()->default_value(0.85),"ligamented volume stopping fraction")
-    ("lig.maxTry",po::value<int>()->default_value(15000),"maximum number of ligaments")
-    ("lig.minAxis",po::value<double>()->default_value(15.0),"min lobule axis length (mm)")
-    ("lig.maxAxis",po::value<double>()->default_value(20.0),"max lobule axis length (mm)")
-    ("lig.minAxialRatio",po::value<double>()->default_value(0.3),"min axial ratio")
-    ("lig.maxAxialRatio",po::value<double>()->default_value(0.4),"max axial ratio")
-    ("lig.maxPerturb",po::value<double>()->default_value(0.1),"maximum perlin perturbation fraction of radius")
-    ("lig.maxDeflect",po::value<double>()->default_value(0.12),"maximum deflection from nipple direction (fraction of pi)")
-    ("lig.scale",po::value<double>()->default_value(0.007),"perlin frequency scaling")
-    ("lig.lacunarity",po::value<double>()->default_value(1.8),"octave frequency multiplier")
-    ("lig.persistence",po::value<double>()->default_value(0.6),"octave signal decay")
-    ("lig.numOctaves",po::value<int>()->default_value(6),"number of frequency octaves")
-    ;
+    vtkSmartPointer<vtkPolyData> myPoly =
+      vtkSmartPointer<vtkPolyData>::New();
+    myPoly->DeepCopy(innerPoly);
+ 
+    // Create the tree
+    vtkSmartPointer<vtkCellLocator> innerLocator =
+      vtkSmartPointer<vtkCellLocator>::New();
+    innerLocator->SetDataSet(myPoly);
+    innerLocator->BuildLocator();
 
-  po::options_description ductTreeOpt("Duct tree options");
-  ductTreeOpt.add_options()
-    ("ductTree.maxBranch",po::value<uint>()->default_value(100),"Maximum number of branches")
-    ("ductTree.maxGen",po::value<uint>()->default_value(15),"Maximum generation")
-    ("ductTree.baseLength",po::value<double>()->default_value(7.6),"main branch length (mm)")
-    ("ductTree.initRad",po::value<double>()->default_value(2.0),"tree start radius")
-    ("ductTree.nFillX",po::value<uint>()->default_value(100),"number x voxels for density map")
-    ("ductTree.nFillY",po::value<uint>()->default_value(100),"number y voxels for density map")
-    ("ductTree.nFillZ",po::value<uint>()->default_value(100),"number z voxels for density map")
-    ;
+    // find intersect with top and bottom surface to voxelize breast
+    // iterate over x and y values
+    for(int i=myThread; i<dim[0]; i+=numThread){
+      double xpos = origin[0]+i*spacing[0];
+      int ijk[3];
+      ijk[0] = i;
+      for(int j=0; j<dim[1]; j++){
+      
+	double ypos = origin[1]+j*spacing[1];
+	ijk[1] = j;
+	// calculate z position of top surface
+	double lineStart[3]; // end points of line
+	double lineEnd[3];
+      
+	double tol = 0.005;
+	double tval;
+	vtkIdType intersectCell;
+	int subId;
 
-  po::options_description ductBrOpt("Duct Branch options");
-  ductBrOpt.add_options()
-    ("ductBr.childMinRad",po::value<double>()->default_value(0.25),"min radius to have children")
-    ("ductBr.minRadFrac",po::value<double>()->default_value(0.65),"min start radius as fraction of parent radius")
-    ("ductBr.maxRadFrac",po::value<double>()->default_value(0.99),"max start radius as fraction of parent radius")
-    ("ductBr.lenShrink",po::value<double>()->default_value(0.5),"duct length relative to parent")
-    ("ductBr.lenRange",po::value<double>()->default_value(0.1),"duct length fraction variability")
-    ("ductBr.rotateJitter",po::value<double>()->default_value(0.1),"jitter in azimuthal angle of second child")
-    ;
-  
-  po::options_description ductSegOpt("Duct Segment options");
-  ductSegOpt.add_options()
-    ("ductSeg.radiusBetaA",po::value<double>()->default_value(2.0),"radius distribution shape parameter A")
-    ("ductSeg.radiusBetaB",po::value<double>()->default_value(2.0),"radius distribution shape parameter B")
-    ("ductSeg.maxCurvRad",po::value<double>()->default_value(20.0),"max radius of curvature")
-    ("ductSeg.maxCurvFrac",po::value<double>()->default_value(0.33),"max fraction of circle")
-    ("ductSeg.minEndRad",po::value<double>()->default_value(0.85),"min end radius as fraction of start radius")
-    ("ductSeg.maxEndRad",po::value<double>()->default_value(1.05),"max end radius as fraction of start radius")
-    ("ductSeg.angleWt",po::value<double>()->default_value(1.0),"cost function preferential angle weighting")
-    ("ductSeg.densityWt",po::value<double>()->default_value(5e-5),"cost function density weighting")
-    ("ductSeg.numTry",po::value<uint>()->default_value(10),"number of trial segments")
-    ("ductSeg.maxTry",po::value<uint>()->default_value(100),"max number of trial segments before reducing length")
-    ("ductSeg.absMaxTry",po::value<uint>()->default_value(10000),"max number of trial segments before completely giving up")
-    // check if this needs to be changed
-    ("ductSeg.roiStep",po::value<double>()->default_value(0.1),"step size for checking segment validity")
-    ("ductSeg.segFrac",po::value<double>()->default_value(0.25),"fraction of branch length per segment")
-    ;
-  
-  /* ==========================================================================================
-  Modifications were made in Lines 277 and 278 by Seonyeong Park to improve blood vasculature 
-  modeling for use in optical and optoacoustic imaging.
-  
-  Reference:
-    Seonyeong Park, Umberto Villa, Fu Li, Refik Mert Cam, Alexander A. Oraevsky, Mark A. 
-    Anastasio, "Stochastic three-dimensional numerical phantoms to enable computational studies 
-    in quantitative optoacoustic computed tomography of breast cancer," J. Biomed. Opt. 28(6) 
-    066002 (20 June 2023) https://doi.org/10.1117/1.JBO.28.6.066002
-  ========================================================================================== */
-  po::options_description vesselTreeOpt("Vessel tree options");
-  vesselTreeOpt.add_options()
-    ("vesselTree.maxBranch",po::value<uint>()->default_value(100),"Maximum number of branches")
-    ("vesselTree.maxGen",po::value<uint>()->default_value(15),"Maximum generation")
-    ("vesselTree.baseLength",po::value<double>()->default_value(12.0),"main branch length (mm)")
-    ("vesselTree.initRad",po::value<double>()->default_value(2.0),"tree start radius")
-    ("vesselTree.nFillX",po::value<uint>()->default_value(100),"number x voxels for density map")
-    ("vesselTree.nFillY",po::value<uint>()->default_value(100),"number y voxels for density map")
-    ("vesselTree.nFillZ",po::value<uint>()->default_value(100),"number z voxels for density map")
-    ("vesselTree.vesselEdgeSep1", po::value<double>()->default_value(2), "distance from edge of breast of vessel entry point (mm)")
-    ("vesselTree.vesselEdgeSep2", po::value<double>()->default_value(24), "distance from edge of breast of vessel entry point (mm)");
-    ;
+	double intersect[3]; // output position
+	double pcoords[3];
+      
+	lineStart[0] = xpos;
+	lineStart[1] = ypos;
+	lineStart[2] = baseBound[4];
 
-  po::options_description vesselBrOpt("Vessel branch options");
-  vesselBrOpt.add_options()
-    ("vesselBr.childMinRad",po::value<double>()->default_value(0.25),"min radius to have children")
-    ("vesselBr.minRadFrac",po::value<double>()->default_value(0.6),"min start radius as fraction of parent radius")
-    ("vesselBr.maxRadFrac",po::value<double>()->default_value(0.85),"max start radius as fraction of parent radius")
-    ("vesselBr.lenShrink",po::value<double>()->default_value(0.5),"mean vessel length relative to parent")
-    ("vesselBr.lenRange",po::value<double>()->default_value(0.1),"vessel length fraction variability")
-    ("vesselBr.rotateJitter",po::value<double>()->default_value(0.1),"jitter in azimuthal angle of second child")
+	lineEnd[0] = xpos;
+	lineEnd[1] = ypos;
+	lineEnd[2] = baseBound[5];
 
-    ;
-  
-  po::options_description vesselSegOpt("Vessel segment options");
-  vesselSegOpt.add_options()
-    ("vesselSeg.radiusBetaA",po::value<double>()->default_value(2.0),"radius distribution shape parameter A")
-    ("vesselSeg.radiusBetaB",po::value<double>()->default_value(2.0),"radius distribution shape parameter B")
-    ("vesselSeg.maxCurvRad",po::value<double>()->default_value(20.0),"max radius of curvature")
-    ("vesselSeg.maxCurvFrac",po::value<double>()->default_value(0.33),"max fraction of circle")
-    ("vesselSeg.minEndRad",po::value<double>()->default_value(0.85),"min end radius as fraction of start radius")
-    ("vesselSeg.maxEndRad",po::value<double>()->default_value(1.05),"max end radius as fraction of start radius")
-    ("vesselSeg.angleWt",po::value<double>()->default_value(1.0),"cost function preferential angle weighting")
-    ("vesselSeg.densityWt",po::value<double>()->default_value(5e-5),"cost function density weighting")
-    ("vesselSeg.dirWt",po::value<double>()->default_value(5e-5),"cost function direction weighting")
-    ("vesselSeg.numTry",po::value<uint>()->default_value(10),"number of trial segments")
-    ("vesselSeg.maxTry",po::value<uint>()->default_value(100),"max number of trial segments before reducing length")
-    ("vesselSeg.absMaxTry",po::value<uint>()->default_value(10000),"max number of trial segments before completely giving up")
-    // check if this needs to be changed
-    ("vesselSeg.roiStep",po::value<double>()->default_value(0.1),"step size for checking segment validity")
-    ("vesselSeg.segFrac",po::value<double>()->default_value(0.25),"fraction of branch length per segment")
-    ;
+	if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
+					   tval, intersect, pcoords, subId, intersectCell)){
 
-  // config file options
-  po::options_description configFileOpt("Configuration file options");
-  configFileOpt.add(baseOpt).add(shapeOpt);
-  configFileOpt.add(ductTreeOpt).add(ductBrOpt).add(ductSegOpt);
-  configFileOpt.add(vesselTreeOpt).add(vesselBrOpt).add(vesselSegOpt);
-  configFileOpt.add(compartOpt).add(TDLUOpt).add(fatOpt);
-  configFileOpt.add(voronOpt).add(perlinOpt).add(boundaryOpt);
-  configFileOpt.add(bufferOpt).add(perturbOpt).add(ligOpt);
+	  // found intersection
+	  double topZ = intersect[2];
 
-  // all of the options
-  po::options_description all("All options");
-  all.add_options()
-    ("config,c", po::value<std::string>()->required(), "name of configuration file")
-    ;
-  all.add(configFileOpt);
-  
-  po::variables_map vm;
-  
-  // get configuration filename from command line
-  po::store(parse_command_line(argc,argv,all), vm);
-  std::string configFile = vm["config"].as<std::string>();
-  
-  // read configuration file
-  ifstream inConfig(configFile.c_str());
-  if(!inConfig){
-    cout << "Can not open configuration file: " << configFile << "\n";
-    return(1);
-  } else {
-    po::store(parse_config_file(inConfig, configFileOpt), vm);
-    inConfig.close();
-  };
+	  // do other direction
+	  lineStart[2] = baseBound[5];
+	  lineEnd[2] = baseBound[4];
 
-  // load resolution variables
+	  if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
+					     tval, intersect, pcoords, subId, intersectCell)){
 
-  double ures = vm["shape.ures"].as<double>();	// spacing in u-v space
-  double vres = vm["shape.vres"].as<double>();
-  double pointSep = vm["shape.pointSep"].as<double>(); // remove close points
-  double featureAngle = vm["shape.featureAngle"].as<double>(); // angle to preserve when smoothing
-  double targetReduction = vm["shape.targetReduction"].as<double>(); // fraction of triangles to decimate
-  double imgRes = vm["base.imgRes"].as<double>();	// size of image voxels (mm)
-  double skinThick = vm["base.skinThick"].as<double>(); // thickness of skin (mm)
-  std::string breastVoxelFilename = "breastVoxel.vti";
-  char outVTIFilename[128];
-  char outhdrFilename[128];
-  char outgzFilename[128];
+	    double bottomZ = intersect[2];
+	    
+	    // find nearest voxels to intersections
+	    int indexTop = static_cast<int>(floor((topZ-origin[2])/spacing[2]));
+	    int indexBottom = static_cast<int>(ceil((bottomZ-origin[2])/spacing[2]));
 
+	    // set edge voxels
+	    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,indexTop));
+	    p[0] = boundVal;
+	    ijk[2] = indexTop;
+	    subList1[myThread]->InsertNextId(breast->ComputePointId(ijk));		
+	    p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,indexBottom));
+	    p[0] = boundVal;
+	    ijk[2] = indexBottom;
+	    if(indexBottom != indexTop){
+	      subList1[myThread]->InsertNextId(breast->ComputePointId(ijk));
+	    }
+	    // set voxels between these 2 points to inner value;
+	    for(int k=indexTop+1; k<indexBottom; k++){
+	      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
+	      p[0] = innerVal;
+	    }
+	  }
+	}
+      }
+    }
 
-  double scaleFactor = 35.0;	// scale voxel size to millimeters
+    // find intersect with second set of directions
+    // iterate over x and z values
+    for(int i=myThread; i<dim[0]; i+=numThread){
+      double xpos = origin[0]+i*spacing[0];
+      int ijk[3];
+      ijk[0] = i;
+      for(int j=0; j<dim[2]; j++){
 
-  double nippleLen = vm["base.nippleLen"].as<double>();	// length of nipple (mm)
-  double nippleRad = vm["base.nippleRad"].as<double>(); // radius of nipple (mm)
-  double areolaRad = vm["base.areolaRad"].as<double>(); // radius of areola (mm)
+	double zpos = origin[2]+j*spacing[2];
+	ijk[2] = j;
+	// calculate y position of top surface
+	double lineStart[3]; // end points of line
+	double lineEnd[3];
+      
+	double tol = 0.005;
+	double tval; 
+	vtkIdType intersectCell;
+	int subId;  
 
-  double voxelVol = imgRes*imgRes*imgRes;	// volume of a voxel (cubic mm)
-	
-  tissueStruct tissue;
-	
-  tissue.bg = 0;
-  tissue.skin = 2;
-  tissue.nipple = 33;
-  tissue.fat = 1;
-  tissue.cooper = 88;
-  tissue.gland = 29;
-  tissue.TDLU = 95;
-  tissue.duct = 125;
-  tissue.artery = 150;
-  tissue.vein = 225 ;
-  tissue.muscle = 40;
+	double intersect[3]; // output position
+	double pcoords[3];
 
-  const unsigned char glandBuffer = 222;
-  const unsigned char innerVal = 175; // not needed after compartment creation
-  const unsigned char boundVal = 50;  // edge of inner breast volume, not needed after skin generation
-  
-  const unsigned char compartmentVal[20] = {12, 13, 14, 15, 16,
-					    17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28};
-  
-  const unsigned char compMax = 28;	// max compartment value for cooper's ligament
-  const unsigned char compMin = 12;
+	lineStart[0] = xpos;
+	lineStart[1] = baseBound[2];
+	lineStart[2] = zpos;
 
-  // unligamented tissue classes
-  const unsigned char ufat = 60;
-  const unsigned char ugland = 61;
-  const unsigned char uTDLU = 62;
-  const unsigned char uduct = 63;
+	lineEnd[0] = xpos;
+	lineEnd[1] = baseBound[3];
+	lineEnd[2] = zpos;
 
-  // random number generator seed
-  // use seed specified in config file, otherwise random seed
-  int randSeed;
-  if(vm.count("base.seed")){
-    // seed specified in configuration file
-    randSeed = vm["base.seed"].as<unsigned int>();
-  } else {
-    // generate random seed
-    FILE *randFile;
-    randFile = fopen("/dev/urandom","r");
-    size_t fread_out;
-    fread_out = fread((char*)(&randSeed), sizeof(int),1,randFile);
-    fclose(randFile);
-  }
+	if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
+					   tval, intersect, pcoords, subId, intersectCell)){
 
-  // output base directory
-  std::string outputDir = vm["base.outputDir"].as<std::string>();
-  
-  // exists?
-  if(access(outputDir.c_str(),F_OK)){
-    // directory doesn't exist
-    // try to create it
-    if(mkdir(outputDir.c_str(),S_IRWXU) == -1){
-      // couldn't create directory
-      cerr << "Could not create directory " << outputDir << "\n";
-      cerr << "Exiting...\n";
-      return(1);
-    }
-  }
+	  // found intersection
+	  double topY = intersect[1];
 
-  // is it a directory?
-  struct stat fileInfo;
-  
-  stat(outputDir.c_str(), &fileInfo);
+	  // do other direction
+	  lineStart[1] = baseBound[3];
+	  lineEnd[1] = baseBound[2];
 
-  if(S_ISDIR(fileInfo.st_mode)){
-    // it's a directory
-    // make it the working directory
-    if(chdir(outputDir.c_str()) == -1){
-      cerr << "Could not access directory " << outputDir << "\n";
-      cerr << "Exiting...\n";
-      return(1);
-    }
-  } else {
-    // error, not a directory
-    cerr << "Specified path is not a valid directory\n";
-    cerr << "Exiting...\n";
-    return(1);
-  }
-
-  // copy over config file
-  
-  char cfgOutFilename[128];
-  sprintf(cfgOutFilename,"%s/p_%d.cfg", outputDir.c_str(),randSeed);
-	
-  FILE *cfgCopy = fopen(cfgOutFilename,"wt");
-  FILE *cfgRead = fopen(configFile.c_str(),"rt");
-  
-  int readChar = getc(cfgRead);
-  while(readChar != EOF){
-    putc(readChar, cfgCopy);
-    readChar = getc(cfgRead);
-  }
-  fclose(cfgCopy);
-  fclose(cfgRead);
-
-  sprintf(outVTIFilename,"%s/p_%d.vti", outputDir.c_str(),randSeed);
-  //sprintf(outrawFilename,"%s/p_%d.zraw", outputDir.c_str(),randSeed);
-  sprintf(outhdrFilename,"%s/p_%d.mhd", outputDir.c_str(),randSeed);
-  sprintf(outgzFilename,"%s/p_%d.raw.gz", outputDir.c_str(),randSeed);
-
-  // shape parameters
-
-  // base shape coefficients
-  double a1b =  vm["shape.a1b"].as<double>();
-  double a1t = vm["shape.a1t"].as<double>();
-  double a2l = vm["shape.a2l"].as<double>();
-  double a2r = vm["shape.a2r"].as<double>();
-  double a3 = vm["shape.a3"].as<double>();
-  double eps1 = vm["shape.eps1"].as<double>();
-  double eps2 = vm["shape.eps2"].as<double>();
-
-  // breast side
-  bool leftSide = vm["base.leftBreast"].as<bool>();
-
-  // ptosis parameters
-  bool doPtosis = vm["shape.doPtosis"].as<bool>();
-  double b0 = vm["shape.ptosisB0"].as<double>();
-  double b1 = vm["shape.ptosisB1"].as<double>();
-
-  // turn parameters
-  bool doTurn = vm["shape.doTurn"].as<bool>();
-  double c0 = vm["shape.turnC0"].as<double>();
-  double c1 = vm["shape.turnC1"].as<double>();
-
-  // top shape parameters
-  bool doTopShape = vm["shape.doTopShape"].as<bool>();
-  double s0 = vm["shape.topShapeS0"].as<double>();
-  double t0 = vm["shape.topShapeT0"].as<double>();
-  double s1 = vm["shape.topShapeS1"].as<double>();
-  double t1 = vm["shape.topShapeT1"].as<double>();
+	  if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
+					     tval, intersect, pcoords, subId, intersectCell)){
+	    
+	    double bottomY = intersect[1];
 
-  // derived top shape parameters
-  double At = -0.5*t0-3.0*s0-3.0*s1+0.5*t1;
-  double Bt = 1.5*t0+8.0*s0+7.0*s1-t1;
-  double Ct = -1.5*t0-6.0*s0-4.0*s1+0.5*t1;
-  double Dt = 0.5*t0;
-  double Et = s0;
-  double Ft = 1.0;
+	    // find nearest voxels to intersections
+	    int indexTop = static_cast<int>(floor((topY-origin[1])/spacing[1]));
+	    int indexBottom = static_cast<int>(ceil((bottomY-origin[1])/spacing[1]));
+	    
+	    // set edge voxels
+	    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,indexTop,j));
+	    p[0] = boundVal;
+	    ijk[1] = indexTop;
+	    subList2[myThread]->InsertNextId(breast->ComputePointId(ijk));
+	    p = static_cast<unsigned char*>(breast->GetScalarPointer(i,indexBottom,j));
+	    p[0] = boundVal;
+	    ijk[1] = indexBottom;
+	    if(indexBottom != indexTop){
+	      subList2[myThread]->InsertNextId(breast->ComputePointId(ijk));
+	    }
+	    // set voxels between these 2 points to inner value;
+	    for(int k=indexTop+1; k<indexBottom; k++){
+	      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,k,j));
+	      // only change if not boundary
+	      if(p[0] != boundVal){
+		p[0] = innerVal;
+	      }
+	    }
+	  }
+	}
+      }
+    }
 
-  // flatten side parameters
-  bool doFlattenSide = vm["shape.doFlattenSide"].as<bool>();
-  double g0 = vm["shape.flattenSideG0"].as<double>();
-  double g1 = vm["shape.flattenSideG1"].as<double>();
+    // find intersect with final set of directions
+    // iterate over y and z values
+    for(int i=myThread; i<dim[1]; i+=numThread){
+      double ypos = origin[1]+i*spacing[1];
+      int ijk[3];
+      ijk[1] = i;
+      for(int j=0; j<dim[2]; j++){
+      
+	double zpos = origin[2]+j*spacing[2];
+	ijk[2] = j;
+      
+	// calculate x position of top surface
+	double lineStart[3]; // end points of line
+	double lineEnd[3];
+      
+	double tol = 0.005;
+	double tval; 
+	vtkIdType intersectCell;
+	int subId; 
 
-  // derived parameters for flatten side
-  double Af = g1+2.0-2.0*g0;
-  double Bf = -g1-3.0+3.0*g0;
-  double Cf = 0.0;
-  double Df = 1.0;
+	double intersect[3]; // output position
+	double pcoords[3];
 
-  // turn top parameters
-  bool doTurnTop = vm["shape.doTurnTop"].as<bool>();
-  double h0 = vm["shape.turnTopH0"].as<double>();
-  double h1 = vm["shape.turnTopH1"].as<double>();
+	lineStart[0] = baseBound[0];
+	lineStart[1] = ypos;
+	lineStart[2] = zpos;
 
-  // start a random number generator
-  vtkSmartPointer<vtkMinimalStandardRandomSequence> rgen =
-    vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+	lineEnd[0] = baseBound[1];;
+	lineEnd[1] = ypos;
+	lineEnd[2] = zpos;
 
-  rgen->SetSeed(randSeed);
+	if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
+					   tval, intersect, pcoords, subId, intersectCell)){
+	
+	  // found intersection
+	  double topX = intersect[0];
 
-  /***********************
-	Shape
-  ***********************/
+	  // do other direction
+	  lineStart[0] = baseBound[1];
+	  lineEnd[0] = baseBound[0];
 
-  // create base shape
-  // point positions
-  double uval,vval,xval,yval,zval;
-  vtkIdType myId;
-  
-  vtkSmartPointer<vtkPoints> brightFront =
-    vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkPoints> brightBack =
-    vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkPoints> brightRing =
-    vtkSmartPointer<vtkPoints>::New();
-		
-  vtkSmartPointer<vtkPoints> trightFront =
-    vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkPoints> trightBack =
-    vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkPoints> trightRing =
-    vtkSmartPointer<vtkPoints>::New();
+	  if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
+					     tval, intersect, pcoords, subId, intersectCell)){
+	  
+	    double bottomX = intersect[0];
+	  
+	    // find nearest voxels to intersections
+	    int indexTop = static_cast<int>(floor((topX-origin[0])/spacing[0]));
+	    indexTop = (indexTop < 0) ? 0 : indexTop; 
+	    int indexBottom = static_cast<int>(ceil((bottomX-origin[0])/spacing[0]));
+	    indexBottom = (indexBottom > dim[0]-1) ? dim[0]-1 : indexBottom;
+	    indexBottom = (indexBottom < 0) ? 0 : indexBottom;
 
-  vtkSmartPointer<vtkPoints> tleftFront =
-    vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkPoints> tleftBack =
-    vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkPoints> tleftRing =
-    vtkSmartPointer<vtkPoints>::New();
-	
-  vtkSmartPointer<vtkPoints> bleftFront =
-    vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkPoints> bleftBack =
-    vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkPoints> bleftRing =
-    vtkSmartPointer<vtkPoints>::New();
-	
-  vtkIdType centerPt;
-	
-#pragma omp sections private(uval,vval,xval,yval,zval,myId)
+	    // set edge voxels on front side only
+	    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(indexBottom,i,j));
+	    p[0] = boundVal;
+	    ijk[0] = indexBottom;
+	    subList3[myThread]->InsertNextId(breast->ComputePointId(ijk));
+	    // set voxels between these 2 points to inner value;
+	    for(int k=indexTop+1; k<indexBottom; k++){
+	      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(k,i,j));
+	      // only change if not boundary
+	      if(p[0] != boundVal){
+		p[0] = innerVal;
+	      }
+	    }
+	  }
+	}
+      }
+    }
+  }
+	    
+  // combine lists
+      #pragma omp parallel sections
   {
-#pragma omp section
+      #pragma omp section
     {
-      // bottom right breast
-      vval = -1.0*pi + vres;
-      while(vval <= -0.5*pi){
-	uval = 0.0;
-	// ring is uval == 0
-	xval = 0.0;
-	yval = pow(a2r,eps1)*pow(sin(vval),eps2);
-	zval = pow(a1b,eps1)*pow(cos(vval),eps2);
-	myId = brightRing->InsertNextPoint(xval,yval,zval);
-	uval += ures;
-			
-	while(uval <= 0.5*pi){
-	  xval = pow(a3*sin(uval),eps1);
-	  yval = pow(a2r*cos(uval),eps1)*pow(sin(vval),eps2);
-	  zval = pow(a1b*cos(uval),eps1)*pow(cos(vval),eps2);
-	  // add point to front
-	  myId = brightFront->InsertNextPoint(xval,yval,zval);
-	  // add backplane point
-	  myId = brightBack->InsertNextPoint(0.0,yval,zval);
-	  uval += ures;
+      vtkIdType nList1;
+      vtkIdType c1 = 0;
+      nList1 = subList1[0]->GetNumberOfIds();
+      for(int i=1; i<maxThread; i++){
+	nList1 += subList1[i]->GetNumberOfIds();
+      }
+      boundaryList1->SetNumberOfIds(nList1);
+      for(int i=0; i<maxThread; i++){
+	int numPts = subList1[i]->GetNumberOfIds();
+	for(int j=0; j<numPts; j++){
+	  boundaryList1->InsertId(c1,subList1[i]->GetId(j));
+	  c1++;
 	}
-	vval += vres;
       }
-	
-      // add center point to bottom-right breast front and back and skip
-      centerPt = brightFront->InsertNextPoint(pow(a3,eps1),0.0,0.0);
-      centerPt = brightBack->InsertNextPoint(0.0,0.0,0.0);
+      vtkSortDataArray::Sort(boundaryList1);
     }
-    
-#pragma omp section
+      #pragma omp section
     {
-      // top right breast
-      
-      vval = -0.5*pi + vres;
-      while(vval <= 0.0){
-	uval = 0.0;
-	xval = 0.0;
-	yval = pow(a2r,eps1)*pow(sin(vval),eps2);
-	zval = pow(a1t,eps1)*pow(cos(vval),eps2);
-	myId = trightRing->InsertNextPoint(xval,yval,zval);
-	uval += ures;
-			
-	while(uval <= 0.5*pi){
-	  xval = pow(a3*sin(uval),eps1);
-	  yval = pow(a2r*cos(uval),eps1)*pow(sin(vval),eps2);
-	  zval = pow(a1t*cos(uval),eps1)*pow(cos(vval),eps2);
-	  // add the point
-	  myId = trightFront->InsertNextPoint(xval,yval,zval);
-	  // add backplane point
-	  myId = trightBack->InsertNextPoint(0.0,yval,zval);
-	  uval += ures;
+      vtkIdType nList2;
+      vtkIdType c2 = 0;
+      nList2 = subList2[0]->GetNumberOfIds();
+      for(int i=1; i<maxThread;i++){
+	nList2 += subList2[i]->GetNumberOfIds();
+      }
+      boundaryList2->SetNumberOfIds(nList2);
+      for(int i=0; i<maxThread; i++){
+	int numPts = subList2[i]->GetNumberOfIds();
+	for(int j=0; j<numPts; j++){
+	  boundaryList2->InsertId(c2,subList2[i]->GetId(j));
+	  c2++;
 	}
-	vval += vres;
       }
+      vtkSortDataArray::Sort(boundaryList2);
     }
-		
-#pragma omp section
+      #pragma omp section
     {
-      // top left breast
-		
-      vval = 0.0 + vres;
-      while(vval <= 0.5*pi){
-	uval = 0.0;
-	xval = 0.0;
-	yval = pow(a2l,eps1)*pow(sin(vval),eps2);
-	zval = pow(a1t,eps1)*pow(cos(vval),eps2);
-	myId = tleftRing->InsertNextPoint(xval,yval,zval);
-	uval += ures;
-	
-	while(uval <= 0.5*pi){
-	  xval = pow(a3*sin(uval),eps1);
-	  yval = pow(a2l*cos(uval),eps1)*pow(sin(vval),eps2);
-	  zval = pow(a1t*cos(uval),eps1)*pow(cos(vval),eps2);
-	  // add the point
-	  myId = tleftFront->InsertNextPoint(xval,yval,zval);
-	  // add backplane point
-	  myId = tleftBack->InsertNextPoint(0.0,yval,zval);
-	  uval += ures;
+      vtkIdType nList3;
+      vtkIdType c3 = 0;
+      nList3 = subList3[0]->GetNumberOfIds();
+      for(int i=1; i<maxThread;i++){
+	nList3 += subList3[i]->GetNumberOfIds();
+      }
+      boundaryList3->SetNumberOfIds(nList3);
+      for(int i=0; i<maxThread; i++){
+	int numPts = subList3[i]->GetNumberOfIds();
+	for(int j=0; j<numPts; j++){
+	  boundaryList3->InsertId(c3,subList3[i]->GetId(j));
+	  c3++;
 	}
-	vval += vres;
       }
+      vtkSortDataArray::Sort(boundaryList3);
     }
+  }
 
-#pragma omp section
-    {
-      // bottom left breast
-      
-      vval = 0.5*pi + vres;
-      while(vval <= pi){
-	uval = 0.0;
-	xval = 0.0;
-	yval = pow(a2l,eps1)*pow(sin(vval),eps2);
-	zval = pow(a1b,eps1)*pow(cos(vval),eps2);
-	myId = bleftRing->InsertNextPoint(xval,yval,zval);
-	uval += ures;
-			
-	while(uval <= 0.5*pi){
-	  xval = pow(a3*sin(uval),eps1);
-	  yval = pow(a2l*cos(uval),eps1)*pow(sin(vval),eps2);
-	  zval = pow(a1b*cos(uval),eps1)*pow(cos(vval),eps2);
-	  // add the point
-	  myId = bleftFront->InsertNextPoint(xval,yval,zval);
-	  // add backplane point
-	  myId = bleftBack->InsertNextPoint(0.0,yval,zval);
-	  uval += ures;
+  vtkIdType nList1 = boundaryList1->GetNumberOfIds();
+  vtkIdType nList2 = boundaryList2->GetNumberOfIds();
+  vtkIdType nList3 = boundaryList3->GetNumberOfIds();
+
+  vtkIdType* pList1 = boundaryList1->GetPointer(0);
+  vtkIdType* pList2 = boundaryList2->GetPointer(0);
+  vtkIdType* pList3 = boundaryList3->GetPointer(0);
+
+  vtkIdType cList1 = 0;
+  vtkIdType cList2 = 0;
+  vtkIdType cList3 = 0;
+
+  bool dList1 = false;
+  bool dList2 = false;
+  bool dList3 = false;
+
+  while(!dList1 || !dList2 || !dList3){
+    vtkIdType curMin;
+    if(!dList1){
+      curMin = *pList1;
+      if(!dList2){
+	curMin = *pList2 < curMin ? *pList2 : curMin;
+	if(!dList3){
+	  curMin = *pList3 < curMin ? *pList3 : curMin;
+	  // check 1,2,3
+	  boundaryList->InsertNextId(curMin);
+	  while(*pList1 == curMin && !dList1){
+	    cList1++;
+	    if(cList1 < nList1){
+	      pList1++;
+	    } else {
+	      dList1 = true;
+	    }
+	  }
+	  while(*pList2 == curMin && !dList2){
+	    cList2++;
+	    if(cList2 < nList2){
+	      pList2++;
+	    } else {
+	      dList2 = true;
+	    }
+	  }
+	  while(*pList3 == curMin && !dList3){
+	    cList3++;
+	    if(cList3 < nList3){
+	      pList3++;
+	    } else {
+	      dList3 = true;
+	    }
+	  }
+	} else {
+	  // check 1,2
+	  boundaryList->InsertNextId(curMin);
+	  while(*pList1 == curMin && !dList1){
+	    cList1++;
+	    if(cList1 <nList1){
+	      pList1++;
+	    } else {
+	      dList1 = true;
+	    }
+	  }
+	  while(*pList2 == curMin && !dList2){
+	    cList2++;
+	    if(cList2 <nList2){
+	      pList2++;
+	    } else {
+	      dList2 = true;
+	    }
+	  }
+	}
+      } else {
+	if(!dList3){
+	  curMin = *pList3 < curMin ? *pList3 : curMin;
+	  // check 1,3
+	  boundaryList->InsertNextId(curMin);
+	  while(*pList1 == curMin && !dList1){
+	    cList1++;
+	    if(cList1 <nList1){
+	      pList1++;
+	    } else {
+	      dList1 = true;
+	    }
+	  }
+	  while(*pList3 == curMin && !dList3){
+	    cList3++;
+	    if(cList3 < nList3){
+	      pList3++;
+	    } else {
+	      dList3 = true;
+	    }
+	  }
+	} else {
+	  // check 1
+	  boundaryList->InsertNextId(curMin);
+	  while(*pList1 == curMin && !dList1){
+	    cList1++;
+	    if(cList1 <nList1){
+	      pList1++;
+	    } else {
+	      dList1 = true;
+	    }
+	  }
+	}
+      }
+    } else {
+      // 1 done
+      if(!dList2){
+	curMin = *pList2;
+	if(!dList3){
+	  curMin = *pList3 < curMin ? *pList3 : curMin;
+	  // check 2,3
+	  boundaryList->InsertNextId(curMin);
+	  while(*pList2 == curMin && !dList2){
+	    cList2++;
+	    if(cList2 <nList2){
+	      pList2++;
+	    } else {
+	      dList2 = true;
+	    }
+	  }
+	  while(*pList3 == curMin && !dList3){
+	    cList3++;
+	    if(cList3 < nList3){
+	      pList3++;
+	    } else {
+	      dList3 = true;
+	    }
+	  }
+	} else {
+	  // check 2
+	  boundaryList->InsertNextId(curMin);
+	  while(*pList2 == curMin && !dList2){
+	    cList2++;
+	    if(cList2 <nList2){
+	      pList2++;
+	    } else {
+	      dList2 = true;
+	    }
+	  }
+	}
+      } else {
+	// only 3 left
+	curMin = *pList3;
+	boundaryList->InsertNextId(curMin);
+	while(*pList3 == curMin && !dList3){
+	  cList3++;
+	  if(cList3 < nList3){
+	    pList3++;
+	  } else {
+	    dList3 = true;
+	  }
 	}
-	vval += vres;
       }
     }
+  }
+	    
+  // delete array subList
+  delete [] subList1;
+  delete [] subList2;
+  delete [] subList3;
 
-  }  // end omp sections
-	
-  // have base shape
-  // do deformations
+  //cout << "done.\n";
 
-  // top shape
-  if(doTopShape){
-    vtkIdType npts = trightFront->GetNumberOfPoints();
-    uval = ures; // need original u value
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      double u2 = uval*2.0/pi;
-      // front
-      trightFront->GetPoint(i, pval);
-      pval[2] = pval[2]*(At*pow(u2,5.0)+Bt*pow(u2,4.0)+
-			 Ct*pow(u2,3.0)+Dt*u2*u2+Et*u2+Ft);
-      trightFront->SetPoint(i,pval);
-      // back
-      trightBack->GetPoint(i, pval);
-      pval[2] = pval[2]*(At*pow(u2,5.0)+Bt*pow(u2,4.0)+
-			 Ct*pow(u2,3.0)+Dt*u2*u2+Et*u2+Ft);
-      trightBack->SetPoint(i,pval);
-      
-      uval += ures;
-      if(uval > 0.5*pi){
-	uval = ures;
-      }
-    }
-		
-    // ring
-    npts = trightRing->GetNumberOfPoints();
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      trightRing->GetPoint(i, pval);
-      pval[2] = pval[2]*Ft;
-      trightRing->SetPoint(i,pval);
+  // correct boundary list to be all boundary values 
+  vtkIdType dnum = boundaryList->GetNumberOfIds();
+  for(vtkIdType i=0; i<dnum; i++){
+    double loc[3];
+    int ijk[3];
+    double pcoords[3];
+    breast->GetPoint(boundaryList->GetId(i),loc);
+    breast->ComputeStructuredCoordinates(loc,ijk,pcoords);
+    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(ijk));
+    if(p[0] != boundVal){
+      p[0] = boundVal;
     }
-		
-    npts = tleftFront->GetNumberOfPoints();
-    uval = ures; // need original u value
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      double u2 = uval*2.0/pi;
-      // front
-      tleftFront->GetPoint(i, pval);
-      pval[2] = pval[2]*(At*pow(u2,5.0)+Bt*pow(u2,4.0)+
-			 Ct*pow(u2,3.0)+Dt*u2*u2+Et*u2+Ft);
-      tleftFront->SetPoint(i,pval);
-      // back
-      tleftBack->GetPoint(i, pval);
-      pval[2] = pval[2]*(At*pow(u2,5.0)+Bt*pow(u2,4.0)+
-			 Ct*pow(u2,3.0)+Dt*u2*u2+Et*u2+Ft);
-      tleftBack->SetPoint(i,pval);
-			
-      uval += ures;
-      if(uval > 0.5*pi){
-	uval = ures;
+  }
+
+  /***********************
+	Skin
+  ***********************/
+
+  // create list of surrounding voxels to check
+  vtkSmartPointer<vtkIntArray> checkVoxels =
+    vtkSmartPointer<vtkIntArray>::New();
+
+  checkVoxels->SetNumberOfComponents(3);
+
+  int voxelThick = (int)ceil(skinThick/imgRes);
+
+  for(int i=-1*voxelThick; i<=voxelThick; i++){
+    for(int j=-1*voxelThick; j<=voxelThick; j++){
+      for(int k=-1*voxelThick; k<=voxelThick; k++){
+	if(sqrt((double)(i*i+j*j+k*k))*imgRes <= skinThick){
+	  // found a voxel to check
+	  checkVoxels->InsertNextTuple3(i,j,k);
+	}
       }
     }
-		
-    // ring
-    npts = tleftRing->GetNumberOfPoints();
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      tleftRing->GetPoint(i, pval);
-      pval[2] = pval[2]*Ft;
-      tleftRing->SetPoint(i,pval);
-    }				
   }
-	
-  // flatten side
-  if(doFlattenSide){
-    if(leftSide){
-      trightFront->ComputeBounds();
-      double bound[6];
-      trightFront->GetBounds(bound);
-      double scale;
-      if(fabs(bound[2]) > fabs(bound[3])){
-	scale = fabs(bound[2]);
-      } else {
-	scale = fabs(bound[3]);
-      }
-      vtkIdType npts = trightFront->GetNumberOfPoints();
-#pragma omp parallel for
-      for(int i=0; i<npts; i++){
-	double pval[3];
-	// front
-	trightFront->GetPoint(i,pval);
-	double yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	trightFront->SetPoint(i,pval);
-	// back
-	trightBack->GetPoint(i,pval);
-	yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	trightBack->SetPoint(i,pval);
-      }
-      // ring
-      npts = trightRing->GetNumberOfPoints();
-#pragma omp parallel for
-      for(int i=0; i<npts; i++){
-	double pval[3];
-	trightRing->GetPoint(i,pval);
-	double yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	trightRing->SetPoint(i,pval);
-      }
-						
-      brightFront->ComputeBounds();
-      brightFront->GetBounds(bound);
-      if(fabs(bound[2]) > fabs(bound[3])){
-	scale = fabs(bound[2]);
+
+  vtkIdType numCheck = checkVoxels->GetNumberOfTuples();
+
+  // breast volume in voxels
+  long long int breastVoxVol = 0;
+
+  // only add skin for x>0
+  int minSkinXVox = static_cast<int>(ceil(-origin[0]/imgRes));
+  int areolaVoxel = static_cast<int>(ceil(areolaRad/imgRes));
+
+  // add skin thickness near nipple
+  double skinThick2 = skinThick*2.0;
+
+  // find point on mesh closest to center
+  vtkSmartPointer<vtkPointLocator> locator =
+    vtkSmartPointer<vtkPointLocator>::New();
+  locator->SetDataSet(innerPoly);
+  locator->BuildLocator();
+
+  vtkIdType nipplePt;
+  nipplePt = locator->FindClosestPoint(nipplePos);
+
+  int nippleVoxel[3];   // coordinates of nipple base
+  double nipplePCoords[3]; // parametric coordinates
+  breast->ComputeStructuredCoordinates(nipplePos,nippleVoxel,nipplePCoords);
+
+  // iterate over boundary voxel list, grow skin
+  vtkIdType nCurBoundary = boundaryList->GetNumberOfIds();
+
+
+  maxThread = omp_get_max_threads();
+
+      #pragma omp parallel for num_threads(maxThread)
+  for(vtkIdType i=0; i<nCurBoundary; i++){
+    int myThread = omp_get_thread_num();
+    vtkIdType myId = boundaryList->GetId(i);
+    double loc[3];
+    double pcoords[3];
+    int ijk[3];
+    breast->GetPoint(myId, loc);
+    breast->ComputeStructuredCoordinates(loc, ijk, pcoords);
+
+    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(ijk));
+    
+    if(ijk[0] >= minSkinXVox){
+      double nipDist2 = vtkMath::Distance2BetweenPoints(loc,nipplePos);
+      if(nipDist2 > 4*areolaRad*areolaRad){
+	// boundary voxel for skinning
+	for(vtkIdType m=0; m<numCheck; m++){
+	  double offset[3];
+	  checkVoxels->GetTuple(m,offset);
+	  int a,b,c;
+	  a = ijk[0]+(int)offset[0];
+	  b = ijk[1]+(int)offset[1];
+	  c = ijk[2]+(int)offset[2];
+	  if(a>=breastExtent[0] && a<=breastExtent[1] && b>=breastExtent[2] && b<=breastExtent[3] &&
+	     c>=breastExtent[4] && c<=breastExtent[5]){
+	    unsigned char* q =
+	      static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
+	    if(q[0] == tissue.bg){
+      #pragma omp atomic write
+	      q[0] = tissue.skin;
+	    }
+	  }
+	}
       } else {
-	scale = fabs(bound[3]);
-      }
-      npts = brightFront->GetNumberOfPoints();
-#pragma omp parallel for
-      for(int i=0; i<npts; i++){
-	double pval[3];
-	//front
-	brightFront->GetPoint(i,pval);
-	double yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	brightFront->SetPoint(i,pval);
-	// back
-	brightBack->GetPoint(i,pval);
-	yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	brightBack->SetPoint(i,pval);
+	// areola
+	double mySkinThick = skinThick + (skinThick2-skinThick)/(1+exp(12/areolaRad*(sqrt(nipDist2)-areolaRad)));
+	int mySearchRad = static_cast<int>(ceil(mySkinThick/imgRes));
+	for(int a=ijk[0]-mySearchRad; a<=ijk[0]+mySearchRad; a++){
+	  for(int b=ijk[1]-mySearchRad; b<=ijk[1]+mySearchRad; b++){
+	    for(int c=ijk[2]-mySearchRad; c<=ijk[2]+mySearchRad; c++){
+	      unsigned char* q = static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
+	      if(q[0] == tissue.bg){
+		// check distance                                                                                                                                                                                                
+		double skinDist = imgRes*sqrt(static_cast<double>((a-ijk[0])*(a-ijk[0])+(b-ijk[1])*(b-ijk[1])+(c-ijk[2])*(c-ijk[2])));
+		if(skinDist <= mySkinThick){
+      #pragma omp atomic write
+		  q[0] = tissue.skin;
+		}
+	      }
+	    }
+	  }
+	}
       }
-      // ring
-      npts = brightRing->GetNumberOfPoints();
-#pragma omp parallel for
-      for(int i=0; i<npts; i++){
-	double pval[3];
-	brightRing->GetPoint(i,pval);
-	double yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	brightRing->SetPoint(i,pval);
-      }
-    } else {
-      // right side
-      tleftFront->ComputeBounds();
-      double bound[6];
-      tleftFront->GetBounds(bound);
-      double scale;
-      if(fabs(bound[2]) > fabs(bound[3])){
-	scale = fabs(bound[2]);
-      } else {
-	scale = fabs(bound[3]);
-      }
-      vtkIdType npts = tleftFront->GetNumberOfPoints();
-#pragma omp parallel for
-      for(int i=0; i<npts; i++){
-	double pval[3];
-	// front
-	tleftFront->GetPoint(i,pval);
-	double yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	tleftFront->SetPoint(i,pval);
-	// back
-	tleftBack->GetPoint(i,pval);
-	yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	tleftBack->SetPoint(i,pval);
-      }
-      // ring
-      npts = tleftRing->GetNumberOfPoints();
-#pragma omp parallel for
-      for(int i=0; i<npts; i++){
-	double pval[3];
-	tleftRing->GetPoint(i,pval);
-	double yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	tleftRing->SetPoint(i,pval);
-      }
-      
-      bleftFront->ComputeBounds();
-      bleftFront->GetBounds(bound);
-      if(fabs(bound[2]) > fabs(bound[3])){
-	scale = fabs(bound[2]);
-      } else {
-	scale = fabs(bound[3]);
-      }
-      npts = bleftFront->GetNumberOfPoints();
-#pragma omp parallel for
-      for(int i=0; i<npts; i++){
-	double pval[3];
-	// front
-	bleftFront->GetPoint(i,pval);
-	double yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	bleftFront->SetPoint(i,pval);
-	// back
-	bleftBack->GetPoint(i,pval);
-	yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	bleftBack->SetPoint(i,pval);
-      }
-      // ring
-      npts = bleftRing->GetNumberOfPoints();
-      //#pragma omp parallel for
-      for(int i=0; i<npts; i++){
-	double pval[3];
-	bleftRing->GetPoint(i,pval);
-	double yv = fabs(pval[1]/scale);
-	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
-			   Cf*yv + Df);
-	bleftRing->SetPoint(i,pval);
+    }
+    p[0] = innerVal;
+  }
+
+  // calculate inner volume and correct border errors
+      #pragma omp parallel for schedule(static) reduction(+:breastVoxVol)
+  for(int k=0; k<dim[2]; k++){
+    int ijk[3];
+    ijk[2] = k;
+    for(int j=0; j<dim[1]; j++){
+      ijk[1] = j;
+      for(int i=0; i<dim[0]; i++){
+	ijk[0] = i;
+	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(ijk));
+	if(p[0] == innerVal){
+	  breastVoxVol += 1;
+	} else {
+	  if(p[0] == boundVal){
+	    p[0] = innerVal;
+	    breastVoxVol += 1;
+	  }
+	}
       }
     }
   }
+
+  breastVol = (double)breastVoxVol*pow(imgRes,3.0);
+
+  //cout << "Breast volume: " << breastVol/1000 << " cc ("<< breastVoxVol << " voxels).\n";
+
+  /***********************
+	Nipple
+  **********************/
+
+  // create nipple structure
+  //cout << "Creating nipple structure...";
+
+  // squared radius
+  double nippleRad2 = nippleRad*nippleRad;
 	
-  // turn top
-  if(doTurnTop){
-    trightFront->ComputeBounds();
-    double bound[6];
-    trightFront->GetBounds(bound);
-    double scale;
-    if(fabs(bound[4]) > fabs(bound[5])){
-      scale = fabs(bound[4]);
-    } else {
-      scale = fabs(bound[5]);
-    }
-    vtkIdType npts = trightFront->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      // front
-      trightFront->GetPoint(i,pval);
-      pval[1] = pval[1] - h0*pval[2]/scale -
-	h1*pval[2]*pval[2]/scale/scale;
-      trightFront->SetPoint(i,pval);
-      // back
-      trightBack->GetPoint(i,pval);
-      pval[1] = pval[1] - h0*pval[2]/scale -
-	h1*pval[2]*pval[2]/scale/scale;
-      trightBack->SetPoint(i,pval);
+  // extract normal
+  vtkSmartPointer<vtkFloatArray> normals2 =
+    vtkFloatArray::SafeDownCast(innerPoly->GetPointData()->GetNormals());
+
+  normals2->GetTuple(nipplePt, nippleNorm);
+  double nippleNormLen = sqrt(nippleNorm[0]*nippleNorm[0] +
+			      nippleNorm[1]*nippleNorm[1] + nippleNorm[2]*nippleNorm[2]);
+  for(int i=0; i<3; i++){
+    nippleNorm[i] = nippleNorm[i]/nippleNormLen;
+  }
+  // nippleNorm may be inward pointing
+  if(nippleNorm[0] < 0.0){
+    for(int i=0; i<3; i++){
+      nippleNorm[i] = -1.0*nippleNorm[i];
     }
-    // ring
-    npts = trightRing->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      trightRing->GetPoint(i,pval);
-      pval[1] = pval[1] - h0*pval[2]/scale -
-	h1*pval[2]*pval[2]/scale/scale;
-      trightRing->SetPoint(i,pval);
+  }
+
+  // create nipple
+
+  // nipple function
+  // superquadric (rad/nippleRad)^t+abs(len/nippleLen)^t <= 1 t = 2.5 - 8
+  double nippleShape = 3.0;
+  
+  double searchRad = sqrt(2*nippleRad*nippleRad+nippleLen*nippleLen);
+
+  int searchSpace[6];	// search region for nipple
+  searchSpace[0] = nippleVoxel[0] - (int)ceil(searchRad/spacing[0]);
+  if(searchSpace[0] < breastExtent[0]){
+    searchSpace[0] = breastExtent[0];
+  }
+  searchSpace[1] = nippleVoxel[0] + (int)ceil(searchRad/spacing[0]);
+  if(searchSpace[1] > breastExtent[1]){
+    searchSpace[1] = breastExtent[1];
+  }
+  searchSpace[2] = nippleVoxel[1] - (int)ceil(searchRad/spacing[1]);
+  if(searchSpace[2] < breastExtent[2]){
+    searchSpace[2] = breastExtent[2];
+  }
+  searchSpace[3] = nippleVoxel[1] + (int)ceil(searchRad/spacing[1]);
+  if(searchSpace[3] > breastExtent[3]){
+    searchSpace[3] = breastExtent[3];
+  }
+  searchSpace[4] = nippleVoxel[2] - (int)ceil(searchRad/spacing[2]);
+  if(searchSpace[4] < breastExtent[4]){
+    searchSpace[4] = breastExtent[4];
+  }
+  searchSpace[5] = nippleVoxel[2] + (int)ceil(searchRad/spacing[2]);
+  if(searchSpace[5] > breastExtent[5]){
+    searchSpace[5] = breastExtent[5];
+  }
+
+      #pragma omp parallel for
+  for(int i=searchSpace[0]; i<= searchSpace[1]; i++){
+    for(int j=searchSpace[2]; j<= searchSpace[3]; j++){
+      for(int k=searchSpace[4]; k<= searchSpace[5]; k++){
+	// search cube, project onto normal and check if in nipple bound
+	// only if outside breast interior
+	unsigned char* q =
+	  static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
+	if(q[0] != innerVal){ // not in interior
+	  // get id for point
+	  vtkIdType id;
+	  int coord[3];
+	  coord[0] = i;
+	  coord[1] = j;
+	  coord[2] = k;
+	  id = breast->ComputePointId(coord);
+	  // get spatial coordinates of point
+	  double pos[3];
+	  breast->GetPoint(id,pos);
+	  // compute distance to nipple line and length along line
+	  double dist=0.0;
+	  double len=0.0;
+	  // project onto nipple line
+	  for(int m=0; m<3; m++){
+	    len += nippleNorm[m]*(pos[m]-nipplePos[m]);
+	  }
+	  // distance from nipple line
+	  for(int m=0; m<3; m++){
+	    dist += (pos[m]-nipplePos[m]-len*nippleNorm[m])*(pos[m]-nipplePos[m]-len*nippleNorm[m]);
+	  }
+	  dist = sqrt(dist);
+	  
+	  if(pow(dist/nippleRad,nippleShape)+pow(fabs(len)/nippleLen,nippleShape) <= 1.0){
+	    q[0] = tissue.nipple;
+	  }
+	}
+      }
     }
+  }
+
+  // add chest muscle
+
+      #pragma omp parallel for  
+  for(int j=0; j<dim[1]; j++){
+	
+    int muscleThick;
 		
-    tleftFront->ComputeBounds();
-    tleftFront->GetBounds(bound);
-    if(fabs(bound[4]) > fabs(bound[5])){
-      scale = fabs(bound[4]);
-    } else {
-      scale = fabs(bound[5]);
-    }
-    npts = tleftFront->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      // front
-      tleftFront->GetPoint(i,pval);
-      pval[1] = pval[1] - h0*pval[2]/scale -
-	h1*pval[2]*pval[2]/scale/scale;
-      tleftFront->SetPoint(i,pval);
-      // back
-      tleftBack->GetPoint(i,pval);
-      pval[1] = pval[1] - h0*pval[2]/scale -
-	h1*pval[2]*pval[2]/scale/scale;
-      tleftBack->SetPoint(i,pval);
+    if(leftSide){
+      muscleThick = static_cast<int>(ceil((minSkinXVox-1)*(1-static_cast<double>(j*j)/(dim[1]*dim[1]))));
+    }else{
+      muscleThick = static_cast<int>(ceil((minSkinXVox-1)*(1-static_cast<double>((j-dim[1])*(j-dim[1]))/(dim[1]*dim[1]))));
     }
-    // ring
-    npts = tleftRing->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      tleftRing->GetPoint(i,pval);
-      pval[1] = pval[1] - h0*pval[2]/scale -
-	h1*pval[2]*pval[2]/scale/scale;
-      tleftRing->SetPoint(i,pval);
+		
+    for(int k=0; k<dim[2]; k++){
+      for(int i=0; i<=muscleThick; i++){
+	unsigned char* p =
+	  static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
+	if(p[0] == innerVal){
+	  p[0] = tissue.muscle;
+	}
+      }
     }
   }
 
-  // ptosis
-  if(doPtosis){
-    vtkIdType npts = trightFront->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      // front
-      trightFront->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      trightFront->SetPoint(i,pval);
-      // back
-      trightBack->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      trightBack->SetPoint(i,pval);
-    }
-    // ring
-    npts = trightRing->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      trightRing->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      trightRing->SetPoint(i,pval);
-    }
-    
-    npts = tleftFront->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      // front
-      tleftFront->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      tleftFront->SetPoint(i,pval);
-      // back
-      tleftBack->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      tleftBack->SetPoint(i,pval);
-    }
-    // ring
-    npts = tleftRing->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      tleftRing->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      tleftRing->SetPoint(i,pval);
-    }
-    
-    npts = brightFront->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      // front
-      brightFront->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      brightFront->SetPoint(i,pval);
-      // back
-      brightBack->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      brightBack->SetPoint(i,pval);
-    }
-    // ring
-    npts = brightRing->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      brightRing->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      brightRing->SetPoint(i,pval);
-    }
-		
-    npts = bleftFront->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      // front
-      bleftFront->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      bleftFront->SetPoint(i,pval);
-      // back
-      bleftBack->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      bleftBack->SetPoint(i,pval);
-    }
-    // ring
-    npts = bleftRing->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      bleftRing->GetPoint(i,pval);
-      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
-      bleftRing->SetPoint(i,pval);
-    }
-  }
+  // breast footprint is now fixed, flag background bricks
+  volume.updateOccupancy();
 
-  // turn
-  if(doTurn){
-    vtkIdType npts = trightFront->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      // front
-      trightFront->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      trightFront->SetPoint(i,pval);
-      // back
-      trightBack->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      trightBack->SetPoint(i,pval);
-    }
-    // ring
-    npts = trightRing->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      trightRing->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      trightRing->SetPoint(i,pval);
-    }
-    
-    npts = tleftFront->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      // front
-      tleftFront->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      tleftFront->SetPoint(i,pval);
-      // back
-      tleftBack->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      tleftBack->SetPoint(i,pval);
-    }
-    // ring
-    npts = tleftRing->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      tleftRing->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      tleftRing->SetPoint(i,pval);
-    }
-		
-    npts = brightFront->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      // front
-      brightFront->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      brightFront->SetPoint(i,pval);
-      // back
-      brightBack->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      brightBack->SetPoint(i,pval);
-    }
-    // ring
-    npts = brightRing->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      brightRing->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      brightRing->SetPoint(i,pval);
-    }
-    
-    npts = bleftFront->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      // front
-      bleftFront->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      bleftFront->SetPoint(i,pval);
-      // back
-      bleftBack->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      bleftBack->SetPoint(i,pval);
-    }
-    // ring
-    npts = bleftRing->GetNumberOfPoints();
-#pragma omp parallel for
-    for(int i=0; i<npts; i++){
-      double pval[3];
-      bleftRing->GetPoint(i,pval);
-      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
-      bleftRing->SetPoint(i,pval);
-    }
-  }
+  /***********************
+	Compartments
+  ***********************/
 
-  // get nipple position
-  double nipplePos[3];
-  brightFront->GetPoint(centerPt,nipplePos);
+  // breast segmentation into compartments and lipid buffer zone
 
-  // scale nipple position
-  for(int i=0; i<3; i++){
-    nipplePos[i] = nipplePos[i]*scaleFactor;
-  }
+  int numAngles = numBreastCompartments;
+	
+  double seedBaseDist = vm["compartments.seedBaseDist"].as<double>();	// distance along nipple line of seed base
 
-  // aggregate front points
-  vtkSmartPointer<vtkPoints> frontPts =
-    vtkSmartPointer<vtkPoints>::New();
+  // pick backplane seed points on this plane
+  int numBackSeeds = vm["compartments.numBackSeeds"].as<int>();	// number of backplane seed points
+  int numSkinSeeds = 250;
+
+  double angularJitter = 2*pi*numAngles*vm["compartments.angularJitter"].as<double>();
+  // max angular jitter for seed placement
+  double zJitter = vm["compartments.zJitter"].as<double>();	// jitter in z direction
+  double maxFracRadialDist = vm["compartments.maxFracRadialDist"].as<double>();
+  // minimum and maximum radial distance from baseSeed as fraction of distance to breast surface
+  double minFracRadialDist = vm["compartments.minFracRadialDist"].as<double>();
+
+  double scaleMin[3];  // scaling for gland compartments
+  scaleMin[0] = vm["compartments.minScaleNippleDir"].as<double>();
+  scaleMin[1] = vm["compartments.minScale"].as<double>();
+  scaleMin[2] = vm["compartments.minScale"].as<double>();
 	
-  for(vtkIdType i=0; i<brightFront->GetNumberOfPoints(); i++){
-    double t[3];
-    brightFront->GetPoint(i, t);
-    frontPts->InsertNextPoint(t);
-  }
-  for(vtkIdType i=0; i<trightFront->GetNumberOfPoints(); i++){
-    double t[3];
-    trightFront->GetPoint(i, t);
-    frontPts->InsertNextPoint(t);
-  }
-  for(vtkIdType i=0; i<bleftFront->GetNumberOfPoints(); i++){
-    double t[3];
-    bleftFront->GetPoint(i, t);
-    frontPts->InsertNextPoint(t);
-  }
-  for(vtkIdType i=0; i<tleftFront->GetNumberOfPoints(); i++){
-    double t[3];
-    tleftFront->GetPoint(i, t);
-    frontPts->InsertNextPoint(t);
-  }
-  vtkIdType numFrontPts = frontPts->GetNumberOfPoints();
+  double scaleMax[3];	// 1st dimension principally points toward nipple - gland seeds
+  scaleMax[0] = vm["compartments.maxScaleNippleDir"].as<double>();
+  scaleMax[1] = vm["compartments.maxScale"].as<double>();
+  scaleMax[2] = vm["compartments.maxScale"].as<double>();
 	
-  // decimate front points
-  vtkSmartPointer<vtkPolyData> frontPoly = 
-    vtkSmartPointer<vtkPolyData>::New();
-  frontPoly->SetPoints(frontPts);
-  vtkSmartPointer<vtkVertexGlyphFilter> frontVertAdd =
-    vtkSmartPointer<vtkVertexGlyphFilter>::New();
-#if VTK_MAJOR_VERSION <= 5
-  frontVertAdd->SetInput(frontPoly);
-#else
-  frontVertAdd->SetInputData(frontPoly);
-#endif
-
-  frontVertAdd->Update();
-  vtkSmartPointer<vtkCleanPolyData> cleanFront =
-    vtkSmartPointer<vtkCleanPolyData>::New();
-#if VTK_MAJOR_VERSION <= 5
-  cleanFront->SetInput(frontVertAdd->GetOutput());
-#else
-  cleanFront->SetInputConnection(frontVertAdd->GetOutputPort());
-#endif
-  cleanFront->SetTolerance(pointSep);
-  cleanFront->Update();	
+  double gMin = vm["compartments.minGlandStrength"].as<double>();	// strength of gland compartments
+  double gMax = vm["compartments.maxGlandStrength"].as<double>();
+  double deflectMax = pi*vm["compartments.maxDeflect"].as<double>();
+  // maximum deflection angle from pointing towards nipple (gland compartments)
+
+  // backplane, nipple are spherical weighting
+  // skin orients towards nipple
+  double scaleSkinMin[3];
+  scaleSkinMin[0] = vm["compartments.minSkinScaleNippleDir"].as<double>();
+  scaleSkinMin[1] = vm["compartments.minSkinScale"].as<double>();
+  scaleSkinMin[2] = vm["compartments.minSkinScale"].as<double>();
+  double scaleSkinMax[3];
+  scaleSkinMax[0] = vm["compartments.maxSkinScaleNippleDir"].as<double>();
+  scaleSkinMax[1] = vm["compartments.maxSkinScale"].as<double>();
+  scaleSkinMax[2] = vm["compartments.maxSkinScale"].as<double>();
 	
-  // aggregate and shift back points
-  vtkSmartPointer<vtkPoints> backPts =
-    vtkSmartPointer<vtkPoints>::New();
+  double gSkin = vm["compartments.skinStrength"].as<double>();
+
+  double scaleBack = vm["compartments.backScale"].as<double>();
+  double gBack = vm["compartments.backStrength"].as<double>();
+
+  double scaleNipple = vm["compartments.nippleScale"].as<double>();
+  double gNipple = vm["compartments.nippleStrength"].as<double>();
 	
-  // ringWidth and ringSep converted to non-physical coordinates
-  double ringWidth = vm["shape.ringWidth"].as<double>();
-  double ringSep = vm["shape.ringSep"].as<double>();
-  double ringWidthOrig = ringWidth/scaleFactor;
-  double ringSepOrig = ringSep/scaleFactor;
-  double backPos = (floor(ringWidthOrig/ringSepOrig)+1)*ringSepOrig;
-  
-  for(vtkIdType i=0; i<brightBack->GetNumberOfPoints(); i++){
-    double t[3];
-    brightBack->GetPoint(i, t);
-    t[0] = -backPos;
-    backPts->InsertNextPoint(t);
-  }
-  for(vtkIdType i=0; i<trightBack->GetNumberOfPoints(); i++){
-    double t[3];
-    trightBack->GetPoint(i, t);
-    t[0] = -backPos;
-    backPts->InsertNextPoint(t);
-  }
-  for(vtkIdType i=0; i<bleftBack->GetNumberOfPoints(); i++){
-    double t[3];
-    bleftBack->GetPoint(i, t);
-    t[0] = -backPos;
-    backPts->InsertNextPoint(t);
-  }
-  for(vtkIdType i=0; i<tleftBack->GetNumberOfPoints(); i++){
-    double t[3];
-    tleftBack->GetPoint(i, t);
-    t[0] = -backPos;
-    backPts->InsertNextPoint(t);
-  }
-  vtkIdType numBackPts = backPts->GetNumberOfPoints();
-  
-  // decimate back points
-  vtkSmartPointer<vtkPolyData> backPoly = 
-    vtkSmartPointer<vtkPolyData>::New();
-  backPoly->SetPoints(backPts);
-  vtkSmartPointer<vtkVertexGlyphFilter> backVertAdd =
-    vtkSmartPointer<vtkVertexGlyphFilter>::New();
-#if VTK_MAJOR_VERSION <= 5
-  backVertAdd->SetInput(backPoly);
-#else
-  backVertAdd->SetInputData(backPoly);
-#endif
-  backVertAdd->Update();
-  vtkSmartPointer<vtkCleanPolyData> cleanBack =
-    vtkSmartPointer<vtkCleanPolyData>::New();
-#if VTK_MAJOR_VERSION <= 5
-  cleanBack->SetInput(backVertAdd->GetOutput());
-#else
-  cleanBack->SetInputConnection(backVertAdd->GetOutputPort());
-#endif
-  cleanBack->SetTolerance(pointSep);
-  cleanBack->Update();	
+  double ligDistThresh = 12.0;
 	
-  // aggregate ring points and create thickness
-  vtkSmartPointer<vtkPoints> ringPts =
+  // radius of fat seeds to check for segmentation
+  double compSeedRadius = vm["compartments.voronSeedRadius"].as<double>();
+
+  numFatSeeds = numAngles + numBackSeeds + numSkinSeeds;  // total number of fat seed points
+
+  // memory allocation
+  glandCompartments = (breastComp*)malloc((numBreastCompartments+1)*sizeof(breastComp));
+  fatCompartments = (breastComp*)malloc(numFatSeeds*sizeof(breastComp));
+
+  vtkSmartPointer<vtkPoints> seeds =
     vtkSmartPointer<vtkPoints>::New();
-	
-  for(vtkIdType i=0; i<brightRing->GetNumberOfPoints(); i++){
-    double t[3];
-    brightRing->GetPoint(i, t);
-    ringPts->InsertNextPoint(t);
-    double xstep = ringSepOrig;
-    while(xstep < ringWidthOrig){
-      t[0] = -xstep;
-      ringPts->InsertNextPoint(t);
-      xstep += ringSepOrig;
-    }
-  }
-  for(vtkIdType i=0; i<trightRing->GetNumberOfPoints(); i++){
-    double t[3];
-    trightRing->GetPoint(i, t);
-    ringPts->InsertNextPoint(t);
-    double xstep = ringSepOrig;
-    while(xstep < ringWidthOrig){
-      t[0] = -xstep;
-      ringPts->InsertNextPoint(t);
-      xstep += ringSepOrig;
-    }
+
+  // base of spokes for seed placement
+  double seedBase[3];
+  // coordinate system for seedBase
+  vtkVector3d baseAxis[3];
+
+  // set seed base location and specify first coordinate vector
+  for(int i=0; i<3; i++){
+    seedBase[i] = nipplePos[i]-seedBaseDist*nippleNorm[i];
+    baseAxis[0][i] = -1.0*nippleNorm[i];
   }
-  for(vtkIdType i=0; i<bleftRing->GetNumberOfPoints(); i++){
-    double t[3];
-    bleftRing->GetPoint(i, t);
-    ringPts->InsertNextPoint(t);
-    double xstep = ringSepOrig;
-    while(xstep < ringWidthOrig){
-      t[0] = -xstep;
-      ringPts->InsertNextPoint(t);
-      xstep += ringSepOrig;
-    }
+
+  // check seed base within breast
+  int coords[3];	// coordinates of nipple seed base
+  double pcoords[3]; // parametric coordinates
+  breast->ComputeStructuredCoordinates(seedBase,coords,pcoords);
+  unsigned char* base = static_cast<unsigned char*>(breast->GetScalarPointer(coords));
+  if(base[0] != innerVal){
+    // outside breast error
+    cout << "Error, breast compartment seed base outside breast volume\n";
+    return EXIT_FAILURE;
   }
-  for(vtkIdType i=0; i<tleftRing->GetNumberOfPoints(); i++){
-    double t[3];
-    tleftRing->GetPoint(i, t);
-    ringPts->InsertNextPoint(t);
-    double xstep = ringSepOrig;
-    while(xstep < ringWidthOrig){
-      t[0] = -xstep;
-      ringPts->InsertNextPoint(t);
-      xstep += ringSepOrig;
-    }
+
+  // construct other coordinate vectors
+
+  // second coordinate vector based on Gram-Schmidt using (0,1,0)
+  vtkVector3d v2;
+  v2[0] = seedBase[0];
+  v2[1] = seedBase[1] - 1.0;
+  v2[2] = seedBase[2];
+  double innerProd = v2.Dot(baseAxis[0]);
+
+  for(int i=0; i<3; i++){
+    baseAxis[1][i] = v2[i] - innerProd*baseAxis[0][i];
   }
-  vtkIdType numRingPts = ringPts->GetNumberOfPoints();
-  
-  // decimate ring points
-  vtkSmartPointer<vtkPolyData> ringPoly = 
-    vtkSmartPointer<vtkPolyData>::New();
-  ringPoly->SetPoints(ringPts);
-  vtkSmartPointer<vtkVertexGlyphFilter> ringVertAdd =
-    vtkSmartPointer<vtkVertexGlyphFilter>::New();
-#if VTK_MAJOR_VERSION <= 5
-  ringVertAdd->SetInput(ringPoly);
-#else
-  ringVertAdd->SetInputData(ringPoly);
-#endif
-  ringVertAdd->Update();
-  vtkSmartPointer<vtkCleanPolyData> cleanRing =
-    vtkSmartPointer<vtkCleanPolyData>::New();
-#if VTK_MAJOR_VERSION <= 5
-  cleanRing->SetInput(ringVertAdd->GetOutput());
-#else
-  cleanRing->SetInputConnection(ringVertAdd->GetOutputPort());
-#endif
-  cleanRing->SetTolerance(pointSep);
-  cleanRing->Update();	
-	
-  // allocate space for breast points
-  vtkSmartPointer<vtkPoints> breastPts =
-    vtkSmartPointer<vtkPoints>::New();
+  // normalize
+  baseAxis[1].Normalize();
 
-  vtkIdType numBreastPts = cleanFront->GetOutput()->GetNumberOfPoints();
-  numBreastPts += cleanBack->GetOutput()->GetNumberOfPoints();
-  numBreastPts += cleanRing->GetOutput()->GetNumberOfPoints();
-  breastPts->SetNumberOfPoints(numBreastPts);
+  // calculate 3rd vector based on cross product
+  baseAxis[2] = baseAxis[0].Cross(baseAxis[1]);
+
+  /* now have baseAxis coordinate system
+     shoot rays toward breast surface and determine compartment seed locations
+     and breast surface seed points */
   
-  // cell array for verticies
-  vtkSmartPointer<vtkCellArray> breastVerts =
-    vtkSmartPointer<vtkCellArray>::New();
-	
-  // scale to physical units
-  vtkIdType totalCount = 0;
-  vtkIdType currentPoints = cleanFront->GetOutput()->GetNumberOfPoints();
+  double rayLength = 500.0;	// some large value to guarantee being outside of breast
 
-  for(vtkIdType i=0; i<currentPoints; i++){
-    double t[3];
-		
-    cleanFront->GetOutput()->GetPoint(i,t);
-    for(int j=0; j<3; j++){
-      t[j] = t[j]*scaleFactor;
-    }
-    breastPts->SetPoint(totalCount,t);
-    breastVerts->InsertNextCell(1,&totalCount); 
-    totalCount++;
-  }
+  for(int i=0; i<numAngles; i++){
+    double theta = (double)i*2*pi/(double)numAngles;
+    
+    // add theta jitter
+    theta = theta + rgen->GetRangeValue(-1.0*angularJitter,angularJitter);
+    rgen->Next();
 
-  // calculate scaled back points
-  currentPoints = cleanBack->GetOutput()->GetNumberOfPoints();
-  for(vtkIdType i=0; i<currentPoints; i++){
-    double t[3];
-    cleanBack->GetOutput()->GetPoint(i,t);
+    vtkVector3d rayDir;
+    double lineEnd[3];
     for(int j=0; j<3; j++){
-      t[j] = t[j]*scaleFactor;
+      rayDir[j] = cos(theta)*baseAxis[1][j]+sin(theta)*baseAxis[2][j];
+      lineEnd[j] = seedBase[j]+rayLength*rayDir[j];
     }
-    breastPts->SetPoint(totalCount,t);
-    breastVerts->InsertNextCell(1,&totalCount); 
-    totalCount++;
-  }
-	
-  // calculate scaled ring points and normals
-  currentPoints = cleanRing->GetOutput()->GetNumberOfPoints();
 
-  for(vtkIdType i=0; i<currentPoints; i++){
-    double t[3];
-    cleanRing->GetOutput()->GetPoint(i,t);
-    for(int j=0; j<3; j++){
-      t[j] = t[j]*scaleFactor;
-    }
-    breastPts->SetPoint(totalCount,t);
-    breastVerts->InsertNextCell(1,&totalCount); 
-    totalCount++;
-  }
-
-  // create polydata
-  vtkSmartPointer<vtkPolyData> breastPoly =
-    vtkSmartPointer<vtkPolyData>::New();
-  breastPoly->SetPoints(breastPts);
-	
-  // add verticies to polydata
-  breastPoly->SetVerts(breastVerts);
-	
-  // surface mesh reconstruction
-  vtkSmartPointer<vtkSurfaceReconstructionFilter> breastFilter =
-    vtkSmartPointer<vtkSurfaceReconstructionFilter>::New();
-		
-#if VTK_MAJOR_VERSION <= 5
-  breastFilter->SetInput(breastPoly);
-#else
-  breastFilter->SetInputData(breastPoly);
-#endif
-  breastFilter->Update();
-	
-  // fix bug in vtkSurfaceReconstructionFilter
-  double pointSetBounds[6];
-  breastPts->GetBounds(pointSetBounds);
-	
-  vtkSmartPointer<vtkContourFilter> breastContourFilter =
-    vtkSmartPointer<vtkContourFilter>::New();
-		
-#if VTK_MAJOR_VERSION <= 5
-  breastContourFilter->SetInput(breastFilter->GetOutput());
-#else
-  breastContourFilter->SetInputConnection(breastFilter->GetOutputPort());
-#endif
-  breastContourFilter->ComputeNormalsOn();
-  breastContourFilter->SetValue(0, 0.0);
-  breastContourFilter->Update();
-	
-  vtkSmartPointer<vtkReverseSense> breastSenseFilter =
-    vtkSmartPointer<vtkReverseSense>::New();
-	
-#if VTK_MAJOR_VERSION <= 5
-  breastSenseFilter->SetInput(breastContourFilter->GetOutput());
-#else
-  breastSenseFilter->SetInputConnection(breastContourFilter->GetOutputPort());
-#endif
-  breastSenseFilter->ReverseCellsOn();
-  breastSenseFilter->ReverseNormalsOn();
-  breastSenseFilter->Update();
-
-  double surfaceBounds[6];
-  breastSenseFilter->GetOutput()->GetBounds(surfaceBounds);
-	
-  double scaling[3];
-	
-  scaling[0] = (pointSetBounds[1]-pointSetBounds[0])/(surfaceBounds[1]-surfaceBounds[0]);
-  scaling[1] = (pointSetBounds[3]-pointSetBounds[2])/(surfaceBounds[3]-surfaceBounds[2]);
-  scaling[2] = (pointSetBounds[5]-pointSetBounds[4])/(surfaceBounds[5]-surfaceBounds[4]);
-
-  vtkSmartPointer<vtkTransform> transp = 
-    vtkSmartPointer<vtkTransform>::New();
-  transp->Translate(pointSetBounds[0], pointSetBounds[2], pointSetBounds[4]);
-  transp->Scale(scaling[0], scaling[1], scaling[2]);
-  transp->Translate(-surfaceBounds[0], -surfaceBounds[2], -surfaceBounds[4]);
-
-  vtkSmartPointer<vtkTransformPolyDataFilter> fixed = 
-    vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-  fixed->SetInputData(breastSenseFilter->GetOutput());
-#if VTK_MAJOR_VERSION <= 5
-  fixed->SetInput(breastSenseFilter->GetOutput());
-#else
-  fixed->SetInputData(breastSenseFilter->GetOutput());
-#endif
-  fixed->SetTransform(transp);
-  fixed->Update();
+    // intersection variables
+    double tol = 0.005;
+    double tval; // not sure what this is for
+    vtkIdType intersectCell;
+    int subId;  // probably don't need this
 
-  // clean mesh
-  vtkSmartPointer<vtkCleanPolyData> cleanPoly =
-    vtkSmartPointer<vtkCleanPolyData>::New();
-#if VTK_MAJOR_VERSION <= 5
-  cleanPoly->SetInput(fixed->GetOutput());
-#else
-  cleanPoly->SetInputConnection(fixed->GetOutputPort());
-#endif
-	
-  // decimate mesh
-  vtkSmartPointer<vtkDecimatePro> decimate = 
-    vtkSmartPointer<vtkDecimatePro>::New();
-  decimate->SetTargetReduction(0.25);
-#if VTK_MAJOR_VERSION <= 5
-  decimate->SetInput(cleanPoly->GetOutput());
-#else
-  decimate->SetInputConnection(cleanPoly->GetOutputPort());
-#endif
-  decimate->Update();
+    double intersect[3]; // output position
+    double pcoords[3];
 
-  vtkSmartPointer<vtkPolyData> innerPoly =
-    vtkSmartPointer<vtkPolyData>::New();
-  innerPoly->ShallowCopy(decimate->GetOutput());
+    vtkSmartPointer<vtkCellLocator> innerLocator =
+      vtkSmartPointer<vtkCellLocator>::New();
+    innerLocator->SetDataSet(innerPoly);
+    innerLocator->BuildLocator();
 
-  // create 3d imagedata
-  vtkSmartPointer<vtkImageData> breast =
-    vtkSmartPointer<vtkImageData>::New();
+    if(innerLocator->IntersectWithLine(seedBase, lineEnd, tol,
+				       tval, intersect, pcoords, subId, intersectCell)){
+      
+      // the breast surface seed point is intersect
+      seeds->InsertNextPoint(intersect);
+      
+      // add fat seed to structure
+      for(int j=0; j<3; j++){
+	fatCompartments[i].pos[j] = intersect[j];
+	fatCompartments[i].scale[j] = rgen->GetRangeValue(scaleSkinMin[j],scaleSkinMax[j]);
+	rgen->Next();
+      }
+      fatCompartments[i].g = gSkin;
+      fatCompartments[i].fat = true;
+      fatCompartments[i].keep = true;
+      fatCompartments[i].compId = 0;
+      fatCompartments[i].voxelCount = 0;
 
-  double baseBound[6];
-  innerPoly->GetBounds(baseBound);
-  
-  // extend bounds slightly to make room for nipple
-  double baseFOV[3];
-  for(int i=0; i<3; i++){
-    baseFOV[i] = fabs(baseBound[2*i+1] - baseBound[2*i]);
-  }
+      fatCompartments[i].boundBox[0] = breastDim[0]+1;
+      fatCompartments[i].boundBox[1] = -1;
+      fatCompartments[i].boundBox[2] = breastDim[1]+1;
+      fatCompartments[i].boundBox[3] = -1;
+      fatCompartments[i].boundBox[4] = breastDim[2]+1;
+      fatCompartments[i].boundBox[5] = -1;
 
-  double finalBound[6];
-  for(int i=0; i<6; i++){
-    finalBound[i] = baseBound[i];
-  }
-  finalBound[0] = finalBound[0] + 1.0;	// move backplane in by 1 mm to avoid surface edge
-  finalBound[1] = finalBound[1] + nippleLen + 2.0;	// make room for nipple
-  finalBound[2] = finalBound[2] - 0.01*baseFOV[1];
-  finalBound[3] = finalBound[3] + 0.01*baseFOV[1];
-  finalBound[4] = finalBound[4] - 0.01*baseFOV[2];
-  finalBound[5] = finalBound[5] + 0.01*baseFOV[2];
+      // principle unit vector oriented towards nipple
+      // first vector
+      for(int j=0; j<3; j++){
+	fatCompartments[i].axis[0][j] = nipplePos[j] - intersect[j];
+      }
+      // normalize
+      fatCompartments[i].axis[0].Normalize();
 
-  double spacing[3];
-  for(int i=0; i<3; i++){
-    spacing[i] = imgRes;
-  }
-  breast->SetSpacing(spacing);
+      // calculate second vector based on direction to coordinate origin
+      vtkVector3d v2;
+      for(int j=0; j<3; j++){
+	v2[j] = intersect[j];
+      }
+      double innerProd = v2.Dot(fatCompartments[i].axis[0]);
 
-  int dim[3];
-  for(int i=0; i<3; i++){
-    dim[i] = static_cast<int>(ceil((finalBound[2*i+1]-finalBound[2*i])/spacing[i]));
-  }
+      for(int j=0; j<3; j++){
+	fatCompartments[i].axis[1][j] = v2[j] - innerProd*fatCompartments[i].axis[0][j];
+      }
+      // normalize
+      fatCompartments[i].axis[1].Normalize();
+			
+      // calculate 3rd vector based on cross product
+      fatCompartments[i].axis[2] = fatCompartments[i].axis[0].Cross(fatCompartments[i].axis[1]);
 
-  breast->SetExtent(0, dim[0]-1, 0, dim[1]-1, 0, dim[2]-1);
-  
-  double origin[3];
-  for(int i=0; i<3; i++){
-    origin[i] = finalBound[2*i]+spacing[i]/2.0;
-  }
-  breast->SetOrigin(origin);
+      // find gland compartment seed point
 
-  // allocate unsigned char
-#if VTK_MAJOR_VERSION <= 5
-  breast->SetNumberOfScalarComponents(1);
-  breast->SetScalarTypeToUnsignedChar();
-  breast->AllocateScalars();
-#else
-  breast->AllocateScalars(VTK_UNSIGNED_CHAR,1);
-#endif
+      double skinDist = sqrt(vtkMath::Distance2BetweenPoints(seedBase,intersect));
+      double seedDist = skinDist*rgen->GetRangeValue(minFracRadialDist,
+						     maxFracRadialDist);
+      rgen->Next();
 
-  int originIndex[3] = {0, 0, 0};
-  double originCoords[3];
-  breast->GetPoint(breast->ComputePointId(originIndex),originCoords);
+      double seedPos[3];
+      for(int j=0; j<3; j++){
+	seedPos[j] = seedBase[j]+seedDist*rayDir[j];
+      }
 
-  // initialize to zero
-  unsigned char* voxVal = static_cast<unsigned char *>(breast->GetScalarPointer());
-  const long long int numElements = dim[0]*dim[1]*dim[2];
-  for(long long int i=0; i<numElements; i++){
-    *voxVal = tissue.bg;
-    voxVal++;
-  }
+      // add z jitter
+      
+      double zjit = rgen->GetRangeValue(-1.0*zJitter, 1.0*zJitter);
+      rgen->Next();
 
-  // voxelize
+      for(int j=0; j<3; j++){
+	seedPos[j] = seedPos[j]+zjit*baseAxis[0][j];
+      }
 
-  // list of boundary voxels
-  vtkSmartPointer<vtkIdList> boundaryList =
-    vtkSmartPointer<vtkIdList>::New();
+      //seeds->InsertNextPoint(seedPos);
 
-  vtkSmartPointer<vtkIdList> boundaryList1 =
-    vtkSmartPointer<vtkIdList>::New();
+      // add to gland structure
+      for(int j=0; j<3; j++){
+	glandCompartments[i].pos[j] = seedPos[j];
+	glandCompartments[i].scale[j] = rgen->GetRangeValue(scaleMin[j],scaleMax[j]);
+	rgen->Next();
+      }
+			
+      glandCompartments[i].g = rgen->GetRangeValue(gMin,gMax);
+      rgen->Next();
+      glandCompartments[i].fat = false;
+      glandCompartments[i].keep = true;
+      glandCompartments[i].compId = (unsigned char)i;
+      glandCompartments[i].voxelCount = 0;
 
-  vtkSmartPointer<vtkIdList> boundaryList2 =
-    vtkSmartPointer<vtkIdList>::New();
+      glandCompartments[i].boundBox[0] = breastDim[0]+1;
+      glandCompartments[i].boundBox[1] = -1;
+      glandCompartments[i].boundBox[2] = breastDim[1]+1;
+      glandCompartments[i].boundBox[3] = -1;
+      glandCompartments[i].boundBox[4] = breastDim[2]+1;
+      glandCompartments[i].boundBox[5] = -1;
 
-  vtkSmartPointer<vtkIdList> boundaryList3 =
-    vtkSmartPointer<vtkIdList>::New();
+      // coordinate system
+      // first vector
+      for(int j=0; j<3; j++){
+	glandCompartments[i].axis[0][j] = nipplePos[j] - seedPos[j];
+      }
+      // normalize
+      glandCompartments[i].axis[0].Normalize();
 
-  int maxThread = omp_get_max_threads();
-
-  // boundary sub-lists
-  vtkSmartPointer<vtkIdList> *subList1 = new vtkSmartPointer<vtkIdList>[maxThread];
-  vtkSmartPointer<vtkIdList> *subList2 = new vtkSmartPointer<vtkIdList>[maxThread];
-  vtkSmartPointer<vtkIdList> *subList3 = new vtkSmartPointer<vtkIdList>[maxThread];
-  for(int i=0; i<maxThread; i++){
-    subList1[i] = vtkSmartPointer<vtkIdList>::New();
-    subList2[i] = vtkSmartPointer<vtkIdList>::New();
-    subList3[i] = vtkSmartPointer<vtkIdList>::New();
-  }
+      // calculate second vector based on direction to coordinate origin
+      for(int j=0; j<3; j++){
+	v2[j] = seedPos[j];
+      }
+      innerProd = v2.Dot(glandCompartments[i].axis[0]);
+      
+      for(int j=0; j<3; j++){
+	glandCompartments[i].axis[1][j] = v2[j] - innerProd*glandCompartments[i].axis[0][j];
+      }
+      // normalize
+      glandCompartments[i].axis[1].Normalize();
 
-#pragma omp parallel num_threads(maxThread)
-  { 
-    int numThread = omp_get_num_threads();
-    int myThread = omp_get_thread_num();
+      // calculate 3rd vector based on cross product
+      glandCompartments[i].axis[2] = glandCompartments[i].axis[0].Cross(glandCompartments[i].axis[1]);
 
-    vtkSmartPointer<vtkPolyData> myPoly =
-      vtkSmartPointer<vtkPolyData>::New();
-    myPoly->DeepCopy(innerPoly);
- 
-    // Create the tree
-    vtkSmartPointer<vtkCellLocator> innerLocator =
-      vtkSmartPointer<vtkCellLocator>::New();
-    innerLocator->SetDataSet(myPoly);
-    innerLocator->BuildLocator();
+      // have 3 unit vectors
+      // rotate randomly about principle direction (to nipple)
+      double dtheta = rgen->GetRangeValue(0,2*pi);
+      rgen->Next();
+      double dphi = rgen->GetRangeValue(0,deflectMax);
+      rgen->Next();
+      double dr = tan(pi*dphi);
 
-    // find intersect with top and bottom surface to voxelize breast
-    // iterate over x and y values
-    for(int i=myThread; i<dim[0]; i+=numThread){
-      double xpos = origin[0]+i*spacing[0];
-      int ijk[3];
-      ijk[0] = i;
-      for(int j=0; j<dim[1]; j++){
+      for(int j=0; j<3; j++){
+	glandCompartments[i].axis[0][j] = nipplePos[j] - seedPos[j] + dr*cos(dtheta)*glandCompartments[i].axis[1][j] +
+	  dr*sin(dtheta)*glandCompartments[i].axis[2][j];
+      }
+      // normalize
+      glandCompartments[i].axis[0].Normalize();
       
-	double ypos = origin[1]+j*spacing[1];
-	ijk[1] = j;
-	// calculate z position of top surface
-	double lineStart[3]; // end points of line
-	double lineEnd[3];
+      // re-calculate second vector based on direction to coordinate origin and updated principle direction
+      for(int j=0; j<3; j++){
+	v2[j] = seedPos[j];
+      }
+      innerProd = v2.Dot(glandCompartments[i].axis[0]);
       
-	double tol = 0.005;
-	double tval;
-	vtkIdType intersectCell;
-	int subId;
+      for(int j=0; j<3; j++){
+	glandCompartments[i].axis[1][j] = v2[j] - innerProd*glandCompartments[i].axis[0][j];
+      }
+      // normalize
+      glandCompartments[i].axis[1].Normalize();
 
-	double intersect[3]; // output position
-	double pcoords[3];
-      
-	lineStart[0] = xpos;
-	lineStart[1] = ypos;
-	lineStart[2] = baseBound[4];
+      // calculate 3rd vector based on cross product
+      glandCompartments[i].axis[2] = glandCompartments[i].axis[0].Cross(glandCompartments[i].axis[1]);
 
-	lineEnd[0] = xpos;
-	lineEnd[1] = ypos;
-	lineEnd[2] = baseBound[5];
+      // finished calculating axes
+    } else {
+      // missed the breast surface - error
+      cout << "Error, missed breast surface when shooting rays\n";
+      return EXIT_FAILURE;
+    }
+  }
 
-	if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
-					   tval, intersect, pcoords, subId, intersectCell)){
+  double nipSc[3] = {20, 1.0, 1.0};
 
-	  // found intersection
-	  double topZ = intersect[2];
+  // add nipple seed to gland structure
+  for(int j=0; j<3; j++){
+    glandCompartments[numBreastCompartments].pos[j] = nipplePos[j];
+    glandCompartments[numBreastCompartments].scale[j] = scaleNipple;
+  }
+  glandCompartments[numBreastCompartments].g = gNipple;
+  glandCompartments[numBreastCompartments].fat = false;
+  glandCompartments[numBreastCompartments].keep = true;
+  glandCompartments[numBreastCompartments].compId = (unsigned char)numBreastCompartments;
+  glandCompartments[numBreastCompartments].voxelCount = 0;
 
-	  // do other direction
-	  lineStart[2] = baseBound[5];
-	  lineEnd[2] = baseBound[4];
+  glandCompartments[numBreastCompartments].boundBox[0] = breastDim[0]+1;
+  glandCompartments[numBreastCompartments].boundBox[1] = -1;
+  glandCompartments[numBreastCompartments].boundBox[2] = breastDim[1]+1;
+  glandCompartments[numBreastCompartments].boundBox[3] = -1;
+  glandCompartments[numBreastCompartments].boundBox[4] = breastDim[2]+1;
+  glandCompartments[numBreastCompartments].boundBox[5] = -1;
 
-	  if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
-					     tval, intersect, pcoords, subId, intersectCell)){
+  // first axis is nipple direction
+  for(int k=0; k<3; k++){
+    glandCompartments[numBreastCompartments].axis[0][k] = nippleNorm[k];
+  }
 
-	    double bottomZ = intersect[2];
-	    
-	    // find nearest voxels to intersections
-	    int indexTop = static_cast<int>(floor((topZ-origin[2])/spacing[2]));
-	    int indexBottom = static_cast<int>(ceil((bottomZ-origin[2])/spacing[2]));
+  // others are random
+  vtkMath::Perpendiculars(glandCompartments[numBreastCompartments].axis[0].GetData(),
+			  glandCompartments[numBreastCompartments].axis[1].GetData(),
+			  glandCompartments[numBreastCompartments].axis[2].GetData(),
+			  rgen->GetRangeValue(0, 2*pi));
+  rgen->Next();
+	
+  // add backplane seed points
+  // random points on backplane
+  // backplane just above muscle layer
+  double backPlanePos = 0.0 + spacing[0];
+  int backPlaneInd = static_cast<int>(ceil((backPlanePos-origin[0])/spacing[0]));
 
-	    // set edge voxels
-	    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,indexTop));
-	    p[0] = boundVal;
-	    ijk[2] = indexTop;
-	    subList1[myThread]->InsertNextId(breast->ComputePointId(ijk));		
-	    p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,indexBottom));
-	    p[0] = boundVal;
-	    ijk[2] = indexBottom;
-	    if(indexBottom != indexTop){
-	      subList1[myThread]->InsertNextId(breast->ComputePointId(ijk));
-	    }
-	    // set voxels between these 2 points to inner value;
-	    for(int k=indexTop+1; k<indexBottom; k++){
-	      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	      p[0] = innerVal;
-	    }
-	  }
-	}
+  for(int i=0; i<numBackSeeds; i++){
+    bool foundSeed = false;
+    double y,z;
+    while(!foundSeed){
+      // pick random location on backplane away from edge of voxel space
+      y = rgen->GetRangeValue(baseBound[2]+2*spacing[1],baseBound[3]-2*spacing[1]);
+      rgen->Next();
+      z = rgen->GetRangeValue(baseBound[4]+2*spacing[2],baseBound[5]-2*spacing[2]);
+      rgen->Next();
+
+      // find nearest voxel and test if in breast interior
+      int yInd = static_cast<int>(floor((y-origin[1])/spacing[1]));
+      int zInd = static_cast<int>(floor((z-origin[2])/spacing[2]));
+
+      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(backPlaneInd,yInd,zInd));
+      if(p[0] == innerVal){
+	// found a new seed point
+	foundSeed = true;
       }
     }
 
-    // find intersect with second set of directions
-    // iterate over x and z values
-    for(int i=myThread; i<dim[0]; i+=numThread){
-      double xpos = origin[0]+i*spacing[0];
-      int ijk[3];
-      ijk[0] = i;
-      for(int j=0; j<dim[2]; j++){
+    // add new seed point
+    double backSeed[3];
+    backSeed[0] = backPlanePos;
+    backSeed[1] = y;
+    backSeed[2] = z;
 
-	double zpos = origin[2]+j*spacing[2];
-	ijk[2] = j;
-	// calculate y position of top surface
-	double lineStart[3]; // end points of line
-	double lineEnd[3];
-      
-	double tol = 0.005;
-	double tval; 
-	vtkIdType intersectCell;
-	int subId;  
+    seeds->InsertNextPoint(backSeed);
 
-	double intersect[3]; // output position
-	double pcoords[3];
+    // add to structure
+    for(int j=0; j<3; j++){
+      fatCompartments[numAngles+i].pos[j] = backSeed[j];
+      fatCompartments[numAngles+i].scale[j] = scaleBack;
+    }
+    fatCompartments[numAngles+i].g = gBack;
+    fatCompartments[numAngles+i].fat = true;
+    fatCompartments[numAngles+i].keep = true;
+    fatCompartments[numAngles+i].compId = 0;
+    fatCompartments[numAngles+i].voxelCount = 0;
 
-	lineStart[0] = xpos;
-	lineStart[1] = baseBound[2];
-	lineStart[2] = zpos;
+    fatCompartments[numAngles+i].boundBox[0] = breastDim[0]+1;
+    fatCompartments[numAngles+i].boundBox[1] = -1;
+    fatCompartments[numAngles+i].boundBox[2] = breastDim[1]+1;
+    fatCompartments[numAngles+i].boundBox[3] = -1;
+    fatCompartments[numAngles+i].boundBox[4] = breastDim[2]+1;
+    fatCompartments[numAngles+i].boundBox[5] = -1;
 
-	lineEnd[0] = xpos;
-	lineEnd[1] = baseBound[3];
-	lineEnd[2] = zpos;
+    // unit vectors are standard
+    for(int j=0; j<3; j++){
+      for(int k=0; k<3; k++){
+	fatCompartments[numAngles+i].axis[j][k] = 0.0;
+      }
+    }
+    fatCompartments[numAngles+i].axis[0][0] = 1.0;
+    fatCompartments[numAngles+i].axis[1][1] = 1.0;
+    fatCompartments[numAngles+i].axis[2][2] = 1.0;
+  }
+  // finished adding backplane seed points
 
-	if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
-					   tval, intersect, pcoords, subId, intersectCell)){
+  // random skin seed points
+  for(int i=0; i<numSkinSeeds; i++){
+    bool foundSeed = false;
+    vtkIdType numPts = innerPoly->GetNumberOfPoints();
+    double seedCoords[3];
+    while(!foundSeed){
+      // pick random breast surface point
+      vtkIdType tryId = static_cast<vtkIdType>(ceil(rgen->GetRangeValue(0, numPts-1)));
+      rgen->Next();
+      innerPoly->GetPoint(tryId, seedCoords);
+			
+      // select point if not to close to backplane or nipple
+      if(seedCoords[0] > backPlanePos + 10.0 && seedCoords[0] < nipplePos[0] - 10.0){
+	foundSeed = true;
+      }  
+    }
 
-	  // found intersection
-	  double topY = intersect[1];
+    seeds->InsertNextPoint(seedCoords);
 
-	  // do other direction
-	  lineStart[1] = baseBound[3];
-	  lineEnd[1] = baseBound[2];
+    // add to structure
+    for(int j=0; j<3; j++){
+      fatCompartments[numAngles+numBackSeeds+i].pos[j] = seedCoords[j];
+      fatCompartments[numAngles+numBackSeeds+i].scale[j] = rgen->GetRangeValue(scaleSkinMin[j],scaleSkinMax[j]);
+      rgen->Next();
+    }
+    fatCompartments[numAngles+numBackSeeds+i].g = gSkin;
+    fatCompartments[numAngles+numBackSeeds+i].fat = true;
+    fatCompartments[numAngles+numBackSeeds+i].keep = true;
+    fatCompartments[numAngles+numBackSeeds+i].compId = 0;
+    fatCompartments[numAngles+numBackSeeds+i].voxelCount = 0;
+    
+    fatCompartments[numAngles+numBackSeeds+i].boundBox[0] = breastDim[0]+1;
+    fatCompartments[numAngles+numBackSeeds+i].boundBox[1] = -1;
+    fatCompartments[numAngles+numBackSeeds+i].boundBox[2] = breastDim[1]+1;
+    fatCompartments[numAngles+numBackSeeds+i].boundBox[3] = -1;
+    fatCompartments[numAngles+numBackSeeds+i].boundBox[4] = breastDim[2]+1;
+    fatCompartments[numAngles+numBackSeeds+i].boundBox[5] = -1;
 
-	  if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
-					     tval, intersect, pcoords, subId, intersectCell)){
-	    
-	    double bottomY = intersect[1];
+    // principle unit vector normal to skin
+    normals2->GetTuple(nipplePt, fatCompartments[numAngles+numBackSeeds+i].axis[0].GetData());
+    fatCompartments[numAngles+numBackSeeds+i].axis[0].Normalize();
 
-	    // find nearest voxels to intersections
-	    int indexTop = static_cast<int>(floor((topY-origin[1])/spacing[1]));
-	    int indexBottom = static_cast<int>(ceil((bottomY-origin[1])/spacing[1]));
-	    
-	    // set edge voxels
-	    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,indexTop,j));
-	    p[0] = boundVal;
-	    ijk[1] = indexTop;
-	    subList2[myThread]->InsertNextId(breast->ComputePointId(ijk));
-	    p = static_cast<unsigned char*>(breast->GetScalarPointer(i,indexBottom,j));
-	    p[0] = boundVal;
-	    ijk[1] = indexBottom;
-	    if(indexBottom != indexTop){
-	      subList2[myThread]->InsertNextId(breast->ComputePointId(ijk));
-	    }
-	    // set voxels between these 2 points to inner value;
-	    for(int k=indexTop+1; k<indexBottom; k++){
-	      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,k,j));
-	      // only change if not boundary
-	      if(p[0] != boundVal){
-		p[0] = innerVal;
-	      }
-	    }
-	  }
-	}
-      }
-    }
+    // other directions random
+    vtkMath::Perpendiculars(fatCompartments[numAngles+numBackSeeds+i].axis[0].GetData(),
+			    fatCompartments[numAngles+numBackSeeds+i].axis[1].GetData(), fatCompartments[numAngles+numBackSeeds+i].axis[2].GetData(),
+			    rgen->GetRangeValue(0, 2*pi));
+    rgen->Next();
+  }
 
-    // find intersect with final set of directions
-    // iterate over y and z values
-    for(int i=myThread; i<dim[1]; i+=numThread){
-      double ypos = origin[1]+i*spacing[1];
-      int ijk[3];
-      ijk[1] = i;
-      for(int j=0; j<dim[2]; j++){
-      
-	double zpos = origin[2]+j*spacing[2];
-	ijk[2] = j;
-      
-	// calculate x position of top surface
-	double lineStart[3]; // end points of line
-	double lineEnd[3];
-      
-	double tol = 0.005;
-	double tval; 
-	vtkIdType intersectCell;
-	int subId; 
+  // create Perlin noise distance function for glandular compartments
+  perlinNoise *boundary = static_cast<perlinNoise*>(::operator new(sizeof(perlinNoise)*(numBreastCompartments+1)));
 
-	double intersect[3]; // output position
-	double pcoords[3];
+  for(int i=0; i<=numBreastCompartments; i++){
+    new(&boundary[i]) perlinNoise(vm, (int32_t)rgen->GetRangeValue(-1073741824, 1073741824),"boundary");
+    rgen->Next();
+  }
 
-	lineStart[0] = baseBound[0];
-	lineStart[1] = ypos;
-	lineStart[2] = zpos;
+  // bin fat seeds for lookup, queries are read-only and thread-safe
+  seedGrid findSeed(seeds, compSeedRadius/4.0);
 
-	lineEnd[0] = baseBound[1];;
-	lineEnd[1] = ypos;
-	lineEnd[2] = zpos;
+  // iterate over voxels to do segmentation
+	
+  // segmentation records voxel count and bounding box of every label it
+  // writes so no separate statistics pass is needed
+  int labelBox[256][6];
+  for(int l=0; l<256; l++){
+    for(int m=0; m<3; m++){
+      labelBox[l][2*m] = breastDim[m]+1;
+      labelBox[l][2*m+1] = -1;
+    }
+  }
 
-	if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
-					   tval, intersect, pcoords, subId, intersectCell)){
+  // starting by setting everything behind back plane to fat
+      #pragma omp parallel for
+  for(int i=0; i<backPlaneInd; i++){
+    for(int j=0; j<dim[1]; j++){
+      for(int k=0; k<dim[2]; k++){
+	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
+	if(p[0] == innerVal){
+	  // set to fat
+	  p[0] = ufat;
+	  hist->move(innerVal, ufat);
+	}
+      }
+    }
+  }
 	
-	  // found intersection
-	  double topX = intersect[0];
+  double boundaryDev = vm["boundary.maxDeviation"].as<double>();
 
-	  // do other direction
-	  lineStart[0] = baseBound[1];
-	  lineEnd[0] = baseBound[0];
+  // Voronoi segmentation is refined hierarchically, a box is filled in one
+  // go when every point in it provably has the same closest label, otherwise
+  // it is split in octants down to single voxels at compartment boundaries
 
-	  if(innerLocator->IntersectWithLine(lineStart, lineEnd, tol,
-					     tval, intersect, pcoords, subId, intersectCell)){
-	  
-	    double bottomX = intersect[0];
-	  
-	    // find nearest voxels to intersections
-	    int indexTop = static_cast<int>(floor((topX-origin[0])/spacing[0]));
-	    indexTop = (indexTop < 0) ? 0 : indexTop; 
-	    int indexBottom = static_cast<int>(ceil((bottomX-origin[0])/spacing[0]));
-	    indexBottom = (indexBottom > dim[0]-1) ? dim[0]-1 : indexBottom;
-	    indexBottom = (indexBottom < 0) ? 0 : indexBottom;
+  // edge length of top level refinement blocks (mm)
+  double blockSize = 1.6;
 
-	    // set edge voxels on front side only
-	    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(indexBottom,i,j));
-	    p[0] = boundVal;
-	    ijk[0] = indexBottom;
-	    subList3[myThread]->InsertNextId(breast->ComputePointId(ijk));
-	    // set voxels between these 2 points to inner value;
-	    for(int k=indexTop+1; k<indexBottom; k++){
-	      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(k,i,j));
-	      // only change if not boundary
-	      if(p[0] != boundVal){
-		p[0] = innerVal;
-	      }
-	    }
-	  }
-	}
+  int blockVox = static_cast<int>(floor(blockSize/imgRes));
+
+  if(blockVox < 1){
+    blockVox = 1;
+  }
+
+  // sqrt of the distance function is a norm, its Lipschitz constant is
+  // sqrt(max scale/g)
+  int numGlandSeeds = numBreastCompartments+1;
+  int numAllSeeds = numFatSeeds + numGlandSeeds;
+  double* seedLip = new double[numAllSeeds];
+  unsigned char* seedLabel = new unsigned char[numAllSeeds];
+  for(int n=0; n<numAllSeeds; n++){
+    breastComp* comp = (n < numFatSeeds) ? &fatCompartments[n] : &glandCompartments[n-numFatSeeds];
+    double maxScale = comp->scale[0];
+    for(int m=1; m<3; m++){
+      if(comp->scale[m] > maxScale){
+	maxScale = comp->scale[m];
       }
     }
+    seedLip[n] = sqrt(maxScale/comp->g);
+    seedLabel[n] = (n < numFatSeeds) ? ufat : compartmentVal[comp->compId];
   }
-	    
-  // combine lists
-#pragma omp parallel sections
+
+  // all seeds in structure of arrays form, slot equals seed id
+  seedKernel allSeeds(numAllSeeds);
+  for(int n=0; n<numAllSeeds; n++){
+    breastComp* comp = (n < numFatSeeds) ? &fatCompartments[n] : &glandCompartments[n-numFatSeeds];
+    allSeeds.add(n, comp->pos, comp->axis, comp->scale, comp->g);
+  }
+
+  // other side of back plane, do segmentation
+  // z slabs, same thread to memory mapping as the other volume passes
+      #pragma omp parallel
   {
-#pragma omp section
-    {
-      vtkIdType nList1;
-      vtkIdType c1 = 0;
-      nList1 = subList1[0]->GetNumberOfIds();
-      for(int i=1; i<maxThread; i++){
-	nList1 += subList1[i]->GetNumberOfIds();
-      }
-      boundaryList1->SetNumberOfIds(nList1);
-      for(int i=0; i<maxThread; i++){
-	int numPts = subList1[i]->GetNumberOfIds();
-	for(int j=0; j<numPts; j++){
-	  boundaryList1->InsertId(c1,subList1[i]->GetId(j));
-	  c1++;
-	}
+    // refinement buffers, allocated once per thread
+    compartmentSeg seg(&findSeed, &allSeeds, numFatSeeds, numGlandSeeds, seedLip, seedLabel,
+		       glandCompartments, boundary, boundaryDev, compSeedRadius, originCoords, imgRes);
+
+    // bounding box of each label written by this thread
+    int myLabelBox[256][6];
+    for(int l=0; l<256; l++){
+      for(int m=0; m<3; m++){
+	myLabelBox[l][2*m] = breastDim[m]+1;
+	myLabelBox[l][2*m+1] = -1;
       }
-      vtkSortDataArray::Sort(boundaryList1);
     }
-#pragma omp section
-    {
-      vtkIdType nList2;
-      vtkIdType c2 = 0;
-      nList2 = subList2[0]->GetNumberOfIds();
-      for(int i=1; i<maxThread;i++){
-	nList2 += subList2[i]->GetNumberOfIds();
-      }
-      boundaryList2->SetNumberOfIds(nList2);
-      for(int i=0; i<maxThread; i++){
-	int numPts = subList2[i]->GetNumberOfIds();
-	for(int j=0; j<numPts; j++){
-	  boundaryList2->InsertId(c2,subList2[i]->GetId(j));
-	  c2++;
+
+      #pragma omp for schedule(static)
+    for(int kb=0; kb<dim[2]; kb+=blockVox){
+      for(int jb=0; jb<dim[1]; jb+=blockVox){
+	for(int ib=backPlaneInd; ib<dim[0]; ib+=blockVox){
+
+	  int block[6] = {ib, ib+blockVox-1, jb, jb+blockVox-1, kb, kb+blockVox-1};
+	  for(int m=0; m<3; m++){
+	    if(block[2*m+1] >= dim[m]){
+	      block[2*m+1] = dim[m]-1;
+	    }
+	  }
+
+	  // skip blocks with nothing to segment
+	  bool doSeg = false;
+	  for(int k=block[4]; k<=block[5] && !doSeg; k++){
+	    for(int j=block[2]; j<=block[3] && !doSeg; j++){
+	      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(block[0],j,k));
+	      for(int i=block[0]; i<=block[1]; i++){
+		if(p[i-block[0]] == innerVal){
+		  doSeg = true;
+		  break;
+		}
+	      }
+	    }
+	  }
+	  if(!doSeg){
+	    continue;
+	  }
+
+	  seg.segment(breast, block, innerVal, hist, myLabelBox);
 	}
       }
-      vtkSortDataArray::Sort(boundaryList2);
     }
-#pragma omp section
+
+    // merge label statistics
+      #pragma omp critical (segStats)
     {
-      vtkIdType nList3;
-      vtkIdType c3 = 0;
-      nList3 = subList3[0]->GetNumberOfIds();
-      for(int i=1; i<maxThread;i++){
-	nList3 += subList3[i]->GetNumberOfIds();
-      }
-      boundaryList3->SetNumberOfIds(nList3);
-      for(int i=0; i<maxThread; i++){
-	int numPts = subList3[i]->GetNumberOfIds();
-	for(int j=0; j<numPts; j++){
-	  boundaryList3->InsertId(c3,subList3[i]->GetId(j));
-	  c3++;
+      for(int l=0; l<256; l++){
+	for(int m=0; m<3; m++){
+	  if(myLabelBox[l][2*m] < labelBox[l][2*m]){
+	    labelBox[l][2*m] = myLabelBox[l][2*m];
+	  }
+	  if(myLabelBox[l][2*m+1] > labelBox[l][2*m+1]){
+	    labelBox[l][2*m+1] = myLabelBox[l][2*m+1];
+	  }
 	}
       }
-      vtkSortDataArray::Sort(boundaryList3);
     }
   }
 
-  vtkIdType nList1 = boundaryList1->GetNumberOfIds();
-  vtkIdType nList2 = boundaryList2->GetNumberOfIds();
-  vtkIdType nList3 = boundaryList3->GetNumberOfIds();
+  delete[] seedLip;
+  delete[] seedLabel;
 
-  vtkIdType* pList1 = boundaryList1->GetPointer(0);
-  vtkIdType* pList2 = boundaryList2->GetPointer(0);
-  vtkIdType* pList3 = boundaryList3->GetPointer(0);
+  hist->flush();
 
-  vtkIdType cList1 = 0;
-  vtkIdType cList2 = 0;
-  vtkIdType cList3 = 0;
+  // deleting boundary noise
+  for(int i=0; i<=numBreastCompartments; i++){
+    boundary[i].~perlinNoise();
+  }
+  ::operator delete(boundary);
 
-  bool dList1 = false;
-  bool dList2 = false;
-  bool dList3 = false;
 
-  while(!dList1 || !dList2 || !dList3){
-    vtkIdType curMin;
-    if(!dList1){
-      curMin = *pList1;
-      if(!dList2){
-	curMin = *pList2 < curMin ? *pList2 : curMin;
-	if(!dList3){
-	  curMin = *pList3 < curMin ? *pList3 : curMin;
-	  // check 1,2,3
-	  boundaryList->InsertNextId(curMin);
-	  while(*pList1 == curMin && !dList1){
-	    cList1++;
-	    if(cList1 < nList1){
-	      pList1++;
-	    } else {
-	      dList1 = true;
-	    }
-	  }
-	  while(*pList2 == curMin && !dList2){
-	    cList2++;
-	    if(cList2 < nList2){
-	      pList2++;
-	    } else {
-	      dList2 = true;
-	    }
-	  }
-	  while(*pList3 == curMin && !dList3){
-            cList3++;
-            if(cList3 < nList3){
-	      pList3++;
-            } else {
-	      dList3 = true;
-            }
-          }
-	} else {
-	  // check 1,2
-	  boundaryList->InsertNextId(curMin);
-	  while(*pList1 == curMin && !dList1){
-            cList1++;
-            if(cList1 <nList1){
-              pList1++;
-	    } else {
-	      dList1 = true;
-            }
-          }
-	  while(*pList2 == curMin && !dList2){
-            cList2++;
-            if(cList2 <nList2){
-	      pList2++;
-            } else {
-	      dList2 = true;
-            }
-          }
-	}
-      } else {
-	if(!dList3){
-	  curMin = *pList3 < curMin ? *pList3 : curMin;
-	  // check 1,3
-	  boundaryList->InsertNextId(curMin);
-	  while(*pList1 == curMin && !dList1){
-	    cList1++;
-	    if(cList1 <nList1){
-	      pList1++;
-	    } else {
-	      dList1 = true;
-	    }
-	  }
-	  while(*pList3 == curMin && !dList3){
-            cList3++;
-            if(cList3 < nList3){
-              pList3++;
-            } else {
-              dList3 = true;
-            }
-          }
-	} else {
-	  // check 1
-	  boundaryList->InsertNextId(curMin);
-	  while(*pList1 == curMin && !dList1){
-            cList1++;
-            if(cList1 <nList1){
-              pList1++;
-            } else {
-              dList1 = true;
-            }
-          }
-	}
-      }
-    } else {
-      // 1 done
-      if(!dList2){
-	curMin = *pList2;
-	if(!dList3){
-	  curMin = *pList3 < curMin ? *pList3 : curMin;
-	  // check 2,3
-	  boundaryList->InsertNextId(curMin);
-	  while(*pList2 == curMin && !dList2){
-            cList2++;
-            if(cList2 <nList2){
-              pList2++;
-            } else {
-              dList2 = true;
-            }
-          }
-	  while(*pList3 == curMin && !dList3){
-            cList3++;
-            if(cList3 < nList3){
-              pList3++;
-            } else {
-              dList3 = true;
-            }
-          }
-	} else {
-	  // check 2
-	  boundaryList->InsertNextId(curMin);
-	  while(*pList2 == curMin && !dList2){
-            cList2++;
-            if(cList2 <nList2){
-              pList2++;
-            } else {
-              dList2 = true;
-            }
-          }
-	}
-      } else {
-	// only 3 left
-	curMin = *pList3;
-	boundaryList->InsertNextId(curMin);
-	while(*pList3 == curMin && !dList3){
-	  cList3++;
-	  if(cList3 < nList3){
-	    pList3++;
-	  } else {
-	    dList3 = true;
-	  }
-	}
-      }
+  // voxel counts and bounding boxes from segmentation statistics
+  // only updating boundBox for gland compartments
+  for(int i=0; i<=numBreastCompartments; i++){
+    unsigned char val = compartmentVal[glandCompartments[i].compId];
+    glandCompartments[i].voxelCount = static_cast<int>(hist->get(val));
+    for(int m=0; m<6; m++){
+      glandCompartments[i].boundBox[m] = labelBox[val][m];
     }
   }
-	    
-  // delete array subList
-  delete [] subList1;
-  delete [] subList2;
-  delete [] subList3;
 
-  //cout << "done.\n";
+  // amount of fat and gland and ligament
+  fatVol = 0.0;
+  glandVol = 0.0;
+  cooperVol = 0.0;
+  glandVoxels = 0;
+  fatVoxels = 0;
+  cooperVoxels = 0;
+  //double ligVol = 0.0;
 
-  // correct boundary list to be all boundary values 
-  vtkIdType dnum = boundaryList->GetNumberOfIds();
-  for(vtkIdType i=0; i<dnum; i++){
-    double loc[3];
-    int ijk[3];
-    double pcoords[3];
-    breast->GetPoint(boundaryList->GetId(i),loc);
-    breast->ComputeStructuredCoordinates(loc,ijk,pcoords);
-    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(ijk));
-    if(p[0] != boundVal){
-      p[0] = boundVal;
-    }
+  // convert gland compartment voxel counts to volume
+  //#pragma omp parallel for reduction(+:glandVol,glandVoxels)
+  for(int i=0; i<=numBreastCompartments; i++){
+    glandCompartments[i].volume = voxelVol*glandCompartments[i].voxelCount;
+    glandVol += glandCompartments[i].volume;
+    glandVoxels += glandCompartments[i].voxelCount;
   }
 
-  /***********************
-	Skin
-  ***********************/
 
-  // create list of surrounding voxels to check
-  vtkSmartPointer<vtkIntArray> checkVoxels =
-    vtkSmartPointer<vtkIntArray>::New();
+  // fat volume includes the back plane, no ligaments exist yet
+  // fat and gland counts are taken from the histogram from now on
+  fatVoxels = hist->get(ufat);
+  fatVol = voxelVol*fatVoxels;
+  
+  //cout << "done.\n";
+  //cout << "Initial Voronoi fat fraction = " << fatVol/(glandVol+fatVol) << "\n";
 
-  checkVoxels->SetNumberOfComponents(3);
 
-  int voxelThick = (int)ceil(skinThick/imgRes);
+  targetGlandVol = (glandVol+fatVol)*(1-targetFatFrac);
 
-  for(int i=-1*voxelThick; i<=voxelThick; i++){
-    for(int j=-1*voxelThick; j<=voxelThick; j++){
-      for(int k=-1*voxelThick; k<=voxelThick; k++){
-	if(sqrt((double)(i*i+j*j+k*k))*imgRes <= skinThick){
-	  // found a voxel to check
-	  checkVoxels->InsertNextTuple3(i,j,k);
-	}
+  // add back plane voxels assigned to glandular compartment
+  numBackPlaneSkin = 0;
+  for(int i=0; i<dim[1]; i++){
+    for(int j=0; j<dim[2]; j++){
+      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(backPlaneInd,i,j));
+      if(p[0] <= compMax && p[0] >= compMin){
+	numBackPlaneSkin += 1;
+	int ijk[3] =  {backPlaneInd,i,j};
+	boundaryList->InsertNextId(breast->ComputePointId(ijk));
       }
     }
   }
 
-  vtkIdType numCheck = checkVoxels->GetNumberOfTuples();
-
-  int breastExtent[6];
-  breast->GetExtent(breastExtent);
-
-  // breast volume in voxels
-  long long int breastVoxVol = 0;
-
-  // only add skin for x>0
-  int minSkinXVox = static_cast<int>(ceil(-origin[0]/imgRes));
-  int areolaVoxel = static_cast<int>(ceil(areolaRad/imgRes));
-
-  // add skin thickness near nipple
-  double skinThick2 = skinThick*2.0;
-
-  // find point on mesh closest to center
-  vtkSmartPointer<vtkPointLocator> locator =
-    vtkSmartPointer<vtkPointLocator>::New();
-  locator->SetDataSet(innerPoly);
-  locator->BuildLocator();
-
-  vtkIdType nipplePt;
-  nipplePt = locator->FindClosestPoint(nipplePos);
-
-  int nippleVoxel[3];   // coordinates of nipple base
-  double nipplePCoords[3]; // parametric coordinates
-  breast->ComputeStructuredCoordinates(nipplePos,nippleVoxel,nipplePCoords);
 
-  // iterate over boundary voxel list, grow skin
-  vtkIdType nCurBoundary = boundaryList->GetNumberOfIds();
+  // check boundary voxels and add fat, muscle and near-nipple voxels to delete mask
+  nBoundary = boundaryList->GetNumberOfIds();
+  remBoundary = nBoundary;
 
+  boundaryDone = new unsigned char [nBoundary];
 
-  maxThread = omp_get_max_threads();
+  for(vtkIdType i=0; i<nBoundary; i++){
+    boundaryDone[i] = 0;
+  }
 
-#pragma omp parallel for num_threads(maxThread)
-  for(vtkIdType i=0; i<nCurBoundary; i++){
-    int myThread = omp_get_thread_num();
+  
+  for(vtkIdType i=0; i<nBoundary; i++){
     vtkIdType myId = boundaryList->GetId(i);
     double loc[3];
     double pcoords[3];
     int ijk[3];
     breast->GetPoint(myId, loc);
     breast->ComputeStructuredCoordinates(loc, ijk, pcoords);
-
+		
     unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(ijk));
-    
-    if(ijk[0] >= minSkinXVox){
-      double nipDist2 = vtkMath::Distance2BetweenPoints(loc,nipplePos);
-      if(nipDist2 > 4*areolaRad*areolaRad){
-	// boundary voxel for skinning
-	for(vtkIdType m=0; m<numCheck; m++){
-	  double offset[3];
-	  checkVoxels->GetTuple(m,offset);
-	  int a,b,c;
-	  a = ijk[0]+(int)offset[0];
-	  b = ijk[1]+(int)offset[1];
-	  c = ijk[2]+(int)offset[2];
-	  if(a>=breastExtent[0] && a<=breastExtent[1] && b>=breastExtent[2] && b<=breastExtent[3] &&
-	     c>=breastExtent[4] && c<=breastExtent[5]){
-	    unsigned char* q =
-	      static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
-	    if(q[0] == tissue.bg){
-#pragma omp atomic write
-	      q[0] = tissue.skin;
-	    }
-	  }
-	}
-      } else {
-	// areola
-	double mySkinThick = skinThick + (skinThick2-skinThick)/(1+exp(12/areolaRad*(sqrt(nipDist2)-areolaRad)));
-	int mySearchRad = static_cast<int>(ceil(mySkinThick/imgRes));
-	for(int a=ijk[0]-mySearchRad; a<=ijk[0]+mySearchRad; a++){
-	  for(int b=ijk[1]-mySearchRad; b<=ijk[1]+mySearchRad; b++){
-	    for(int c=ijk[2]-mySearchRad; c<=ijk[2]+mySearchRad; c++){
-	      unsigned char* q = static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
-	      if(q[0] == tissue.bg){
-		// check distance                                                                                                                                                                                                
-		double skinDist = imgRes*sqrt(static_cast<double>((a-ijk[0])*(a-ijk[0])+(b-ijk[1])*(b-ijk[1])+(c-ijk[2])*(c-ijk[2])));
-		if(skinDist <= mySkinThick){
-#pragma omp atomic write
-		  q[0] = tissue.skin;
-		}
-	      }
-	    }
-	  }
-	}
-      }
+		
+    if(p[0] == ufat || p[0] == tissue.muscle || vtkMath::Distance2BetweenPoints(loc, nipplePos) < areolaRad*areolaRad*2){
+      boundaryDone[i] = 1;
+      remBoundary++;
     }
-    p[0] = innerVal;
   }
+	
+  // determine glandular compartments to remove
 
-  // calculate inner volume and correct border errors
-#pragma omp parallel for reduction(+:breastVoxVol)
-  for(int i=0; i<dim[0]; i++){
-    int ijk[3];
-    ijk[0] = i;
-    for(int j=0; j<dim[1]; j++){
-      ijk[1] = j;
-      for(int k=0; k<dim[2]; k++){
-	ijk[2] = k;
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(ijk));
-	if(p[0] == innerVal){
-	  breastVoxVol += 1;
-	} else {
-	  if(p[0] == boundVal){
-	    p[0] = innerVal;
-	    breastVoxVol += 1;
-	  }
-	}
-      }
+  // find smallest compartment
+  unsigned int delNext=0;
+  double volNext=glandCompartments[0].volume;
+
+  for(int i=1; i<numBreastCompartments; i++){
+    if(glandCompartments[i].volume < volNext){
+      delNext = i;
+      volNext = glandCompartments[i].volume;
     }
   }
 
-  double breastVol = (double)breastVoxVol*pow(imgRes,3.0);
-
-  //cout << "Breast volume: " << breastVol/1000 << " cc ("<< breastVoxVol << " voxels).\n";
+  // target fat fraction post compartment removal
+  double targetFatFracStep1 = targetFatFrac*0.5;
+  currentFatFrac = fatVol/(fatVol+glandVol);
+  
+  if(currentFatFrac >= targetFatFracStep1){
+    targetFatFracStep1 = currentFatFrac;
+  }
 
-  /***********************
-	Nipple
-  **********************/
 
-  // create nipple structure
-  //cout << "Creating nipple structure...";
+  // disable gland compartment removal
+  //double removeGlandVol = (targetFatFracStep1-currentFatFrac)*(fatVol+glandVol);
+  double removeGlandVol = 0.0;
 
-  // squared radius
-  double nippleRad2 = nippleRad*nippleRad;
-	
-  double nippleNorm[3];
-  // extract normal
-  vtkSmartPointer<vtkFloatArray> normals2 =
-    vtkFloatArray::SafeDownCast(innerPoly->GetPointData()->GetNormals());
 
-  normals2->GetTuple(nipplePt, nippleNorm);
-  double nippleNormLen = sqrt(nippleNorm[0]*nippleNorm[0] +
-			      nippleNorm[1]*nippleNorm[1] + nippleNorm[2]*nippleNorm[2]);
-  for(int i=0; i<3; i++){
-    nippleNorm[i] = nippleNorm[i]/nippleNormLen;
-  }
-  // nippleNorm may be inward pointing
-  if(nippleNorm[0] < 0.0){
-    for(int i=0; i<3; i++){
-      nippleNorm[i] = -1.0*nippleNorm[i];
-    }
+  if(targetFatFrac < 0.4){
+    densityClass = 1;
+    // dense breast
+  } else if(targetFatFrac < 0.75){
+    densityClass = 2;
+    // heterogeneous breast
+  } else if(targetFatFrac < 0.9){
+    densityClass = 3;
+    // scattered density
+  } else{
+    densityClass = 4;
+    // fatty breast
   }
 
-  // create nipple
+  numKeepComp = numBreastCompartments;
+  // set numKeepComp based on fat fraction
+  //if(targetFatFrac < 0.3){
+  //  numKeepComp = numBreastCompartments;
+  //  // keep all
+  //} else if(targetFatFrac > 0.9){
+  //  numKeepComp = 4;
+  //  if(numBreastCompartments < 4){
+  //    numKeepComp = numBreastCompartments;
+  //  }
+  //} else {
+  //  // linear function of fat fraction
+  //  numKeepComp = 2 + static_cast<unsigned int>(round((numBreastCompartments-4)/(0.9-0.3)*(0.9-targetFatFrac)));
+  //  if(numBreastCompartments < 4){
+  //    numKeepComp = numBreastCompartments;
+  //  }
+  //}
 
-  // nipple function
-  // superquadric (rad/nippleRad)^t+abs(len/nippleLen)^t <= 1 t = 2.5 - 8
-  double nippleShape = 3.0;
-  
-  double searchRad = sqrt(2*nippleRad*nippleRad+nippleLen*nippleLen);
+  // identify compartments to remove
+  //unsigned int numDelComp = numBreastCompartments - numKeepComp;
+  keepCompList = (unsigned int*)malloc(numBreastCompartments*sizeof(unsigned int));
+  unsigned int *delCompList = (unsigned int*)malloc(numBreastCompartments*sizeof(unsigned int));
 
-  int searchSpace[6];	// search region for nipple
-  searchSpace[0] = nippleVoxel[0] - (int)ceil(searchRad/spacing[0]);
-  if(searchSpace[0] < breastExtent[0]){
-    searchSpace[0] = breastExtent[0];
-  }
-  searchSpace[1] = nippleVoxel[0] + (int)ceil(searchRad/spacing[0]);
-  if(searchSpace[1] > breastExtent[1]){
-    searchSpace[1] = breastExtent[1];
-  }
-  searchSpace[2] = nippleVoxel[1] - (int)ceil(searchRad/spacing[1]);
-  if(searchSpace[2] < breastExtent[2]){
-    searchSpace[2] = breastExtent[2];
-  }
-  searchSpace[3] = nippleVoxel[1] + (int)ceil(searchRad/spacing[1]);
-  if(searchSpace[3] > breastExtent[3]){
-    searchSpace[3] = breastExtent[3];
-  }
-  searchSpace[4] = nippleVoxel[2] - (int)ceil(searchRad/spacing[2]);
-  if(searchSpace[4] < breastExtent[4]){
-    searchSpace[4] = breastExtent[4];
-  }
-  searchSpace[5] = nippleVoxel[2] + (int)ceil(searchRad/spacing[2]);
-  if(searchSpace[5] > breastExtent[5]){
-    searchSpace[5] = breastExtent[5];
-  }
+  unsigned int foundComp = 0;
+  keepComp = 0;
 
-#pragma omp parallel for
-  for(int i=searchSpace[0]; i<= searchSpace[1]; i++){
-    for(int j=searchSpace[2]; j<= searchSpace[3]; j++){
-      for(int k=searchSpace[4]; k<= searchSpace[5]; k++){
-	// search cube, project onto normal and check if in nipple bound
-	// only if outside breast interior
-	unsigned char* q =
-	  static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(q[0] != innerVal){ // not in interior
-	  // get id for point
-	  vtkIdType id;
-	  int coord[3];
-	  coord[0] = i;
-	  coord[1] = j;
-	  coord[2] = k;
-	  id = breast->ComputePointId(coord);
-	  // get spatial coordinates of point
-	  double pos[3];
-	  breast->GetPoint(id,pos);
-	  // compute distance to nipple line and length along line
-	  double dist=0.0;
-	  double len=0.0;
-	  // project onto nipple line
-	  for(int m=0; m<3; m++){
-	    len += nippleNorm[m]*(pos[m]-nipplePos[m]);
-	  }
-	  // distance from nipple line
-	  for(int m=0; m<3; m++){
-	    dist += (pos[m]-nipplePos[m]-len*nippleNorm[m])*(pos[m]-nipplePos[m]-len*nippleNorm[m]);
-	  }
-	  dist = sqrt(dist);
-	  
-	  if(pow(dist/nippleRad,nippleShape)+pow(fabs(len)/nippleLen,nippleShape) <= 1.0){
-	    q[0] = tissue.nipple;
-	  }
-	}
+  //while(foundComp < numDelComp){
+  //  // random compartment
+  //  unsigned int c = static_cast<unsigned int>(floor(rgen->GetRangeValue(0.0, numBreastCompartments)));
+  //  rgen->Next();
+  //  if(glandCompartments[c].keep == true){
+  //    // found one
+  //    delCompList[foundComp] = c;
+  //    glandCompartments[c].keep = false;
+  //    foundComp++;
+  //  }
+  //}
+
+  while(removeGlandVol > volNext){
+    delCompList[foundComp] = delNext;
+    glandCompartments[delNext].keep = false;
+    removeGlandVol -= volNext;
+    foundComp++;
+    // update next compartment to delete
+    volNext = fatVol+glandVol;
+    for(int i=0; i<numBreastCompartments; i++){
+      if(glandCompartments[i].volume < volNext && glandCompartments[i].keep == true){
+	delNext = i;
+	volNext = glandCompartments[i].volume;
       }
     }
   }
 
-  // add chest muscle
-
-#pragma omp parallel for  
-  for(int j=0; j<dim[1]; j++){
-	
-    int muscleThick;
-		
-    if(leftSide){
-      muscleThick = static_cast<int>(ceil((minSkinXVox-1)*(1-static_cast<double>(j*j)/(dim[1]*dim[1]))));
-    }else{
-      muscleThick = static_cast<int>(ceil((minSkinXVox-1)*(1-static_cast<double>((j-dim[1])*(j-dim[1]))/(dim[1]*dim[1]))));
+  // populate keepCompList
+  keepComp = 0;
+  for(int i=0; i<numBreastCompartments; i++){
+    if(glandCompartments[i].keep == true){
+      keepCompList[keepComp] = i;
+      keepComp++;
     }
-		
-    for(int k=0; k<dim[2]; k++){
-      for(int i=0; i<=muscleThick; i++){
-	unsigned char* p =
-	  static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == innerVal){
-	  p[0] = tissue.muscle;
+  }
+    
+
+  // set removed compartments to fat
+      #pragma omp parallel for
+  for(int i=0; i<foundComp; i++){
+    int mc = delCompList[i];
+    for(int a=glandCompartments[mc].boundBox[0]; a<=glandCompartments[mc].boundBox[1]; a++){
+      for(int b=glandCompartments[mc].boundBox[2]; b<=glandCompartments[mc].boundBox[3]; b++){
+	for(int c=glandCompartments[mc].boundBox[4]; c<=glandCompartments[mc].boundBox[5]; c++){
+	  unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
+	  if(p[0] == compartmentVal[glandCompartments[mc].compId]){
+	    hist->move(p[0], ufat);
+	    p[0] = ufat;
+	  }
 	}
       }
     }
-  }
-
-  /***********************
-	Compartments
-  ***********************/
-
-  // breast segmentation into compartments and lipid buffer zone
+  } 
 
-  int numBreastCompartments = vm["compartments.num"].as<int>();
-  
-  int numAngles = numBreastCompartments;
-	
-  double seedBaseDist = vm["compartments.seedBaseDist"].as<double>();	// distance along nipple line of seed base
+  // update fat fraction and voxel counts
+  for(int i=0; i<foundComp; i++){
+    glandVol -= glandCompartments[delCompList[i]].volume;
+    fatVol += glandCompartments[delCompList[i]].volume;
+  }
 
-  // pick backplane seed points on this plane
-  int numBackSeeds = vm["compartments.numBackSeeds"].as<int>();	// number of backplane seed points
-  int numSkinSeeds = 250;
+  hist->flush();
+  fatVoxels = hist->get(ufat);
+  glandVoxels = 0;
+  for(int l=compMin; l<=compMax; l++){
+    glandVoxels += hist->get(l);
+  }
 
-  double angularJitter = 2*pi*numAngles*vm["compartments.angularJitter"].as<double>();
-  // max angular jitter for seed placement
-  double zJitter = vm["compartments.zJitter"].as<double>();	// jitter in z direction
-  double maxFracRadialDist = vm["compartments.maxFracRadialDist"].as<double>();
-  // minimum and maximum radial distance from baseSeed as fraction of distance to breast surface
-  double minFracRadialDist = vm["compartments.minFracRadialDist"].as<double>();
+  return EXIT_SUCCESS;
+}
 
-  double scaleMin[3];  // scaling for gland compartments
-  scaleMin[0] = vm["compartments.minScaleNippleDir"].as<double>();
-  scaleMin[1] = vm["compartments.minScale"].as<double>();
-  scaleMin[2] = vm["compartments.minScale"].as<double>();
-	
-  double scaleMax[3];	// 1st dimension principally points toward nipple - gland seeds
-  scaleMax[0] = vm["compartments.maxScaleNippleDir"].as<double>();
-  scaleMax[1] = vm["compartments.maxScale"].as<double>();
-  scaleMax[2] = vm["compartments.maxScale"].as<double>();
-	
-  double gMin = vm["compartments.minGlandStrength"].as<double>();	// strength of gland compartments
-  double gMax = vm["compartments.maxGlandStrength"].as<double>();
-  double deflectMax = pi*vm["compartments.maxDeflect"].as<double>();
-  // maximum deflection angle from pointing towards nipple (gland compartments)
+int main(int argc, char* argv[]){
 
-  // backplane, nipple are spherical weighting
-  // skin orients towards nipple
-  double scaleSkinMin[3];
-  scaleSkinMin[0] = vm["compartments.minSkinScaleNippleDir"].as<double>();
-  scaleSkinMin[1] = vm["compartments.minSkinScale"].as<double>();
-  scaleSkinMin[2] = vm["compartments.minSkinScale"].as<double>();
-  double scaleSkinMax[3];
-  scaleSkinMax[0] = vm["compartments.maxSkinScaleNippleDir"].as<double>();
-  scaleSkinMax[1] = vm["compartments.maxSkinScale"].as<double>();
-  scaleSkinMax[2] = vm["compartments.maxSkinScale"].as<double>();
+  double pi = vtkMath::Pi();
 	
-  double gSkin = vm["compartments.skinStrength"].as<double>();
-
-  double scaleBack = vm["compartments.backScale"].as<double>();
-  double gBack = vm["compartments.backStrength"].as<double>();
+  // configuration file variables
+  po::options_description baseOpt("base options");
+  baseOpt.add_options()
+    ("base.outputDir",po::value<std::string>()->default_value("."),"output directory")
+    ("base.imgRes",po::value<double>()->default_value(0.25),"phantom resolution (mm)")
+    ("base.skinThick",po::value<double>()->default_value(0.75),"skin thickness (mm)")
+    ("base.nippleLen",po::value<double>()->default_value(4.0),"nipple length (mm)")
+    ("base.nippleRad",po::value<double>()->default_value(4.0),"nipple radius (mm)")
+    ("base.areolaRad",po::value<double>()->default_value(8.0),"areola radius (mm)")
+    ("base.leftBreast",po::value<bool>()->default_value(true),"left side breast (boolean)")
+    ("base.targetFatFrac",po::value<double>()->default_value(0.75),"desired fraction of breast to be fat")
+    ("base.seed",po::value<unsigned int>(),"random number generator seed")
+    ;
 
-  double scaleNipple = vm["compartments.nippleScale"].as<double>();
-  double gNipple = vm["compartments.nippleStrength"].as<double>();
-	
-  double ligDistThresh = 12.0;
-	
-  // radius of fat seeds to check for segmentation
-  double compSeedRadius = vm["compartments.voronSeedRadius"].as<double>();
+  po::options_description volumeOpt("Volume storage options");
+  volumeOpt.add_options()
+    ("volume.brickSize",po::value<int>()->default_value(32),"edge length of volume bricks (voxels)")
+    ("volume.outOfCore",po::value<bool>()->default_value(false),"keep volume in memory-mapped raw output file (boolean)")
+    ("volume.firstTouch",po::value<bool>()->default_value(false),"initialize volume in parallel for NUMA page placement (boolean)")
+    ("volume.hugePages",po::value<bool>()->default_value(false),"back volume with transparent huge pages (boolean)")
+    ("volume.pinThreads",po::value<bool>()->default_value(false),"pin OpenMP threads to cpus (boolean)")
+    ;
 
-  int numFatSeeds = numAngles + numBackSeeds + numSkinSeeds;  // total number of fat seed points
-
-  typedef struct breastComp{
-    // data structure for breast compartment
-    double scale[3]; // size
-    double g;	// size weight
-    vtkVector3d axis[3];	// local coordinate system
-    double pos[3];	// position
-    bool fat;	// is it fat?
-    bool keep;  // retain glandular compartment?
-    unsigned char compId;	// compartment id 1,2,....
-    int boundBox[6];	// bounding box indices
-    int voxelCount;		// number of voxels
-    double volume;		// volume (cubic mm)
-  } breastComp;
+  po::options_description cacheOpt("Compartment cache options");
+  cacheOpt.add_options()
+    ("cache.dir",po::value<std::string>()->default_value(""),"directory holding compartment stage cache, empty disables the cache")
+    ("cache.shapeSeed",po::value<unsigned int>(),"random number generator seed for stages up to compartments")
+    ;
 
-  // memory allocation
-  breastComp *glandCompartments = (breastComp*)malloc((numBreastCompartments+1)*sizeof(breastComp));
-  breastComp *fatCompartments = (breastComp*)malloc(numFatSeeds*sizeof(breastComp));
-	
-  // breast dimensions for initializing bounding box
-  int breastDim[3];
-  breast->GetDimensions(breastDim);
-
-  vtkSmartPointer<vtkPoints> seeds =
-    vtkSmartPointer<vtkPoints>::New();
-
-  // base of spokes for seed placement
-  double seedBase[3];
-  // coordinate system for seedBase
-  vtkVector3d baseAxis[3];
-
-  // set seed base location and specify first coordinate vector
-  for(int i=0; i<3; i++){
-    seedBase[i] = nipplePos[i]-seedBaseDist*nippleNorm[i];
-    baseAxis[0][i] = -1.0*nippleNorm[i];
-  }
-
-  // check seed base within breast
-  int coords[3];	// coordinates of nipple seed base
-  double pcoords[3]; // parametric coordinates
-  breast->ComputeStructuredCoordinates(seedBase,coords,pcoords);
-  unsigned char* base = static_cast<unsigned char*>(breast->GetScalarPointer(coords));
-  if(base[0] != innerVal){
-    // outside breast error
-    cout << "Error, breast compartment seed base outside breast volume\n";
-    return EXIT_FAILURE;
-  }
-
-  // construct other coordinate vectors
-
-  // second coordinate vector based on Gram-Schmidt using (0,1,0)
-  vtkVector3d v2;
-  v2[0] = seedBase[0];
-  v2[1] = seedBase[1] - 1.0;
-  v2[2] = seedBase[2];
-  double innerProd = v2.Dot(baseAxis[0]);
-
-  for(int i=0; i<3; i++){
-    baseAxis[1][i] = v2[i] - innerProd*baseAxis[0][i];
-  }
-  // normalize
-  baseAxis[1].Normalize();
-
-  // calculate 3rd vector based on cross product
-  baseAxis[2] = baseAxis[0].Cross(baseAxis[1]);
+  po::options_description shapeOpt("breast shape options");
+  shapeOpt.add_options()
+    ("shape.ures",po::value<double>()->default_value(0.02),"u resolution of base shape")
+    ("shape.vres",po::value<double>()->default_value(0.02),"v resolution of base shape")
+    ("shape.pointSep",po::value<double>()->default_value(0.01),"minimum point separation (mm)")
+    ("shape.ringWidth",po::value<double>()->default_value(10.0),"thickness of back ring (mm)")
+    ("shape.ringSep",po::value<double>()->default_value(0.5),"ring node step size (mm)")
+    ("shape.featureAngle",po::value<double>()->default_value(20.0),"angle to preserve while smoothing (degrees)")
+    ("shape.targetReduction",po::value<double>()->default_value(0.05),"fraction of triangles to decimate")
+    ("shape.a1b",po::value<double>()->default_value(1.0),"bottom size")
+    ("shape.a1t",po::value<double>()->default_value(1.0),"top size")
+    ("shape.a2l",po::value<double>()->default_value(1.0),"left size")
+    ("shape.a2r",po::value<double>()->default_value(1.0),"right size")
+    ("shape.a3",po::value<double>()->default_value(1.0),"outward size")
+    ("shape.eps1",po::value<double>()->default_value(1.0),"u quadric exponent")
+    ("shape.eps2",po::value<double>()->default_value(1.0),"v quadric exponent")
+    ("shape.doPtosis",po::value<bool>()->default_value(false),"ptosis deformation (boolean)")
+    ("shape.ptosisB0",po::value<double>()->default_value(0.4),"ptosis b0")
+    ("shape.ptosisB1",po::value<double>()->default_value(0.3),"ptosis b1")
+    ("shape.doTurn",po::value<bool>()->default_value(false),"turn deformation (boolean)")
+    ("shape.turnC0",po::value<double>()->default_value(-0.4),"turn c0")
+    ("shape.turnC1",po::value<double>()->default_value(0.2),"turn c1")
+    ("shape.doTopShape",po::value<bool>()->default_value(false),"top shape deformation (boolean)")
+    ("shape.topShapeS0",po::value<double>()->default_value(1.54),"top shape s0")
+    ("shape.topShapeS1",po::value<double>()->default_value(1.3),"top shape s1")
+    ("shape.topShapeT0",po::value<double>()->default_value(-3.0),"top shape t0")
+    ("shape.topShapeT1",po::value<double>()->default_value(-1.0),"top shape t1")
+    ("shape.doFlattenSide",po::value<bool>()->default_value(false),"flatten side deformation (boolean)")
+    ("shape.flattenSideG0",po::value<double>()->default_value(-0.4),"flatten side g0")
+    ("shape.flattenSideG1",po::value<double>()->default_value(0.2),"flatten side g1")
+    ("shape.doTurnTop",po::value<bool>()->default_value(false),"turn top deformation (boolean)")
+    ("shape.turnTopH0",po::value<double>()->default_value(-2.7),"turn top h0")
+    ("shape.turnTopH1",po::value<double>()->default_value(-3.7),"turn top h1")
+    ;
 
-  /* now have baseAxis coordinate system
-     shoot rays toward breast surface and determine compartment seed locations
-     and breast surface seed points */
+  po::options_description compartOpt("breast compartment options");
+  compartOpt.add_options()
+    ("compartments.num",po::value<int>()->default_value(8),"number of breast compartments")
+    ("compartments.seedBaseDist",po::value<double>()->default_value(12.5),"distance along nipple line of compartment seed base (mm)")
+    ("compartments.backFatBufferFrac",po::value<double>()->default_value(0.2),"fraction of phantom in nipple direction forced to be fat")
+    ("compartments.numBackSeeds",po::value<int>()->default_value(100),"number of backplane seed points")
+    ("compartments.angularJitter",po::value<double>()->default_value(0.125),"maximum seed jitter (fraction of subtended angle)")
+    ("compartments.zJitter",po::value<double>()->default_value(5.0),"maximum seed jitter in nipple direction (mm)")
+    ("compartments.maxFracRadialDist",po::value<double>()->default_value(0.5),"maximum radial distance from base seed as a fraction of distance to breast surface")
+    ("compartments.minFracRadialDist",po::value<double>()->default_value(0.25),"minimum radial distance from base seed as a fraction of distance to breast surface")
+    ("compartments.minScaleNippleDir",po::value<double>()->default_value(0.01),"minimum scale in nipple direction")
+    ("compartments.maxScaleNippleDir",po::value<double>()->default_value(0.01),"maximum scale in nipple direction")
+    ("compartments.minScale",po::value<double>()->default_value(50.0),"minimum scale in non-nipple direction")
+    ("compartments.maxScale",po::value<double>()->default_value(60.0),"maximum scale in non-nipple direction")
+    ("compartments.minGlandStrength",po::value<double>()->default_value(20.0),"minimum gland strength")
+    ("compartments.maxGlandStrength",po::value<double>()->default_value(20.0),"maximum gland strength")
+    ("compartments.maxDeflect",po::value<double>()->default_value(0.01),"maximum compartment deflection angle from pointing towards nipple (fraction of pi)")
+    ("compartments.minSkinScaleNippleDir",po::value<double>()->default_value(0.01),"minimum scale skin seeds in nipple direction")
+    ("compartments.maxSkinScaleNippleDir",po::value<double>()->default_value(0.01),"maximum scale skin seeds in nipple direction")
+    ("compartments.minSkinScale",po::value<double>()->default_value(70.0),"minimum scale skin in non-nipple direction")
+    ("compartments.maxSkinScale",po::value<double>()->default_value(70.0),"maximum scale skin in non-nipple direction")
+    ("compartments.skinStrength",po::value<double>()->default_value(20.0),"skin strength")
+    ("compartments.backScale",po::value<double>()->default_value(50.0),"back scale")
+    ("compartments.backStrength",po::value<double>()->default_value(50.0),"back strength")
+    ("compartments.nippleScale",po::value<double>()->default_value(50.0),"nipple scale")
+    ("compartments.nippleStrength",po::value<double>()->default_value(50.0),"nipple strength")
+    ("compartments.voronSeedRadius",po::value<double>()->default_value(40.0),"check all seeds in radius (mm)")
+    ;
   
-  double rayLength = 500.0;	// some large value to guarantee being outside of breast
+  po::options_description TDLUOpt("TDLU options");
+  TDLUOpt.add_options()
+    ("TDLU.maxLength",po::value<double>()->default_value(4.0),"maximum TDLU length")
+    ("TDLU.minLength",po::value<double>()->default_value(2.0),"minimum TDLU length")
+    ("TDLU.maxWidth",po::value<double>()->default_value(2.0),"maximum TDLU width")
+    ("TDLU.minWidth",po::value<double>()->default_value(1.0),"minimum TDLU width")
+    ;
+  
+  po::options_description perlinOpt("Perlin noise options");
+  perlinOpt.add_options()
+    ("perlin.maxDeviation",po::value<double>()->default_value(0.1),"maximum perlin perturbation fraction of radius")
+    ("perlin.frequency",po::value<double>()->default_value(0.5),"starting frequency")
+    ("perlin.lacunarity",po::value<double>()->default_value(1.5),"octave frequency multiplier")
+    ("perlin.persistence",po::value<double>()->default_value(0.2),"octave signal decay")
+    ("perlin.numOctaves",po::value<int>()->default_value(6),"number of frequency octaves")
+    ("perlin.xNoiseGen",po::value<int>()->default_value(683),"x direction noise generation seed")
+    ("perlin.yNoiseGen",po::value<int>()->default_value(4933),"y direction noise generation seed")
+    ("perlin.zNoiseGen",po::value<int>()->default_value(23),"z direction noise generation seed")
+    ("perlin.seedNoiseGen",po::value<int>()->default_value(3095),"seed noise generation")
+    ("perlin.shiftNoiseGen",po::value<int>()->default_value(11),"shift noise generation seed")
+    ;
 
-  for(int i=0; i<numAngles; i++){
-    double theta = (double)i*2*pi/(double)numAngles;
-    
-    // add theta jitter
-    theta = theta + rgen->GetRangeValue(-1.0*angularJitter,angularJitter);
-    rgen->Next();
+  po::options_description boundaryOpt("Boundary noise options");
+  boundaryOpt.add_options()
+    ("boundary.maxDeviation",po::value<double>()->default_value(0.25),"maximum perlin perturbation fraction of radius")
+    ("boundary.frequency",po::value<double>()->default_value(0.2),"starting frequency")
+    ("boundary.lacunarity",po::value<double>()->default_value(1.5),"octave frequency multiplier")
+    ("boundary.persistence",po::value<double>()->default_value(0.5),"octave signal decay")
+    ;
 
-    vtkVector3d rayDir;
-    double lineEnd[3];
-    for(int j=0; j<3; j++){
-      rayDir[j] = cos(theta)*baseAxis[1][j]+sin(theta)*baseAxis[2][j];
-      lineEnd[j] = seedBase[j]+rayLength*rayDir[j];
-    }
+  po::options_description perturbOpt("Lobule perturbation noise options");
+  perturbOpt.add_options()
+    ("perturb.maxDeviation",po::value<double>()->default_value(0.25),"maximum perlin perturbation fraction of radius")
+    ("perturb.frequency",po::value<double>()->default_value(0.2),"starting frequency")
+    ("perturb.lacunarity",po::value<double>()->default_value(1.5),"octave frequency multiplier")
+    ("perturb.persistence",po::value<double>()->default_value(0.5),"octave signal decay")
+    ;
+	
+  po::options_description bufferOpt("Lobule glandular buffer options");
+  bufferOpt.add_options()
+    ("buffer.maxDeviation",po::value<double>()->default_value(0.1),"maximum perlin buffer fraction of radius")
+    ("buffer.frequency",po::value<double>()->default_value(0.2),"starting frequency")
+    ("buffer.lacunarity",po::value<double>()->default_value(1.5),"octave frequency multiplier")
+    ("buffer.persistence",po::value<double>()->default_value(0.5),"octave signal decay")
+    ;
+	
+  po::options_description voronOpt("Voronoi options");
+  voronOpt.add_options()
+    ("voronoi.fatInFatSeedDensity",po::value<double>()->default_value(0.0),"fat voronoi seed density (mm^-3)")
+    ("voronoi.fatInGlandSeedDensity",po::value<double>()->default_value(0.0),"fat voronoi seed in glandular tissue density (mm^-3)")
+    ("voronoi.glandInGlandSeedDensity",po::value<double>()->default_value(0.0),"glandular voronoi seed density (mm^-3)")
+    ("voronoi.TDLUDeflectMax",po::value<double>()->default_value(0.0),"maximum deflection (fraction of pi)")
+    ("voronoi.minScaleLenTDLU",po::value<double>()->default_value(0.0),"minimum length scale")
+    ("voronoi.maxScaleLenTDLU",po::value<double>()->default_value(0.0),"maximum length scale")
+    ("voronoi.minScaleWidTDLU",po::value<double>()->default_value(0.0),"minimum width scale")
+    ("voronoi.maxScaleWidTDLU",po::value<double>()->default_value(0.0),"maximum width scale")
+    ("voronoi.minStrTDLU",po::value<double>()->default_value(0.0),"minimum strength")
+    ("voronoi.maxStrTDLU",po::value<double>()->default_value(0.0),"maximum strength")
+    ("voronoi.fatInFatDeflectMax",po::value<double>()->default_value(0.15),"maximum deflection (fraction of pi)")
+    ("voronoi.minScaleLenFatInFat",po::value<double>()->default_value(0.0),"minimum length scale")
+    ("voronoi.maxScaleLenFatInFat",po::value<double>()->default_value(0.0),"maximum length scale")
+    ("voronoi.minScaleWidFatInFat",po::value<double>()->default_value(0.0),"minimum width scale")
+    ("voronoi.maxScaleWidFatInFat",po::value<double>()->default_value(0.0),"maximum width scale")
+    ("voronoi.minStrFatInFat",po::value<double>()->default_value(0.0),"minimum strength")
+    ("voronoi.maxStrFatInFat",po::value<double>()->default_value(0.0),"maximum strength")
+    ("voronoi.fatInGlandDeflectMax",po::value<double>()->default_value(0.0),"maximum deflection (fraction of pi)")
+    ("voronoi.minScaleLenFatInGland",po::value<double>()->default_value(0.0),"minimum length scale")
+    ("voronoi.maxScaleLenFatInGland",po::value<double>()->default_value(0.0),"maximum length scale")
+    ("voronoi.minScaleWidFatInGland",po::value<double>()->default_value(0.0),"minimum width scale")
+    ("voronoi.maxScaleWidFatInGland",po::value<double>()->default_value(0.0),"maximum width scale")
+    ("voronoi.minStrFatInGland",po::value<double>()->default_value(0.0),"minimum strength")
+    ("voronoi.maxStrFatInGland",po::value<double>()->default_value(0.0),"maximum strength")
+    ("voronoi.glandInGlandDeflectMax",po::value<double>()->default_value(0.0),"maximum deflection (fraction of pi)")
+    ("voronoi.minScaleLenGlandInGland",po::value<double>()->default_value(0.0),"minimum length scale")
+    ("voronoi.maxScaleLenGlandInGland",po::value<double>()->default_value(0.0),"maximum length scale")
+    ("voronoi.minScaleWidGlandInGland",po::value<double>()->default_value(0.0),"minimum width scale")
+    ("voronoi.maxScaleWidGlandInGland",po::value<double>()->default_value(0.0),"maximum width scale")
+    ("voronoi.minStrGlandInGland",po::value<double>()->default_value(0.0),"minimum strength")
+    ("voronoi.maxStrGlandInGland",po::value<double>()->default_value(0.0),"maximum strength")
+    ("voronoi.seedRadius",po::value<double>()->default_value(10),"check seeds in radius (mm)")
+    ;
 
-    // intersection variables
-    double tol = 0.005;
-    double tval; // not sure what this is for
-    vtkIdType intersectCell;
-    int subId;  // probably don't need this
+  po::options_description fatOpt("Fat lobule options");
+  fatOpt.add_options()
+    ("fat.minLobuleAxis",po::value<double>()->default_value(7.0),"min lobule axis length (mm)")
+    ("fat.maxLobuleAxis",po::value<double>()->default_value(12.0),"max lobule axis length (mm)")
+    ("fat.minAxialRatio",po::value<double>()->default_value(0.33),"min axial ratio")
+    ("fat.maxAxialRatio",po::value<double>()->default_value(0.53),"max axial ratio")
+    ("fat.minLobuleGap",po::value<double>()->default_value(0.2),"minimum ligament separation between lobules")
+    ("fat.maxCoeffStr",po::value<double>()->default_value(0.08),"maximum of absolute value of Fourier coefficient as fraction of main radius")
+    ("fat.minCoeffStr",po::value<double>()->default_value(0.02),"minimum of absolute value of Fourier coefficient as fraction of main radius")
+    ("fat.maxLobuleTry",po::value<int>()->default_value(600),"maximum number of trial lobules")
+    ;
 
-    double intersect[3]; // output position
-    double pcoords[3];
+  po::options_description ligOpt("Ligament options");
+  ligOpt.add_options()
+    ("lig.thickness",po::value<double>()->default_value(0.12),"ligament thickness (mm)")
+    ("lig.targetFrac",po::value<double>()->default_value(0.85),"ligamented volume stopping fraction")
+    ("lig.maxTry",po::value<int>()->default_value(15000),"maximum number of ligaments")
+    ("lig.minAxis",po::value<double>()->default_value(15.0),"min lobule axis length (mm)")
+    ("lig.maxAxis",po::value<double>()->default_value(20.0),"max lobule axis length (mm)")
+    ("lig.minAxialRatio",po::value<double>()->default_value(0.3),"min axial ratio")
+    ("lig.maxAxialRatio",po::value<double>()->default_value(0.4),"max axial ratio")
+    ("lig.maxPerturb",po::value<double>()->default_value(0.1),"maximum perlin perturbation fraction of radius")
+    ("lig.maxDeflect",po::value<double>()->default_value(0.12),"maximum deflection from nipple direction (fraction of pi)")
+    ("lig.scale",po::value<double>()->default_value(0.007),"perlin frequency scaling")
+    ("lig.lacunarity",po::value<double>()->default_value(1.8),"octave frequency multiplier")
+    ("lig.persistence",po::value<double>()->default_value(0.6),"octave signal decay")
+    ("lig.numOctaves",po::value<int>()->default_value(6),"number of frequency octaves")
+    ;
 
-    vtkSmartPointer<vtkCellLocator> innerLocator =
-      vtkSmartPointer<vtkCellLocator>::New();
-    innerLocator->SetDataSet(innerPoly);
-    innerLocator->BuildLocator();
+  po::options_description ductTreeOpt("Duct tree options");
+  ductTreeOpt.add_options()
+    ("ductTree.maxBranch",po::value<uint>()->default_value(100),"Maximum number of branches")
+    ("ductTree.maxGen",po::value<uint>()->default_value(15),"Maximum generation")
+    ("ductTree.baseLength",po::value<double>()->default_value(7.6),"main branch length (mm)")
+    ("ductTree.initRad",po::value<double>()->default_value(2.0),"tree start radius")
+    ("ductTree.nFillX",po::value<uint>()->default_value(100),"number x voxels for density map")
+    ("ductTree.nFillY",po::value<uint>()->default_value(100),"number y voxels for density map")
+    ("ductTree.nFillZ",po::value<uint>()->default_value(100),"number z voxels for density map")
+    ("ductTree.threads",po::value<uint>()->default_value(0),"number of duct trees grown at once, 0 for automatic")
+    ;
 
-    if(innerLocator->IntersectWithLine(seedBase, lineEnd, tol,
-				       tval, intersect, pcoords, subId, intersectCell)){
-      
-      // the breast surface seed point is intersect
-      seeds->InsertNextPoint(intersect);
-      
-      // add fat seed to structure
-      for(int j=0; j<3; j++){
-	fatCompartments[i].pos[j] = intersect[j];
-	fatCompartments[i].scale[j] = rgen->GetRangeValue(scaleSkinMin[j],scaleSkinMax[j]);
-	rgen->Next();
-      }
-      fatCompartments[i].g = gSkin;
-      fatCompartments[i].fat = true;
-      fatCompartments[i].keep = true;
-      fatCompartments[i].compId = 0;
-      fatCompartments[i].voxelCount = 0;
+  po::options_description ductBrOpt("Duct Branch options");
+  ductBrOpt.add_options()
+    ("ductBr.childMinRad",po::value<double>()->default_value(0.25),"min radius to have children")
+    ("ductBr.minRadFrac",po::value<double>()->default_value(0.65),"min start radius as fraction of parent radius")
+    ("ductBr.maxRadFrac",po::value<double>()->default_value(0.99),"max start radius as fraction of parent radius")
+    ("ductBr.lenShrink",po::value<double>()->default_value(0.5),"duct length relative to parent")
+    ("ductBr.lenRange",po::value<double>()->default_value(0.1),"duct length fraction variability")
+    ("ductBr.rotateJitter",po::value<double>()->default_value(0.1),"jitter in azimuthal angle of second child")
+    ;
+  
+  po::options_description ductSegOpt("Duct Segment options");
+  ductSegOpt.add_options()
+    ("ductSeg.radiusBetaA",po::value<double>()->default_value(2.0),"radius distribution shape parameter A")
+    ("ductSeg.radiusBetaB",po::value<double>()->default_value(2.0),"radius distribution shape parameter B")
+    ("ductSeg.maxCurvRad",po::value<double>()->default_value(20.0),"max radius of curvature")
+    ("ductSeg.maxCurvFrac",po::value<double>()->default_value(0.33),"max fraction of circle")
+    ("ductSeg.minEndRad",po::value<double>()->default_value(0.85),"min end radius as fraction of start radius")
+    ("ductSeg.maxEndRad",po::value<double>()->default_value(1.05),"max end radius as fraction of start radius")
+    ("ductSeg.angleWt",po::value<double>()->default_value(1.0),"cost function preferential angle weighting")
+    ("ductSeg.densityWt",po::value<double>()->default_value(5e-5),"cost function density weighting")
+    ("ductSeg.numTry",po::value<uint>()->default_value(10),"number of trial segments")
+    ("ductSeg.thinFrac",po::value<double>()->default_value(0.0),"radius as fraction of voxel size below which the first valid trial is kept, 0 to disable")
+    ("ductSeg.maxTry",po::value<uint>()->default_value(100),"max number of trial segments before reducing length")
+    ("ductSeg.absMaxTry",po::value<uint>()->default_value(10000),"max number of trial segments before completely giving up")
+    // check if this needs to be changed
+    ("ductSeg.roiStep",po::value<double>()->default_value(0.1),"step size for checking segment validity")
+    ("ductSeg.segFrac",po::value<double>()->default_value(0.25),"fraction of branch length per segment")
+    ;
+  
+  /* ==========================================================================================
+  Modifications were made in Lines 277 and 278 by Seonyeong Park to improve blood vasculature 
+  modeling for use in optical and optoacoustic imaging.
+  
+  Reference:
+    Seonyeong Park, Umberto Villa, Fu Li, Refik Mert Cam, Alexander A. Oraevsky, Mark A. 
+    Anastasio, "Stochastic three-dimensional numerical phantoms to enable computational studies 
+    in quantitative optoacoustic computed tomography of breast cancer," J. Biomed. Opt. 28(6) 
+    066002 (20 June 2023) https://doi.org/10.1117/1.JBO.28.6.066002
+  ========================================================================================== */
+  po::options_description vesselTreeOpt("Vessel tree options");
+  vesselTreeOpt.add_options()
+    ("vesselTree.maxBranch",po::value<uint>()->default_value(100),"Maximum number of branches")
+    ("vesselTree.maxGen",po::value<uint>()->default_value(15),"Maximum generation")
+    ("vesselTree.baseLength",po::value<double>()->default_value(12.0),"main branch length (mm)")
+    ("vesselTree.initRad",po::value<double>()->default_value(2.0),"tree start radius")
+    ("vesselTree.nFillX",po::value<uint>()->default_value(100),"number x voxels for density map")
+    ("vesselTree.nFillY",po::value<uint>()->default_value(100),"number y voxels for density map")
+    ("vesselTree.nFillZ",po::value<uint>()->default_value(100),"number z voxels for density map")
+    ("vesselTree.saveFill",po::value<bool>()->default_value(false),"save network density map after each tree")
+    ("vesselTree.vesselEdgeSep1", po::value<double>()->default_value(2), "distance from edge of breast of vessel entry point (mm)")
+    ("vesselTree.vesselEdgeSep2", po::value<double>()->default_value(24), "distance from edge of breast of vessel entry point (mm)");
+    ;
 
-      fatCompartments[i].boundBox[0] = breastDim[0]+1;
-      fatCompartments[i].boundBox[1] = -1;
-      fatCompartments[i].boundBox[2] = breastDim[1]+1;
-      fatCompartments[i].boundBox[3] = -1;
-      fatCompartments[i].boundBox[4] = breastDim[2]+1;
-      fatCompartments[i].boundBox[5] = -1;
+  po::options_description vesselBrOpt("Vessel branch options");
+  vesselBrOpt.add_options()
+    ("vesselBr.childMinRad",po::value<double>()->default_value(0.25),"min radius to have children")
+    ("vesselBr.minRadFrac",po::value<double>()->default_value(0.6),"min start radius as fraction of parent radius")
+    ("vesselBr.maxRadFrac",po::value<double>()->default_value(0.85),"max start radius as fraction of parent radius")
+    ("vesselBr.lenShrink",po::value<double>()->default_value(0.5),"mean vessel length relative to parent")
+    ("vesselBr.lenRange",po::value<double>()->default_value(0.1),"vessel length fraction variability")
+    ("vesselBr.rotateJitter",po::value<double>()->default_value(0.1),"jitter in azimuthal angle of second child")
 
-      // principle unit vector oriented towards nipple
-      // first vector
-      for(int j=0; j<3; j++){
-	fatCompartments[i].axis[0][j] = nipplePos[j] - intersect[j];
-      }
-      // normalize
-      fatCompartments[i].axis[0].Normalize();
+    ;
+  
+  po::options_description vesselSegOpt("Vessel segment options");
+  vesselSegOpt.add_options()
+    ("vesselSeg.radiusBetaA",po::value<double>()->default_value(2.0),"radius distribution shape parameter A")
+    ("vesselSeg.radiusBetaB",po::value<double>()->default_value(2.0),"radius distribution shape parameter B")
+    ("vesselSeg.maxCurvRad",po::value<double>()->default_value(20.0),"max radius of curvature")
+    ("vesselSeg.maxCurvFrac",po::value<double>()->default_value(0.33),"max fraction of circle")
+    ("vesselSeg.minEndRad",po::value<double>()->default_value(0.85),"min end radius as fraction of start radius")
+    ("vesselSeg.maxEndRad",po::value<double>()->default_value(1.05),"max end radius as fraction of start radius")
+    ("vesselSeg.angleWt",po::value<double>()->default_value(1.0),"cost function preferential angle weighting")
+    ("vesselSeg.densityWt",po::value<double>()->default_value(5e-5),"cost function density weighting")
+    ("vesselSeg.dirWt",po::value<double>()->default_value(5e-5),"cost function direction weighting")
+    ("vesselSeg.numTry",po::value<uint>()->default_value(10),"number of trial segments")
+    ("vesselSeg.thinFrac",po::value<double>()->default_value(0.0),"radius as fraction of voxel size below which the first valid trial is kept, 0 to disable")
+    ("vesselSeg.maxTry",po::value<uint>()->default_value(100),"max number of trial segments before reducing length")
+    ("vesselSeg.absMaxTry",po::value<uint>()->default_value(10000),"max number of trial segments before completely giving up")
+    // check if this needs to be changed
+    ("vesselSeg.roiStep",po::value<double>()->default_value(0.1),"step size for checking segment validity")
+    ("vesselSeg.segFrac",po::value<double>()->default_value(0.25),"fraction of branch length per segment")
+    ;
 
-      // calculate second vector based on direction to coordinate origin
-      vtkVector3d v2;
-      for(int j=0; j<3; j++){
-	v2[j] = intersect[j];
-      }
-      double innerProd = v2.Dot(fatCompartments[i].axis[0]);
+  // config file options
+  po::options_description configFileOpt("Configuration file options");
+  configFileOpt.add(baseOpt).add(volumeOpt).add(cacheOpt).add(shapeOpt);
+  configFileOpt.add(ductTreeOpt).add(ductBrOpt).add(ductSegOpt);
+  configFileOpt.add(vesselTreeOpt).add(vesselBrOpt).add(vesselSegOpt);
+  configFileOpt.add(compartOpt).add(TDLUOpt).add(fatOpt);
+  configFileOpt.add(voronOpt).add(perlinOpt).add(boundaryOpt);
+  configFileOpt.add(bufferOpt).add(perturbOpt).add(ligOpt);
 
-      for(int j=0; j<3; j++){
-	fatCompartments[i].axis[1][j] = v2[j] - innerProd*fatCompartments[i].axis[0][j];
-      }
-      // normalize
-      fatCompartments[i].axis[1].Normalize();
-			
-      // calculate 3rd vector based on cross product
-      fatCompartments[i].axis[2] = fatCompartments[i].axis[0].Cross(fatCompartments[i].axis[1]);
+  // all of the options
+  po::options_description all("All options");
+  all.add_options()
+    ("config,c", po::value<std::string>()->required(), "name of configuration file")
+    ;
+  all.add(configFileOpt);
+  
+  po::variables_map vm;
+  
+  // get configuration filename from command line
+  po::store(parse_command_line(argc,argv,all), vm);
+  std::string configFile = vm["config"].as<std::string>();
+  
+  // read configuration file
+  ifstream inConfig(configFile.c_str());
+  if(!inConfig){
+    cout << "Can not open configuration file: " << configFile << "\n";
+    return(1);
+  } else {
+    po::store(parse_config_file(inConfig, configFileOpt), vm);
+    inConfig.close();
+  };
 
-      // find gland compartment seed point
+  // load resolution variables
 
-      double skinDist = sqrt(vtkMath::Distance2BetweenPoints(seedBase,intersect));
-      double seedDist = skinDist*rgen->GetRangeValue(minFracRadialDist,
-						     maxFracRadialDist);
-      rgen->Next();
+  double ures = vm["shape.ures"].as<double>();	// spacing in u-v space
+  double vres = vm["shape.vres"].as<double>();
+  double pointSep = vm["shape.pointSep"].as<double>(); // remove close points
+  double featureAngle = vm["shape.featureAngle"].as<double>(); // angle to preserve when smoothing
+  double targetReduction = vm["shape.targetReduction"].as<double>(); // fraction of triangles to decimate
+  double imgRes = vm["base.imgRes"].as<double>();	// size of image voxels (mm)
+  double skinThick = vm["base.skinThick"].as<double>(); // thickness of skin (mm)
+  std::string breastVoxelFilename = "breastVoxel.vti";
+  char outVTIFilename[128];
+  char outhdrFilename[128];
+  char outgzFilename[128];
+  char outRawFilename[128];
 
-      double seedPos[3];
-      for(int j=0; j<3; j++){
-	seedPos[j] = seedBase[j]+seedDist*rayDir[j];
-      }
 
-      // add z jitter
-      
-      double zjit = rgen->GetRangeValue(-1.0*zJitter, 1.0*zJitter);
-      rgen->Next();
+  double scaleFactor = 35.0;	// scale voxel size to millimeters
 
-      for(int j=0; j<3; j++){
-	seedPos[j] = seedPos[j]+zjit*baseAxis[0][j];
-      }
+  double nippleLen = vm["base.nippleLen"].as<double>();	// length of nipple (mm)
+  double nippleRad = vm["base.nippleRad"].as<double>(); // radius of nipple (mm)
+  double areolaRad = vm["base.areolaRad"].as<double>(); // radius of areola (mm)
 
-      //seeds->InsertNextPoint(seedPos);
+  double voxelVol = imgRes*imgRes*imgRes;	// volume of a voxel (cubic mm)
+	
+  tissueStruct tissue;
+	
+  tissue.bg = 0;
+  tissue.skin = 2;
+  tissue.nipple = 33;
+  tissue.fat = 1;
+  tissue.cooper = 88;
+  tissue.gland = 29;
+  tissue.TDLU = 95;
+  tissue.duct = 125;
+  tissue.artery = 150;
+  tissue.vein = 225 ;
+  tissue.muscle = 40;
 
-      // add to gland structure
-      for(int j=0; j<3; j++){
-	glandCompartments[i].pos[j] = seedPos[j];
-	glandCompartments[i].scale[j] = rgen->GetRangeValue(scaleMin[j],scaleMax[j]);
-	rgen->Next();
-      }
-			
-      glandCompartments[i].g = rgen->GetRangeValue(gMin,gMax);
-      rgen->Next();
-      glandCompartments[i].fat = false;
-      glandCompartments[i].keep = true;
-      glandCompartments[i].compId = (unsigned char)i;
-      glandCompartments[i].voxelCount = 0;
+  const unsigned char glandBuffer = 222;
+  const unsigned char innerVal = 175; // not needed after compartment creation
+  const unsigned char boundVal = 50;  // edge of inner breast volume, not needed after skin generation
+  
+  const unsigned char compartmentVal[20] = {12, 13, 14, 15, 16,
+					    17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28};
+  
+  const unsigned char compMax = 28;	// max compartment value for cooper's ligament
+  const unsigned char compMin = 12;
 
-      glandCompartments[i].boundBox[0] = breastDim[0]+1;
-      glandCompartments[i].boundBox[1] = -1;
-      glandCompartments[i].boundBox[2] = breastDim[1]+1;
-      glandCompartments[i].boundBox[3] = -1;
-      glandCompartments[i].boundBox[4] = breastDim[2]+1;
-      glandCompartments[i].boundBox[5] = -1;
+  // unligamented tissue classes
+  const unsigned char ufat = 60;
+  const unsigned char ugland = 61;
+  const unsigned char uTDLU = 62;
+  const unsigned char uduct = 63;
 
-      // coordinate system
-      // first vector
-      for(int j=0; j<3; j++){
-	glandCompartments[i].axis[0][j] = nipplePos[j] - seedPos[j];
-      }
-      // normalize
-      glandCompartments[i].axis[0].Normalize();
+  // random number generator seed
+  // use seed specified in config file, otherwise random seed
+  int randSeed;
+  if(vm.count("base.seed")){
+    // seed specified in configuration file
+    randSeed = vm["base.seed"].as<unsigned int>();
+  } else {
+    // generate random seed
+    FILE *randFile;
+    randFile = fopen("/dev/urandom","r");
+    size_t fread_out;
+    fread_out = fread((char*)(&randSeed), sizeof(int),1,randFile);
+    fclose(randFile);
+  }
 
-      // calculate second vector based on direction to coordinate origin
-      for(int j=0; j<3; j++){
-	v2[j] = seedPos[j];
-      }
-      innerProd = v2.Dot(glandCompartments[i].axis[0]);
-      
-      for(int j=0; j<3; j++){
-	glandCompartments[i].axis[1][j] = v2[j] - innerProd*glandCompartments[i].axis[0][j];
-      }
-      // normalize
-      glandCompartments[i].axis[1].Normalize();
+  // output base directory
+  std::string outputDir = vm["base.outputDir"].as<std::string>();
+  
+  // exists?
+  if(access(outputDir.c_str(),F_OK)){
+    // directory doesn't exist
+    // try to create it
+    if(mkdir(outputDir.c_str(),S_IRWXU) == -1){
+      // couldn't create directory
+      cerr << "Could not create directory " << outputDir << "\n";
+      cerr << "Exiting...\n";
+      return(1);
+    }
+  }
 
-      // calculate 3rd vector based on cross product
-      glandCompartments[i].axis[2] = glandCompartments[i].axis[0].Cross(glandCompartments[i].axis[1]);
+  // is it a directory?
+  struct stat fileInfo;
+  
+  stat(outputDir.c_str(), &fileInfo);
 
-      // have 3 unit vectors
-      // rotate randomly about principle direction (to nipple)
-      double dtheta = rgen->GetRangeValue(0,2*pi);
-      rgen->Next();
-      double dphi = rgen->GetRangeValue(0,deflectMax);
-      rgen->Next();
-      double dr = tan(pi*dphi);
+  if(S_ISDIR(fileInfo.st_mode)){
+    // it's a directory
+    // make it the working directory
+    if(chdir(outputDir.c_str()) == -1){
+      cerr << "Could not access directory " << outputDir << "\n";
+      cerr << "Exiting...\n";
+      return(1);
+    }
+  } else {
+    // error, not a directory
+    cerr << "Specified path is not a valid directory\n";
+    cerr << "Exiting...\n";
+    return(1);
+  }
 
-      for(int j=0; j<3; j++){
-	glandCompartments[i].axis[0][j] = nipplePos[j] - seedPos[j] + dr*cos(dtheta)*glandCompartments[i].axis[1][j] +
-	  dr*sin(dtheta)*glandCompartments[i].axis[2][j];
-      }
-      // normalize
-      glandCompartments[i].axis[0].Normalize();
-      
-      // re-calculate second vector based on direction to coordinate origin and updated principle direction
-      for(int j=0; j<3; j++){
-	v2[j] = seedPos[j];
+  // copy over config file
+  
+  char cfgOutFilename[128];
+  sprintf(cfgOutFilename,"%s/p_%d.cfg", outputDir.c_str(),randSeed);
+	
+  FILE *cfgCopy = fopen(cfgOutFilename,"wt");
+  FILE *cfgRead = fopen(configFile.c_str(),"rt");
+  
+  int readChar = getc(cfgRead);
+  while(readChar != EOF){
+    putc(readChar, cfgCopy);
+    readChar = getc(cfgRead);
+  }
+  fclose(cfgCopy);
+  fclose(cfgRead);
+
+  sprintf(outVTIFilename,"%s/p_%d.vti", outputDir.c_str(),randSeed);
+  //sprintf(outrawFilename,"%s/p_%d.zraw", outputDir.c_str(),randSeed);
+  sprintf(outhdrFilename,"%s/p_%d.mhd", outputDir.c_str(),randSeed);
+  sprintf(outgzFilename,"%s/p_%d.raw.gz", outputDir.c_str(),randSeed);
+  sprintf(outRawFilename,"%s/p_%d.raw", outputDir.c_str(),randSeed);
+
+  // keep OpenMP threads on fixed cpus so first-touch placement holds
+  if(vm["volume.pinThreads"].as<bool>()){
+    breastVolume::pinThreads();
+  }
+
+  // shape parameters
+
+  // base shape coefficients
+  double a1b =  vm["shape.a1b"].as<double>();
+  double a1t = vm["shape.a1t"].as<double>();
+  double a2l = vm["shape.a2l"].as<double>();
+  double a2r = vm["shape.a2r"].as<double>();
+  double a3 = vm["shape.a3"].as<double>();
+  double eps1 = vm["shape.eps1"].as<double>();
+  double eps2 = vm["shape.eps2"].as<double>();
+
+  // breast side
+  bool leftSide = vm["base.leftBreast"].as<bool>();
+
+  // ptosis parameters
+  bool doPtosis = vm["shape.doPtosis"].as<bool>();
+  double b0 = vm["shape.ptosisB0"].as<double>();
+  double b1 = vm["shape.ptosisB1"].as<double>();
+
+  // turn parameters
+  bool doTurn = vm["shape.doTurn"].as<bool>();
+  double c0 = vm["shape.turnC0"].as<double>();
+  double c1 = vm["shape.turnC1"].as<double>();
+
+  // top shape parameters
+  bool doTopShape = vm["shape.doTopShape"].as<bool>();
+  double s0 = vm["shape.topShapeS0"].as<double>();
+  double t0 = vm["shape.topShapeT0"].as<double>();
+  double s1 = vm["shape.topShapeS1"].as<double>();
+  double t1 = vm["shape.topShapeT1"].as<double>();
+
+  // derived top shape parameters
+  double At = -0.5*t0-3.0*s0-3.0*s1+0.5*t1;
+  double Bt = 1.5*t0+8.0*s0+7.0*s1-t1;
+  double Ct = -1.5*t0-6.0*s0-4.0*s1+0.5*t1;
+  double Dt = 0.5*t0;
+  double Et = s0;
+  double Ft = 1.0;
+
+  // flatten side parameters
+  bool doFlattenSide = vm["shape.doFlattenSide"].as<bool>();
+  double g0 = vm["shape.flattenSideG0"].as<double>();
+  double g1 = vm["shape.flattenSideG1"].as<double>();
+
+  // derived parameters for flatten side
+  double Af = g1+2.0-2.0*g0;
+  double Bf = -g1-3.0+3.0*g0;
+  double Cf = 0.0;
+  double Df = 1.0;
+
+  // turn top parameters
+  bool doTurnTop = vm["shape.doTurnTop"].as<bool>();
+  double h0 = vm["shape.turnTopH0"].as<double>();
+  double h1 = vm["shape.turnTopH1"].as<double>();
+
+  // start a random number generator
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> rgen =
+    vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+
+  // stages up to the compartments may use their own seed so an ensemble
+  // of textures can share one shape and compartment layout
+  bool ownShapeSeed = (vm.count("cache.shapeSeed") > 0);
+  int shapeSeed = ownShapeSeed ? (int)vm["cache.shapeSeed"].as<unsigned int>() : randSeed;
+
+  rgen->SetSeed(shapeSeed);
+
+  /***********************
+	Shape
+  ***********************/
+
+  // create base shape
+  // point positions
+  double uval,vval,xval,yval,zval;
+  vtkIdType myId;
+  
+  vtkSmartPointer<vtkPoints> brightFront =
+    vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkPoints> brightBack =
+    vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkPoints> brightRing =
+    vtkSmartPointer<vtkPoints>::New();
+		
+  vtkSmartPointer<vtkPoints> trightFront =
+    vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkPoints> trightBack =
+    vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkPoints> trightRing =
+    vtkSmartPointer<vtkPoints>::New();
+
+  vtkSmartPointer<vtkPoints> tleftFront =
+    vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkPoints> tleftBack =
+    vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkPoints> tleftRing =
+    vtkSmartPointer<vtkPoints>::New();
+	
+  vtkSmartPointer<vtkPoints> bleftFront =
+    vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkPoints> bleftBack =
+    vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkPoints> bleftRing =
+    vtkSmartPointer<vtkPoints>::New();
+	
+  vtkIdType centerPt;
+	
+#pragma omp sections private(uval,vval,xval,yval,zval,myId)
+  {
+#pragma omp section
+    {
+      // bottom right breast
+      vval = -1.0*pi + vres;
+      while(vval <= -0.5*pi){
+	uval = 0.0;
+	// ring is uval == 0
+	xval = 0.0;
+	yval = pow(a2r,eps1)*pow(sin(vval),eps2);
+	zval = pow(a1b,eps1)*pow(cos(vval),eps2);
+	myId = brightRing->InsertNextPoint(xval,yval,zval);
+	uval += ures;
+			
+	while(uval <= 0.5*pi){
+	  xval = pow(a3*sin(uval),eps1);
+	  yval = pow(a2r*cos(uval),eps1)*pow(sin(vval),eps2);
+	  zval = pow(a1b*cos(uval),eps1)*pow(cos(vval),eps2);
+	  // add point to front
+	  myId = brightFront->InsertNextPoint(xval,yval,zval);
+	  // add backplane point
+	  myId = brightBack->InsertNextPoint(0.0,yval,zval);
+	  uval += ures;
+	}
+	vval += vres;
       }
-      innerProd = v2.Dot(glandCompartments[i].axis[0]);
+	
+      // add center point to bottom-right breast front and back and skip
+      centerPt = brightFront->InsertNextPoint(pow(a3,eps1),0.0,0.0);
+      centerPt = brightBack->InsertNextPoint(0.0,0.0,0.0);
+    }
+    
+#pragma omp section
+    {
+      // top right breast
       
-      for(int j=0; j<3; j++){
-	glandCompartments[i].axis[1][j] = v2[j] - innerProd*glandCompartments[i].axis[0][j];
+      vval = -0.5*pi + vres;
+      while(vval <= 0.0){
+	uval = 0.0;
+	xval = 0.0;
+	yval = pow(a2r,eps1)*pow(sin(vval),eps2);
+	zval = pow(a1t,eps1)*pow(cos(vval),eps2);
+	myId = trightRing->InsertNextPoint(xval,yval,zval);
+	uval += ures;
+			
+	while(uval <= 0.5*pi){
+	  xval = pow(a3*sin(uval),eps1);
+	  yval = pow(a2r*cos(uval),eps1)*pow(sin(vval),eps2);
+	  zval = pow(a1t*cos(uval),eps1)*pow(cos(vval),eps2);
+	  // add the point
+	  myId = trightFront->InsertNextPoint(xval,yval,zval);
+	  // add backplane point
+	  myId = trightBack->InsertNextPoint(0.0,yval,zval);
+	  uval += ures;
+	}
+	vval += vres;
       }
-      // normalize
-      glandCompartments[i].axis[1].Normalize();
-
-      // calculate 3rd vector based on cross product
-      glandCompartments[i].axis[2] = glandCompartments[i].axis[0].Cross(glandCompartments[i].axis[1]);
-
-      // finished calculating axes
-    } else {
-      // missed the breast surface - error
-      cout << "Error, missed breast surface when shooting rays\n";
-      return EXIT_FAILURE;
+    }
+		
+#pragma omp section
+    {
+      // top left breast
+		
+      vval = 0.0 + vres;
+      while(vval <= 0.5*pi){
+	uval = 0.0;
+	xval = 0.0;
+	yval = pow(a2l,eps1)*pow(sin(vval),eps2);
+	zval = pow(a1t,eps1)*pow(cos(vval),eps2);
+	myId = tleftRing->InsertNextPoint(xval,yval,zval);
+	uval += ures;
+	
+	while(uval <= 0.5*pi){
+	  xval = pow(a3*sin(uval),eps1);
+	  yval = pow(a2l*cos(uval),eps1)*pow(sin(vval),eps2);
+	  zval = pow(a1t*cos(uval),eps1)*pow(cos(vval),eps2);
+	  // add the point
+	  myId = tleftFront->InsertNextPoint(xval,yval,zval);
+	  // add backplane point
+	  myId = tleftBack->InsertNextPoint(0.0,yval,zval);
+	  uval += ures;
+	}
+	vval += vres;
+      }
+    }
+
+#pragma omp section
+    {
+      // bottom left breast
+      
+      vval = 0.5*pi + vres;
+      while(vval <= pi){
+	uval = 0.0;
+	xval = 0.0;
+	yval = pow(a2l,eps1)*pow(sin(vval),eps2);
+	zval = pow(a1b,eps1)*pow(cos(vval),eps2);
+	myId = bleftRing->InsertNextPoint(xval,yval,zval);
+	uval += ures;
+			
+	while(uval <= 0.5*pi){
+	  xval = pow(a3*sin(uval),eps1);
+	  yval = pow(a2l*cos(uval),eps1)*pow(sin(vval),eps2);
+	  zval = pow(a1b*cos(uval),eps1)*pow(cos(vval),eps2);
+	  // add the point
+	  myId = bleftFront->InsertNextPoint(xval,yval,zval);
+	  // add backplane point
+	  myId = bleftBack->InsertNextPoint(0.0,yval,zval);
+	  uval += ures;
+	}
+	vval += vres;
+      }
+    }
+
+  }  // end omp sections
+	
+  // have base shape
+  // do deformations
+
+  // top shape
+  if(doTopShape){
+    vtkIdType npts = trightFront->GetNumberOfPoints();
+    uval = ures; // need original u value
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      double u2 = uval*2.0/pi;
+      // front
+      trightFront->GetPoint(i, pval);
+      pval[2] = pval[2]*(At*pow(u2,5.0)+Bt*pow(u2,4.0)+
+			 Ct*pow(u2,3.0)+Dt*u2*u2+Et*u2+Ft);
+      trightFront->SetPoint(i,pval);
+      // back
+      trightBack->GetPoint(i, pval);
+      pval[2] = pval[2]*(At*pow(u2,5.0)+Bt*pow(u2,4.0)+
+			 Ct*pow(u2,3.0)+Dt*u2*u2+Et*u2+Ft);
+      trightBack->SetPoint(i,pval);
+      
+      uval += ures;
+      if(uval > 0.5*pi){
+	uval = ures;
+      }
+    }
+		
+    // ring
+    npts = trightRing->GetNumberOfPoints();
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      trightRing->GetPoint(i, pval);
+      pval[2] = pval[2]*Ft;
+      trightRing->SetPoint(i,pval);
+    }
+		
+    npts = tleftFront->GetNumberOfPoints();
+    uval = ures; // need original u value
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      double u2 = uval*2.0/pi;
+      // front
+      tleftFront->GetPoint(i, pval);
+      pval[2] = pval[2]*(At*pow(u2,5.0)+Bt*pow(u2,4.0)+
+			 Ct*pow(u2,3.0)+Dt*u2*u2+Et*u2+Ft);
+      tleftFront->SetPoint(i,pval);
+      // back
+      tleftBack->GetPoint(i, pval);
+      pval[2] = pval[2]*(At*pow(u2,5.0)+Bt*pow(u2,4.0)+
+			 Ct*pow(u2,3.0)+Dt*u2*u2+Et*u2+Ft);
+      tleftBack->SetPoint(i,pval);
+			
+      uval += ures;
+      if(uval > 0.5*pi){
+	uval = ures;
+      }
+    }
+		
+    // ring
+    npts = tleftRing->GetNumberOfPoints();
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      tleftRing->GetPoint(i, pval);
+      pval[2] = pval[2]*Ft;
+      tleftRing->SetPoint(i,pval);
+    }				
+  }
+	
+  // flatten side
+  if(doFlattenSide){
+    if(leftSide){
+      trightFront->ComputeBounds();
+      double bound[6];
+      trightFront->GetBounds(bound);
+      double scale;
+      if(fabs(bound[2]) > fabs(bound[3])){
+	scale = fabs(bound[2]);
+      } else {
+	scale = fabs(bound[3]);
+      }
+      vtkIdType npts = trightFront->GetNumberOfPoints();
+#pragma omp parallel for
+      for(int i=0; i<npts; i++){
+	double pval[3];
+	// front
+	trightFront->GetPoint(i,pval);
+	double yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	trightFront->SetPoint(i,pval);
+	// back
+	trightBack->GetPoint(i,pval);
+	yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	trightBack->SetPoint(i,pval);
+      }
+      // ring
+      npts = trightRing->GetNumberOfPoints();
+#pragma omp parallel for
+      for(int i=0; i<npts; i++){
+	double pval[3];
+	trightRing->GetPoint(i,pval);
+	double yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	trightRing->SetPoint(i,pval);
+      }
+						
+      brightFront->ComputeBounds();
+      brightFront->GetBounds(bound);
+      if(fabs(bound[2]) > fabs(bound[3])){
+	scale = fabs(bound[2]);
+      } else {
+	scale = fabs(bound[3]);
+      }
+      npts = brightFront->GetNumberOfPoints();
+#pragma omp parallel for
+      for(int i=0; i<npts; i++){
+	double pval[3];
+	//front
+	brightFront->GetPoint(i,pval);
+	double yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	brightFront->SetPoint(i,pval);
+	// back
+	brightBack->GetPoint(i,pval);
+	yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	brightBack->SetPoint(i,pval);
+      }
+      // ring
+      npts = brightRing->GetNumberOfPoints();
+#pragma omp parallel for
+      for(int i=0; i<npts; i++){
+	double pval[3];
+	brightRing->GetPoint(i,pval);
+	double yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	brightRing->SetPoint(i,pval);
+      }
+    } else {
+      // right side
+      tleftFront->ComputeBounds();
+      double bound[6];
+      tleftFront->GetBounds(bound);
+      double scale;
+      if(fabs(bound[2]) > fabs(bound[3])){
+	scale = fabs(bound[2]);
+      } else {
+	scale = fabs(bound[3]);
+      }
+      vtkIdType npts = tleftFront->GetNumberOfPoints();
+#pragma omp parallel for
+      for(int i=0; i<npts; i++){
+	double pval[3];
+	// front
+	tleftFront->GetPoint(i,pval);
+	double yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	tleftFront->SetPoint(i,pval);
+	// back
+	tleftBack->GetPoint(i,pval);
+	yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	tleftBack->SetPoint(i,pval);
+      }
+      // ring
+      npts = tleftRing->GetNumberOfPoints();
+#pragma omp parallel for
+      for(int i=0; i<npts; i++){
+	double pval[3];
+	tleftRing->GetPoint(i,pval);
+	double yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	tleftRing->SetPoint(i,pval);
+      }
+      
+      bleftFront->ComputeBounds();
+      bleftFront->GetBounds(bound);
+      if(fabs(bound[2]) > fabs(bound[3])){
+	scale = fabs(bound[2]);
+      } else {
+	scale = fabs(bound[3]);
+      }
+      npts = bleftFront->GetNumberOfPoints();
+#pragma omp parallel for
+      for(int i=0; i<npts; i++){
+	double pval[3];
+	// front
+	bleftFront->GetPoint(i,pval);
+	double yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	bleftFront->SetPoint(i,pval);
+	// back
+	bleftBack->GetPoint(i,pval);
+	yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	bleftBack->SetPoint(i,pval);
+      }
+      // ring
+      npts = bleftRing->GetNumberOfPoints();
+      //#pragma omp parallel for
+      for(int i=0; i<npts; i++){
+	double pval[3];
+	bleftRing->GetPoint(i,pval);
+	double yv = fabs(pval[1]/scale);
+	pval[1] = pval[1]*(Af*yv*yv*yv + Bf*yv*yv +
+			   Cf*yv + Df);
+	bleftRing->SetPoint(i,pval);
+      }
+    }
+  }
+	
+  // turn top
+  if(doTurnTop){
+    trightFront->ComputeBounds();
+    double bound[6];
+    trightFront->GetBounds(bound);
+    double scale;
+    if(fabs(bound[4]) > fabs(bound[5])){
+      scale = fabs(bound[4]);
+    } else {
+      scale = fabs(bound[5]);
+    }
+    vtkIdType npts = trightFront->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      // front
+      trightFront->GetPoint(i,pval);
+      pval[1] = pval[1] - h0*pval[2]/scale -
+	h1*pval[2]*pval[2]/scale/scale;
+      trightFront->SetPoint(i,pval);
+      // back
+      trightBack->GetPoint(i,pval);
+      pval[1] = pval[1] - h0*pval[2]/scale -
+	h1*pval[2]*pval[2]/scale/scale;
+      trightBack->SetPoint(i,pval);
+    }
+    // ring
+    npts = trightRing->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      trightRing->GetPoint(i,pval);
+      pval[1] = pval[1] - h0*pval[2]/scale -
+	h1*pval[2]*pval[2]/scale/scale;
+      trightRing->SetPoint(i,pval);
+    }
+		
+    tleftFront->ComputeBounds();
+    tleftFront->GetBounds(bound);
+    if(fabs(bound[4]) > fabs(bound[5])){
+      scale = fabs(bound[4]);
+    } else {
+      scale = fabs(bound[5]);
+    }
+    npts = tleftFront->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      // front
+      tleftFront->GetPoint(i,pval);
+      pval[1] = pval[1] - h0*pval[2]/scale -
+	h1*pval[2]*pval[2]/scale/scale;
+      tleftFront->SetPoint(i,pval);
+      // back
+      tleftBack->GetPoint(i,pval);
+      pval[1] = pval[1] - h0*pval[2]/scale -
+	h1*pval[2]*pval[2]/scale/scale;
+      tleftBack->SetPoint(i,pval);
+    }
+    // ring
+    npts = tleftRing->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      tleftRing->GetPoint(i,pval);
+      pval[1] = pval[1] - h0*pval[2]/scale -
+	h1*pval[2]*pval[2]/scale/scale;
+      tleftRing->SetPoint(i,pval);
+    }
+  }
+
+  // ptosis
+  if(doPtosis){
+    vtkIdType npts = trightFront->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      // front
+      trightFront->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      trightFront->SetPoint(i,pval);
+      // back
+      trightBack->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      trightBack->SetPoint(i,pval);
+    }
+    // ring
+    npts = trightRing->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      trightRing->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      trightRing->SetPoint(i,pval);
+    }
+    
+    npts = tleftFront->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      // front
+      tleftFront->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      tleftFront->SetPoint(i,pval);
+      // back
+      tleftBack->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      tleftBack->SetPoint(i,pval);
+    }
+    // ring
+    npts = tleftRing->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      tleftRing->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      tleftRing->SetPoint(i,pval);
+    }
+    
+    npts = brightFront->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      // front
+      brightFront->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      brightFront->SetPoint(i,pval);
+      // back
+      brightBack->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      brightBack->SetPoint(i,pval);
+    }
+    // ring
+    npts = brightRing->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      brightRing->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      brightRing->SetPoint(i,pval);
+    }
+		
+    npts = bleftFront->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      // front
+      bleftFront->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      bleftFront->SetPoint(i,pval);
+      // back
+      bleftBack->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      bleftBack->SetPoint(i,pval);
+    }
+    // ring
+    npts = bleftRing->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      bleftRing->GetPoint(i,pval);
+      pval[2] = pval[2] - (b0*pval[0] + b1*pval[0]*pval[0]);
+      bleftRing->SetPoint(i,pval);
+    }
+  }
+
+  // turn
+  if(doTurn){
+    vtkIdType npts = trightFront->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      // front
+      trightFront->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      trightFront->SetPoint(i,pval);
+      // back
+      trightBack->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      trightBack->SetPoint(i,pval);
+    }
+    // ring
+    npts = trightRing->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      trightRing->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      trightRing->SetPoint(i,pval);
+    }
+    
+    npts = tleftFront->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      // front
+      tleftFront->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      tleftFront->SetPoint(i,pval);
+      // back
+      tleftBack->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      tleftBack->SetPoint(i,pval);
+    }
+    // ring
+    npts = tleftRing->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      tleftRing->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      tleftRing->SetPoint(i,pval);
+    }
+		
+    npts = brightFront->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      // front
+      brightFront->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      brightFront->SetPoint(i,pval);
+      // back
+      brightBack->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      brightBack->SetPoint(i,pval);
+    }
+    // ring
+    npts = brightRing->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      brightRing->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      brightRing->SetPoint(i,pval);
+    }
+    
+    npts = bleftFront->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      // front
+      bleftFront->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      bleftFront->SetPoint(i,pval);
+      // back
+      bleftBack->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      bleftBack->SetPoint(i,pval);
+    }
+    // ring
+    npts = bleftRing->GetNumberOfPoints();
+#pragma omp parallel for
+    for(int i=0; i<npts; i++){
+      double pval[3];
+      bleftRing->GetPoint(i,pval);
+      pval[1] = pval[1] + (c0*pval[0] + c1*pval[0]*pval[0]);
+      bleftRing->SetPoint(i,pval);
     }
   }
 
-  double nipSc[3] = {20, 1.0, 1.0};
+  // get nipple position
+  double nipplePos[3];
+  brightFront->GetPoint(centerPt,nipplePos);
 
-  // add nipple seed to gland structure
-  for(int j=0; j<3; j++){
-    glandCompartments[numBreastCompartments].pos[j] = nipplePos[j];
-    glandCompartments[numBreastCompartments].scale[j] = scaleNipple;
+  // scale nipple position
+  for(int i=0; i<3; i++){
+    nipplePos[i] = nipplePos[i]*scaleFactor;
   }
-  glandCompartments[numBreastCompartments].g = gNipple;
-  glandCompartments[numBreastCompartments].fat = false;
-  glandCompartments[numBreastCompartments].keep = true;
-  glandCompartments[numBreastCompartments].compId = (unsigned char)numBreastCompartments;
-  glandCompartments[numBreastCompartments].voxelCount = 0;
 
-  glandCompartments[numBreastCompartments].boundBox[0] = breastDim[0]+1;
-  glandCompartments[numBreastCompartments].boundBox[1] = -1;
-  glandCompartments[numBreastCompartments].boundBox[2] = breastDim[1]+1;
-  glandCompartments[numBreastCompartments].boundBox[3] = -1;
-  glandCompartments[numBreastCompartments].boundBox[4] = breastDim[2]+1;
-  glandCompartments[numBreastCompartments].boundBox[5] = -1;
-
-  // first axis is nipple direction
-  for(int k=0; k<3; k++){
-    glandCompartments[numBreastCompartments].axis[0][k] = nippleNorm[k];
+  // aggregate front points
+  vtkSmartPointer<vtkPoints> frontPts =
+    vtkSmartPointer<vtkPoints>::New();
+	
+  for(vtkIdType i=0; i<brightFront->GetNumberOfPoints(); i++){
+    double t[3];
+    brightFront->GetPoint(i, t);
+    frontPts->InsertNextPoint(t);
   }
-
-  // others are random
-  vtkMath::Perpendiculars(glandCompartments[numBreastCompartments].axis[0].GetData(),
-			  glandCompartments[numBreastCompartments].axis[1].GetData(),
-			  glandCompartments[numBreastCompartments].axis[2].GetData(),
-			  rgen->GetRangeValue(0, 2*pi));
-  rgen->Next();
+  for(vtkIdType i=0; i<trightFront->GetNumberOfPoints(); i++){
+    double t[3];
+    trightFront->GetPoint(i, t);
+    frontPts->InsertNextPoint(t);
+  }
+  for(vtkIdType i=0; i<bleftFront->GetNumberOfPoints(); i++){
+    double t[3];
+    bleftFront->GetPoint(i, t);
+    frontPts->InsertNextPoint(t);
+  }
+  for(vtkIdType i=0; i<tleftFront->GetNumberOfPoints(); i++){
+    double t[3];
+    tleftFront->GetPoint(i, t);
+    frontPts->InsertNextPoint(t);
+  }
+  vtkIdType numFrontPts = frontPts->GetNumberOfPoints();
 	
-  // add backplane seed points
-  // random points on backplane
-  // backplane just above muscle layer
-  double backPlanePos = 0.0 + spacing[0];
-  int backPlaneInd = static_cast<int>(ceil((backPlanePos-origin[0])/spacing[0]));
-
-  for(int i=0; i<numBackSeeds; i++){
-    bool foundSeed = false;
-    double y,z;
-    while(!foundSeed){
-      // pick random location on backplane away from edge of voxel space
-      y = rgen->GetRangeValue(baseBound[2]+2*spacing[1],baseBound[3]-2*spacing[1]);
-      rgen->Next();
-      z = rgen->GetRangeValue(baseBound[4]+2*spacing[2],baseBound[5]-2*spacing[2]);
-      rgen->Next();
-
-      // find nearest voxel and test if in breast interior
-      int yInd = static_cast<int>(floor((y-origin[1])/spacing[1]));
-      int zInd = static_cast<int>(floor((z-origin[2])/spacing[2]));
-
-      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(backPlaneInd,yInd,zInd));
-      if(p[0] == innerVal){
-	// found a new seed point
-	foundSeed = true;
-      }
-    }
-
-    // add new seed point
-    double backSeed[3];
-    backSeed[0] = backPlanePos;
-    backSeed[1] = y;
-    backSeed[2] = z;
-
-    seeds->InsertNextPoint(backSeed);
-
-    // add to structure
-    for(int j=0; j<3; j++){
-      fatCompartments[numAngles+i].pos[j] = backSeed[j];
-      fatCompartments[numAngles+i].scale[j] = scaleBack;
-    }
-    fatCompartments[numAngles+i].g = gBack;
-    fatCompartments[numAngles+i].fat = true;
-    fatCompartments[numAngles+i].keep = true;
-    fatCompartments[numAngles+i].compId = 0;
-    fatCompartments[numAngles+i].voxelCount = 0;
-
-    fatCompartments[numAngles+i].boundBox[0] = breastDim[0]+1;
-    fatCompartments[numAngles+i].boundBox[1] = -1;
-    fatCompartments[numAngles+i].boundBox[2] = breastDim[1]+1;
-    fatCompartments[numAngles+i].boundBox[3] = -1;
-    fatCompartments[numAngles+i].boundBox[4] = breastDim[2]+1;
-    fatCompartments[numAngles+i].boundBox[5] = -1;
+  // decimate front points
+  vtkSmartPointer<vtkPolyData> frontPoly = 
+    vtkSmartPointer<vtkPolyData>::New();
+  frontPoly->SetPoints(frontPts);
+  vtkSmartPointer<vtkVertexGlyphFilter> frontVertAdd =
+    vtkSmartPointer<vtkVertexGlyphFilter>::New();
+#if VTK_MAJOR_VERSION <= 5
+  frontVertAdd->SetInput(frontPoly);
+#else
+  frontVertAdd->SetInputData(frontPoly);
+#endif
 
-    // unit vectors are standard
-    for(int j=0; j<3; j++){
-      for(int k=0; k<3; k++){
-	fatCompartments[numAngles+i].axis[j][k] = 0.0;
-      }
-    }
-    fatCompartments[numAngles+i].axis[0][0] = 1.0;
-    fatCompartments[numAngles+i].axis[1][1] = 1.0;
-    fatCompartments[numAngles+i].axis[2][2] = 1.0;
+  frontVertAdd->Update();
+  vtkSmartPointer<vtkCleanPolyData> cleanFront =
+    vtkSmartPointer<vtkCleanPolyData>::New();
+#if VTK_MAJOR_VERSION <= 5
+  cleanFront->SetInput(frontVertAdd->GetOutput());
+#else
+  cleanFront->SetInputConnection(frontVertAdd->GetOutputPort());
+#endif
+  cleanFront->SetTolerance(pointSep);
+  cleanFront->Update();	
+	
+  // aggregate and shift back points
+  vtkSmartPointer<vtkPoints> backPts =
+    vtkSmartPointer<vtkPoints>::New();
+	
+  // ringWidth and ringSep converted to non-physical coordinates
+  double ringWidth = vm["shape.ringWidth"].as<double>();
+  double ringSep = vm["shape.ringSep"].as<double>();
+  double ringWidthOrig = ringWidth/scaleFactor;
+  double ringSepOrig = ringSep/scaleFactor;
+  double backPos = (floor(ringWidthOrig/ringSepOrig)+1)*ringSepOrig;
+  
+  for(vtkIdType i=0; i<brightBack->GetNumberOfPoints(); i++){
+    double t[3];
+    brightBack->GetPoint(i, t);
+    t[0] = -backPos;
+    backPts->InsertNextPoint(t);
   }
-  // finished adding backplane seed points
-
-  // random skin seed points
-  for(int i=0; i<numSkinSeeds; i++){
-    bool foundSeed = false;
-    vtkIdType numPts = innerPoly->GetNumberOfPoints();
-    double seedCoords[3];
-    while(!foundSeed){
-      // pick random breast surface point
-      vtkIdType tryId = static_cast<vtkIdType>(ceil(rgen->GetRangeValue(0, numPts-1)));
-      rgen->Next();
-      innerPoly->GetPoint(tryId, seedCoords);
-			
-      // select point if not to close to backplane or nipple
-      if(seedCoords[0] > backPlanePos + 10.0 && seedCoords[0] < nipplePos[0] - 10.0){
-	foundSeed = true;
-      }  
-    }
-
-    seeds->InsertNextPoint(seedCoords);
-
-    // add to structure
-    for(int j=0; j<3; j++){
-      fatCompartments[numAngles+numBackSeeds+i].pos[j] = seedCoords[j];
-      fatCompartments[numAngles+numBackSeeds+i].scale[j] = rgen->GetRangeValue(scaleSkinMin[j],scaleSkinMax[j]);
-      rgen->Next();
-    }
-    fatCompartments[numAngles+numBackSeeds+i].g = gSkin;
-    fatCompartments[numAngles+numBackSeeds+i].fat = true;
-    fatCompartments[numAngles+numBackSeeds+i].keep = true;
-    fatCompartments[numAngles+numBackSeeds+i].compId = 0;
-    fatCompartments[numAngles+numBackSeeds+i].voxelCount = 0;
-    
-    fatCompartments[numAngles+numBackSeeds+i].boundBox[0] = breastDim[0]+1;
-    fatCompartments[numAngles+numBackSeeds+i].boundBox[1] = -1;
-    fatCompartments[numAngles+numBackSeeds+i].boundBox[2] = breastDim[1]+1;
-    fatCompartments[numAngles+numBackSeeds+i].boundBox[3] = -1;
-    fatCompartments[numAngles+numBackSeeds+i].boundBox[4] = breastDim[2]+1;
-    fatCompartments[numAngles+numBackSeeds+i].boundBox[5] = -1;
-
-    // principle unit vector normal to skin
-    normals2->GetTuple(nipplePt, fatCompartments[numAngles+numBackSeeds+i].axis[0].GetData());
-    fatCompartments[numAngles+numBackSeeds+i].axis[0].Normalize();
-
-    // other directions random
-    vtkMath::Perpendiculars(fatCompartments[numAngles+numBackSeeds+i].axis[0].GetData(),
-			    fatCompartments[numAngles+numBackSeeds+i].axis[1].GetData(), fatCompartments[numAngles+numBackSeeds+i].axis[2].GetData(),
-			    rgen->GetRangeValue(0, 2*pi));
-    rgen->Next();
+  for(vtkIdType i=0; i<trightBack->GetNumberOfPoints(); i++){
+    double t[3];
+    trightBack->GetPoint(i, t);
+    t[0] = -backPos;
+    backPts->InsertNextPoint(t);
   }
-
-  // create Perlin noise distance function for glandular compartments
-  perlinNoise *boundary = static_cast<perlinNoise*>(::operator new(sizeof(perlinNoise)*(numBreastCompartments+1)));
-
-  for(int i=0; i<=numBreastCompartments; i++){
-    new(&boundary[i]) perlinNoise(vm, (int32_t)rgen->GetRangeValue(-1073741824, 1073741824),"boundary");
-    rgen->Next();
+  for(vtkIdType i=0; i<bleftBack->GetNumberOfPoints(); i++){
+    double t[3];
+    bleftBack->GetPoint(i, t);
+    t[0] = -backPos;
+    backPts->InsertNextPoint(t);
   }
-
-  // setup point locator
-  vtkSmartPointer<vtkOctreePointLocator> findSeed =
-    vtkSmartPointer<vtkOctreePointLocator>::New();
-	
-  // create a vtkPolyData
-  vtkSmartPointer<vtkPolyData> seedSet =
+  for(vtkIdType i=0; i<tleftBack->GetNumberOfPoints(); i++){
+    double t[3];
+    tleftBack->GetPoint(i, t);
+    t[0] = -backPos;
+    backPts->InsertNextPoint(t);
+  }
+  vtkIdType numBackPts = backPts->GetNumberOfPoints();
+  
+  // decimate back points
+  vtkSmartPointer<vtkPolyData> backPoly = 
     vtkSmartPointer<vtkPolyData>::New();
-  seedSet->SetPoints(seeds);
-
-  // add verticies
-  vtkSmartPointer<vtkVertexGlyphFilter> vertexGlyphFilter2 =
+  backPoly->SetPoints(backPts);
+  vtkSmartPointer<vtkVertexGlyphFilter> backVertAdd =
     vtkSmartPointer<vtkVertexGlyphFilter>::New();
 #if VTK_MAJOR_VERSION <= 5
-  vertexGlyphFilter2->AddInput(seedSet);
+  backVertAdd->SetInput(backPoly);
 #else
-  vertexGlyphFilter2->AddInputData(seedSet);
+  backVertAdd->SetInputData(backPoly);
 #endif
-  vertexGlyphFilter2->Update();
-
-  findSeed->SetDataSet(vertexGlyphFilter2->GetOutput());
-  findSeed->BuildLocator();
-
-  // iterate over voxels to do segmentation
+  backVertAdd->Update();
+  vtkSmartPointer<vtkCleanPolyData> cleanBack =
+    vtkSmartPointer<vtkCleanPolyData>::New();
+#if VTK_MAJOR_VERSION <= 5
+  cleanBack->SetInput(backVertAdd->GetOutput());
+#else
+  cleanBack->SetInputConnection(backVertAdd->GetOutputPort());
+#endif
+  cleanBack->SetTolerance(pointSep);
+  cleanBack->Update();	
 	
-  // starting by setting everything behind back plane to fat
-#pragma omp parallel for
-  for(int i=0; i<backPlaneInd; i++){
-    for(int j=0; j<dim[1]; j++){
-      for(int k=0; k<dim[2]; k++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == innerVal){
-	  // set to fat
-	  p[0] = ufat;
-	}
-      }
-    }
-  }
+  // aggregate ring points and create thickness
+  vtkSmartPointer<vtkPoints> ringPts =
+    vtkSmartPointer<vtkPoints>::New();
 	
-  double boundaryDev = vm["boundary.maxDeviation"].as<double>();
-
-  // resolution of Voronoi segmentation
-  double segSize = 0.2;
-
-  int voxSkip = static_cast<int>(floor(segSize/imgRes));
-
-  if(voxSkip < 1){
-    voxSkip = 1;
+  for(vtkIdType i=0; i<brightRing->GetNumberOfPoints(); i++){
+    double t[3];
+    brightRing->GetPoint(i, t);
+    ringPts->InsertNextPoint(t);
+    double xstep = ringSepOrig;
+    while(xstep < ringWidthOrig){
+      t[0] = -xstep;
+      ringPts->InsertNextPoint(t);
+      xstep += ringSepOrig;
+    }
   }
-
-  // other side of back plane, do segmentation
-#pragma omp parallel for schedule(static,1)
-  for(int i=backPlaneInd; i<=dim[0]-voxSkip; i+=voxSkip){
-    double coords[3];
-    coords[0] = originCoords[0] + imgRes*i;
-    for(int j=0; j<=dim[1]-voxSkip; j+=voxSkip){
-      coords[1] = originCoords[1] + imgRes*j;
-      for(int k=0; k<=dim[2]-voxSkip; k+=voxSkip){
-
-	bool doSeg = false;
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	
-	if(p[0] == innerVal){
-	  doSeg = true;
-	} else {
-	  // check other voxels in supervoxel
-	  for(int a=0; a<voxSkip; a++){
-	    for(int b=0; b<voxSkip; b++){
-	      for(int c=0; c<voxSkip; c++){
-		p = static_cast<unsigned char*>(breast->GetScalarPointer(i+a,j+b,k+c));
-		if(p[0] == innerVal){
-		  doSeg = true;
-		}
-	      }
-	    }
-	  }
-	}
-	if(doSeg){
-	  // found voxel to segment
-	  
-	  // find coordinates
-	  coords[2] = originCoords[2] + imgRes*k;
-	  
-	  // nearest fat points
-	  vtkSmartPointer<vtkIdList> nearPts =
-	    vtkSmartPointer<vtkIdList>::New();
-	  
-	  findSeed->FindPointsWithinRadius(compSeedRadius, coords, nearPts);
-
-	  // find minimum distance
-	  // starting with the first
-	  vtkIdType id = nearPts->GetId(0);
-
-	  // compute position in local coordinate system
-	  vtkVector3d rvec;
-	  vtkVector3d localCoords;
-	  for(int m=0; m<3; m++){
-	    rvec[m] = coords[m]-fatCompartments[id].pos[m];
-	  }
-	  for(int m=0; m<3; m++){
-	    localCoords[m] = rvec.Dot(fatCompartments[id].axis[m]);
-	  }
-					
-	  // compute distance function
-	  double minDist = 0.0;
-	  double nextMinDist = 0.0;
-	  
-	  for(int m=0; m<3; m++){
-	    minDist += fatCompartments[id].scale[m]*localCoords[m]*localCoords[m];
-	  }
-	  minDist = minDist/fatCompartments[id].g;
-					
-	  vtkIdType closestId = id;
-	  vtkIdType nextClosestId = id;
-
-	  int numSeedToCheck = nearPts->GetNumberOfIds();
-
-	  // check other fat points to find minimum distance
-	  for(int n=1; n<numSeedToCheck; n++){
-	    vtkIdType thisId = nearPts->GetId(n);
-	    for(int m=0; m<3; m++){
-	      rvec[m] = coords[m]-fatCompartments[thisId].pos[m];
-	    }
-	    for(int m=0; m<3; m++){
-	      localCoords[m] = rvec.Dot(fatCompartments[thisId].axis[m]);
-	    }
-
-	    // compute distance
-	    double dist = 0.0;
-	    for(int m=0; m<3; m++){
-	      dist += fatCompartments[thisId].scale[m]*localCoords[m]*localCoords[m];
-	    }
-	    dist = dist/fatCompartments[thisId].g;
-	    
-	    if(dist < minDist){
-	      nextMinDist = minDist;
-	      nextClosestId = closestId;
-	      minDist = dist;
-	      closestId = thisId;
-	    } else if(dist < nextMinDist){
-	      nextMinDist = dist;
-	      nextClosestId = thisId;
-	    }
-	  }
-
-	  // now check all gland seeds
-	  for(int n=0; n<=numBreastCompartments; n++){
-	    for(int m=0; m<3; m++){
-	      rvec[m] = coords[m]-glandCompartments[n].pos[m];
-	    }
-	    for(int m=0; m<3; m++){
-	      localCoords[m] = rvec.Dot(glandCompartments[n].axis[m]);
-	    }
-
-	    // compute distance
-	    double dist = 0.0;
-	    for(int m=0; m<3; m++){
-	      dist += glandCompartments[n].scale[m]*localCoords[m]*localCoords[m];
-	    }
-	    dist = dist/glandCompartments[n].g;
-
-	    
-	    // glandular compartment so add noise
-	    dist += boundaryDev*dist*boundary[n].getNoise(localCoords.Normalized().GetData());
-	    
-	    if(dist < minDist){
-	      nextMinDist = minDist;
-	      nextClosestId = closestId;
-	      minDist = dist;
-	      closestId = numFatSeeds+n;
-	    } else if(dist < nextMinDist){
-	      nextMinDist = dist;
-	      nextClosestId = numFatSeeds+n;
-	    }
-	  }
-
-	  // set tissue type
-	  unsigned char myTissue;
-	  
-	  if(closestId < numFatSeeds){
-	    myTissue = ufat;
-	  } else {
-	    myTissue = compartmentVal[glandCompartments[closestId-numFatSeeds].compId];
-	  }
-
-	  for(int a=0; a<voxSkip; a++){
-            for(int b=0; b<voxSkip; b++){
-              for(int c=0; c<voxSkip; c++){
-                p = static_cast<unsigned char*>(breast->GetScalarPointer(i+a,j+b,k+c));
-                if(p[0] == innerVal){
-                  p[0] = myTissue;
-                }
-              }
-            }
-          }
-	}
-      }
+  for(vtkIdType i=0; i<trightRing->GetNumberOfPoints(); i++){
+    double t[3];
+    trightRing->GetPoint(i, t);
+    ringPts->InsertNextPoint(t);
+    double xstep = ringSepOrig;
+    while(xstep < ringWidthOrig){
+      t[0] = -xstep;
+      ringPts->InsertNextPoint(t);
+      xstep += ringSepOrig;
     }
   }
-
-  // deleting boundary noise
-  for(int i=0; i<=numBreastCompartments; i++){
-    boundary[i].~perlinNoise();
+  for(vtkIdType i=0; i<bleftRing->GetNumberOfPoints(); i++){
+    double t[3];
+    bleftRing->GetPoint(i, t);
+    ringPts->InsertNextPoint(t);
+    double xstep = ringSepOrig;
+    while(xstep < ringWidthOrig){
+      t[0] = -xstep;
+      ringPts->InsertNextPoint(t);
+      xstep += ringSepOrig;
+    }
   }
-  ::operator delete(boundary);
-
-
-  // calculate voxel counts and bounding boxes
-  // only updating boundBox for gland compartments
-#pragma omp parallel for
-  for(int i=0; i<=numBreastCompartments; i++){
-    unsigned char val;
-    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer());
-    for(int c=0; c<dim[2]; c++){
-      for(int b=0; b<dim[1]; b++){
-	for(int a=0; a<dim[0]; a++){
-	  val = *p;
-	  p++;
-	  if(val == compartmentVal[glandCompartments[i].compId]){
-	    if(a < glandCompartments[i].boundBox[0]){
-	      glandCompartments[i].boundBox[0] = a;
-	    } else {
-	      if(a > glandCompartments[i].boundBox[1]){
-		glandCompartments[i].boundBox[1] = a;
-	      }
-	    }
-	    if(b < glandCompartments[i].boundBox[2]){
-	      glandCompartments[i].boundBox[2] = b;
-	    } else {
-	      if(b > glandCompartments[i].boundBox[3]){
-		glandCompartments[i].boundBox[3] = b;
-	      }
-	    }
-	    if(c < glandCompartments[i].boundBox[4]){
-	      glandCompartments[i].boundBox[4] = c;
-	    } else {
-	      if(c > glandCompartments[i].boundBox[5]){
-		glandCompartments[i].boundBox[5] = c;
-	      }
-	    }
-	    glandCompartments[i].voxelCount += 1;
-	  }
-	}
-      }
+  for(vtkIdType i=0; i<tleftRing->GetNumberOfPoints(); i++){
+    double t[3];
+    tleftRing->GetPoint(i, t);
+    ringPts->InsertNextPoint(t);
+    double xstep = ringSepOrig;
+    while(xstep < ringWidthOrig){
+      t[0] = -xstep;
+      ringPts->InsertNextPoint(t);
+      xstep += ringSepOrig;
     }
   }
+  vtkIdType numRingPts = ringPts->GetNumberOfPoints();
+  
+  // decimate ring points
+  vtkSmartPointer<vtkPolyData> ringPoly = 
+    vtkSmartPointer<vtkPolyData>::New();
+  ringPoly->SetPoints(ringPts);
+  vtkSmartPointer<vtkVertexGlyphFilter> ringVertAdd =
+    vtkSmartPointer<vtkVertexGlyphFilter>::New();
+#if VTK_MAJOR_VERSION <= 5
+  ringVertAdd->SetInput(ringPoly);
+#else
+  ringVertAdd->SetInputData(ringPoly);
+#endif
+  ringVertAdd->Update();
+  vtkSmartPointer<vtkCleanPolyData> cleanRing =
+    vtkSmartPointer<vtkCleanPolyData>::New();
+#if VTK_MAJOR_VERSION <= 5
+  cleanRing->SetInput(ringVertAdd->GetOutput());
+#else
+  cleanRing->SetInputConnection(ringVertAdd->GetOutputPort());
+#endif
+  cleanRing->SetTolerance(pointSep);
+  cleanRing->Update();	
+	
+  // allocate space for breast points
+  vtkSmartPointer<vtkPoints> breastPts =
+    vtkSmartPointer<vtkPoints>::New();
 
-  // amount of fat and gland and ligament
-  double fatVol = 0.0;		// keep track of fat and glandular segmented volume
-  double glandVol = 0.0;
-  double cooperVol = 0.0;
-  double targetGlandVol;
-  long long int glandVoxels = 0;
-  long long int fatVoxels = 0;
-  long long int cooperVoxels = 0;
-  //double ligVol = 0.0;
+  vtkIdType numBreastPts = cleanFront->GetOutput()->GetNumberOfPoints();
+  numBreastPts += cleanBack->GetOutput()->GetNumberOfPoints();
+  numBreastPts += cleanRing->GetOutput()->GetNumberOfPoints();
+  breastPts->SetNumberOfPoints(numBreastPts);
+  
+  // cell array for verticies
+  vtkSmartPointer<vtkCellArray> breastVerts =
+    vtkSmartPointer<vtkCellArray>::New();
+	
+  // scale to physical units
+  vtkIdType totalCount = 0;
+  vtkIdType currentPoints = cleanFront->GetOutput()->GetNumberOfPoints();
 
-  double targetFatFrac = vm["base.targetFatFrac"].as<double>(); // desired fat fraction of breast
-  if(targetFatFrac > 1.0){
-    targetFatFrac = 1.0;
-  }
-  if(targetFatFrac < 0.0){
-    targetFatFrac = 0.0;
+  for(vtkIdType i=0; i<currentPoints; i++){
+    double t[3];
+		
+    cleanFront->GetOutput()->GetPoint(i,t);
+    for(int j=0; j<3; j++){
+      t[j] = t[j]*scaleFactor;
+    }
+    breastPts->SetPoint(totalCount,t);
+    breastVerts->InsertNextCell(1,&totalCount); 
+    totalCount++;
   }
 
-  // convert gland compartment voxel counts to volume
-  //#pragma omp parallel for reduction(+:glandVol,glandVoxels)
-  for(int i=0; i<=numBreastCompartments; i++){
-    glandCompartments[i].volume = voxelVol*glandCompartments[i].voxelCount;
-    glandVol += glandCompartments[i].volume;
-    glandVoxels += glandCompartments[i].voxelCount;
+  // calculate scaled back points
+  currentPoints = cleanBack->GetOutput()->GetNumberOfPoints();
+  for(vtkIdType i=0; i<currentPoints; i++){
+    double t[3];
+    cleanBack->GetOutput()->GetPoint(i,t);
+    for(int j=0; j<3; j++){
+      t[j] = t[j]*scaleFactor;
+    }
+    breastPts->SetPoint(totalCount,t);
+    breastVerts->InsertNextCell(1,&totalCount); 
+    totalCount++;
   }
+	
+  // calculate scaled ring points and normals
+  currentPoints = cleanRing->GetOutput()->GetNumberOfPoints();
 
-
-  // fat and ligament volume need to count voxel by voxel to capture backplane
-#pragma omp parallel for reduction(+:fatVoxels)
-  for(int c=0; c<dim[2]; c++){
-    for(int b=0; b<dim[1]; b++){
-      for(int a=0; a<dim[0]; a++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
-	if(p[0] == ufat){
-	  fatVoxels += 1;
-	} else if(p[0] == tissue.cooper){
-	  cooperVoxels += 1;
-	}
-      }
+  for(vtkIdType i=0; i<currentPoints; i++){
+    double t[3];
+    cleanRing->GetOutput()->GetPoint(i,t);
+    for(int j=0; j<3; j++){
+      t[j] = t[j]*scaleFactor;
     }
+    breastPts->SetPoint(totalCount,t);
+    breastVerts->InsertNextCell(1,&totalCount); 
+    totalCount++;
   }
-  fatVol = voxelVol*fatVoxels;
-  
-  //cout << "done.\n";
-  //cout << "Initial Voronoi fat fraction = " << fatVol/(glandVol+fatVol) << "\n";
 
+  // create polydata
+  vtkSmartPointer<vtkPolyData> breastPoly =
+    vtkSmartPointer<vtkPolyData>::New();
+  breastPoly->SetPoints(breastPts);
+	
+  // add verticies to polydata
+  breastPoly->SetVerts(breastVerts);
+	
+  // surface mesh reconstruction
+  vtkSmartPointer<vtkSurfaceReconstructionFilter> breastFilter =
+    vtkSmartPointer<vtkSurfaceReconstructionFilter>::New();
+		
+#if VTK_MAJOR_VERSION <= 5
+  breastFilter->SetInput(breastPoly);
+#else
+  breastFilter->SetInputData(breastPoly);
+#endif
+  breastFilter->Update();
+	
+  // fix bug in vtkSurfaceReconstructionFilter
+  double pointSetBounds[6];
+  breastPts->GetBounds(pointSetBounds);
+	
+  vtkSmartPointer<vtkContourFilter> breastContourFilter =
+    vtkSmartPointer<vtkContourFilter>::New();
+		
+#if VTK_MAJOR_VERSION <= 5
+  breastContourFilter->SetInput(breastFilter->GetOutput());
+#else
+  breastContourFilter->SetInputConnection(breastFilter->GetOutputPort());
+#endif
+  breastContourFilter->ComputeNormalsOn();
+  breastContourFilter->SetValue(0, 0.0);
+  breastContourFilter->Update();
+	
+  vtkSmartPointer<vtkReverseSense> breastSenseFilter =
+    vtkSmartPointer<vtkReverseSense>::New();
+	
+#if VTK_MAJOR_VERSION <= 5
+  breastSenseFilter->SetInput(breastContourFilter->GetOutput());
+#else
+  breastSenseFilter->SetInputConnection(breastContourFilter->GetOutputPort());
+#endif
+  breastSenseFilter->ReverseCellsOn();
+  breastSenseFilter->ReverseNormalsOn();
+  breastSenseFilter->Update();
 
-  targetGlandVol = (glandVol+fatVol)*(1-targetFatFrac);
+  double surfaceBounds[6];
+  breastSenseFilter->GetOutput()->GetBounds(surfaceBounds);
+	
+  double scaling[3];
+	
+  scaling[0] = (pointSetBounds[1]-pointSetBounds[0])/(surfaceBounds[1]-surfaceBounds[0]);
+  scaling[1] = (pointSetBounds[3]-pointSetBounds[2])/(surfaceBounds[3]-surfaceBounds[2]);
+  scaling[2] = (pointSetBounds[5]-pointSetBounds[4])/(surfaceBounds[5]-surfaceBounds[4]);
 
-  // add back plane voxels assigned to glandular compartment
-  int numBackPlaneSkin = 0;
-  for(int i=0; i<dim[1]; i++){
-    for(int j=0; j<dim[2]; j++){
-      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(backPlaneInd,i,j));
-      if(p[0] <= compMax && p[0] >= compMin){
-        numBackPlaneSkin += 1;
-        int ijk[3] =  {backPlaneInd,i,j};
-        boundaryList->InsertNextId(breast->ComputePointId(ijk));
-      }
-    }
-  }
+  vtkSmartPointer<vtkTransform> transp = 
+    vtkSmartPointer<vtkTransform>::New();
+  transp->Translate(pointSetBounds[0], pointSetBounds[2], pointSetBounds[4]);
+  transp->Scale(scaling[0], scaling[1], scaling[2]);
+  transp->Translate(-surfaceBounds[0], -surfaceBounds[2], -surfaceBounds[4]);
 
+  vtkSmartPointer<vtkTransformPolyDataFilter> fixed = 
+    vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+  fixed->SetInputData(breastSenseFilter->GetOutput());
+#if VTK_MAJOR_VERSION <= 5
+  fixed->SetInput(breastSenseFilter->GetOutput());
+#else
+  fixed->SetInputData(breastSenseFilter->GetOutput());
+#endif
+  fixed->SetTransform(transp);
+  fixed->Update();
 
-  // check boundary voxels and add fat, muscle and near-nipple voxels to delete mask
-  vtkIdType nBoundary = boundaryList->GetNumberOfIds();
-  vtkIdType remBoundary = nBoundary;
+  // clean mesh
+  vtkSmartPointer<vtkCleanPolyData> cleanPoly =
+    vtkSmartPointer<vtkCleanPolyData>::New();
+#if VTK_MAJOR_VERSION <= 5
+  cleanPoly->SetInput(fixed->GetOutput());
+#else
+  cleanPoly->SetInputConnection(fixed->GetOutputPort());
+#endif
+	
+  // decimate mesh
+  vtkSmartPointer<vtkDecimatePro> decimate = 
+    vtkSmartPointer<vtkDecimatePro>::New();
+  decimate->SetTargetReduction(0.25);
+#if VTK_MAJOR_VERSION <= 5
+  decimate->SetInput(cleanPoly->GetOutput());
+#else
+  decimate->SetInputConnection(cleanPoly->GetOutputPort());
+#endif
+  decimate->Update();
 
-  unsigned char *boundaryDone;
-  boundaryDone = new unsigned char [nBoundary];
+  vtkSmartPointer<vtkPolyData> innerPoly =
+    vtkSmartPointer<vtkPolyData>::New();
+  innerPoly->ShallowCopy(decimate->GetOutput());
 
-  for(vtkIdType i=0; i<nBoundary; i++){
-    boundaryDone[i] = 0;
-  }
+  // create 3d imagedata
+  vtkSmartPointer<vtkImageData> breast =
+    vtkSmartPointer<vtkImageData>::New();
 
+  double baseBound[6];
+  innerPoly->GetBounds(baseBound);
   
-  for(vtkIdType i=0; i<nBoundary; i++){
-    vtkIdType myId = boundaryList->GetId(i);
-    double loc[3];
-    double pcoords[3];
-    int ijk[3];
-    breast->GetPoint(myId, loc);
-    breast->ComputeStructuredCoordinates(loc, ijk, pcoords);
-		
-    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(ijk));
-		
-    if(p[0] == ufat || p[0] == tissue.muscle || vtkMath::Distance2BetweenPoints(loc, nipplePos) < areolaRad*areolaRad*2){
-      boundaryDone[i] = 1;
-      remBoundary++;
-    }
+  // extend bounds slightly to make room for nipple
+  double baseFOV[3];
+  for(int i=0; i<3; i++){
+    baseFOV[i] = fabs(baseBound[2*i+1] - baseBound[2*i]);
   }
-	
-  // determine glandular compartments to remove
 
-  // find smallest compartment
-  unsigned int delNext=0;
-  double volNext=glandCompartments[0].volume;
+  double finalBound[6];
+  for(int i=0; i<6; i++){
+    finalBound[i] = baseBound[i];
+  }
+  finalBound[0] = finalBound[0] + 1.0;	// move backplane in by 1 mm to avoid surface edge
+  finalBound[1] = finalBound[1] + nippleLen + 2.0;	// make room for nipple
+  finalBound[2] = finalBound[2] - 0.01*baseFOV[1];
+  finalBound[3] = finalBound[3] + 0.01*baseFOV[1];
+  finalBound[4] = finalBound[4] - 0.01*baseFOV[2];
+  finalBound[5] = finalBound[5] + 0.01*baseFOV[2];
 
-  for(int i=1; i<numBreastCompartments; i++){
-    if(glandCompartments[i].volume < volNext){
-      delNext = i;
-      volNext = glandCompartments[i].volume;
-    }
+  double spacing[3];
+  for(int i=0; i<3; i++){
+    spacing[i] = imgRes;
   }
+  breast->SetSpacing(spacing);
 
-  unsigned int densityClass;
-  unsigned int numKeepComp;
+  int dim[3];
+  for(int i=0; i<3; i++){
+    dim[i] = static_cast<int>(ceil((finalBound[2*i+1]-finalBound[2*i])/spacing[i]));
+  }
 
-  // target fat fraction post compartment removal
-  double targetFatFracStep1 = targetFatFrac*0.5;
-  double currentFatFrac = fatVol/(fatVol+glandVol);
+  breast->SetExtent(0, dim[0]-1, 0, dim[1]-1, 0, dim[2]-1);
   
-  if(currentFatFrac >= targetFatFracStep1){
-    targetFatFracStep1 = currentFatFrac;
+  double origin[3];
+  for(int i=0; i<3; i++){
+    origin[i] = finalBound[2*i]+spacing[i]/2.0;
   }
+  breast->SetOrigin(origin);
 
+  // allocate unsigned char, sparse storage reads as zero (tissue.bg)
+  // until written so no initialization pass is needed
+  // out of core volume lives in the raw output file
+  bool outOfCore = vm["volume.outOfCore"].as<bool>();
+  breastVolume volume(breast, vm["volume.brickSize"].as<int>(), outOfCore ? outRawFilename : NULL);
+  if(vm["volume.hugePages"].as<bool>()){
+    volume.useHugePages();
+  }
+  // place pages on the node of the thread owning their z slab
+  if(vm["volume.firstTouch"].as<bool>()){
+    volume.firstTouch();
+  }
 
-  // disable gland compartment removal
-  //double removeGlandVol = (targetFatFracStep1-currentFatFrac)*(fatVol+glandVol);
-  double removeGlandVol = 0.0;
+  int originIndex[3] = {0, 0, 0};
+  double originCoords[3];
+  breast->GetPoint(breast->ComputePointId(originIndex),originCoords);
 
+  // voxelize
 
-  if(targetFatFrac < 0.4){
-    densityClass = 1;
-    // dense breast
-  } else if(targetFatFrac < 0.75){
-    densityClass = 2;
-    // heterogeneous breast
-  } else if(targetFatFrac < 0.9){
-    densityClass = 3;
-    // scattered density
-  } else{
-    densityClass = 4;
-    // fatty breast
-  }
+  // list of boundary voxels
+  vtkSmartPointer<vtkIdList> boundaryList =
+    vtkSmartPointer<vtkIdList>::New();
 
-  numKeepComp = numBreastCompartments;
-  // set numKeepComp based on fat fraction
-  //if(targetFatFrac < 0.3){
-  //  numKeepComp = numBreastCompartments;
-  //  // keep all
-  //} else if(targetFatFrac > 0.9){
-  //  numKeepComp = 4;
-  //  if(numBreastCompartments < 4){
-  //    numKeepComp = numBreastCompartments;
-  //  }
-  //} else {
-  //  // linear function of fat fraction
-  //  numKeepComp = 2 + static_cast<unsigned int>(round((numBreastCompartments-4)/(0.9-0.3)*(0.9-targetFatFrac)));
-  //  if(numBreastCompartments < 4){
-  //    numKeepComp = numBreastCompartments;
-  //  }
-  //}
+  // state carried past the compartment stage, set by the stage or
+  // restored from the compartment cache
+  int breastExtent[6];
+  breast->GetExtent(breastExtent);
+  double breastVol;
+  double nippleNorm[3];
 
-  // identify compartments to remove
-  //unsigned int numDelComp = numBreastCompartments - numKeepComp;
-  unsigned int *keepCompList = (unsigned int*)malloc(numBreastCompartments*sizeof(unsigned int));
-  unsigned int *delCompList = (unsigned int*)malloc(numBreastCompartments*sizeof(unsigned int));
+  // label counts from here on are kept by the writers
+  tissueHistogram* hist = volume.getHistogram();
 
-  unsigned int foundComp = 0;
-  unsigned int keepComp = 0;
+  int numBreastCompartments = vm["compartments.num"].as<int>();
+  int numFatSeeds;
 
-  //while(foundComp < numDelComp){
-  //  // random compartment
-  //  unsigned int c = static_cast<unsigned int>(floor(rgen->GetRangeValue(0.0, numBreastCompartments)));
-  //  rgen->Next();
-  //  if(glandCompartments[c].keep == true){
-  //    // found one
-  //    delCompList[foundComp] = c;
-  //    glandCompartments[c].keep = false;
-  //    foundComp++;
-  //  }
-  //}
+  breastComp *glandCompartments;
+  breastComp *fatCompartments;
+	
+  // breast dimensions for initializing bounding box
+  int breastDim[3];
+  breast->GetDimensions(breastDim);
+
+  // amount of fat and gland and ligament
+  double fatVol;		// keep track of fat and glandular segmented volume
+  double glandVol;
+  double cooperVol;
+  double targetGlandVol;
+  long long int glandVoxels;
+  long long int fatVoxels;
+  long long int cooperVoxels;
 
-  while(removeGlandVol > volNext){
-    delCompList[foundComp] = delNext;
-    glandCompartments[delNext].keep = false;
-    removeGlandVol -= volNext;
-    foundComp++;
-    // update next compartment to delete
-    volNext = fatVol+glandVol;
-    for(int i=0; i<numBreastCompartments; i++){
-      if(glandCompartments[i].volume < volNext && glandCompartments[i].keep == true){
-	delNext = i;
-	volNext = glandCompartments[i].volume;
+  double targetFatFrac = vm["base.targetFatFrac"].as<double>(); // desired fat fraction of breast
+  if(targetFatFrac > 1.0){
+    targetFatFrac = 1.0;
+  }
+  if(targetFatFrac < 0.0){
+    targetFatFrac = 0.0;
+  }
+
+  int numBackPlaneSkin;
+  vtkIdType nBoundary;
+  vtkIdType remBoundary;
+  unsigned char *boundaryDone;
+
+  unsigned int densityClass;
+  unsigned int numKeepComp;
+  double currentFatFrac;
+  unsigned int *keepCompList;
+  unsigned int keepComp;
+
+  // the compartment stage only depends on the options below and the seed,
+  // look for a cached result
+  std::string cacheDir = vm["cache.dir"].as<std::string>();
+  stageCache compCache(cacheDir);
+  bool cacheHit = false;
+
+  if(!cacheDir.empty()){
+    for(po::variables_map::iterator it = vm.begin(); it != vm.end(); ++it){
+      const std::string& name = it->first;
+      if((name.compare(0, 5, "base.") == 0 && name != "base.outputDir" && name != "base.seed") ||
+	 name.compare(0, 6, "shape.") == 0 || name.compare(0, 13, "compartments.") == 0 ||
+	 name.compare(0, 9, "boundary.") == 0 || name.compare(0, 7, "perlin.") == 0){
+	compCache.addOption(name, it->second.value());
       }
     }
+    compCache.addOption("seed", boost::any(shapeSeed));
+    compCache.addOption("sizeof.breastComp", boost::any((unsigned int)sizeof(breastComp)));
+    cacheHit = compCache.openRead();
   }
 
-  // populate keepCompList
-  keepComp = 0;
-  for(int i=0; i<numBreastCompartments; i++){
-    if(glandCompartments[i].keep == true){
-      keepCompList[keepComp] = i;
-      keepComp++;
+  if(!cacheHit){
+    int status = compartmentStage(vm, pi, tissue, innerVal, boundVal, compartmentVal, compMin, compMax, ufat,
+				  imgRes, skinThick, nippleLen, nippleRad, areolaRad, voxelVol, leftSide,
+				  targetFatFrac, numBreastCompartments, innerPoly, breast, volume, hist, rgen,
+				  baseBound, dim, origin, spacing, originCoords, breastExtent, breastDim, nipplePos,
+				  boundaryList, numFatSeeds, breastVol, nippleNorm, glandCompartments,
+				  fatCompartments, fatVol, glandVol, cooperVol, targetGlandVol, glandVoxels,
+				  fatVoxels, cooperVoxels, numBackPlaneSkin, nBoundary, remBoundary, boundaryDone,
+				  densityClass, numKeepComp, currentFatFrac, keepCompList, keepComp);
+    if(status != EXIT_SUCCESS){
+      return status;
     }
   }
-    
 
-  // set removed compartments to fat
-#pragma omp parallel for
-  for(int i=0; i<foundComp; i++){
-    int mc = delCompList[i];
-    for(int a=glandCompartments[mc].boundBox[0]; a<=glandCompartments[mc].boundBox[1]; a++){
-      for(int b=glandCompartments[mc].boundBox[2]; b<=glandCompartments[mc].boundBox[3]; b++){
-	for(int c=glandCompartments[mc].boundBox[4]; c<=glandCompartments[mc].boundBox[5]; c++){
-	  unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
-	  if(p[0] == compartmentVal[glandCompartments[mc].compId]){
-	    p[0] = ufat;
-	  }
-	}
-      }
+  if(cacheHit){
+    // restore compartment stage
+    int rgenState;
+    vtkIdType numBoundaryIds;
+    void* stateVal[] = {&numFatSeeds, &breastVol, nippleNorm, &fatVol, &glandVol, &cooperVol,
+			&targetGlandVol, &glandVoxels, &fatVoxels, &cooperVoxels, &numBackPlaneSkin,
+			&nBoundary, &remBoundary, &numBoundaryIds, &densityClass, &numKeepComp,
+			&currentFatFrac, &keepComp, &rgenState};
+    size_t stateLen[] = {sizeof(numFatSeeds), sizeof(breastVol), sizeof(nippleNorm), sizeof(fatVol),
+			 sizeof(glandVol), sizeof(cooperVol), sizeof(targetGlandVol), sizeof(glandVoxels),
+			 sizeof(fatVoxels), sizeof(cooperVoxels), sizeof(numBackPlaneSkin), sizeof(nBoundary),
+			 sizeof(remBoundary), sizeof(numBoundaryIds), sizeof(densityClass), sizeof(numKeepComp),
+			 sizeof(currentFatFrac), sizeof(keepComp), sizeof(rgenState)};
+    for(size_t n=0; n<sizeof(stateLen)/sizeof(size_t); n++){
+      compCache.read(stateVal[n], stateLen[n]);
     }
-  } 
 
-  // update fat fraction and voxel counts
-  for(int i=0; i<foundComp; i++){
-    glandVol -= glandCompartments[delCompList[i]].volume;
-    fatVol += glandCompartments[delCompList[i]].volume;
+    glandCompartments = (breastComp*)malloc((numBreastCompartments+1)*sizeof(breastComp));
+    fatCompartments = (breastComp*)malloc(numFatSeeds*sizeof(breastComp));
+    boundaryDone = new unsigned char [nBoundary];
+    keepCompList = (unsigned int*)malloc(numBreastCompartments*sizeof(unsigned int));
+    boundaryList->SetNumberOfIds(numBoundaryIds);
+
+    compCache.read(glandCompartments, (numBreastCompartments+1)*sizeof(breastComp));
+    compCache.read(fatCompartments, numFatSeeds*sizeof(breastComp));
+    compCache.read(boundaryList->GetPointer(0), numBoundaryIds*sizeof(vtkIdType));
+    compCache.read(boundaryDone, nBoundary);
+    compCache.read(keepCompList, numBreastCompartments*sizeof(unsigned int));
+    compCache.readVolume(breast);
+
+    if(!compCache.close()){
+      cerr << "Could not read compartment cache " << compCache.getFilename() << "\n";
+      cerr << "Exiting...\n";
+      return(1);
+    }
+
+    // continue the random sequence where the cached run left it
+    rgen->SetSeedOnly(rgenState);
+
+    // flag background bricks and count labels
+    volume.updateOccupancy();
+  } else if(!cacheDir.empty()){
+    // save compartment stage for later runs, a failure only costs the cache
+    int rgenState = rgen->GetSeed();
+    vtkIdType numBoundaryIds = boundaryList->GetNumberOfIds();
+    const void* stateVal[] = {&numFatSeeds, &breastVol, nippleNorm, &fatVol, &glandVol, &cooperVol,
+			      &targetGlandVol, &glandVoxels, &fatVoxels, &cooperVoxels, &numBackPlaneSkin,
+			      &nBoundary, &remBoundary, &numBoundaryIds, &densityClass, &numKeepComp,
+			      &currentFatFrac, &keepComp, &rgenState};
+    size_t stateLen[] = {sizeof(numFatSeeds), sizeof(breastVol), sizeof(nippleNorm), sizeof(fatVol),
+			 sizeof(glandVol), sizeof(cooperVol), sizeof(targetGlandVol), sizeof(glandVoxels),
+			 sizeof(fatVoxels), sizeof(cooperVoxels), sizeof(numBackPlaneSkin), sizeof(nBoundary),
+			 sizeof(remBoundary), sizeof(numBoundaryIds), sizeof(densityClass), sizeof(numKeepComp),
+			 sizeof(currentFatFrac), sizeof(keepComp), sizeof(rgenState)};
+    if(compCache.openWrite()){
+      for(size_t n=0; n<sizeof(stateLen)/sizeof(size_t); n++){
+	compCache.write(stateVal[n], stateLen[n]);
+      }
+      compCache.write(glandCompartments, (numBreastCompartments+1)*sizeof(breastComp));
+      compCache.write(fatCompartments, numFatSeeds*sizeof(breastComp));
+      compCache.write(boundaryList->GetPointer(0), numBoundaryIds*sizeof(vtkIdType));
+      compCache.write(boundaryDone, nBoundary);
+      compCache.write(keepCompList, numBreastCompartments*sizeof(unsigned int));
+      compCache.writeVolume(breast);
+    }
+    if(!compCache.close()){
+      cerr << "Could not write compartment cache " << compCache.getFilename() << "\n";
+    }
   }
 
-  fatVoxels = static_cast<long long int>(round(fatVol/voxelVol));
-  glandVoxels = static_cast<long long int>(round(glandVol/voxelVol));
+  // textures of an ensemble member follow the run seed
+  if(ownShapeSeed){
+    rgen->SetSeed(randSeed);
+  }
 
   /***********************
 	Ducts and TDLUs
@@ -3303,13 +3379,25 @@ int main(int argc, char* argv[]){
     }
   }
 
+  // number of duct trees, one per kept compartment
+  int numDuct = keepComp;
+
+  // duct start position and direction of each compartment
+  double* ductStartPos = new double[3*keepComp];
+  double* ductStartDir = new double[3*keepComp];
+
+  // distance from nipple to each duct start position
+  double* ductStartDist = new double[keepComp];
+
+  // find every start position before any connector is drawn, so no search
+  // sees another compartment's connector
 #pragma omp parallel
   {
 #pragma omp for
-    for(int i=0; i<keepComp; i++){
+    for(int i=0; i<numDuct; i++){
       
       // find starting direction
-      double sdir[3];
+      double* sdir = &ductStartDir[3*i];
 
       for(int j=0; j<3; j++){
 	sdir[j] = glandCompartments[keepCompList[i]].pos[j] - nipplePos[j];
@@ -3323,7 +3411,10 @@ int main(int argc, char* argv[]){
       // find starting position
 
       // start from nipple, move towards compartment seed until inside compartment
-      double currentPos[3] = {nipplePos[0], nipplePos[1], nipplePos[2]};
+      double* currentPos = &ductStartPos[3*i];
+      for(int j=0; j<3; j++){
+	currentPos[j] = nipplePos[j];
+      }
       bool inCompartment = false;
       double pcoords[3];
       int indicies[3];
@@ -3359,6 +3450,22 @@ int main(int argc, char* argv[]){
 	cout << "Error, could not find starting duct position\n";
 	//	return EXIT_FAILURE;
       }
+      ductStartDist[i] = dist;
+    }
+  }
+
+  // connectors from the nipple all meet near the nipple, draw them before
+  // any tree is grown so no tree sees another's connector half drawn
+  // a connector writes duct over every label but background, skin and
+  // nipple, which no connector writes, so overlapping connectors give the
+  // same voxels in any order
+#pragma omp parallel
+  {
+#pragma omp for
+    for(int i=0; i<numDuct; i++){
+      double* sdir = &ductStartDir[3*i];
+      double* currentPos = &ductStartPos[3*i];
+      double dist = ductStartDist[i];
 
       // create connector from nipple to start position
       // with cubic spline
@@ -3407,12 +3514,15 @@ int main(int argc, char* argv[]){
 						     (thisPix[1]-myPosPix[1])*(thisPix[1]-myPosPix[1])+(thisPix[2]-myPosPix[2])*(thisPix[2]-myPosPix[2])));
 	      if(dist2 <= myRad*myRad){
 		unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(thisPix));
-		unsigned char pval;
-#pragma omp atomic read
-		pval = *p;
-		if(pval != tissue.bg && pval != tissue.skin && pval != tissue.nipple){
-#pragma omp atomic write
-		  *p = tissue.duct;
+		// connectors overlap near the nipple, only the thread whose
+		// exchange succeeds moves the voxel in the histogram
+		unsigned char pval = __atomic_load_n(p, __ATOMIC_RELAXED);
+		while(pval != tissue.duct && pval != tissue.bg && pval != tissue.skin && pval != tissue.nipple){
+		  // on failure pval is reloaded
+		  if(__atomic_compare_exchange_n(p, &pval, tissue.duct, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+		    hist->move(pval, tissue.duct);
+		    break;
+		  }
 		}
 	      }
 	    }
@@ -3420,21 +3530,94 @@ int main(int argc, char* argv[]){
 	}
 	pos[0] += nipconStep;
       }
-						  
-      // create a seed for duct random number generator
-      int seed;
-#pragma omp critical (randgen)
-      {
-	seed = static_cast<int>(round(rgen->GetRangeValue(0.0, 1.0)*2147483648));
-	rgen->Next();
-      }
+    }
+  }
+
+  // draw duct tree seeds in compartment order before growing any tree, so
+  // a compartment gets the same tree whatever the number of threads
+  int* ductSeed = new int[keepComp];
+  for(int i=0; i<numDuct; i++){
+    ductSeed[i] = static_cast<int>(round(rgen->GetRangeValue(0.0, 1.0)*2147483648));
+    rgen->Next();
+  }
+
+  // grow trees largest compartment first, so the longest tree is not
+  // started last
+  int* ductOrder = new int[keepComp];
+  for(int i=0; i<numDuct; i++){
+    int j = i;
+    while(j > 0 && glandCompartments[keepCompList[ductOrder[j-1]]].voxelCount <
+	  glandCompartments[keepCompList[i]].voxelCount){
+      ductOrder[j] = ductOrder[j-1];
+      j--;
+    }
+    ductOrder[j] = i;
+  }
+
+  // split threads between trees and the fill map sweeps inside each tree
+  int ductThreads = omp_get_max_threads();
+  if(vm["ductTree.threads"].as<uint>() > 0){
+    ductThreads = vm["ductTree.threads"].as<uint>();
+  }
+  if(ductThreads > numDuct){
+    ductThreads = numDuct;
+  }
+  if(ductThreads < 1){
+    ductThreads = 1;
+  }
+  int ductFillThreads = omp_get_max_threads()/ductThreads;
+  if(ductFillThreads < 1){
+    ductFillThreads = 1;
+  }
+  int ductLevels = omp_get_max_active_levels();
+  omp_set_max_active_levels(2);
+
+  // every tree takes its region from the labels before any tree grows, and
+  // while growing only reads that and its own writes, so trees grown side
+  // by side do not see each other, the region is one bit per voxel, the
+  // fill map, ROI mask and branches are only made when the tree is grown
+  ductTree** ductTrees = new ductTree*[keepComp];
+  for(int i=0; i<numDuct; i++){
+    volume.prefetch(glandCompartments[keepCompList[i]].boundBox);
+    ductTrees[i] = create_duct(breast, vm, TDLUloc[i], TDLUattr[i], compartmentVal[glandCompartments[keepCompList[i]].compId], 
+			       glandCompartments[keepCompList[i]].boundBox, &tissue, hist, &ductStartDir[3*i], ductSeed[i]);
+    volume.evict(glandCompartments[keepCompList[i]].boundBox);
+  }
+
+#pragma omp parallel num_threads(ductThreads)
+  {
+    omp_set_num_threads(ductFillThreads);
+    // each tree's fill sweeps run on its own share of the cpus
+    breastVolume::pinTeam();
+    if(ductFillThreads > 1 && breastVolume::teamSpread() < 2){
+#pragma omp critical
+      cerr << "Warning: duct fill threads confined to a single cpu\n";
+    }
+#pragma omp for schedule(dynamic,1)
+    for(int n=0; n<numDuct; n++){
+      int i = ductOrder[n];
 
       // call duct generation function
-      generate_duct(breast, vm, TDLUloc[i], TDLUattr[i], compartmentVal[glandCompartments[keepCompList[i]].compId], 
-		    glandCompartments[keepCompList[i]].boundBox, &tissue, currentPos, sdir, seed);
+      volume.prefetch(glandCompartments[keepCompList[i]].boundBox);
+      generate_duct(ductTrees[i], &ductStartPos[3*i], &ductStartDir[3*i]);
+      volume.evict(glandCompartments[keepCompList[i]].boundBox);
     }
   }
 
+  omp_set_max_active_levels(ductLevels);
+
+  // back to one cpu per thread for the volume passes
+  if(vm["volume.pinThreads"].as<bool>()){
+    breastVolume::pinThreads();
+  }
+
+  delete[] ductStartPos;
+  delete[] ductStartDir;
+  delete[] ductStartDist;
+  delete[] ductSeed;
+  delete[] ductTrees;
+  delete[] ductOrder;
+
   // write TDLU locations to .loc file
   FILE *TDLUlocFile;
   TDLUlocFile = fopen(TDLUlocFilename, "w");
@@ -3451,6 +3634,7 @@ int main(int argc, char* argv[]){
   fclose(TDLUlocFile);
 
   // ducts/TDLUs complete
+  hist->flush();
 
   /**********************
    * 
@@ -3479,11 +3663,13 @@ int main(int argc, char* argv[]){
 	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
 	if(p[0] <= compMax && p[0] >= compMin){
 	  // glandular
+	  hist->move(p[0], ugland);
 	  p[0] = ugland;
 	}
       }
     }
   }
+  hist->flush();
 
   currentFatFrac = fatVol/(glandVol+fatVol);
   targetFatFrac = vm["base.targetFatFrac"].as<double>();	// desired fat fraction of breast
@@ -3706,6 +3892,8 @@ int main(int argc, char* argv[]){
     segSpace[3] = (seedVox[1] + (int)(pixelA*1.2) < glandBox[3]) ? seedVox[1] + (int)(pixelA*1.2) : glandBox[3];
     segSpace[4] = (seedVox[2] - (int)(pixelA*1.2) > glandBox[4]) ? seedVox[2] - (int)(pixelA*1.2) : glandBox[4];
     segSpace[5] = (seedVox[2] + (int)(pixelA*1.2) < glandBox[5]) ? seedVox[2] + (int)(pixelA*1.2) : glandBox[5];
+
+    volume.prefetch(segSpace);
 		
     // iterative over search space, adjusting A as we go
 #pragma omp parallel for collapse(3)
@@ -3789,6 +3977,8 @@ int main(int argc, char* argv[]){
     segSpace[4] = (seedVox[2] - (int)(pixelA*1.2) > glandBox[4]) ? seedVox[2] - (int)(pixelA*1.2) : glandBox[4];
     segSpace[5] = (seedVox[2] + (int)(pixelA*1.2) < glandBox[5]) ? seedVox[2] + (int)(pixelA*1.2) : glandBox[5];
 
+    long long int ufatBefore = hist->get(ufat);
+
     // iterative over search space, and segment
 #pragma omp parallel for collapse(3)
     for(int i=segSpace[0]; i<= segSpace[1]; i++){
@@ -3838,27 +4028,24 @@ int main(int argc, char* argv[]){
 	    // inside lobule?
 	    if(r <= A*(f + perturbVal)-skinLigThick){
 	      // gland to fat
+	      hist->move(*p, ufat);
 	      *p = ufat;
-#pragma omp atomic
-	      glandVoxels -= 1;
-#pragma omp atomic
-	      fatVoxels += 1;
 	    } else if(r <= A*(f + perturbVal)) {
 	      // disabled skin lobule ligaments
 	      // *p = tissue.cooper;
-	      //#pragma omp atomic
-	      //cooperVoxels += 1;
+	      hist->move(*p, ufat);
 	      *p = ufat;
-#pragma omp atomic
-	      fatVoxels += 1;
-#pragma omp atomic
-	      glandVoxels -= 1;
 	    } 
 	  }
 	}
       }
     }
 		
+    // gland converted by this lobule
+    hist->flush();
+    fatVoxels += hist->get(ufat) - ufatBefore;
+    glandVoxels -= hist->get(ufat) - ufatBefore;
+
     // update fatfrac
     currentFatFrac = (double)(fatVoxels)/(double)(fatVoxels+glandVoxels+cooperVoxels);
 
@@ -4085,6 +4272,10 @@ int main(int argc, char* argv[]){
     segSpace[4] = (seedVox[2] - (int)(pixelA*1.2) > glandBox[4]) ? seedVox[2] - (int)(pixelA*1.2) : glandBox[4];
     segSpace[5] = (seedVox[2] + (int)(pixelA*1.2) < glandBox[5]) ? seedVox[2] + (int)(pixelA*1.2) : glandBox[5];
 
+    volume.prefetch(segSpace);
+
+    long long int ufatBefore = hist->get(ufat);
+
     // iterative over search space, and segment
 #pragma omp parallel for collapse(3)
     for(int i=segSpace[0]; i<= segSpace[1]; i++){
@@ -4132,16 +4323,18 @@ int main(int argc, char* argv[]){
 	    // inside lobule?
 	    if(r <= A*(f + perturbVal)){
 	      // gland to fat
+	      hist->move(*p, ufat);
 	      *p = ufat;
-#pragma omp atomic
-	      glandVoxels -= 1;
-#pragma omp atomic
-	      fatVoxels += 1;
 	    }
 	  }
 	}
       }
     }
+    // gland converted by this lobule
+    hist->flush();
+    fatVoxels += hist->get(ufat) - ufatBefore;
+    glandVoxels -= hist->get(ufat) - ufatBefore;
+
     // update fatfrac
     currentFatFrac = (double)(fatVoxels)/(double)(fatVoxels+glandVoxels);
     //if(!(numInnerFatLobuleTry % 10)){
@@ -4285,7 +4478,11 @@ int main(int argc, char* argv[]){
     segSpace[3] = (seedVox[1] + (int)(pixelA*1.2) < breastExtent[3]) ? seedVox[1] + (int)(pixelA*1.2) : breastExtent[3];
     segSpace[4] = (seedVox[2] - (int)(pixelA*1.2) > breastExtent[4]) ? seedVox[2] - (int)(pixelA*1.2) : breastExtent[4];
     segSpace[5] = (seedVox[2] + (int)(pixelA*1.2) < breastExtent[5]) ? seedVox[2] + (int)(pixelA*1.2) : breastExtent[5];
+
+    volume.prefetch(segSpace);
 		
+    long long int ligBefore = hist->get(tissue.fat) + hist->get(tissue.gland) + hist->get(tissue.cooper);
+
     // iterative over search space, and segment
 #pragma omp parallel for collapse(3)
     for(int i=segSpace[0]; i<= segSpace[1]; i++){
@@ -4330,203 +4527,91 @@ int main(int argc, char* argv[]){
 	    if(r <= A*(f + perturbVal)-ligThick){
 	      // interior of ligament volume
 	      if(*p == ufat){
+		hist->move(*p, tissue.fat);
 		*p = tissue.fat;
 	      } else {
+		hist->move(*p, tissue.gland);
 		*p = tissue.gland;
 	      }
-#pragma omp atomic
-	      ligedVoxels += 1;
 	    } else if(r <= A*(f + perturbVal)) {
+	      hist->move(*p, tissue.cooper);
 	      *p = tissue.cooper;
-#pragma omp atomic
-	      ligedVoxels += 1;
 	    } 
 	  }
 	}
       }
     }
+    // voxels ligamented by this lobule
+    hist->flush();
+    ligedVoxels += hist->get(tissue.fat) + hist->get(tissue.gland) + hist->get(tissue.cooper) - ligBefore;
+
     // update ligamented frac
     ligamentedFrac = static_cast<double>(ligedVoxels)/static_cast<double>(fatVoxels+glandVoxels);
     //cout << "Lig " << fltry << ", Ligamented fraction = " << ligamentedFrac << "\n";
   }
 
-  // convert remaining ufat and ugland 
-	
-#pragma omp parallel for schedule(static,1)
-  for(int k=0; k<dim[2]; k++){
-    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(0,0,k));
-    for(int j=0; j<dim[1]; j++){
-      for(int i=0; i<dim[0]; i++){
-	if(*p == ugland){
-	  *p = tissue.gland;
-	} else if(*p == ufat){
-	  *p = tissue.fat;
-	}
-	p++;
-      }
-    }
-  }
-		
-  // calculate gland and fat bounding boxes
+  // convert remaining ufat and ugland and calculate gland and fat
+  // bounding boxes in the same pass, skipping background bricks
   int fatVoxBound[6] = {breastDim[0]+1,-1,breastDim[1]+1,-1,breastDim[2],-1};
   int glandVoxBound[6] = {breastDim[0]+1,-1,breastDim[1]+1,-1,breastDim[2],-1};
-	
-  for(int i=0; i<dim[0]; i++){
-    for(int j=0; j<dim[1]; j++){
-      for(int k=0; k<dim[2]; k++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.fat){
-	  fatVoxBound[0] = i;
-	  goto foundf0;
-	}
-      }
-    }
-  }
+  vtkIdType numBricks = volume.getNumBricks();
 
- foundf0:
-  for(int i=dim[0]-1; i>=0; i--){
-    for(int j=0; j<dim[1]; j++){
-      for(int k=0; k<dim[2]; k++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.fat){
-	  fatVoxBound[1] = i;
-	  goto foundf1;
-	}
-      }
-    }
-  }
-	
- foundf1:
-  for(int j=0; j<dim[1]; j++){
-    for(int i=0; i<dim[0]; i++){
-      for(int k=0; k<dim[2]; k++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.fat){
-	  fatVoxBound[2] = j;
-	  goto foundf2;
-	}
-      }
-    }
-  }
-	
- foundf2:
-  for(int j=dim[1]-1; j>=0; j--){
-    for(int i=0; i<dim[0]; i++){
-      for(int k=0; k<dim[2]; k++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.fat){
-	  fatVoxBound[3] = j;
-	  goto foundf3;
-	}
-      }
-    }
-  }		
-					
- foundf3:
-  for(int k=0; k<dim[2]; k++){
-    for(int i=0; i<dim[0]; i++){
-      for(int j=0; j<dim[1]; j++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.fat){
-	  fatVoxBound[4] = k;
-	  goto foundf4;
-	}
-      }
-    }
-  }
-	
- foundf4:
-  for(int k=dim[2]-1; k>=0; k--){
-    for(int i=0; i<dim[0]; i++){
-      for(int j=0; j<dim[1]; j++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.fat){
-	  fatVoxBound[5] = k;
-	  goto foundf5;
-	}
-      }
-    }
-  }
-	
- foundf5:
-  for(int i=0; i<dim[0]; i++){
-    for(int j=0; j<dim[1]; j++){
-      for(int k=0; k<dim[2]; k++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.duct || p[0] == tissue.TDLU || p[0] == tissue.gland){
-	  glandVoxBound[0] = i;
-	  goto foundg0;
+#pragma omp parallel
+  {
+    int myFatBound[6] = {breastDim[0]+1,-1,breastDim[1]+1,-1,breastDim[2],-1};
+    int myGlandBound[6] = {breastDim[0]+1,-1,breastDim[1]+1,-1,breastDim[2],-1};
+
+#pragma omp for schedule(static)
+    for(vtkIdType n=0; n<numBricks; n++){
+      if(!volume.isEmpty(n)){
+	int ext[6];
+	volume.getBrickExtent(n, ext);
+	for(int k=ext[4]; k<=ext[5]; k++){
+	  for(int j=ext[2]; j<=ext[3]; j++){
+	    unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(ext[0],j,k));
+	    for(int i=ext[0]; i<=ext[1]; i++){
+	      if(*p == ugland){
+		*p = tissue.gland;
+	      } else if(*p == ufat){
+		*p = tissue.fat;
+	      }
+	      int *bound = NULL;
+	      if(*p == tissue.fat){
+		bound = myFatBound;
+	      } else if(*p == tissue.duct || *p == tissue.TDLU || *p == tissue.gland){
+		bound = myGlandBound;
+	      }
+	      if(bound != NULL){
+		bound[0] = (i < bound[0]) ? i : bound[0];
+		bound[1] = (i > bound[1]) ? i : bound[1];
+		bound[2] = (j < bound[2]) ? j : bound[2];
+		bound[3] = (j > bound[3]) ? j : bound[3];
+		bound[4] = (k < bound[4]) ? k : bound[4];
+		bound[5] = (k > bound[5]) ? k : bound[5];
+	      }
+	      p++;
+	    }
+	  }
 	}
       }
     }
-  }
 
- foundg0:
-  for(int i=dim[0]-1; i>=0; i--){
-    for(int j=0; j<dim[1]; j++){
-      for(int k=0; k<dim[2]; k++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.duct || p[0] == tissue.TDLU || p[0] == tissue.gland){
-	  glandVoxBound[1] = i;
-	  goto foundg1;
-	}
-      }
-    }
-  }
-	
- foundg1:
-  for(int j=0; j<dim[1]; j++){
-    for(int i=0; i<dim[0]; i++){
-      for(int k=0; k<dim[2]; k++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.duct || p[0] == tissue.TDLU || p[0] == tissue.gland){
-	  glandVoxBound[2] = j;
-	  goto foundg2;
-	}
-      }
-    }
-  }
-	
- foundg2:
-  for(int j=dim[1]-1; j>=0; j--){
-    for(int i=0; i<dim[0]; i++){
-      for(int k=0; k<dim[2]; k++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.duct || p[0] == tissue.TDLU || p[0] == tissue.gland){
-	  glandVoxBound[3] = j;
-	  goto foundg3;
-	}
-      }
-    }
-  }		
-					
- foundg3:
-  for(int k=0; k<dim[2]; k++){
-    for(int i=0; i<dim[0]; i++){
-      for(int j=0; j<dim[1]; j++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.duct || p[0] == tissue.TDLU || p[0] == tissue.gland){
-	  glandVoxBound[4] = k;
-	  goto foundg4;
-	}
-      }
-    }
-  }
-	
- foundg4:
-  for(int k=dim[2]-1; k>=0; k--){
-    for(int i=0; i<dim[0]; i++){
-      for(int j=0; j<dim[1]; j++){
-	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(i,j,k));
-	if(p[0] == tissue.duct || p[0] == tissue.TDLU || p[0] == tissue.gland){
-	  glandVoxBound[5] = k;
-	  goto foundg5;
-	}
+#pragma omp critical (voxBound)
+    {
+      for(int m=0; m<6; m+=2){
+	fatVoxBound[m] = (myFatBound[m] < fatVoxBound[m]) ? myFatBound[m] : fatVoxBound[m];
+	fatVoxBound[m+1] = (myFatBound[m+1] > fatVoxBound[m+1]) ? myFatBound[m+1] : fatVoxBound[m+1];
+	glandVoxBound[m] = (myGlandBound[m] < glandVoxBound[m]) ? myGlandBound[m] : glandVoxBound[m];
+	glandVoxBound[m+1] = (myGlandBound[m+1] > glandVoxBound[m+1]) ? myGlandBound[m+1] : glandVoxBound[m+1];
       }
     }
   }
-		
- foundg5:
+
+  // every ufat and ugland voxel was converted
+  hist->set(tissue.gland, hist->get(tissue.gland) + hist->get(ugland));
+  hist->set(tissue.fat, hist->get(tissue.fat) + hist->get(ufat));
+  hist->set(ugland, 0);
+  hist->set(ufat, 0);
 
   /********************
    * Vascular network
@@ -4789,58 +4874,125 @@ int main(int argc, char* argv[]){
     }
   }
 
-  // create arteries
-  /*
-  for(int i=0; i<4; i++){
-  */
-  for (int i = 0; i < 7; i++){
-    // create a seed for artery random number generator
-    int arterySeed = static_cast<int>(round(rgen->GetRangeValue(0.0, 1.0)*2147483648));
+  // vessel trees work within the internal breast extent
+  volume.prefetch(internalExtentVox);
+
+  // distance to skin and background for the vessel edge tests, cells of
+  // about the 1 mm step those tests take, voxels beyond the internal
+  // extent count as outside
+  double skinStart[3];
+  double skinEnd[3];
+  unsigned int skinCells[3];
+  for(int i=0; i<3; i++){
+    skinStart[i] = origin[i] + internalExtentVox[2*i]*spacing[i];
+    skinEnd[i] = origin[i] + (internalExtentVox[2*i+1]+1)*spacing[i];
+    skinCells[i] = (unsigned int)ceil(skinEnd[i] - skinStart[i]);
+    skinCells[i] = (skinCells[i] < 1) ? 1 : skinCells[i];
+  }
+  roiMask skinMap(skinStart, skinEnd, skinCells);
+  unsigned char skinLabels[2] = {tissue.skin, tissue.bg};
+  skinMap.build(breast, internalExtentVox, skinLabels, 2, false);
+
+  // each network keeps one fill map in memory across its trees
+  int vesselStartInd[3] = {internalExtentVox[0], internalExtentVox[2], internalExtentVox[4]};
+  int vesselEndInd[3] = {internalExtentVox[1], internalExtentVox[3], internalExtentVox[5]};
+  double vesselStart[3];
+  double vesselEnd[3];
+  breast->GetPoint(breast->ComputePointId(vesselStartInd), vesselStart);
+  breast->GetPoint(breast->ComputePointId(vesselEndInd), vesselEnd);
+  unsigned int vesselFill[3] = {vm["vesselTree.nFillX"].as<uint>(), vm["vesselTree.nFillY"].as<uint>(),
+				vm["vesselTree.nFillZ"].as<uint>()};
+  fillMap arteryFill(vesselStart, vesselEnd, vesselFill);
+  fillMap veinFill(vesselStart, vesselEnd, vesselFill);
+
+  // seeds for the artery and vein random number generators, drawn in
+  // the order the trees used to be grown in
+  int arterySeed[7];
+  int veinSeed[7];
+  for(int i=0; i<7; i++){
+    arterySeed[i] = static_cast<int>(round(rgen->GetRangeValue(0.0, 1.0)*2147483648));
     rgen->Next();
-    
-    if(i == 0){
-      generate_artery(breast, vm, internalExtentVox, &tissue,
-		      arteryStartPosList[i], arteryStartDirList[i], nipplePos, arterySeed, randSeed, true);
-    } else {
-      generate_artery(breast, vm, internalExtentVox, &tissue,
-		      arteryStartPosList[i], arteryStartDirList[i], nipplePos, arterySeed, randSeed, false);
-    }
   }
-	
-  // create veins
-  /*
-  for(int i=0; i<5; i++){
-  */
-  for (int i = 0; i < 7; i++){ 
-    // create a seed for vein random number generator
-    int veinSeed = static_cast<int>(round(rgen->GetRangeValue(0.0, 1.0)*2147483648));
+  for(int i=0; i<7; i++){
+    veinSeed[i] = static_cast<int>(round(rgen->GetRangeValue(0.0, 1.0)*2147483648));
     rgen->Next();
-		
-    if(i == 0){
-      generate_vein(breast, vm, internalExtentVox, &tissue,
-		    veinStartPosList[i], veinStartDirList[i], nipplePos, veinSeed, randSeed, true);
-    } else {
-      generate_vein(breast, vm, internalExtentVox, &tissue,
-		    veinStartPosList[i], veinStartDirList[i], nipplePos, veinSeed, randSeed, false);
+  }
+
+  // the two networks grow at once, each with half the threads for its
+  // inner loops, they share no fill map and only read labels neither
+  // writes, so the result does not depend on their timing
+  int vesselThreads = omp_get_max_threads()/2;
+  if(vesselThreads < 1){
+    vesselThreads = 1;
+  }
+  int vesselLevels = omp_get_max_active_levels();
+  omp_set_max_active_levels(2);
+
+#pragma omp parallel sections num_threads(2)
+  {
+#pragma omp section
+    {
+      omp_set_num_threads(vesselThreads);
+      // each network runs on its own share of the cpus
+      breastVolume::pinTeam();
+      if(vesselThreads > 1 && breastVolume::teamSpread() < 2){
+#pragma omp critical
+	cerr << "Warning: vessel threads confined to a single cpu\n";
+      }
+      // create arteries
+      for(int i=0; i<7; i++){
+	generate_artery(breast, vm, internalExtentVox, &tissue, hist, &skinMap, &arteryFill,
+			arteryStartPosList[i], arteryStartDirList[i], nipplePos, arterySeed[i], randSeed, i == 0);
+      }
+    }
+#pragma omp section
+    {
+      omp_set_num_threads(vesselThreads);
+      // each network runs on its own share of the cpus
+      breastVolume::pinTeam();
+      if(vesselThreads > 1 && breastVolume::teamSpread() < 2){
+#pragma omp critical
+	cerr << "Warning: vessel threads confined to a single cpu\n";
+      }
+      // create veins
+      for(int i=0; i<7; i++){
+	generate_vein(breast, vm, internalExtentVox, &tissue, hist, &skinMap, &veinFill,
+		      veinStartPosList[i], veinStartDirList[i], nipplePos, veinSeed[i], randSeed, i == 0);
+      }
     }
   }
 
+  omp_set_max_active_levels(vesselLevels);
+
+  // back to one cpu per thread for the volume passes
+  if(vm["volume.pinThreads"].as<bool>()){
+    breastVolume::pinThreads();
+  }
+
+  // vessel voxels
+  hist->flush();
+
 
   /*************
    * Save stuff
    ************/
 
-  // save segmented breast with duct network
-  vtkSmartPointer<vtkXMLImageDataWriter> writerSeg5 =
-    vtkSmartPointer<vtkXMLImageDataWriter>::New();
+  if(outOfCore){
+    // labels are already in the raw file, flush the mapping
+    volume.sync();
+  } else {
+    // save segmented breast with duct network
+    vtkSmartPointer<vtkXMLImageDataWriter> writerSeg5 =
+      vtkSmartPointer<vtkXMLImageDataWriter>::New();
 
-  writerSeg5->SetFileName(outVTIFilename);
+    writerSeg5->SetFileName(outVTIFilename);
 #if VTK_MAJOR_VERSION <= 5
-  writerSeg5->SetInput(breast);
+    writerSeg5->SetInput(breast);
 #else
-  writerSeg5->SetInputData(breast);
+    writerSeg5->SetInputData(breast);
 #endif
-  writerSeg5->Write();
+    writerSeg5->Write();
+  }
 
   // save metaimage header
   FILE *hdrFile = fopen(outhdrFilename, "w");
@@ -4865,20 +5017,22 @@ int main(int argc, char* argv[]){
     fclose(hdrFile);
   }
 
-  // save gzipped raw
-  gzFile gzf = gzopen(outgzFilename, "wb");
+  if(!outOfCore){
+    // save gzipped raw
+    gzFile gzf = gzopen(outgzFilename, "wb");
 
-  if(gzf == NULL){
-    cerr << "Unable to open gzip file for writing\n";
-  } else {
-    gzbuffer(gzf, dim[1]*dim[2]);
-    unsigned char *p = static_cast<unsigned char*>(breast->GetScalarPointer());
-    for(int i=0; i<dim[0]; i++){
-      gzwrite(gzf, static_cast<const void*>(p), dim[1]*dim[2]);
-      p += dim[1]*dim[2];
-    }
+    if(gzf == NULL){
+      cerr << "Unable to open gzip file for writing\n";
+    } else {
+      gzbuffer(gzf, dim[1]*dim[2]);
+      unsigned char *p = static_cast<unsigned char*>(breast->GetScalarPointer());
+      for(int i=0; i<dim[0]; i++){
+        gzwrite(gzf, static_cast<const void*>(p), dim[1]*dim[2]);
+        p += dim[1]*dim[2];
+      }
 
-    gzclose(gzf);
+      gzclose(gzf);
+    }
   }
 
   return EXIT_SUCCESS;
@@ -43,6 +43,11 @@
 #include "createDuct.hxx"
 #include "createArtery.hxx"
 #include "createVein.hxx"
+#include "breastVolume.hxx"
+#include "seedGrid.hxx"
+#include "seedKernel.hxx"
+#include "compartmentSeg.hxx"
+#include "stageCache.hxx"
 
 // vtk stuff
 #include <vtkVersion.h>
@@ -91,7 +96,6 @@
 #endif
 #include <vtkMetaImageWriter.h>
 #include <vtkPointLocator.h>
-#include <vtkOctreePointLocator.h>
 #include <vtkMinimalStandardRandomSequence.h>
 #ifndef __VTKVECTOR__
 	#define __VTKVECTOR__
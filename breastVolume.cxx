@@ -0,0 +1,334 @@
+/*! \file breastVolume.cxx
+ *  \brief breastPhantom breastVolume
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "breastVolume.hxx"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+int* breastVolume::allowedCpus = nullptr;
+
+int breastVolume::numAllowed = 0;
+
+/* This class owns the voxel buffer of the segmented breast.  The buffer is an
+ * anonymous mapping, the kernel supplies zero pages on first read and only
+ * allocates memory on first write, so air surrounding the breast costs nothing.
+ * For volumes larger than memory the buffer is a shared mapping of a sparse
+ * file instead, which only holds the pages of the current working set */
+
+breastVolume::breastVolume(vtkImageData* img, int bsize, const char* filename){
+
+  image = img;
+  image->GetDimensions(dim);
+
+  numBytes = static_cast<size_t>(dim[0])*static_cast<size_t>(dim[1])*static_cast<size_t>(dim[2]);
+
+  void* buf;
+  if(filename == NULL){
+    fd = -1;
+    buf = mmap(NULL, numBytes, PROT_READ | PROT_WRITE,
+	       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  } else {
+    // sparse file, holes read as zero
+    fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if(fd == -1 || ftruncate(fd, static_cast<off_t>(numBytes)) == -1){
+      cerr << "Unable to create volume file " << filename << "\n";
+      exit(EXIT_FAILURE);
+    }
+    buf = mmap(NULL, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if(buf == MAP_FAILED){
+    cerr << "Unable to allocate breast volume (" << numBytes << " bytes)\n";
+    exit(EXIT_FAILURE);
+  }
+  voxels = static_cast<unsigned char*>(buf);
+
+  // wrap buffer, save flag set so vtk does not free it
+  scalars = vtkUnsignedCharArray::New();
+  scalars->SetNumberOfComponents(1);
+  scalars->SetArray(voxels, static_cast<vtkIdType>(numBytes), 1);
+
+#if VTK_MAJOR_VERSION <= 5
+  image->SetNumberOfScalarComponents(1);
+  image->SetScalarTypeToUnsignedChar();
+#endif
+  image->GetPointData()->SetScalars(scalars);
+
+  // brick layout
+  brickSize = (bsize < 1) ? 1 : bsize;
+  totalBricks = 1;
+  for(int i=0; i<3; i++){
+    numBricks[i] = (dim[i]+brickSize-1)/brickSize;
+    totalBricks *= numBricks[i];
+  }
+
+  // until first occupancy update every brick is considered occupied
+  brickUsed = new unsigned char[totalBricks];
+  for(vtkIdType b=0; b<totalBricks; b++){
+    brickUsed[b] = 1;
+  }
+}
+
+breastVolume::~breastVolume(){
+  image->GetPointData()->SetScalars(NULL);
+  scalars->Delete();
+  if(fd != -1){
+    msync(voxels, numBytes, MS_SYNC);
+  }
+  munmap(voxels, numBytes);
+  if(fd != -1){
+    close(fd);
+  }
+  delete[] brickUsed;
+}
+
+void breastVolume::updateOccupancy(void){
+
+  histogram.clear();
+
+  // bricks are numbered z slowest, a static schedule keeps each thread on its own slab
+#pragma omp parallel for schedule(static)
+  for(vtkIdType b=0; b<totalBricks; b++){
+    int ext[6];
+    getBrickExtent(b, ext);
+    long long int count[256] = {0};
+    // reading an untouched page maps the shared zero page, nothing is allocated
+    for(int k=ext[4]; k<=ext[5]; k++){
+      for(int j=ext[2]; j<=ext[3]; j++){
+	unsigned char* p = static_cast<unsigned char*>(image->GetScalarPointer(ext[0],j,k));
+	for(int i=ext[0]; i<=ext[1]; i++){
+	  count[*p]++;
+	  p++;
+	}
+      }
+    }
+    long long int numVox = static_cast<long long int>(ext[1]-ext[0]+1)*(ext[3]-ext[2]+1)*(ext[5]-ext[4]+1);
+    brickUsed[b] = (count[0] < numVox) ? 1 : 0;
+    for(int l=0; l<256; l++){
+      if(count[l] != 0){
+	histogram.add(static_cast<unsigned char>(l), count[l]);
+      }
+    }
+  }
+
+  histogram.flush();
+}
+
+tissueHistogram* breastVolume::getHistogram(void){
+  return &histogram;
+}
+
+vtkIdType breastVolume::getNumBricks(void){
+  return totalBricks;
+}
+
+int breastVolume::getBrickSize(void){
+  return brickSize;
+}
+
+bool breastVolume::isEmpty(vtkIdType b){
+  return brickUsed[b] == 0;
+}
+
+bool breastVolume::isEmpty(int i, int j, int k){
+  vtkIdType b = (static_cast<vtkIdType>(k/brickSize)*numBricks[1] + j/brickSize)*numBricks[0] + i/brickSize;
+  return brickUsed[b] == 0;
+}
+
+void breastVolume::getBrickExtent(vtkIdType b, int* ext){
+
+  int brick[3];
+  brick[0] = static_cast<int>(b % numBricks[0]);
+  brick[1] = static_cast<int>((b / numBricks[0]) % numBricks[1]);
+  brick[2] = static_cast<int>(b / (static_cast<vtkIdType>(numBricks[0])*numBricks[1]));
+
+  for(int m=0; m<3; m++){
+    ext[2*m] = brick[m]*brickSize;
+    ext[2*m+1] = ext[2*m] + brickSize - 1;
+    if(ext[2*m+1] >= dim[m]){
+      ext[2*m+1] = dim[m]-1;
+    }
+  }
+}
+
+vtkIdType breastVolume::numOccupied(void){
+
+  vtkIdType count = 0;
+  for(vtkIdType b=0; b<totalBricks; b++){
+    count += brickUsed[b];
+  }
+  return count;
+}
+
+void breastVolume::adviseBox(const int* box, int advice){
+
+  // clip box to volume
+  int lo[3], hi[3];
+  for(int m=0; m<3; m++){
+    lo[m] = (box[2*m] < 0) ? 0 : box[2*m];
+    hi[m] = (box[2*m+1] >= dim[m]) ? dim[m]-1 : box[2*m+1];
+    if(lo[m] > hi[m]){
+      return;
+    }
+  }
+
+  size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t sliceSize = static_cast<size_t>(dim[0])*static_cast<size_t>(dim[1]);
+
+  // rows of the box in one slice are a single span of the buffer
+  for(int k=lo[2]; k<=hi[2]; k++){
+    size_t first = k*sliceSize + static_cast<size_t>(lo[1])*dim[0] + lo[0];
+    size_t last = k*sliceSize + static_cast<size_t>(hi[1])*dim[0] + hi[0];
+    first = (first/pageSize)*pageSize;
+    last = (last/pageSize+1)*pageSize;
+    if(last > numBytes){
+      last = numBytes;
+    }
+    if(advice == MADV_DONTNEED){
+      // write back before dropping pages
+      msync(voxels+first, last-first, MS_ASYNC);
+    }
+    madvise(voxels+first, last-first, advice);
+  }
+}
+
+void breastVolume::prefetch(const int* box){
+  if(fd != -1){
+    adviseBox(box, MADV_WILLNEED);
+  }
+}
+
+void breastVolume::evict(const int* box){
+  // dropping pages of an anonymous mapping would discard them
+  if(fd != -1){
+    adviseBox(box, MADV_DONTNEED);
+  }
+}
+
+void breastVolume::sync(void){
+  if(fd != -1){
+    msync(voxels, numBytes, MS_SYNC);
+  }
+}
+
+bool breastVolume::isFileBacked(void){
+  return fd != -1;
+}
+
+void breastVolume::firstTouch(void){
+
+  // a file backed buffer is placed by the page cache, writing zeros would only
+  // dirty pages of the output file
+  if(fd != -1){
+    return;
+  }
+
+  size_t sliceSize = static_cast<size_t>(dim[0])*static_cast<size_t>(dim[1]);
+
+  // same decomposition as the volume-wide passes
+#pragma omp parallel for schedule(static)
+  for(int k=0; k<dim[2]; k++){
+    memset(voxels+k*sliceSize, 0, sliceSize);
+  }
+}
+
+void breastVolume::useHugePages(void){
+#ifdef MADV_HUGEPAGE
+  if(fd == -1){
+    madvise(voxels, numBytes, MADV_HUGEPAGE);
+  }
+#endif
+}
+
+void breastVolume::pinThreads(void){
+
+  // later calls restore the pinning after nested stages, when the calling
+  // thread may only see its share of the cpus
+  if(numAllowed == 0){
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if(sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == -1){
+      cerr << "Unable to query cpu affinity, threads not pinned\n";
+      return;
+    }
+
+    int numCpu = CPU_COUNT(&allowed);
+    if(numCpu < 1){
+      return;
+    }
+    // kept until the program ends
+    allowedCpus = new int[numCpu];
+    int n = 0;
+    for(int c=0; c<CPU_SETSIZE && n<numCpu; c++){
+      if(CPU_ISSET(c, &allowed)){
+	allowedCpus[n] = c;
+	n++;
+      }
+    }
+    numAllowed = numCpu;
+  }
+
+#pragma omp parallel
+  {
+    cpu_set_t mine;
+    CPU_ZERO(&mine);
+    CPU_SET(allowedCpus[omp_get_thread_num() % numAllowed], &mine);
+    sched_setaffinity(0, sizeof(cpu_set_t), &mine);
+  }
+}
+
+void breastVolume::pinTeam(void){
+  if(numAllowed == 0){
+    return;
+  }
+
+  // contiguous share of the allowed cpus, threads inherit the mask of the
+  // thread that creates them so the nested team spreads over the share,
+  // shares overlap when there are more threads than cpus
+  int teamSize = omp_get_num_threads();
+  int t = omp_get_thread_num();
+  int first = static_cast<int>(static_cast<long long int>(t)*numAllowed/teamSize);
+  int last = static_cast<int>(static_cast<long long int>(t+1)*numAllowed/teamSize);
+  if(last <= first){
+    last = first+1;
+  }
+
+  cpu_set_t mine;
+  CPU_ZERO(&mine);
+  for(int n=first; n<last; n++){
+    CPU_SET(allowedCpus[n % numAllowed], &mine);
+  }
+  sched_setaffinity(0, sizeof(cpu_set_t), &mine);
+}
+
+int breastVolume::teamSpread(void){
+  cpu_set_t all;
+  CPU_ZERO(&all);
+
+#pragma omp parallel
+  {
+    cpu_set_t mine;
+    CPU_ZERO(&mine);
+    if(sched_getaffinity(0, sizeof(cpu_set_t), &mine) == 0){
+#pragma omp critical(teamSpread)
+      CPU_OR(&all, &all, &mine);
+    }
+  }
+
+  return CPU_COUNT(&all);
+}
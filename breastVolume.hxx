@@ -0,0 +1,141 @@
+/*! \file breastVolume.hxx
+ *  \brief breastPhantom label volume storage header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef BREASTVOLUME_HXX_
+#define BREASTVOLUME_HXX_
+
+#ifndef __OMP__
+#define __OMP__
+#include <omp.h>
+#endif
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef __VTKIMAGEDATA__
+#define __VTKIMAGEDATA__
+#include <vtkImageData.h>
+#endif
+
+#ifndef __VTKUNSIGNEDCHARARRAY__
+#define __VTKUNSIGNEDCHARARRAY__
+#include <vtkUnsignedCharArray.h>
+#endif
+
+#ifndef __VTKPOINTDATA__
+#define __VTKPOINTDATA__
+#include <vtkPointData.h>
+#endif
+
+#include "tissueHistogram.hxx"
+
+/**********************************************
+*
+* Class for sparse storage of the label volume
+*
+**********************************************/
+
+class breastVolume{
+  // the voxel buffer keeps the dense vtkImageData layout so all stages
+  // can keep using GetScalarPointer, but it is a lazily zero-filled
+  // mapping - pages never written are never materialized and read as
+  // background (label 0)
+  // the volume is split into cubic bricks, bricks holding only background
+  // are flagged so volume-wide passes can skip them
+  // optionally the mapping is backed by a file holding the volume as raw
+  // 8-bit labels, the kernel then pages voxels in and out on demand and
+  // the file is the final .raw output
+  // volume-wide passes split the volume into contiguous z slabs with a
+  // static schedule over slices, so the same thread touches the same
+  // memory in every pass
+
+  // image wrapping the voxel buffer
+  vtkImageData* image;
+  // scalar array handed to the image
+  vtkUnsignedCharArray* scalars;
+  // voxel buffer
+  unsigned char* voxels;
+  // length of mapped buffer (bytes)
+  size_t numBytes;
+  // backing file descriptor, -1 for anonymous memory
+  int fd;
+  // volume dimensions (voxels)
+  int dim[3];
+  // brick edge length (voxels)
+  int brickSize;
+  // number of bricks in each direction
+  int numBricks[3];
+  // total number of bricks
+  vtkIdType totalBricks;
+  // 1 if brick may hold non-background voxels
+  unsigned char* brickUsed;
+  // voxel count of each label, kept current by all writers
+  tissueHistogram histogram;
+  // apply madvise to the pages covering index box
+  void adviseBox(const int*, int);
+  // cpus the process may run on, in order, saved when threads are first
+  // pinned
+  static int* allowedCpus;
+  // number of allowed cpus, 0 until threads are pinned
+  static int numAllowed;
+public:
+  // flag bricks holding any non-background voxel and recount histogram
+  void updateOccupancy(void);
+  // label histogram of the volume
+  tissueHistogram* getHistogram(void);
+  // total number of bricks
+  vtkIdType getNumBricks(void);
+  // brick edge length (voxels)
+  int getBrickSize(void);
+  // true if brick only holds background
+  bool isEmpty(vtkIdType);
+  // true if brick containing voxel (i,j,k) only holds background
+  bool isEmpty(int, int, int);
+  // index bounds {i0,i1,j0,j1,k0,k1} of a brick, clipped to the volume
+  void getBrickExtent(vtkIdType, int*);
+  // number of bricks that may hold non-background voxels
+  vtkIdType numOccupied(void);
+  // hint that index box {i0,i1,j0,j1,k0,k1} is about to be used
+  void prefetch(const int*);
+  // hint that index box is done with, pages are written back and released
+  void evict(const int*);
+  // flush voxel buffer to backing file
+  void sync(void);
+  // true if volume is backed by a file
+  bool isFileBacked(void);
+  // zero every slice in parallel so pages are placed on the NUMA node of
+  // the thread that later works on them, materializes the whole buffer
+  void firstTouch(void);
+  // request transparent huge pages for the voxel buffer
+  void useHugePages(void);
+  // bind each OpenMP thread to one allowed cpu
+  static void pinThreads(void);
+  // called by every thread of a team whose threads start nested teams,
+  // binds the calling thread, and so the team it starts, to its share of
+  // the allowed cpus, does nothing if threads are not pinned
+  static void pinTeam(void);
+  // number of cpus the threads of a team started here may run on
+  static int teamSpread(void);
+  // constructor allocates voxel buffer for image, extent must already be set
+  // if filename is NULL buffer is anonymous memory
+  breastVolume(vtkImageData*, int, const char*);
+  // destructor releases voxel buffer
+  ~breastVolume();
+};
+
+#endif /* BREASTVOLUME_HXX_ */
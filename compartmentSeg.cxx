@@ -0,0 +1,308 @@
+/*! \file compartmentSeg.cxx
+ *  \brief breastPhantom compartment segmentation
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "compartmentSeg.hxx"
+
+#include <cmath>
+
+using namespace std;
+
+compartmentSeg::compartmentSeg(seedGrid* grid, seedKernel* seeds, int numFat, int numGland,
+			       const double* lip, const unsigned char* labels, const breastComp* gland,
+			       perlinNoise* noise, double dev, double searchRadius, const double* originCoords,
+			       double res):
+  boxSeeds(numFat+numGland){
+  fatGrid = grid;
+  allSeeds = seeds;
+  numFatSeeds = numFat;
+  numGlandSeeds = numGland;
+  seedLip = lip;
+  seedLabel = labels;
+  glands = gland;
+  boundary = noise;
+  boundaryDev = dev;
+  radius = searchRadius;
+  for(int m=0; m<3; m++){
+    origin[m] = originCoords[m];
+  }
+  imgRes = res;
+
+  // all compartments share the boundary noise parameters
+  noiseAmp = boundary[0].maxNoise();
+  noiseSlope = boundary[0].maxSlope();
+
+  int numAllSeeds = numFatSeeds + numGlandSeeds;
+  blockPts = new vtkIdType[numFatSeeds];
+  glandOrder = new int[numGlandSeeds];
+  seedDist = new double[numAllSeeds];
+  seedEucl2 = new double[numAllSeeds];
+  upperDist = new double[numAllSeeds];
+  lowerDist = new double[numAllSeeds];
+}
+
+compartmentSeg::~compartmentSeg(){
+  delete[] blockPts;
+  delete[] glandOrder;
+  delete[] seedDist;
+  delete[] seedEucl2;
+  delete[] upperDist;
+  delete[] lowerDist;
+}
+
+double compartmentSeg::glandNoise(int g, const double* coords, double* r){
+  vtkVector3d rvec;
+  vtkVector3d localCoords;
+  for(int m=0; m<3; m++){
+    rvec[m] = coords[m]-glands[g].pos[m];
+  }
+  for(int m=0; m<3; m++){
+    localCoords[m] = rvec.Dot(glands[g].axis[m]);
+  }
+  *r = localCoords.Norm();
+  return boundary[g].getNoise(localCoords.Normalized().GetData());
+}
+
+void compartmentSeg::segment(vtkImageData* breast, const int* block, unsigned char innerVal,
+			     tissueHistogram* hist, int (*labelBox)[6]){
+
+  // fat seeds within search radius of block
+  double blockBox[6];
+  for(int m=0; m<3; m++){
+    blockBox[2*m] = origin[m] + imgRes*block[2*m];
+    blockBox[2*m+1] = origin[m] + imgRes*block[2*m+1];
+  }
+  int numBlockPts = fatGrid->findInBox(blockBox, radius, blockPts);
+
+  // block candidates followed by all gland seeds
+  boxSeeds.clear();
+  boxSeeds.append(*allSeeds, blockPts, numBlockPts);
+  boxSeeds.appendRange(*allSeeds, numFatSeeds, numGlandSeeds);
+
+  int numBox = 1;
+  for(int m=0; m<6; m++){
+    boxStack[0][m] = block[m];
+  }
+
+  while(numBox > 0){
+    numBox--;
+    int box[6];
+    for(int m=0; m<6; m++){
+      box[m] = boxStack[numBox][m];
+    }
+
+    // box center and half diagonal
+    double coords[3];
+    double halfDiag = 0.0;
+    for(int m=0; m<3; m++){
+      coords[m] = origin[m] + imgRes*0.5*(box[2*m]+box[2*m+1]);
+      halfDiag += 0.25*imgRes*imgRes*(box[2*m+1]-box[2*m])*(box[2*m+1]-box[2*m]);
+    }
+    halfDiag = sqrt(halfDiag);
+
+    // noise free distance to all block seeds in one pass
+    boxSeeds.distances(coords, seedDist, seedEucl2);
+    int numBoxSeeds = boxSeeds.getNumSeeds();
+    int numBoxFat = numBoxSeeds - numGlandSeeds;
+
+    // range of noise free distance over box, a fat seed counts at a voxel
+    // within the search radius of it, over the box its euclidean distance
+    // is within halfDiag of the center value
+    double radius2 = radius*radius;
+    for(int n=0; n<numBoxSeeds; n++){
+      double rootDist = sqrt(seedDist[n]);
+      double lip = seedLip[boxSeeds.getId(n)];
+      double upper = rootDist + halfDiag*lip;
+      double lower = rootDist - halfDiag*lip;
+      upperDist[n] = upper*upper;
+      lowerDist[n] = (lower > 0.0) ? lower*lower : 0.0;
+      if(n < numBoxFat){
+	double eucl = sqrt(seedEucl2[n]);
+	if(eucl - halfDiag > radius){
+	  // out of range everywhere in box
+	  upperDist[n] = VTK_DOUBLE_MAX;
+	  lowerDist[n] = VTK_DOUBLE_MAX;
+	} else if(eucl + halfDiag > radius){
+	  // out of range somewhere in box, cannot vouch for its label
+	  upperDist[n] = VTK_DOUBLE_MAX;
+	}
+	if(seedEucl2[n] > radius2){
+	  seedDist[n] = VTK_DOUBLE_MAX;
+	}
+      }
+    }
+
+    // best fat distance, fat seeds have no noise
+    double minDist = VTK_DOUBLE_MAX;
+    for(int n=0; n<numBoxFat; n++){
+      if(seedDist[n] < minDist){
+	minDist = seedDist[n];
+      }
+    }
+
+    // visit gland compartments by noise free distance, closest first
+    for(int n=0; n<numGlandSeeds; n++){
+      int slot = numBoxFat+n;
+      int m = n;
+      while(m > 0 && seedDist[glandOrder[m-1]] > seedDist[slot]){
+	glandOrder[m] = glandOrder[m-1];
+	m--;
+      }
+      glandOrder[m] = slot;
+    }
+
+    // glandular compartments so add noise, noise depends on direction
+    // only so its change over box is bounded by the angle subtended
+    for(int o=0; o<numGlandSeeds; o++){
+      int n = glandOrder[o];
+
+      // noise can at most shrink distance by boundaryDev*noiseAmp, skip
+      // noise evaluation for compartments that cannot win
+      double minFactor = 1.0 - boundaryDev*noiseAmp;
+      if(minFactor < 0.0){
+	minFactor = 0.0;
+      }
+      if(seedDist[n]*minFactor >= minDist){
+	upperDist[n] *= 1.0 + boundaryDev*noiseAmp;
+	lowerDist[n] *= minFactor;
+	seedDist[n] = VTK_DOUBLE_MAX;
+	continue;
+      }
+
+      double r;
+      double noise = glandNoise(boxSeeds.getId(n)-numFatSeeds, coords, &r);
+      seedDist[n] += boundaryDev*seedDist[n]*noise;
+      if(seedDist[n] < minDist){
+	minDist = seedDist[n];
+      }
+
+      double noiseRange = 2*noiseAmp;
+      if(r > halfDiag && noiseSlope*halfDiag/(r-halfDiag) < noiseRange){
+	noiseRange = noiseSlope*halfDiag/(r-halfDiag);
+      }
+      upperDist[n] *= 1.0 + boundaryDev*(noise + noiseRange);
+      double lowFactor = 1.0 + boundaryDev*(noise - noiseRange);
+      lowerDist[n] *= (lowFactor > 0.0) ? lowFactor : 0.0;
+    }
+
+    // find minimum distance at center
+    int closestSlot, nextClosestSlot;
+    seedKernel::nearest(seedDist, numBoxSeeds, &closestSlot, &nextClosestSlot);
+    int closestId = boxSeeds.getId(closestSlot);
+
+    // set tissue type
+    unsigned char myTissue = seedLabel[closestId];
+
+    bool single = (box[0] == box[1] && box[2] == box[3] && box[4] == box[5]);
+    bool uniform = single;
+
+    if(!uniform){
+      // closest label is the same everywhere if its best upper bound is
+      // below the lower bound of every other label
+      double minDistUpper = VTK_DOUBLE_MAX;
+      double nextMinDistLower = VTK_DOUBLE_MAX;
+      for(int n=0; n<numBoxSeeds; n++){
+	if(seedLabel[boxSeeds.getId(n)] == myTissue){
+	  if(upperDist[n] < minDistUpper){
+	    minDistUpper = upperDist[n];
+	  }
+	} else {
+	  if(lowerDist[n] < nextMinDistLower){
+	    nextMinDistLower = lowerDist[n];
+	  }
+	}
+      }
+      uniform = (minDistUpper < nextMinDistLower);
+    }
+
+    if(uniform){
+      long long int numSet = 0;
+      int* myBox = labelBox[myTissue];
+      for(int k=box[4]; k<=box[5]; k++){
+	for(int j=box[2]; j<=box[3]; j++){
+	  unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(box[0],j,k));
+	  for(int i=box[0]; i<=box[1]; i++){
+	    if(p[i-box[0]] == innerVal){
+	      p[i-box[0]] = myTissue;
+	      numSet++;
+	      // label statistics
+	      if(i < myBox[0]) myBox[0] = i;
+	      if(i > myBox[1]) myBox[1] = i;
+	      if(j < myBox[2]) myBox[2] = j;
+	      if(j > myBox[3]) myBox[3] = j;
+	      if(k < myBox[4]) myBox[4] = k;
+	      if(k > myBox[5]) myBox[5] = k;
+	    }
+	  }
+	}
+      }
+      hist->add(innerVal, -numSet);
+      hist->add(myTissue, numSet);
+    } else {
+      // split in octants
+      int mid[3];
+      for(int m=0; m<3; m++){
+	mid[m] = (box[2*m]+box[2*m+1])/2;
+      }
+      for(int c=0; c<2; c++){
+	for(int b=0; b<2; b++){
+	  for(int a=0; a<2; a++){
+	    int sub[6] = {a ? mid[0]+1 : box[0], a ? box[1] : mid[0],
+			  b ? mid[1]+1 : box[2], b ? box[3] : mid[1],
+			  c ? mid[2]+1 : box[4], c ? box[5] : mid[2]};
+	    if(sub[0] <= sub[1] && sub[2] <= sub[3] && sub[4] <= sub[5]){
+	      for(int m=0; m<6; m++){
+		boxStack[numBox][m] = sub[m];
+	      }
+	      numBox++;
+	    }
+	  }
+	}
+      }
+    }
+  }
+}
+
+unsigned char compartmentSeg::label(const int* ijk){
+  double coords[3];
+  for(int m=0; m<3; m++){
+    coords[m] = origin[m] + imgRes*ijk[m];
+  }
+
+  int numAllSeeds = numFatSeeds + numGlandSeeds;
+  allSeeds->distances(coords, seedDist, seedEucl2);
+
+  // first seed with the smallest distance wins, fat seeds in id order
+  // come first as in the candidate lists
+  double radius2 = radius*radius;
+  double minDist = VTK_DOUBLE_MAX;
+  int closest = -1;
+  for(int n=0; n<numAllSeeds; n++){
+    double d = seedDist[n];
+    if(n < numFatSeeds){
+      if(seedEucl2[n] > radius2){
+	continue;
+      }
+    } else {
+      double r;
+      double noise = glandNoise(n-numFatSeeds, coords, &r);
+      d += boundaryDev*d*noise;
+    }
+    if(closest < 0 || d < minDist){
+      minDist = d;
+      closest = n;
+    }
+  }
+  return seedLabel[closest];
+}
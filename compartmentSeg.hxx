@@ -0,0 +1,113 @@
+/*! \file compartmentSeg.hxx
+ *  \brief breastPhantom compartment segmentation header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef COMPARTMENTSEG_HXX_
+#define COMPARTMENTSEG_HXX_
+
+#ifndef __VTKIMAGEDATA__
+#define __VTKIMAGEDATA__
+#include <vtkImageData.h>
+#endif
+
+#ifndef __VTKVECTOR__
+#define __VTKVECTOR__
+#include <vtkVector.h>
+#endif
+
+#include "perlinNoise.hxx"
+#include "seedGrid.hxx"
+#include "seedKernel.hxx"
+#include "tissueHistogram.hxx"
+
+// data structure for breast compartment
+typedef struct breastComp{
+  double scale[3]; // size
+  double g;	// size weight
+  vtkVector3d axis[3];	// local coordinate system
+  double pos[3];	// position
+  bool fat;	// is it fat?
+  bool keep;  // retain glandular compartment?
+  unsigned char compId;	// compartment id 1,2,....
+  int boundBox[6];	// bounding box indices
+  int voxelCount;		// number of voxels
+  double volume;		// volume (cubic mm)
+} breastComp;
+
+/**********************************************
+*
+* Voronoi segmentation of breast compartments
+*
+**********************************************/
+
+class compartmentSeg{
+  // a voxel takes the label of the closest seed, fat seeds count only
+  // within the search radius, glandular seeds have their distance scaled
+  // by boundary noise
+  // blocks are refined hierarchically, a box is filled in one go when
+  // every voxel in it provably has the same closest label, otherwise it is
+  // split in octants down to single voxels
+  // one instance per thread, the seeds and noise are shared read-only
+
+  // fat seeds binned for lookup
+  seedGrid* fatGrid;
+  // all seeds, fat seeds first, slot equals seed id
+  seedKernel* allSeeds;
+  // number of fat and glandular seeds
+  int numFatSeeds;
+  int numGlandSeeds;
+  // Lipschitz constant of sqrt of the distance of each seed
+  const double* seedLip;
+  // label of each seed
+  const unsigned char* seedLabel;
+  // glandular compartments
+  const breastComp* glands;
+  // boundary noise of each glandular compartment
+  perlinNoise* boundary;
+  // boundary noise scaling, amplitude and rate of change per radian
+  double boundaryDev, noiseAmp, noiseSlope;
+  // fat seed search radius (mm)
+  double radius;
+  // coordinates of voxel (0,0,0) and voxel size (mm)
+  double origin[3];
+  double imgRes;
+  // candidate and work buffers
+  vtkIdType* blockPts;
+  seedKernel boxSeeds;
+  int* glandOrder;
+  double* seedDist;
+  double* seedEucl2;
+  double* upperDist;
+  double* lowerDist;
+  // boxes {i0,i1,j0,j1,k0,k1} waiting for refinement, 7 per level
+  int boxStack[256][6];
+  // boundary noise of glandular compartment at point, also gives the
+  // distance of the point from the compartment position
+  double glandNoise(int, const double*, double*);
+public:
+  // label the voxels of index block {i0,i1,j0,j1,k0,k1} holding innerVal,
+  // counts go to histogram, labelBox widens the bounding box of each label
+  // written
+  void segment(vtkImageData*, const int*, unsigned char, tissueHistogram*, int (*)[6]);
+  // label of a voxel index from every seed, no bounds or candidate lists,
+  // for checking segment
+  unsigned char label(const int*);
+  // constructor takes the shared seeds, noise and search radius
+  compartmentSeg(seedGrid*, seedKernel*, int, int, const double*, const unsigned char*,
+		 const breastComp*, perlinNoise*, double, double, const double*, double);
+  // destructor
+  ~compartmentSeg();
+};
+
+#endif /* COMPARTMENTSEG_HXX_ */
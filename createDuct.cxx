@@ -18,22 +18,15 @@
 using namespace std;
 namespace po = boost::program_options;
 
-/* This function creates a duct tree within a given compartment, inserts it into the segmented
- * breast and saves the tree */
+/* This function creates a duct tree within a given compartment and takes its region from the current
+ * breast labels, the fill map, ROI mask and branches are only made when the tree is grown */
 
-void generate_duct(vtkImageData* breast, po::variables_map vm, vtkPoints* TDLUloc, vtkDoubleArray* TDLUattr, 
-		   unsigned char compartmentId, int* boundBox, tissueStruct* tissue, double* sposPtr, double* sdirPtr, int seed){
+ductTree* create_duct(vtkImageData* breast, po::variables_map vm, vtkPoints* TDLUloc, vtkDoubleArray* TDLUattr, 
+		      unsigned char compartmentId, int* boundBox, tissueStruct* tissue, tissueHistogram* histogram, double* sdirPtr, int seed){
 
-  double spos[3];
-  double sdir[3];
-
-  for(int i=0; i<3; i++){
-    spos[i] = sposPtr[i];
-    sdir[i] = sdirPtr[i];
-  }
-
-  // declare ductTreeInit struct and fill information
-  ductTreeInit treeInit;
+  // declare ductTreeInit struct and fill information, fields ducts do
+  // not use stay zero
+  ductTreeInit treeInit = ductTreeInit();
 
   treeInit.seed = seed;
 
@@ -51,12 +44,8 @@ void generate_duct(vtkImageData* breast, po::variables_map vm, vtkPoints* TDLUlo
   treeInit.nVox[1] = boundBox[3]-boundBox[2];
   treeInit.nVox[2] = boundBox[5]-boundBox[4];
 
-  treeInit.nFill[0] = vm["ductTree.nFillX"].as<uint>();
-  treeInit.nFill[1] = vm["ductTree.nFillY"].as<uint>();
-  treeInit.nFill[2] = vm["ductTree.nFillZ"].as<uint>();
-
   for(int i=0; i<3; i++){
-    treeInit.prefDir[i] = sdir[i];
+    treeInit.prefDir[i] = sdirPtr[i];
   }
 
   treeInit.boundBox = boundBox;
@@ -64,6 +53,8 @@ void generate_duct(vtkImageData* breast, po::variables_map vm, vtkPoints* TDLUlo
   treeInit.compartmentId = compartmentId;
   
   treeInit.tissue = tissue;
+
+  treeInit.histogram = histogram;
   
   treeInit.breast = breast;
 	
@@ -71,48 +62,63 @@ void generate_duct(vtkImageData* breast, po::variables_map vm, vtkPoints* TDLUlo
 	
   treeInit.TDLUattr = TDLUattr;
 
-  ductTree myTree(vm, &treeInit);
+  ductTree* myTree = new ductTree(vm, &treeInit);
 
-  // root of tree
-  double srad = vm["ductTree.initRad"].as<double>();
-
-  // initialize fill map based on distance to start position
-  int fillExtent[6];
-  myTree.fill->GetExtent(fillExtent);
-#pragma omp parallel for
-  for(int a=fillExtent[0]; a<=fillExtent[1]; a++){
-    for(int b=fillExtent[2]; b<=fillExtent[3]; b++){
-      for(int c=fillExtent[4]; c<=fillExtent[5]; c++){
-	double* v = static_cast<double*>(myTree.fill->GetScalarPointer(a,b,c));
-	// set distance to 0 if fill voxel is not in compartment, otherwise
-	// initialize with squared distance to tree base
-
-	// fill voxel location
-	vtkIdType id;
-	int coord[3];
-	coord[0] = a;
-	coord[1] = b;
-	coord[2] = c;
-	id = myTree.fill->ComputePointId(coord);
-	// get spatial coordinates of fill voxel
-	double pos[3];
-	myTree.fill->GetPoint(id,pos);
-	// compare to nearest breast voxel id
-	unsigned char* breastVal = static_cast<unsigned char *>(breast->GetScalarPointer());
-	if(breastVal[breast->FindPoint(pos)] == compartmentId){
-	  // inside compartment
-	  v[0] = vtkMath::Distance2BetweenPoints(spos, pos);
-	} else {
-	  // outside compartment, set distance to zero
-	  v[0] = 0.0;
-	}
-      }
-    }
+  // compartment and connectors as they are now, ducts are part of the ROI
+  myTree->buildRegion();
+
+  return myTree;
+}
+
+/* This function grows a duct tree from the given start, inserts it into the segmented breast and frees it,
+ * the tree reads the region it was created with, never the current labels */
+
+void generate_duct(ductTree* myTree, double* sposPtr, double* sdirPtr){
+
+  double spos[3];
+  double sdir[3];
+
+  for(int i=0; i<3; i++){
+    spos[i] = sposPtr[i];
+    sdir[i] = sdirPtr[i];
   }
 
-  myTree.head = new ductBr(spos, sdir, srad, &myTree);
+  int* boundBox = myTree->boundBox;
+  int startInd[3] = {boundBox[0], boundBox[2], boundBox[4]};
+  int endInd[3] = {boundBox[1], boundBox[3], boundBox[5]};
+  double startPos[3];
+  double endPos[3];
+  myTree->breast->GetPoint(myTree->breast->ComputePointId(startInd), startPos);
+  myTree->breast->GetPoint(myTree->breast->ComputePointId(endInd), endPos);
+
+  unsigned int nFill[3];
+  nFill[0] = myTree->opt["ductTree.nFillX"].as<uint>();
+  nFill[1] = myTree->opt["ductTree.nFillY"].as<uint>();
+  nFill[2] = myTree->opt["ductTree.nFillZ"].as<uint>();
+
+  // fill map and distance to compartment boundary of this tree
+  myTree->fill = new fillMap(startPos, endPos, nFill);
+
+  myTree->roi = new roiMask(startPos, endPos, nFill);
+
+  // initialize fill map with squared distance to tree base for fill
+  // voxels in the compartment
+  myTree->fill->build(myTree->breast, spos, myTree->fillRegion, boundBox);
+  delete[] myTree->fillRegion;
+  myTree->fillRegion = nullptr;
+
+  // distance to compartment boundary
+  myTree->roi->build(myTree->breast, boundBox, myTree->region);
+
+  // root of tree
+  double srad = myTree->opt["ductTree.initRad"].as<double>();
+
+  myTree->head = new(myTree->brPool.alloc()) ductBr(spos, sdir, srad, myTree);
 
-  return;
+  myTree->grow();
+  delete myTree->fill;
+  delete myTree->roi;
+  delete myTree;
 }
 
 
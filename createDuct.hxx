@@ -41,7 +41,9 @@
 	#include "duct.hxx"
 #endif
 
-void generate_duct(vtkImageData* breast, boost::program_options::variables_map vm, vtkPoints* TDLUloc, vtkDoubleArray* TDLUattr, 
-	unsigned char compartmentId, int* boundBox, tissueStruct* tissue, double* sposPtr, double* sdirPtr, int seed);
+ductTree* create_duct(vtkImageData* breast, boost::program_options::variables_map vm, vtkPoints* TDLUloc, vtkDoubleArray* TDLUattr, 
+	unsigned char compartmentId, int* boundBox, tissueStruct* tissue, tissueHistogram* histogram, double* sdirPtr, int seed);
+
+void generate_duct(ductTree* myTree, double* sposPtr, double* sdirPtr);
 
 #endif /* CREATEDUCT_HXX_ */
@@ -23,7 +23,7 @@ namespace po = boost::program_options;
 /* This function creates arterial network, inserts it into the segmented
  * breast and saves the tree */
 void generate_vein(vtkImageData* breast, po::variables_map vm, int* boundBox,
-		   tissueStruct* tissue, double* sposPtr, double* sdirPtr, double* nipplePos, int seed, int mainSeed, bool firstTree){
+		   tissueStruct* tissue, tissueHistogram* histogram, roiMask* skin, fillMap* fill, double* sposPtr, double* sdirPtr, double* nipplePos, int seed, int mainSeed, bool firstTree){
 
   char veinFilename[256];
   std::string outputDir = vm["base.outputDir"].as<std::string>();
@@ -37,8 +37,9 @@ void generate_vein(vtkImageData* breast, po::variables_map vm, int* boundBox,
     sdir[i] = sdirPtr[i];
   }
 
-  // declare veinTreeInit struct and fill information
-  veinTreeInit treeInit;
+  // declare veinTreeInit struct and fill information, fields vessels
+  // do not use stay zero
+  veinTreeInit treeInit = veinTreeInit();
 
   treeInit.seed = seed;
 
@@ -56,10 +57,6 @@ void generate_vein(vtkImageData* breast, po::variables_map vm, int* boundBox,
   treeInit.nVox[1] = boundBox[3]-boundBox[2];
   treeInit.nVox[2] = boundBox[5]-boundBox[4];
 
-  treeInit.nFill[0] = vm["vesselTree.nFillX"].as<uint>();
-  treeInit.nFill[1] = vm["vesselTree.nFillY"].as<uint>();
-  treeInit.nFill[2] = vm["vesselTree.nFillZ"].as<uint>();
-
   for(int i=0; i<3; i++){
     treeInit.nipplePos[i] = nipplePos[i];
   }
@@ -68,79 +65,48 @@ void generate_vein(vtkImageData* breast, po::variables_map vm, int* boundBox,
   
   treeInit.tissue = tissue;
 
+  treeInit.histogram = histogram;
+
   treeInit.breast = breast;
 
+  treeInit.roi = skin;
+
+  treeInit.fill = fill;
+
   // create arterial tree
   veinTree myTree(vm, &treeInit);
 
   // root of tree
   double srad = vm["vesselTree.initRad"].as<double>();
 
-  // initialize fill map based on distance to start position if first tree, else load current fill
-
+  // fill map is shared by the trees of the network, the first tree
+  // initializes it with squared distance to its base for fill voxels in
+  // the breast
   if(firstTree){
-    // initialize fill map based on distance to start position
-    int fillExtent[6];
-    myTree.fill->GetExtent(fillExtent);
-    for(int a=fillExtent[0]; a<=fillExtent[1]; a++){
-      for(int b=fillExtent[2]; b<=fillExtent[3]; b++){
-	for(int c=fillExtent[4]; c<=fillExtent[5]; c++){
-	  double* v = static_cast<double*>(myTree.fill->GetScalarPointer(a,b,c));
-	  // set distance to 0 if fill voxel is not in breast, otherwise
-	  // initialize with squared distance to tree base
-
-	  // fill voxel location
-	  vtkIdType id;
-	  int coord[3];
-	  coord[0] = a;
-	  coord[1] = b;
-	  coord[2] = c;
-	  id = myTree.fill->ComputePointId(coord);
-	  // get spatial coordinates of fill voxel
-	  double pos[3];
-	  myTree.fill->GetPoint(id,pos);
-	  // compare to nearest breast voxel id
-	  unsigned char* breastVal = static_cast<unsigned char *>(breast->GetScalarPointer());
-	  bool inBreast = true;
-	  unsigned char voxelVal = breastVal[breast->FindPoint(pos)];
-	  if(voxelVal == tissue->skin || voxelVal == tissue->bg){
-	    inBreast = false;
-	  }
-	  if(inBreast){
-	    // inside breast
-	    v[0] = vtkMath::Distance2BetweenPoints(spos,pos);
-	  } else {
-	    // outside breast, set distance to zero
-	    v[0] = 0.0;
-	  }
-	}
-      }
-    }
-  } else {
-    vtkSmartPointer<vtkXMLImageDataReader> fillReader =
-      vtkSmartPointer<vtkXMLImageDataReader>::New();
-    fillReader->SetFileName(veinFilename);
-    fillReader->Update();
-    vtkSmartPointer<vtkImageData> holder = 
-      vtkSmartPointer<vtkImageData>::New();
-    holder = fillReader->GetOutput();
-    myTree.fill->DeepCopy(holder);
-		
+    unsigned char outside[2] = {tissue->skin, tissue->bg};
+    fill->build(breast, spos, outside, 2, false);
   }
 
-  myTree.head = new veinBr(spos, sdir, srad, &myTree);
+  myTree.head = new(myTree.brPool.alloc()) veinBr(spos, sdir, srad, &myTree);
+  myTree.grow();
+
+  // save density map for debugging
+  if(vm["vesselTree.saveFill"].as<bool>()){
+    vtkSmartPointer<vtkImageData> fillImage =
+      vtkSmartPointer<vtkImageData>::New();
+    fill->toImage(fillImage);
 
-  // save density map
-  vtkSmartPointer<vtkXMLImageDataWriter> fillWriter =
-    vtkSmartPointer<vtkXMLImageDataWriter>::New();
+    vtkSmartPointer<vtkXMLImageDataWriter> fillWriter =
+      vtkSmartPointer<vtkXMLImageDataWriter>::New();
 
-  fillWriter->SetFileName(veinFilename);
+    fillWriter->SetFileName(veinFilename);
 #if VTK_MAJOR_VERSION <= 5
-  fillWriter->SetInput(myTree.fill);
+    fillWriter->SetInput(fillImage);
 #else
-  fillWriter->SetInputData(myTree.fill);
+    fillWriter->SetInputData(fillImage);
 #endif
-  fillWriter->Write();
+    fillWriter->Write();
+  }
 
   return;
 }
@@ -47,7 +47,7 @@
 #endif
 
 void generate_vein(vtkImageData* breast, boost::program_options::variables_map vm, int* boundBox,
-		   tissueStruct* tissue, double* sposPtr, double* sdirPtr, double* nipplePos, int seed, int mainSeed, bool firstTree);
+		   tissueStruct* tissue, tissueHistogram* histogram, roiMask* skin, fillMap* fill, double* sposPtr, double* sdirPtr, double* nipplePos, int seed, int mainSeed, bool firstTree);
 
 
 #endif /* CREATEVEIN_HXX_ */
@@ -0,0 +1,361 @@
+/*! \file fillMap.cxx
+ *  \brief breastPhantom fillMap
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "fillMap.hxx"
+
+#include <vtkVersion.h>
+
+using namespace std;
+
+fillMap::fillMap(const double* startPos, const double* endPos, const unsigned int* nFill){
+  for(int i=0; i<3; i++){
+    dim[i] = nFill[i];
+    spacing[i] = (endPos[i] - startPos[i])/(nFill[i]);
+    origin[i] = startPos[i]+spacing[i]/2.0;
+  }
+  numActive = 0;
+  x = NULL;
+  y = NULL;
+  z = NULL;
+  dist = NULL;
+  index = NULL;
+  numBuckets = 0;
+  bucketStart = NULL;
+  bucketBox = NULL;
+  bucketMax = NULL;
+}
+
+fillMap::~fillMap(){
+  delete[] x;
+  delete[] y;
+  delete[] z;
+  delete[] dist;
+  delete[] index;
+  delete[] bucketStart;
+  delete[] bucketBox;
+  delete[] bucketMax;
+}
+
+void fillMap::compact(const unsigned char* mask){
+  delete[] x;
+  delete[] y;
+  delete[] z;
+  delete[] dist;
+  delete[] index;
+  delete[] bucketStart;
+  delete[] bucketBox;
+  delete[] bucketMax;
+
+  // bucket of every grid voxel and number of active voxels per bucket
+  int nb[3];
+  for(int i=0; i<3; i++){
+    nb[i] = (dim[i]+bucketSize-1)/bucketSize;
+  }
+  int allBuckets = nb[0]*nb[1]*nb[2];
+  vtkIdType* count = new vtkIdType[allBuckets+1];
+  for(int k=0; k<=allBuckets; k++){
+    count[k] = 0;
+  }
+
+  numActive = 0;
+  vtkIdType n = 0;
+  for(int c=0; c<dim[2]; c++){
+    for(int b=0; b<dim[1]; b++){
+      for(int a=0; a<dim[0]; a++){
+	if(mask[n]){
+	  count[((c/bucketSize)*nb[1] + b/bucketSize)*nb[0] + a/bucketSize] += 1;
+	  numActive++;
+	}
+	n++;
+      }
+    }
+  }
+
+  // keep non-empty buckets, count becomes running write position
+  numBuckets = 0;
+  for(int k=0; k<allBuckets; k++){
+    if(count[k] > 0){
+      numBuckets++;
+    }
+  }
+  bucketStart = new vtkIdType[numBuckets+1];
+  bucketBox = new float[6*(numBuckets > 0 ? numBuckets : 1)];
+  bucketMax = new float[numBuckets > 0 ? numBuckets : 1];
+
+  vtkIdType start = 0;
+  int bucket = 0;
+  for(int k=0; k<allBuckets; k++){
+    vtkIdType num = count[k];
+    count[k] = start;
+    if(num > 0){
+      bucketStart[bucket] = start;
+      bucket++;
+    }
+    start += num;
+  }
+  bucketStart[numBuckets] = numActive;
+
+  x = new float[numActive];
+  y = new float[numActive];
+  z = new float[numActive];
+  dist = new float[numActive];
+  index = new vtkIdType[numActive];
+
+  n = 0;
+  for(int c=0; c<dim[2]; c++){
+    for(int b=0; b<dim[1]; b++){
+      for(int a=0; a<dim[0]; a++){
+	if(mask[n]){
+	  vtkIdType m = count[((c/bucketSize)*nb[1] + b/bucketSize)*nb[0] + a/bucketSize]++;
+	  x[m] = origin[0] + a*spacing[0];
+	  y[m] = origin[1] + b*spacing[1];
+	  z[m] = origin[2] + c*spacing[2];
+	  index[m] = n;
+	}
+	n++;
+      }
+    }
+  }
+  delete[] count;
+
+  // bounding box of voxel centers in each bucket
+  for(int k=0; k<numBuckets; k++){
+    float* box = &bucketBox[6*k];
+    vtkIdType m = bucketStart[k];
+    box[0] = box[1] = x[m];
+    box[2] = box[3] = y[m];
+    box[4] = box[5] = z[m];
+    for(m=bucketStart[k]+1; m<bucketStart[k+1]; m++){
+      box[0] = (x[m] < box[0]) ? x[m] : box[0];
+      box[1] = (x[m] > box[1]) ? x[m] : box[1];
+      box[2] = (y[m] < box[2]) ? y[m] : box[2];
+      box[3] = (y[m] > box[3]) ? y[m] : box[3];
+      box[4] = (z[m] < box[4]) ? z[m] : box[4];
+      box[5] = (z[m] > box[5]) ? z[m] : box[5];
+    }
+  }
+}
+
+void fillMap::boundBuckets(void){
+#pragma omp parallel for schedule(static)
+  for(int k=0; k<numBuckets; k++){
+    float vMax = 0.0f;
+    for(vtkIdType m=bucketStart[k]; m<bucketStart[k+1]; m++){
+      vMax = (dist[m] > vMax) ? dist[m] : vMax;
+    }
+    bucketMax[k] = vMax;
+  }
+}
+
+float fillMap::boxDist2(int k, float px, float py, float pz){
+  const float* box = &bucketBox[6*k];
+  float dx = (px < box[0]) ? box[0]-px : ((px > box[1]) ? px-box[1] : 0.0f);
+  float dy = (py < box[2]) ? box[2]-py : ((py > box[3]) ? py-box[3] : 0.0f);
+  float dz = (pz < box[4]) ? box[4]-pz : ((pz > box[5]) ? pz-box[5] : 0.0f);
+  return dx*dx + dy*dy + dz*dz;
+}
+
+void fillMap::build(vtkImageData* breast, const double* base, const unsigned char* labels,
+		    int numLabels, bool inside){
+  build(breast, base, labels, numLabels, NULL, NULL, inside);
+}
+
+void fillMap::build(vtkImageData* breast, const double* base, const unsigned char* bits,
+		    const int* box){
+  build(breast, base, NULL, 0, bits, box, true);
+}
+
+void fillMap::build(vtkImageData* breast, const double* base, const unsigned char* labels,
+		    int numLabels, const unsigned char* bits, const int* box, bool inside){
+  vtkIdType numVox = (vtkIdType)dim[0]*dim[1]*dim[2];
+  unsigned char* mask = new unsigned char[numVox];
+  unsigned char* breastVal = static_cast<unsigned char *>(breast->GetScalarPointer());
+  int breastDim[3];
+  int breastExtent[6];
+  breast->GetDimensions(breastDim);
+  breast->GetExtent(breastExtent);
+
+  // compare to nearest breast voxel
+#pragma omp parallel for collapse(2) schedule(static)
+  for(int c=0; c<dim[2]; c++){
+    for(int b=0; b<dim[1]; b++){
+      vtkIdType n = ((vtkIdType)c*dim[1] + b)*dim[0];
+      for(int a=0; a<dim[0]; a++){
+	double pos[3] = {origin[0] + a*spacing[0], origin[1] + b*spacing[1], origin[2] + c*spacing[2]};
+	vtkIdType id = breast->FindPoint(pos);
+	unsigned char voxelVal = breastVal[id];
+	bool found = false;
+	if(bits != NULL){
+	  int ijk[3] = {(int)(id % breastDim[0]) + breastExtent[0],
+			(int)((id / breastDim[0]) % breastDim[1]) + breastExtent[2],
+			(int)(id / ((vtkIdType)breastDim[0]*breastDim[1])) + breastExtent[4]};
+	  bool inBox = true;
+	  for(int i=0; i<3; i++){
+	    inBox = inBox && ijk[i] >= box[2*i] && ijk[i] <= box[2*i+1];
+	  }
+	  if(inBox){
+	    vtkIdType m = ((vtkIdType)(ijk[2]-box[4])*(box[3]-box[2]+1) + (ijk[1]-box[2]))*
+	      (box[1]-box[0]+1) + (ijk[0]-box[0]);
+	    found = (bits[m >> 3] >> (m & 7)) & 1;
+	  }
+	}
+	for(int l=0; l<numLabels; l++){
+	  found = found || (voxelVal == labels[l]);
+	}
+	mask[n+a] = (found == inside) ? 1 : 0;
+      }
+    }
+  }
+
+  compact(mask);
+  delete[] mask;
+
+  // initial value is squared distance to base of tree
+#pragma omp parallel for schedule(static)
+  for(vtkIdType m=0; m<numActive; m++){
+    double dx = x[m] - base[0];
+    double dy = y[m] - base[1];
+    double dz = z[m] - base[2];
+    dist[m] = dx*dx + dy*dy + dz*dz;
+  }
+  boundBuckets();
+}
+
+void fillMap::score(const double* pos, int num, double* density){
+  float* px = new float[num];
+  float* py = new float[num];
+  float* pz = new float[num];
+  for(int k=0; k<num; k++){
+    px[k] = pos[3*k];
+    py[k] = pos[3*k+1];
+    pz[k] = pos[3*k+2];
+  }
+
+  // buckets are summed in fixed blocks and the blocks in order, so the
+  // result does not depend on the number of threads or their timing
+  int numBlocks = (numBuckets+blockSize-1)/blockSize;
+  double* blockDensity = new double[(numBlocks > 0 ? numBlocks : 1)*num];
+  for(int k=0; k<numBlocks*num; k++){
+    blockDensity[k] = 0.0;
+  }
+
+#pragma omp parallel
+  {
+    // candidates that may lower a voxel of current bucket
+    float* lx = new float[num];
+    float* ly = new float[num];
+    float* lz = new float[num];
+    double* acc = new double[num];
+    int* lid = new int[num];
+
+#pragma omp for schedule(dynamic)
+    for(int blk=0; blk<numBlocks; blk++){
+      double* myDensity = &blockDensity[blk*num];
+      int lastBucket = (blk+1)*blockSize < numBuckets ? (blk+1)*blockSize : numBuckets;
+      for(int k=blk*blockSize; k<lastBucket; k++){
+	int numLive = 0;
+	for(int l=0; l<num; l++){
+	  if(boxDist2(k, px[l], py[l], pz[l]) < bucketMax[k]){
+	    lx[numLive] = px[l];
+	    ly[numLive] = py[l];
+	    lz[numLive] = pz[l];
+	    lid[numLive] = l;
+	    acc[numLive] = 0.0;
+	    numLive++;
+	  }
+	}
+	if(numLive == 0){
+	  continue;
+	}
+	for(vtkIdType m=bucketStart[k]; m<bucketStart[k+1]; m++){
+	  float vx = x[m];
+	  float vy = y[m];
+	  float vz = z[m];
+	  float v = dist[m];
+#pragma omp simd
+	  for(int l=0; l<numLive; l++){
+	    float d = (lx[l]-vx)*(lx[l]-vx) + (ly[l]-vy)*(ly[l]-vy) + (lz[l]-vz)*(lz[l]-vz);
+	    acc[l] -= (d < v) ? v - d : 0.0f;
+	  }
+	}
+	for(int l=0; l<numLive; l++){
+	  myDensity[lid[l]] += acc[l];
+	}
+      }
+    }
+
+    delete[] lx;
+    delete[] ly;
+    delete[] lz;
+    delete[] acc;
+    delete[] lid;
+  }
+
+  for(int blk=0; blk<numBlocks; blk++){
+    for(int k=0; k<num; k++){
+      density[k] += blockDensity[blk*num+k];
+    }
+  }
+  delete[] blockDensity;
+
+  delete[] px;
+  delete[] py;
+  delete[] pz;
+}
+
+void fillMap::update(const double* pos){
+  float px = pos[0];
+  float py = pos[1];
+  float pz = pos[2];
+
+#pragma omp parallel for schedule(dynamic,16)
+  for(int k=0; k<numBuckets; k++){
+    if(boxDist2(k, px, py, pz) < bucketMax[k]){
+      float vMax = 0.0f;
+      for(vtkIdType m=bucketStart[k]; m<bucketStart[k+1]; m++){
+	float d = (px-x[m])*(px-x[m]) + (py-y[m])*(py-y[m]) + (pz-z[m])*(pz-z[m]);
+	dist[m] = (d < dist[m]) ? d : dist[m];
+	vMax = (dist[m] > vMax) ? dist[m] : vMax;
+      }
+      bucketMax[k] = vMax;
+    }
+  }
+}
+
+vtkIdType fillMap::getNumActive(void){
+  return numActive;
+}
+
+void fillMap::toImage(vtkImageData* img){
+  img->SetSpacing(spacing);
+  img->SetExtent(0, dim[0]-1, 0, dim[1]-1, 0, dim[2]-1);
+  img->SetOrigin(origin);
+#if VTK_MAJOR_VERSION <= 5
+  img->SetNumberOfScalarComponents(1);
+  img->SetScalarTypeToDouble();
+  img->AllocateScalars();
+#else
+  img->AllocateScalars(VTK_DOUBLE,1);
+#endif
+
+  double* v = static_cast<double*>(img->GetScalarPointer());
+  vtkIdType numVox = (vtkIdType)dim[0]*dim[1]*dim[2];
+  for(vtkIdType n=0; n<numVox; n++){
+    v[n] = 0.0;
+  }
+  for(vtkIdType m=0; m<numActive; m++){
+    v[index[m]] = dist[m];
+  }
+}
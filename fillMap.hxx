@@ -0,0 +1,105 @@
+/*! \file fillMap.hxx
+ *  \brief breastPhantom tree growth fill map header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef FILLMAP_HXX_
+#define FILLMAP_HXX_
+
+#ifndef __OMP__
+#define __OMP__
+#include <omp.h>
+#endif
+
+#ifndef __VTKIMAGEDATA__
+#define __VTKIMAGEDATA__
+#include <vtkImageData.h>
+#endif
+
+/**********************************************
+*
+* Squared distance to a growing tree on a coarse grid
+*
+**********************************************/
+
+class fillMap{
+  // only grid voxels inside the region of interest are stored, as a
+  // compacted list with their coordinates precomputed, so sweeps read
+  // contiguous memory
+  // the list is grouped into cubic buckets of the grid, each bucket keeps
+  // its bounding box and largest distance, a point farther from the box
+  // than that distance can not lower any voxel in it and the bucket is
+  // skipped, so late in tree growth most of the map is never read
+  // voxels outside the region read as distance 0 when exported
+
+  // number of grid voxels in each direction
+  int dim[3];
+  // center of first grid voxel
+  double origin[3];
+  // grid voxel size (mm)
+  double spacing[3];
+  // number of voxels in region of interest
+  vtkIdType numActive;
+  // coordinates of active voxels
+  float* x;
+  float* y;
+  float* z;
+  // squared distance from active voxels to tree
+  float* dist;
+  // grid index of active voxels
+  vtkIdType* index;
+  // bucket edge length (grid voxels)
+  static const int bucketSize = 4;
+  // buckets per block when summing scores
+  static const int blockSize = 16;
+  // number of non-empty buckets
+  int numBuckets;
+  // first active voxel of each bucket, numBuckets+1 entries
+  vtkIdType* bucketStart;
+  // bounding box {x0,x1,y0,y1,z0,z1} of voxel centers in each bucket
+  float* bucketBox;
+  // largest distance in each bucket
+  float* bucketMax;
+  // replace active list with voxels flagged in grid sized mask
+  void compact(const unsigned char*);
+  // recompute largest distance of every bucket
+  void boundBuckets(void);
+  // squared distance from point to box of bucket
+  float boxDist2(int, float, float, float);
+  // activate voxels from labels, or from bits over box if not NULL
+  void build(vtkImageData*, const double*, const unsigned char*, int, const unsigned char*, const int*, bool);
+public:
+  // activate voxels whose nearest breast voxel label is in labels (inside
+  // true) or not in labels (inside false), distance starts as squared
+  // distance to base
+  void build(vtkImageData*, const double*, const unsigned char*, int, bool);
+  // activate voxels whose nearest breast voxel is set in a mask of one bit
+  // per breast voxel of index box, x fastest, bit n&7 of byte n>>3 for
+  // voxel n
+  void build(vtkImageData*, const double*, const unsigned char*, const int*);
+  // density change from adding each of num tree points pos (3 per point),
+  // the summed reduction in squared distance is subtracted from density
+  void score(const double*, int, double*);
+  // add a tree point, lowering distances
+  void update(const double*);
+  // number of voxels in region of interest
+  vtkIdType getNumActive(void);
+  // write distances to a grid image of matching geometry
+  void toImage(vtkImageData*);
+  // constructor spans box from startPos to endPos with nFill voxels
+  fillMap(const double*, const double*, const unsigned int*);
+  // destructor
+  ~fillMap();
+};
+
+#endif /* FILLMAP_HXX_ */
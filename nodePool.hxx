@@ -0,0 +1,132 @@
+/*! \file nodePool.hxx
+ *  \brief breastPhantom tree node pool header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef NODEPOOL_HXX_
+#define NODEPOOL_HXX_
+
+#ifndef __OMP__
+#define __OMP__
+#include <omp.h>
+#endif
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+/**********************************************
+*
+* Pool of tree nodes owned by one tree
+*
+**********************************************/
+
+template <class T>
+class nodePool{
+  // nodes are placed in blocks of blockSize consecutive slots, blocks never
+  // move so node pointers stay valid for the life of the pool
+  // a released node's slot is reused by the next allocation
+  // the pool frees its blocks without running node destructors, so nodes
+  // must not own memory of their own
+  // allocation and release may be called from several threads
+
+  // slots per block
+  static const int blockSize = 256;
+  // storage blocks
+  char** blocks;
+  // blocks in use
+  int numBlocks;
+  // block pointers allocated
+  int maxBlocks;
+  // slots used in last block
+  int numUsed;
+  // released slots, each holds the next one
+  void* freeSlot;
+  // serializes allocation and release
+  omp_lock_t lock;
+  // pools are not copied
+  nodePool(const nodePool&);
+  nodePool& operator=(const nodePool&);
+public:
+  // storage for one node, construct with placement new
+  void* alloc(void);
+  // destroy node and keep its slot for reuse
+  void release(T*);
+  // constructor
+  nodePool();
+  // destructor frees all nodes at once
+  ~nodePool();
+};
+
+template <class T>
+nodePool<T>::nodePool(){
+  maxBlocks = 16;
+  blocks = new char*[maxBlocks];
+  numBlocks = 0;
+  numUsed = blockSize;
+  freeSlot = nullptr;
+  omp_init_lock(&lock);
+}
+
+template <class T>
+nodePool<T>::~nodePool(){
+  static_assert(std::is_trivially_destructible<T>::value, "pooled nodes are freed without destructors");
+  for(int k=0; k<numBlocks; k++){
+    delete[] blocks[k];
+  }
+  delete[] blocks;
+  omp_destroy_lock(&lock);
+}
+
+template <class T>
+void* nodePool<T>::alloc(void){
+  // a slot must hold a node and the free list link
+  const size_t slotSize = (sizeof(T) > sizeof(void*)) ? sizeof(T) : sizeof(void*);
+  void* slot;
+  omp_set_lock(&lock);
+  if(freeSlot != nullptr){
+    slot = freeSlot;
+    freeSlot = *static_cast<void**>(slot);
+  } else {
+    if(numUsed == blockSize){
+      if(numBlocks == maxBlocks){
+	char** more = new char*[2*maxBlocks];
+	for(int k=0; k<numBlocks; k++){
+	  more[k] = blocks[k];
+	}
+	delete[] blocks;
+	blocks = more;
+	maxBlocks *= 2;
+      }
+      // operator new[] storage is aligned for any node type
+      blocks[numBlocks] = new char[blockSize*slotSize];
+      numBlocks++;
+      numUsed = 0;
+    }
+    slot = blocks[numBlocks-1] + numUsed*slotSize;
+    numUsed++;
+  }
+  omp_unset_lock(&lock);
+  return slot;
+}
+
+template <class T>
+void nodePool<T>::release(T* node){
+  node->~T();
+  omp_set_lock(&lock);
+  *reinterpret_cast<void**>(node) = freeSlot;
+  freeSlot = node;
+  omp_unset_lock(&lock);
+}
+
+#endif /* NODEPOOL_HXX_ */
@@ -15,6 +15,8 @@
  
 #include "perlinNoise.hxx"
 
+#include <cmath>
+
 double randPerm[256][3] = {
 	{0.7321, 0.3079, 0.6076},
 	{-0.7627, -0.6454, 0.0418},
@@ -445,6 +447,51 @@ double perlinNoise::getNoise(double* r){
   return nval;
 }
 
-	
-	
-	 
+double perlinNoise::maxGradient(void){
+  // table vectors are unit length up to rounding
+  double maxNorm = 0.0;
+  for(int i=0; i<256; i++){
+    double norm = sqrt(randPerm[i][0]*randPerm[i][0] + randPerm[i][1]*randPerm[i][1] +
+		       randPerm[i][2]*randPerm[i][2]);
+    if(norm > maxNorm){
+      maxNorm = norm;
+    }
+  }
+  return maxNorm;
+}
+
+double perlinNoise::maxNoise(void){
+  // an octave is a weighted mean of corner terms 2.12*g.(x-c), with the
+  // largest choice of gradients g it is 2.12*|g| times the weighted mean of
+  // the corner distances, which peaks at the cell center where every
+  // corner is sqrt(3)/2 away
+  double octave = 2.12*maxGradient()*sqrt(3.0)/2.0;
+  double bound = 0.0;
+  double myPersistence = 1.0;
+  for(int32_t i=0; i<numOctaves; i++){
+    bound += octave*myPersistence;
+    myPersistence *= persistence;
+  }
+  return bound;
+}
+
+double perlinNoise::maxSlope(void){
+  // along one axis the derivative of an octave is the weighted mean of
+  // 2.12*g, at most 2.12*|g|, plus the fade slope, at most 15/8, times a
+  // weighted mean of differences of opposite corner terms, each at most
+  // 2.12*|g| times the sum of two corner distances, at most
+  // sqrt(2)+sqrt(3), the gradient norm is at most sqrt(3) times the axis
+  // bound
+  // r has unit length so turning it by an angle moves frequency*r by at
+  // most frequency times the angle
+  double octave = 2.12*maxGradient()*sqrt(3.0)*(1.0 + 15.0/8.0*(sqrt(2.0) + sqrt(3.0)));
+  double bound = 0.0;
+  double myFrequency = frequency;
+  double myPersistence = 1.0;
+  for(int32_t i=0; i<numOctaves; i++){
+    bound += octave*myFrequency*myPersistence;
+    myFrequency *= lacunarity;
+    myPersistence *= persistence;
+  }
+  return bound;
+}
@@ -39,8 +39,14 @@ private:
   double gradientNoise(double x, double y, double z, 
 		       int32_t ia, int32_t ib, int32_t ic, int32_t mySeed);
 	
+  double maxGradient(void);
+	
 public:
   double getNoise(double* r);
+  // bound on absolute value of getNoise
+  double maxNoise(void);
+  // bound on change of getNoise per radian change of unit direction r
+  double maxSlope(void);
   void setSeed(int32_t inSeed);
   perlinNoise(boost::program_options::variables_map vm, int32_t inSeed, const char* type);
   perlinNoise(boost::program_options::variables_map vm, int32_t inSeed, double freq, double lac, double pers, int oct);
@@ -0,0 +1,343 @@
+/*! \file roiMask.cxx
+ *  \brief breastPhantom roiMask
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "roiMask.hxx"
+
+#include <cmath>
+
+using namespace std;
+
+roiMask::roiMask(const double* startPos, const double* endPos, const unsigned int* nCell){
+  for(int i=0; i<3; i++){
+    dim[i] = nCell[i];
+    start[i] = startPos[i];
+    spacing[i] = (endPos[i] - startPos[i])/(nCell[i]);
+  }
+  vtkIdType numCell = (vtkIdType)dim[0]*dim[1]*dim[2];
+  dist = new float[numCell];
+  solid = new unsigned char[numCell];
+  // nothing known until built
+  for(vtkIdType n=0; n<numCell; n++){
+    dist[n] = -1.0f;
+    solid[n] = 0;
+  }
+  maxDist = -1.0;
+}
+
+roiMask::~roiMask(){
+  delete[] dist;
+  delete[] solid;
+}
+
+vtkIdType roiMask::cellOf(const double* pos){
+  int ijk[3];
+  for(int i=0; i<3; i++){
+    double f = (pos[i] - start[i])/spacing[i];
+    if(!(f >= 0.0 && f < dim[i])){
+      return -1;
+    }
+    ijk[i] = (int)f;
+  }
+  return ((vtkIdType)ijk[2]*dim[1] + ijk[1])*dim[0] + ijk[0];
+}
+
+void roiMask::transformLine(double* f, int n, double h, int* v, double* z, double* g){
+  // lower envelope of parabolas rooted at the sources
+  for(int q=0; q<n; q++){
+    g[q] = f[q];
+  }
+  int k = -1;
+  for(int q=0; q<n; q++){
+    if(g[q] < 0.0){
+      continue;
+    }
+    double fq = g[q] + (q*h)*(q*h);
+    if(k < 0){
+      k = 0;
+      v[0] = q;
+      z[0] = -1e300;
+      z[1] = 1e300;
+      continue;
+    }
+    double s = (fq - (g[v[k]] + (v[k]*h)*(v[k]*h)))/(2*h*(q - v[k]));
+    while(k > 0 && s <= z[k]){
+      k--;
+      s = (fq - (g[v[k]] + (v[k]*h)*(v[k]*h)))/(2*h*(q - v[k]));
+    }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k+1] = 1e300;
+  }
+  if(k < 0){
+    // no source on line
+    return;
+  }
+  k = 0;
+  for(int q=0; q<n; q++){
+    while(z[k+1] < q*h){
+      k++;
+    }
+    f[q] = (q - v[k])*h*(q - v[k])*h + g[v[k]];
+  }
+}
+
+void roiMask::build(vtkImageData* breast, const int* boundBox, const unsigned char* labels,
+		    int numLabels, bool inside){
+  build(breast, boundBox, labels, numLabels, NULL, inside);
+}
+
+void roiMask::build(vtkImageData* breast, const int* boundBox, const unsigned char* bits){
+  build(breast, boundBox, NULL, 0, bits, true);
+}
+
+void roiMask::build(vtkImageData* breast, const int* boundBox, const unsigned char* labels,
+		    int numLabels, const unsigned char* bits, bool inside){
+  double origin[3];
+  double voxSpacing[3];
+  int extent[6];
+  breast->GetOrigin(origin);
+  breast->GetSpacing(voxSpacing);
+  breast->GetExtent(extent);
+
+  int first[3];
+  int last[3];
+  for(int i=0; i<3; i++){
+    first[i] = (boundBox[2*i] < extent[2*i]) ? extent[2*i] : boundBox[2*i];
+    last[i] = (boundBox[2*i+1] > extent[2*i+1]) ? extent[2*i+1] : boundBox[2*i+1];
+  }
+
+  // range of cells overlapped by each voxel [v,v+1) of box
+  int* cellLo[3];
+  int* cellHi[3];
+  for(int i=0; i<3; i++){
+    int num = last[i] - first[i] + 1;
+    cellLo[i] = new int[num > 0 ? num : 1];
+    cellHi[i] = new int[num > 0 ? num : 1];
+    for(int v=first[i]; v<=last[i]; v++){
+      double lo = (origin[i] + v*voxSpacing[i] - start[i])/spacing[i];
+      double hi = (origin[i] + (v+1)*voxSpacing[i] - start[i])/spacing[i];
+      int a = (int)floor(lo);
+      int b = (int)ceil(hi) - 1;
+      cellLo[i][v-first[i]] = (a < 0) ? 0 : a;
+      cellHi[i][v-first[i]] = (b > dim[i]-1) ? dim[i]-1 : b;
+    }
+  }
+
+  vtkIdType numCell = (vtkIdType)dim[0]*dim[1]*dim[2];
+  unsigned char* blocked = new unsigned char[numCell];
+  for(vtkIdType n=0; n<numCell; n++){
+    blocked[n] = 0;
+    solid[n] = 1;
+  }
+
+  // cells not fully covered by region voxels are blocked, cells without any
+  // region voxel are solid
+#pragma omp parallel for schedule(static)
+  for(int c=first[2]; c<=last[2]; c++){
+    for(int b=first[1]; b<=last[1]; b++){
+      unsigned char* row = static_cast<unsigned char*>(breast->GetScalarPointer(first[0],b,c));
+      for(int a=first[0]; a<=last[0]; a++){
+	bool found = false;
+	if(bits != NULL){
+	  vtkIdType m = ((vtkIdType)(c-boundBox[4])*(boundBox[3]-boundBox[2]+1) + (b-boundBox[2]))*
+	    (boundBox[1]-boundBox[0]+1) + (a-boundBox[0]);
+	  found = (bits[m >> 3] >> (m & 7)) & 1;
+	}
+	for(int l=0; l<numLabels; l++){
+	  found = found || (row[a-first[0]] == labels[l]);
+	}
+	for(int z=cellLo[2][c-first[2]]; z<=cellHi[2][c-first[2]]; z++){
+	  for(int y=cellLo[1][b-first[1]]; y<=cellHi[1][b-first[1]]; y++){
+	    for(int x=cellLo[0][a-first[0]]; x<=cellHi[0][a-first[0]]; x++){
+	      vtkIdType n = ((vtkIdType)z*dim[1] + y)*dim[0] + x;
+	      if(found == inside){
+#pragma omp atomic write
+		solid[n] = 0;
+	      } else {
+#pragma omp atomic write
+		blocked[n] = 1;
+	      }
+	    }
+	  }
+	}
+      }
+    }
+  }
+
+  // the box of breast voxels may not reach the grid edge, cells partly
+  // beyond it are blocked and unknown
+#pragma omp parallel for schedule(static)
+  for(int c=0; c<dim[2]; c++){
+    for(int b=0; b<dim[1]; b++){
+      for(int a=0; a<dim[0]; a++){
+	double lo[3] = {start[0] + a*spacing[0], start[1] + b*spacing[1], start[2] + c*spacing[2]};
+	for(int i=0; i<3; i++){
+	  double covLo = origin[i] + first[i]*voxSpacing[i];
+	  double covHi = origin[i] + (last[i]+1)*voxSpacing[i];
+	  if(lo[i] < covLo || lo[i] + spacing[i] > covHi){
+	    blocked[((vtkIdType)c*dim[1] + b)*dim[0] + a] = 1;
+	    solid[((vtkIdType)c*dim[1] + b)*dim[0] + a] = 0;
+	  }
+	}
+      }
+    }
+  }
+
+  for(int i=0; i<3; i++){
+    delete[] cellLo[i];
+    delete[] cellHi[i];
+  }
+
+  // exact squared distance between cell centers to the nearest blocked
+  // cell, on a grid padded by one blocked layer standing for the outside
+  int pad[3] = {dim[0]+2, dim[1]+2, dim[2]+2};
+  vtkIdType numPad = (vtkIdType)pad[0]*pad[1]*pad[2];
+  double* d2 = new double[numPad];
+#pragma omp parallel for schedule(static)
+  for(int c=0; c<pad[2]; c++){
+    for(int b=0; b<pad[1]; b++){
+      for(int a=0; a<pad[0]; a++){
+	vtkIdType m = ((vtkIdType)c*pad[1] + b)*pad[0] + a;
+	if(a == 0 || b == 0 || c == 0 || a == pad[0]-1 || b == pad[1]-1 || c == pad[2]-1){
+	  d2[m] = 0.0;
+	} else {
+	  d2[m] = blocked[((vtkIdType)(c-1)*dim[1] + (b-1))*dim[0] + (a-1)] ? 0.0 : -1.0;
+	}
+      }
+    }
+  }
+  delete[] blocked;
+
+  int maxPad = pad[0];
+  maxPad = (pad[1] > maxPad) ? pad[1] : maxPad;
+  maxPad = (pad[2] > maxPad) ? pad[2] : maxPad;
+  vtkIdType stride[3] = {1, pad[0], (vtkIdType)pad[0]*pad[1]};
+
+  for(int axis=0; axis<3; axis++){
+    int u = (axis == 0) ? 1 : 0;
+    int w = (axis == 2) ? 1 : 2;
+#pragma omp parallel
+    {
+      double* line = new double[maxPad];
+      double* g = new double[maxPad];
+      double* z = new double[maxPad+1];
+      int* v = new int[maxPad];
+#pragma omp for collapse(2) schedule(static)
+      for(int j=0; j<pad[w]; j++){
+	for(int i=0; i<pad[u]; i++){
+	  vtkIdType base = i*stride[u] + j*stride[w];
+	  for(int q=0; q<pad[axis]; q++){
+	    line[q] = d2[base + q*stride[axis]];
+	  }
+	  transformLine(line, pad[axis], spacing[axis], v, z, g);
+	  for(int q=0; q<pad[axis]; q++){
+	    d2[base + q*stride[axis]] = line[q];
+	  }
+	}
+      }
+      delete[] line;
+      delete[] g;
+      delete[] z;
+      delete[] v;
+    }
+  }
+
+  // a point and a blocked point are each within half a cell diagonal of
+  // their cell centers
+  double diag = sqrt(spacing[0]*spacing[0] + spacing[1]*spacing[1] + spacing[2]*spacing[2]);
+  double largest = -1.0;
+#pragma omp parallel for schedule(static) reduction(max:largest)
+  for(int c=0; c<dim[2]; c++){
+    for(int b=0; b<dim[1]; b++){
+      for(int a=0; a<dim[0]; a++){
+	double v = sqrt(d2[((vtkIdType)(c+1)*pad[1] + (b+1))*pad[0] + (a+1)]) - diag;
+	// round down so the stored value stays a lower bound
+	float f = (float)v;
+	dist[((vtkIdType)c*dim[1] + b)*dim[0] + a] = (f > v) ? nextafterf(f, -1e30f) : f;
+	largest = (v > largest) ? v : largest;
+      }
+    }
+  }
+  delete[] d2;
+  maxDist = largest;
+}
+
+void roiMask::addHole(const double* pos, double radius){
+  // only cells nearer the hole than the largest stored distance can change
+  double reach = radius + maxDist;
+  if(reach < 0.0){
+    return;
+  }
+  int lo[3];
+  int hi[3];
+  for(int i=0; i<3; i++){
+    lo[i] = (int)floor((pos[i] - reach - start[i])/spacing[i]);
+    hi[i] = (int)floor((pos[i] + reach - start[i])/spacing[i]);
+    lo[i] = (lo[i] < 0) ? 0 : lo[i];
+    hi[i] = (hi[i] > dim[i]-1) ? dim[i]-1 : hi[i];
+  }
+#pragma omp parallel for schedule(static)
+  for(int c=lo[2]; c<=hi[2]; c++){
+    double cellLo[3];
+    double gap[3];
+    cellLo[2] = start[2] + c*spacing[2];
+    gap[2] = (pos[2] < cellLo[2]) ? cellLo[2] - pos[2] :
+      ((pos[2] > cellLo[2] + spacing[2]) ? pos[2] - cellLo[2] - spacing[2] : 0.0);
+    for(int b=lo[1]; b<=hi[1]; b++){
+      cellLo[1] = start[1] + b*spacing[1];
+      gap[1] = (pos[1] < cellLo[1]) ? cellLo[1] - pos[1] :
+	((pos[1] > cellLo[1] + spacing[1]) ? pos[1] - cellLo[1] - spacing[1] : 0.0);
+      for(int a=lo[0]; a<=hi[0]; a++){
+	cellLo[0] = start[0] + a*spacing[0];
+	gap[0] = (pos[0] < cellLo[0]) ? cellLo[0] - pos[0] :
+	  ((pos[0] > cellLo[0] + spacing[0]) ? pos[0] - cellLo[0] - spacing[0] : 0.0);
+	// no point of the cell is nearer the hole center than its box
+	double v = sqrt(gap[0]*gap[0] + gap[1]*gap[1] + gap[2]*gap[2]) - radius;
+	vtkIdType n = ((vtkIdType)c*dim[1] + b)*dim[0] + a;
+	if(v < dist[n]){
+	  // round down so the stored value stays a lower bound
+	  float f = (float)v;
+	  dist[n] = (f > v) ? nextafterf(f, -1e30f) : f;
+	}
+      }
+    }
+  }
+}
+
+double roiMask::clearance(const double* pos){
+  vtkIdType n = cellOf(pos);
+  if(n < 0){
+    return -1.0;
+  }
+  return dist[n];
+}
+
+int roiMask::freeSteps(const double* pos, double step){
+  double d = clearance(pos);
+  if(d <= 0.0){
+    return 0;
+  }
+  // every point closer than d is in the region
+  return (int)ceil(d/step);
+}
+
+bool roiMask::outside(const double* pos){
+  vtkIdType n = cellOf(pos);
+  if(n < 0){
+    return false;
+  }
+  return solid[n] != 0;
+}
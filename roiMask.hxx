@@ -0,0 +1,89 @@
+/*! \file roiMask.hxx
+ *  \brief breastPhantom tree region of interest distance mask header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef ROIMASK_HXX_
+#define ROIMASK_HXX_
+
+#ifndef __OMP__
+#define __OMP__
+#include <omp.h>
+#endif
+
+#ifndef __VTKIMAGEDATA__
+#define __VTKIMAGEDATA__
+#include <vtkImageData.h>
+#endif
+
+/**********************************************
+*
+* Coarse distance to the boundary of a region of interest
+*
+**********************************************/
+
+class roiMask{
+  // a coarse cell is blocked if any breast voxel overlapping it has a label
+  // outside the region, everything outside the grid is blocked
+  // each cell stores a lower bound on the distance from any point in it
+  // to a blocked cell, so a point with positive clearance lies in a region
+  // voxel for certain, cells no region voxel overlaps are marked solid
+  // voxels leaving the region after the mask is built are registered as
+  // holes, spheres whose distance is folded into the cells when added, so
+  // a clearance query stays a single lookup
+
+  // number of cells in each direction
+  int dim[3];
+  // corner of grid
+  double start[3];
+  // cell size (mm)
+  double spacing[3];
+  // lower bound on distance to blocked cells (mm)
+  float* dist;
+  // 1 if no region voxel overlaps cell
+  unsigned char* solid;
+  // largest stored distance (mm)
+  double maxDist;
+  // cell containing point, -1 outside grid
+  vtkIdType cellOf(const double*);
+  // squared distance transform of a line of n samples spaced h apart, f
+  // holds 0 or a negative value for no source on input and the squared
+  // distance on output, v, z and g are work arrays of n, n+1 and n entries
+  static void transformLine(double*, int, double, int*, double*, double*);
+  // mark region from labels, or from bits if not NULL
+  void build(vtkImageData*, const int*, const unsigned char*, int, const unsigned char*, bool);
+public:
+  // mark region from breast voxels in boundBox, inside is true if labels
+  // lists the region labels and false if it lists the labels outside it
+  void build(vtkImageData*, const int*, const unsigned char*, int, bool);
+  // mark region from one bit per breast voxel of boundBox, x fastest, bit
+  // n&7 of byte n>>3 for voxel n, set for region voxels
+  void build(vtkImageData*, const int*, const unsigned char*);
+  // voxels within radius of point have left the region
+  void addHole(const double*, double);
+  // lower bound on distance from point to outside of region, negative if
+  // unknown
+  double clearance(const double*);
+  // number of steps of given length from point along any direction that
+  // certainly stay in the region, the point itself included, so a ray
+  // march can skip that many voxel lookups
+  int freeSteps(const double*, double);
+  // true if voxel containing point is certainly outside region
+  bool outside(const double*);
+  // constructor spans box from startPos to endPos with nCell cells
+  roiMask(const double*, const double*, const unsigned int*);
+  // destructor
+  ~roiMask();
+};
+
+#endif /* ROIMASK_HXX_ */
@@ -0,0 +1,142 @@
+/*! \file seedGrid.cxx
+ *  \brief breastPhantom seedGrid
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "seedGrid.hxx"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+seedGrid::seedGrid(vtkPoints* pts, double size){
+
+  numSeeds = pts->GetNumberOfPoints();
+  pos = new double[3*(numSeeds > 0 ? numSeeds : 1)];
+  cellSize = (size > 0.0) ? size : 1.0;
+
+  double lo[3] = {0.0, 0.0, 0.0};
+  double hi[3] = {0.0, 0.0, 0.0};
+  for(vtkIdType n=0; n<numSeeds; n++){
+    pts->GetPoint(n, &pos[3*n]);
+    for(int m=0; m<3; m++){
+      if(n == 0 || pos[3*n+m] < lo[m]){
+	lo[m] = pos[3*n+m];
+      }
+      if(n == 0 || pos[3*n+m] > hi[m]){
+	hi[m] = pos[3*n+m];
+      }
+    }
+  }
+
+  vtkIdType numCells = 1;
+  for(int m=0; m<3; m++){
+    origin[m] = lo[m];
+    dim[m] = static_cast<int>(floor((hi[m]-lo[m])/cellSize)) + 1;
+    numCells *= dim[m];
+  }
+
+  // counting sort of seeds by cell, ids stay increasing within a cell
+  cellStart = new vtkIdType[numCells+1];
+  for(vtkIdType c=0; c<=numCells; c++){
+    cellStart[c] = 0;
+  }
+  vtkIdType* seedCell = new vtkIdType[numSeeds > 0 ? numSeeds : 1];
+  for(vtkIdType n=0; n<numSeeds; n++){
+    seedCell[n] = (static_cast<vtkIdType>(cellIndex(pos[3*n+2],2))*dim[1] +
+		   cellIndex(pos[3*n+1],1))*dim[0] + cellIndex(pos[3*n],0);
+    cellStart[seedCell[n]+1]++;
+  }
+  for(vtkIdType c=0; c<numCells; c++){
+    cellStart[c+1] += cellStart[c];
+  }
+  cellIds = new vtkIdType[numSeeds > 0 ? numSeeds : 1];
+  vtkIdType* fill = new vtkIdType[numCells];
+  for(vtkIdType c=0; c<numCells; c++){
+    fill[c] = cellStart[c];
+  }
+  for(vtkIdType n=0; n<numSeeds; n++){
+    cellIds[fill[seedCell[n]]] = n;
+    fill[seedCell[n]]++;
+  }
+  delete[] fill;
+  delete[] seedCell;
+}
+
+seedGrid::~seedGrid(){
+  delete[] pos;
+  delete[] cellStart;
+  delete[] cellIds;
+}
+
+int seedGrid::cellIndex(double x, int m){
+  int c = static_cast<int>(floor((x-origin[m])/cellSize));
+  if(c < 0){
+    c = 0;
+  }
+  if(c >= dim[m]){
+    c = dim[m]-1;
+  }
+  return c;
+}
+
+int seedGrid::findInBox(const double* box, double radius, vtkIdType* ids){
+
+  int lo[3], hi[3];
+  for(int m=0; m<3; m++){
+    lo[m] = cellIndex(box[2*m]-radius, m);
+    hi[m] = cellIndex(box[2*m+1]+radius, m);
+  }
+
+  double r2 = radius*radius;
+  int num = 0;
+
+  for(int c=lo[2]; c<=hi[2]; c++){
+    for(int b=lo[1]; b<=hi[1]; b++){
+      for(int a=lo[0]; a<=hi[0]; a++){
+	vtkIdType cell = (static_cast<vtkIdType>(c)*dim[1] + b)*dim[0] + a;
+	for(vtkIdType n=cellStart[cell]; n<cellStart[cell+1]; n++){
+	  vtkIdType id = cellIds[n];
+	  // squared distance from seed to box
+	  double d2 = 0.0;
+	  for(int m=0; m<3; m++){
+	    double x = pos[3*id+m];
+	    if(x < box[2*m]){
+	      d2 += (box[2*m]-x)*(box[2*m]-x);
+	    } else if(x > box[2*m+1]){
+	      d2 += (x-box[2*m+1])*(x-box[2*m+1]);
+	    }
+	  }
+	  if(d2 <= r2){
+	    ids[num] = id;
+	    num++;
+	  }
+	}
+      }
+    }
+  }
+
+  // cells are visited out of id order
+  sort(ids, ids+num);
+
+  return num;
+}
+
+const double* seedGrid::getPos(vtkIdType id){
+  return &pos[3*id];
+}
+
+vtkIdType seedGrid::getNumSeeds(void){
+  return numSeeds;
+}
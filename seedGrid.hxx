@@ -0,0 +1,66 @@
+/*! \file seedGrid.hxx
+ *  \brief breastPhantom Voronoi seed hash grid header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef SEEDGRID_HXX_
+#define SEEDGRID_HXX_
+
+#ifndef __VTKPOINTS__
+#define __VTKPOINTS__
+#include <vtkPoints.h>
+#endif
+
+/**********************************************
+*
+* Uniform hash grid over Voronoi seed points
+*
+**********************************************/
+
+class seedGrid{
+  // seeds are bucketed into cubic cells, the ids of each cell are stored
+  // contiguously so a query only reads memory, it allocates nothing and
+  // may be called from any number of threads
+
+  // number of seeds
+  vtkIdType numSeeds;
+  // seed coordinates, 3 per seed
+  double* pos;
+  // corner of grid
+  double origin[3];
+  // cell edge length (mm)
+  double cellSize;
+  // number of cells in each direction
+  int dim[3];
+  // first entry of each cell in cellIds, numCells+1 entries
+  vtkIdType* cellStart;
+  // seed ids sorted by cell
+  vtkIdType* cellIds;
+  // cell index of coordinate along direction m, clamped to grid
+  int cellIndex(double, int);
+public:
+  // ids of all seeds within radius of axis aligned box {x0,x1,y0,y1,z0,z1},
+  // written in increasing order to ids which must hold getNumSeeds entries,
+  // returns number found
+  int findInBox(const double*, double, vtkIdType*);
+  // coordinates of a seed
+  const double* getPos(vtkIdType);
+  // number of seeds
+  vtkIdType getNumSeeds(void);
+  // constructor bins points using given cell edge length
+  seedGrid(vtkPoints*, double);
+  // destructor
+  ~seedGrid();
+};
+
+#endif /* SEEDGRID_HXX_ */
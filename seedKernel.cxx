@@ -0,0 +1,144 @@
+/*! \file seedKernel.cxx
+ *  \brief breastPhantom seedKernel
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "seedKernel.hxx"
+
+#include <cmath>
+
+using namespace std;
+
+seedKernel::seedKernel(int size){
+  capacity = (size > 0) ? size : 1;
+  numSeeds = 0;
+  px = new double[capacity];
+  py = new double[capacity];
+  pz = new double[capacity];
+  for(int m=0; m<9; m++){
+    w[m] = new double[capacity];
+  }
+  ids = new int[capacity];
+}
+
+seedKernel::~seedKernel(){
+  delete[] px;
+  delete[] py;
+  delete[] pz;
+  for(int m=0; m<9; m++){
+    delete[] w[m];
+  }
+  delete[] ids;
+}
+
+int seedKernel::add(int id, const double* pos, const vtkVector3d* axis, const double* scale, double g){
+
+  int n = numSeeds;
+  px[n] = pos[0];
+  py[n] = pos[1];
+  pz[n] = pos[2];
+  for(int m=0; m<3; m++){
+    double weight = sqrt(scale[m]/g);
+    for(int c=0; c<3; c++){
+      w[3*m+c][n] = weight*axis[m][c];
+    }
+  }
+  ids[n] = id;
+  numSeeds++;
+  return n;
+}
+
+void seedKernel::append(const seedKernel& src, const vtkIdType* slots, int num){
+
+  for(int s=0; s<num; s++){
+    int from = static_cast<int>(slots[s]);
+    int n = numSeeds + s;
+    px[n] = src.px[from];
+    py[n] = src.py[from];
+    pz[n] = src.pz[from];
+    for(int m=0; m<9; m++){
+      w[m][n] = src.w[m][from];
+    }
+    ids[n] = src.ids[from];
+  }
+  numSeeds += num;
+}
+
+void seedKernel::appendRange(const seedKernel& src, int first, int num){
+
+  for(int s=0; s<num; s++){
+    int from = first + s;
+    int n = numSeeds + s;
+    px[n] = src.px[from];
+    py[n] = src.py[from];
+    pz[n] = src.pz[from];
+    for(int m=0; m<9; m++){
+      w[m][n] = src.w[m][from];
+    }
+    ids[n] = src.ids[from];
+  }
+  numSeeds += num;
+}
+
+void seedKernel::clear(void){
+  numSeeds = 0;
+}
+
+int seedKernel::getNumSeeds(void){
+  return numSeeds;
+}
+
+int seedKernel::getId(int slot){
+  return ids[slot];
+}
+
+void seedKernel::distances(const double* x, double* dist, double* eucl2){
+
+  const double* w0 = w[0];
+  const double* w1 = w[1];
+  const double* w2 = w[2];
+  const double* w3 = w[3];
+  const double* w4 = w[4];
+  const double* w5 = w[5];
+  const double* w6 = w[6];
+  const double* w7 = w[7];
+  const double* w8 = w[8];
+
+#pragma omp simd
+  for(int n=0; n<numSeeds; n++){
+    double rx = x[0]-px[n];
+    double ry = x[1]-py[n];
+    double rz = x[2]-pz[n];
+    double l0 = w0[n]*rx + w1[n]*ry + w2[n]*rz;
+    double l1 = w3[n]*rx + w4[n]*ry + w5[n]*rz;
+    double l2 = w6[n]*rx + w7[n]*ry + w8[n]*rz;
+    dist[n] = l0*l0 + l1*l1 + l2*l2;
+    eucl2[n] = rx*rx + ry*ry + rz*rz;
+  }
+}
+
+void seedKernel::nearest(const double* dist, int num, int* first, int* second){
+
+  int best = -1;
+  int next = -1;
+  for(int n=0; n<num; n++){
+    if(best == -1 || dist[n] < dist[best]){
+      next = best;
+      best = n;
+    } else if(next == -1 || dist[n] < dist[next]){
+      next = n;
+    }
+  }
+  *first = best;
+  *second = next;
+}
@@ -0,0 +1,71 @@
+/*! \file seedKernel.hxx
+ *  \brief breastPhantom compartment seed distance kernel header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef SEEDKERNEL_HXX_
+#define SEEDKERNEL_HXX_
+
+#ifndef __VTKVECTOR__
+#define __VTKVECTOR__
+#include <vtkVector.h>
+#endif
+
+/**********************************************
+*
+* Structure of arrays anisotropic seed distance
+*
+**********************************************/
+
+class seedKernel{
+  // compartment distance is sum_m scale[m]/g*(axis[m].(x-pos))^2, the
+  // axes are stored premultiplied by sqrt(scale[m]/g) so a distance is
+  // three dot products, each coordinate is its own contiguous array so
+  // the loop over seeds vectorizes
+
+  // number of slots
+  int capacity;
+  // number of slots in use
+  int numSeeds;
+  // seed position
+  double* px;
+  double* py;
+  double* pz;
+  // weighted axes, row m column c is w[3*m+c]
+  double* w[9];
+  // caller defined id of each slot
+  int* ids;
+public:
+  // store seed in next slot, returns slot
+  int add(int, const double*, const vtkVector3d*, const double*, double);
+  // append slots of another kernel
+  void append(const seedKernel&, const vtkIdType*, int);
+  // append a range of slots of another kernel
+  void appendRange(const seedKernel&, int, int);
+  // drop all slots
+  void clear(void);
+  // number of slots in use
+  int getNumSeeds(void);
+  // caller id of slot
+  int getId(int);
+  // noise free distance and squared euclidean distance of point to every slot
+  void distances(const double*, double*, double*);
+  // slots with smallest and second smallest of num distances, -1 if none
+  static void nearest(const double*, int, int*, int*);
+  // constructor with maximum number of seeds
+  seedKernel(int);
+  // destructor
+  ~seedKernel();
+};
+
+#endif /* SEEDKERNEL_HXX_ */
@@ -0,0 +1,211 @@
+/*! \file stageCache.cxx
+ *  \brief breastPhantom stageCache
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "stageCache.hxx"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <typeinfo>
+#include <unistd.h>
+
+using namespace std;
+
+// file signature, bump when the layout written by breastPhantom changes
+static const char cacheMagic[8] = {'B','P','S','T','A','G','E','1'};
+
+stageCache::stageCache(const std::string& cacheDir){
+  dir = cacheDir;
+  file = NULL;
+  writing = false;
+  good = true;
+}
+
+stageCache::~stageCache(){
+  if(file != NULL){
+    gzclose(file);
+    if(writing){
+      remove(tmpName.c_str());
+    }
+  }
+}
+
+void stageCache::addKey(const std::string& name, const std::string& value){
+  key += name + "=" + value + "\n";
+}
+
+void stageCache::addOption(const std::string& name, const boost::any& value){
+  ostringstream text;
+  text.precision(17);
+  if(value.type() == typeid(double)){
+    text << boost::any_cast<double>(value);
+  } else if(value.type() == typeid(int)){
+    text << boost::any_cast<int>(value);
+  } else if(value.type() == typeid(unsigned int)){
+    text << boost::any_cast<unsigned int>(value);
+  } else if(value.type() == typeid(bool)){
+    text << boost::any_cast<bool>(value);
+  } else if(value.type() == typeid(std::string)){
+    text << boost::any_cast<std::string>(value);
+  } else {
+    // unknown type, never match
+    text << "?" << this;
+  }
+  addKey(name, text.str());
+}
+
+std::string stageCache::getFilename(void){
+  // 64 bit FNV-1a hash of key, stable across builds
+  unsigned long long int hash = 14695981039346656037ULL;
+  for(size_t i=0; i<key.size(); i++){
+    hash ^= (unsigned char)key[i];
+    hash *= 1099511628211ULL;
+  }
+  char name[32];
+  sprintf(name, "/c_%016llx.cache", hash);
+  return dir + name;
+}
+
+bool stageCache::openRead(void){
+  std::string name = getFilename();
+  if(access(name.c_str(), R_OK)){
+    return false;
+  }
+  file = gzopen(name.c_str(), "rb");
+  if(file == NULL){
+    return false;
+  }
+  writing = false;
+  good = true;
+
+  // compare signature and full key
+  char magic[8];
+  unsigned long long int keyLen = 0;
+  read(magic, sizeof(magic));
+  read(&keyLen, sizeof(keyLen));
+  if(!good || memcmp(magic, cacheMagic, sizeof(magic)) || keyLen != key.size()){
+    gzclose(file);
+    file = NULL;
+    return false;
+  }
+  std::string fileKey(keyLen, '\0');
+  read(&fileKey[0], keyLen);
+  if(!good || fileKey != key){
+    gzclose(file);
+    file = NULL;
+    return false;
+  }
+  return true;
+}
+
+bool stageCache::openWrite(void){
+  ostringstream name;
+  name << getFilename() << "." << getpid();
+  tmpName = name.str();
+  // labels compress well, favour speed
+  file = gzopen(tmpName.c_str(), "wb1");
+  if(file == NULL){
+    return false;
+  }
+  writing = true;
+  good = true;
+
+  unsigned long long int keyLen = key.size();
+  write(cacheMagic, sizeof(cacheMagic));
+  write(&keyLen, sizeof(keyLen));
+  write(key.data(), keyLen);
+  return good;
+}
+
+void stageCache::write(const void* data, size_t len){
+  const char* p = static_cast<const char*>(data);
+  while(good && len > 0){
+    unsigned int chunk = (len > (1u << 30)) ? (1u << 30) : (unsigned int)len;
+    if(gzwrite(file, p, chunk) != (int)chunk){
+      good = false;
+    }
+    p += chunk;
+    len -= chunk;
+  }
+}
+
+void stageCache::read(void* data, size_t len){
+  char* p = static_cast<char*>(data);
+  while(good && len > 0){
+    unsigned int chunk = (len > (1u << 30)) ? (1u << 30) : (unsigned int)len;
+    if(gzread(file, p, chunk) != (int)chunk){
+      good = false;
+    }
+    p += chunk;
+    len -= chunk;
+  }
+}
+
+void stageCache::writeVolume(vtkImageData* img){
+  int dim[3];
+  img->GetDimensions(dim);
+  write(dim, sizeof(dim));
+  size_t sliceLen = (size_t)dim[0]*dim[1];
+  for(int k=0; k<dim[2]; k++){
+    write(img->GetScalarPointer(0,0,k), sliceLen);
+  }
+}
+
+void stageCache::readVolume(vtkImageData* img){
+  int dim[3];
+  int fileDim[3];
+  img->GetDimensions(dim);
+  read(fileDim, sizeof(fileDim));
+  if(fileDim[0] != dim[0] || fileDim[1] != dim[1] || fileDim[2] != dim[2]){
+    good = false;
+  }
+  if(!good){
+    return;
+  }
+
+  unsigned char* slice = new unsigned char[(size_t)dim[0]*dim[1]];
+  for(int k=0; k<dim[2] && good; k++){
+    read(slice, (size_t)dim[0]*dim[1]);
+    for(int j=0; j<dim[1]; j++){
+      unsigned char* row = &slice[(size_t)j*dim[0]];
+      bool used = false;
+      for(int i=0; i<dim[0] && !used; i++){
+	used = (row[i] != 0);
+      }
+      if(used){
+	memcpy(img->GetScalarPointer(0,j,k), row, dim[0]);
+      }
+    }
+  }
+  delete[] slice;
+}
+
+bool stageCache::close(void){
+  if(file == NULL){
+    return false;
+  }
+  if(gzclose(file) != Z_OK){
+    good = false;
+  }
+  file = NULL;
+  if(writing){
+    writing = false;
+    if(!good || rename(tmpName.c_str(), getFilename().c_str())){
+      remove(tmpName.c_str());
+      good = false;
+    }
+  }
+  return good;
+}
@@ -0,0 +1,82 @@
+/*! \file stageCache.hxx
+ *  \brief breastPhantom intermediate stage cache header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef STAGECACHE_HXX_
+#define STAGECACHE_HXX_
+
+#include <string>
+#include <zlib.h>
+#include <boost/any.hpp>
+
+#ifndef __VTKIMAGEDATA__
+#define __VTKIMAGEDATA__
+#include <vtkImageData.h>
+#endif
+
+/**********************************************
+*
+* Gzipped cache of the phantom state after a stage
+*
+**********************************************/
+
+class stageCache{
+  // the file name is a hash of a key text listing every option and seed
+  // the stage depends on, the full key is stored in the file and compared
+  // on open so a hash collision is a miss
+  // entries are written to a temporary file renamed into place on close,
+  // so concurrent runs never read a partial entry
+
+  // cache directory
+  std::string dir;
+  // key text
+  std::string key;
+  // open cache file, NULL if none
+  gzFile file;
+  // name of entry being written
+  std::string tmpName;
+  // true while an entry is being written
+  bool writing;
+  // true if every read and write so far succeeded
+  bool good;
+public:
+  // add a named value to the key
+  void addKey(const std::string&, const std::string&);
+  // add a configuration option to the key, value is rendered as text
+  void addOption(const std::string&, const boost::any&);
+  // name of cache entry for current key
+  std::string getFilename(void);
+  // open entry with current key for reading, false if there is none
+  bool openRead(void);
+  // start writing entry with current key, false on failure
+  bool openWrite(void);
+  // append bytes to entry being written
+  void write(const void*, size_t);
+  // read bytes from open entry
+  void read(void*, size_t);
+  // append all voxel labels of image slice by slice
+  void writeVolume(vtkImageData*);
+  // read voxel labels into image, rows holding only background are
+  // skipped so sparse storage stays sparse
+  void readVolume(vtkImageData*);
+  // close entry, a written entry is moved into place, returns false if any
+  // read or write failed
+  bool close(void);
+  // constructor
+  stageCache(const std::string&);
+  // destructor discards an unfinished entry
+  ~stageCache();
+};
+
+#endif /* STAGECACHE_HXX_ */
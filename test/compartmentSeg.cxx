@@ -0,0 +1,235 @@
+/*! \file compartmentSeg.cxx
+ *  \brief breastPhantom test of hierarchical compartment segmentation
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "../compartmentSeg.hxx"
+
+#include <iostream>
+#include <vtkSmartPointer.h>
+#include <vtkPoints.h>
+#include <vtkVersion.h>
+
+using namespace std;
+namespace po = boost::program_options;
+
+/* Fat seeds with a search radius shorter than the refinement block
+ * diagonal and noisy glandular compartments segment a small volume block
+ * by block. Every voxel must get the label of its closest seed found by
+ * brute force, voxels not holding the inner value must be left alone and
+ * the label bounding boxes must match the voxels written. */
+
+int main(){
+
+  // options of the default configuration the boundary noise reads
+  po::options_description opt;
+  opt.add_options()
+    ("boundary.frequency",po::value<double>()->default_value(0.15),"")
+    ("boundary.lacunarity",po::value<double>()->default_value(1.5),"")
+    ("boundary.persistence",po::value<double>()->default_value(0.5),"")
+    ("perlin.numOctaves",po::value<int>()->default_value(6),"")
+    ("perlin.xNoiseGen",po::value<int>()->default_value(683),"")
+    ("perlin.yNoiseGen",po::value<int>()->default_value(4933),"")
+    ("perlin.zNoiseGen",po::value<int>()->default_value(23),"")
+    ("perlin.seedNoiseGen",po::value<int>()->default_value(3095),"")
+    ("perlin.shiftNoiseGen",po::value<int>()->default_value(11),"");
+  const char* args[1] = {"compartmentSeg"};
+  po::variables_map vm;
+  po::store(po::parse_command_line(1, args, opt), vm);
+  po::notify(vm);
+
+  const unsigned char innerVal = 200;
+  const unsigned char skinVal = 2;
+  const unsigned char fatVal = 1;
+
+  // 12 mm cube at 0.25 mm in a skin shell
+  const int n = 48;
+  const double imgRes = 0.25;
+  double origin[3] = {-6.0, -6.0, -6.0};
+  vtkSmartPointer<vtkImageData> breast =
+    vtkSmartPointer<vtkImageData>::New();
+  breast->SetExtent(0, n-1, 0, n-1, 0, n-1);
+  breast->SetOrigin(origin);
+  breast->SetSpacing(imgRes, imgRes, imgRes);
+#if VTK_MAJOR_VERSION <= 5
+  breast->SetNumberOfScalarComponents(1);
+  breast->SetScalarTypeToUnsignedChar();
+  breast->AllocateScalars();
+#else
+  breast->AllocateScalars(VTK_UNSIGNED_CHAR,1);
+#endif
+
+  for(int c=0; c<n; c++){
+    for(int b=0; b<n; b++){
+      for(int a=0; a<n; a++){
+	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
+	if(a == 0 || b == 0 || c == 0 || a == n-1 || b == n-1 || c == n-1){
+	  p[0] = skinVal;
+	} else {
+	  p[0] = innerVal;
+	}
+      }
+    }
+  }
+
+  boost::mt19937 rgen(2018);
+  boost::uniform_01<boost::mt19937> u01(rgen);
+
+  // fat seeds scattered over the cube, isotropic
+  const int numFatSeeds = 24;
+  const int numGlandSeeds = 3;
+  const int numAllSeeds = numFatSeeds + numGlandSeeds;
+  breastComp comps[numAllSeeds];
+  vtkSmartPointer<vtkPoints> seeds = vtkSmartPointer<vtkPoints>::New();
+  for(int s=0; s<numFatSeeds; s++){
+    for(int m=0; m<3; m++){
+      comps[s].pos[m] = -6.0 + 12.0*u01();
+      comps[s].scale[m] = 1.0;
+      comps[s].axis[m] = vtkVector3d(m==0 ? 1.0 : 0.0, m==1 ? 1.0 : 0.0, m==2 ? 1.0 : 0.0);
+    }
+    comps[s].g = 1.0 + u01();
+    seeds->InsertNextPoint(comps[s].pos);
+  }
+
+  // glandular compartments, stretched and rotated about z
+  for(int s=numFatSeeds; s<numAllSeeds; s++){
+    double angle = 6.283185307179586*u01();
+    comps[s].axis[0] = vtkVector3d(cos(angle), sin(angle), 0.0);
+    comps[s].axis[1] = vtkVector3d(-sin(angle), cos(angle), 0.0);
+    comps[s].axis[2] = vtkVector3d(0.0, 0.0, 1.0);
+    for(int m=0; m<3; m++){
+      comps[s].pos[m] = -4.0 + 8.0*u01();
+      comps[s].scale[m] = 1.0 + 2.0*u01();
+    }
+    comps[s].g = 1.0;
+  }
+
+  double seedLip[numAllSeeds];
+  unsigned char seedLabel[numAllSeeds];
+  seedKernel allSeeds(numAllSeeds);
+  for(int s=0; s<numAllSeeds; s++){
+    double maxScale = comps[s].scale[0];
+    for(int m=1; m<3; m++){
+      if(comps[s].scale[m] > maxScale){
+	maxScale = comps[s].scale[m];
+      }
+    }
+    seedLip[s] = sqrt(maxScale/comps[s].g);
+    seedLabel[s] = (s < numFatSeeds) ? fatVal : 10+s-numFatSeeds;
+    allSeeds.add(s, comps[s].pos, comps[s].axis, comps[s].scale, comps[s].g);
+  }
+
+  perlinNoise* boundary = static_cast<perlinNoise*>(::operator new(sizeof(perlinNoise)*numGlandSeeds));
+  for(int g=0; g<numGlandSeeds; g++){
+    new(&boundary[g]) perlinNoise(vm, 1000+g, "boundary");
+  }
+
+  // search radius well below the block diagonal so boxes straddle it
+  double radius = 2.5;
+  double boundaryDev = 0.1;
+  seedGrid findSeed(seeds, radius/4.0);
+
+  tissueHistogram histogram;
+  histogram.set(innerVal, (long long int)(n-2)*(n-2)*(n-2));
+
+  int labelBox[256][6];
+  for(int l=0; l<256; l++){
+    for(int m=0; m<3; m++){
+      labelBox[l][2*m] = n+1;
+      labelBox[l][2*m+1] = -1;
+    }
+  }
+
+  compartmentSeg seg(&findSeed, &allSeeds, numFatSeeds, numGlandSeeds, seedLip, seedLabel,
+		     &comps[numFatSeeds], boundary, boundaryDev, radius, origin, imgRes);
+
+  // uneven blocks so boxes split unevenly and the last ones are clipped
+  const int blockVox = 7;
+  for(int kb=0; kb<n; kb+=blockVox){
+    for(int jb=0; jb<n; jb+=blockVox){
+      for(int ib=0; ib<n; ib+=blockVox){
+	int block[6] = {ib, ib+blockVox-1, jb, jb+blockVox-1, kb, kb+blockVox-1};
+	for(int m=0; m<3; m++){
+	  if(block[2*m+1] >= n){
+	    block[2*m+1] = n-1;
+	  }
+	}
+	seg.segment(breast, block, innerVal, &histogram, labelBox);
+      }
+    }
+  }
+  histogram.flush();
+
+  int fail = 0;
+  long long int numWrong = 0;
+  long long int count[256] = {0};
+  int voxBox[256][6];
+  for(int l=0; l<256; l++){
+    for(int m=0; m<3; m++){
+      voxBox[l][2*m] = n+1;
+      voxBox[l][2*m+1] = -1;
+    }
+  }
+
+  for(int c=0; c<n; c++){
+    for(int b=0; b<n; b++){
+      for(int a=0; a<n; a++){
+	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
+	int ijk[3] = {a, b, c};
+	unsigned char expect = (a == 0 || b == 0 || c == 0 || a == n-1 || b == n-1 || c == n-1) ?
+	  skinVal : seg.label(ijk);
+	if(p[0] != expect){
+	  if(numWrong < 10){
+	    cerr << "voxel " << a << "," << b << "," << c << " is " << (int)p[0]
+		 << ", closest seed gives " << (int)expect << "\n";
+	  }
+	  numWrong++;
+	}
+	count[p[0]]++;
+	for(int m=0; m<3; m++){
+	  if(ijk[m] < voxBox[p[0]][2*m]) voxBox[p[0]][2*m] = ijk[m];
+	  if(ijk[m] > voxBox[p[0]][2*m+1]) voxBox[p[0]][2*m+1] = ijk[m];
+	}
+      }
+    }
+  }
+  if(numWrong > 0){
+    cerr << numWrong << " voxels differ from closest seed labels\n";
+    fail = 1;
+  }
+
+  // statistics of every label written
+  for(int l=0; l<256; l++){
+    if(l == skinVal){
+      continue;
+    }
+    if(histogram.get(l) != count[l]){
+      cerr << "label " << l << " histogram " << histogram.get(l) << ", voxels " << count[l] << "\n";
+      fail = 1;
+    }
+    for(int m=0; m<6; m++){
+      if(labelBox[l][m] != voxBox[l][m]){
+	cerr << "label " << l << " bounding box differs from its voxels\n";
+	fail = 1;
+	break;
+      }
+    }
+  }
+
+  for(int g=0; g<numGlandSeeds; g++){
+    boundary[g].~perlinNoise();
+  }
+  ::operator delete(boundary);
+
+  return fail;
+}
@@ -0,0 +1,195 @@
+/*! \file vesselRetry.cxx
+ *  \brief breastPhantom test of a vessel child whose tries all fail
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "../artery.hxx"
+#include "../fillMap.hxx"
+#include "../roiMask.hxx"
+
+#include <vtkSmartPointer.h>
+#include <vtkVersion.h>
+
+using namespace std;
+namespace po = boost::program_options;
+
+/* An artery root grows along a line of fat through muscle. Below the root
+ * every segment end touches muscle, so both children of the root fail all
+ * ten tries. They must end where they start and draw nothing, only the root
+ * may be drawn. */
+
+int main(){
+
+  tissueStruct tissue;
+  tissue.bg = 0;
+  tissue.skin = 2;
+  tissue.nipple = 33;
+  tissue.fat = 1;
+  tissue.cooper = 88;
+  tissue.gland = 29;
+  tissue.TDLU = 95;
+  tissue.duct = 125;
+  tissue.artery = 150;
+  tissue.vein = 225;
+  tissue.muscle = 40;
+
+  // options of the default configuration the tree reads
+  po::options_description opt;
+  opt.add_options()
+    ("base.imgRes",po::value<double>()->default_value(1.0),"")
+    ("ductSeg.segFrac",po::value<double>()->default_value(0.25),"")
+    ("vesselTree.maxBranch",po::value<uint>()->default_value(100),"")
+    ("vesselTree.maxGen",po::value<uint>()->default_value(15),"")
+    ("vesselTree.baseLength",po::value<double>()->default_value(12.0),"")
+    ("vesselBr.childMinRad",po::value<double>()->default_value(0.25),"")
+    ("vesselBr.minRadFrac",po::value<double>()->default_value(0.6),"")
+    ("vesselBr.maxRadFrac",po::value<double>()->default_value(0.85),"")
+    ("vesselBr.lenShrink",po::value<double>()->default_value(0.5),"")
+    ("vesselBr.lenRange",po::value<double>()->default_value(0.1),"")
+    ("vesselBr.rotateJitter",po::value<double>()->default_value(0.1),"")
+    ("vesselSeg.radiusBetaA",po::value<double>()->default_value(2.0),"")
+    ("vesselSeg.radiusBetaB",po::value<double>()->default_value(2.0),"")
+    ("vesselSeg.maxCurvRad",po::value<double>()->default_value(20.0),"")
+    ("vesselSeg.maxCurvFrac",po::value<double>()->default_value(0.33),"")
+    ("vesselSeg.minEndRad",po::value<double>()->default_value(0.85),"")
+    ("vesselSeg.maxEndRad",po::value<double>()->default_value(1.05),"")
+    ("vesselSeg.angleWt",po::value<double>()->default_value(1.0),"")
+    ("vesselSeg.densityWt",po::value<double>()->default_value(5e-5),"")
+    ("vesselSeg.dirWt",po::value<double>()->default_value(5e-5),"")
+    ("vesselSeg.numTry",po::value<uint>()->default_value(10),"")
+    ("vesselSeg.thinFrac",po::value<double>()->default_value(0.0),"")
+    ("vesselSeg.maxTry",po::value<uint>()->default_value(100),"")
+    ("vesselSeg.absMaxTry",po::value<uint>()->default_value(10000),"")
+    ("vesselSeg.roiStep",po::value<double>()->default_value(0.1),"");
+  const char* args[1] = {"vesselRetry"};
+  po::variables_map vm;
+  po::store(po::parse_command_line(1, args, opt), vm);
+  po::notify(vm);
+
+  // 81 mm cube of muscle in a skin shell, a line of fat along y
+  const int n = 81;
+  vtkSmartPointer<vtkImageData> breast =
+    vtkSmartPointer<vtkImageData>::New();
+  breast->SetExtent(0, n-1, 0, n-1, 0, n-1);
+  breast->SetOrigin(-40.0, -40.0, -40.0);
+  breast->SetSpacing(1.0, 1.0, 1.0);
+#if VTK_MAJOR_VERSION <= 5
+  breast->SetNumberOfScalarComponents(1);
+  breast->SetScalarTypeToUnsignedChar();
+  breast->AllocateScalars();
+#else
+  breast->AllocateScalars(VTK_UNSIGNED_CHAR,1);
+#endif
+
+  const int lineX = 60;
+  const int lineZ = 40;
+  for(int c=0; c<n; c++){
+    for(int b=0; b<n; b++){
+      for(int a=0; a<n; a++){
+	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
+	if(a == 0 || b == 0 || c == 0 || a == n-1 || b == n-1 || c == n-1){
+	  p[0] = tissue.skin;
+	} else if(a == lineX && c == lineZ && b >= 5 && b <= n-6){
+	  p[0] = tissue.fat;
+	} else {
+	  p[0] = tissue.muscle;
+	}
+      }
+    }
+  }
+
+  tissueHistogram histogram;
+
+  int boundBox[6] = {1, n-2, 1, n-2, 1, n-2};
+  double boxStart[3];
+  double boxEnd[3];
+  int startInd[3] = {boundBox[0], boundBox[2], boundBox[4]};
+  int endInd[3] = {boundBox[1], boundBox[3], boundBox[5]};
+  breast->GetPoint(breast->ComputePointId(startInd), boxStart);
+  breast->GetPoint(breast->ComputePointId(endInd), boxEnd);
+
+  unsigned int nCell[3] = {20, 20, 20};
+  roiMask skin(boxStart, boxEnd, nCell);
+  unsigned char outside[2] = {tissue.skin, tissue.bg};
+  skin.build(breast, boundBox, outside, 2, false);
+
+  // root starts on the fat line heading along it
+  double spos[3] = {20.0, -25.0, 0.0};
+  double sdir[3] = {0.0, 1.0, 0.0};
+  double nipplePos[3] = {20.0, 40.0, 0.0};
+  double srad = 2.0;
+
+  fillMap fill(boxStart, boxEnd, nCell);
+  fill.build(breast, spos, outside, 2, false);
+
+  arteryTreeInit treeInit = arteryTreeInit();
+  treeInit.seed = 12345;
+  for(int i=0; i<3; i++){
+    treeInit.startPos[i] = boxStart[i];
+    treeInit.endPos[i] = boxEnd[i];
+    treeInit.nipplePos[i] = nipplePos[i];
+  }
+  treeInit.nVox[0] = boundBox[1]-boundBox[0];
+  treeInit.nVox[1] = boundBox[3]-boundBox[2];
+  treeInit.nVox[2] = boundBox[5]-boundBox[4];
+  treeInit.boundBox = boundBox;
+  treeInit.tissue = &tissue;
+  treeInit.histogram = &histogram;
+  treeInit.breast = breast;
+  treeInit.roi = &skin;
+  treeInit.fill = &fill;
+
+  arteryTree myTree(vm, &treeInit);
+  myTree.head = new(myTree.brPool.alloc()) arteryBr(spos, sdir, srad, &myTree);
+  myTree.grow();
+
+  int fail = 0;
+
+  // the root and its two children, the children grew nothing of their own
+  if(myTree.numBranch != 3){
+    cerr << "expected 3 branches, got " << myTree.numBranch << "\n";
+    fail = 1;
+  }
+
+  // artery voxels only where the root can reach, its length is at most
+  // 13.2 mm and its radius 2.1 mm
+  double reach = 12.0*1.1 + srad*1.05 + sqrt(3.0);
+  long long int numArtery = 0;
+  for(int c=0; c<n; c++){
+    for(int b=0; b<n; b++){
+      for(int a=0; a<n; a++){
+	unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(a,b,c));
+	if(p[0] == tissue.artery){
+	  numArtery++;
+	  double pos[3];
+	  int ijk[3] = {a, b, c};
+	  breast->GetPoint(breast->ComputePointId(ijk), pos);
+	  double d = 0.0;
+	  for(int i=0; i<3; i++){
+	    d += (pos[i]-spos[i])*(pos[i]-spos[i]);
+	  }
+	  if(sqrt(d) > reach){
+	    cerr << "artery voxel " << a << "," << b << "," << c << " out of reach of the root\n";
+	    fail = 1;
+	  }
+	}
+      }
+    }
+  }
+  if(numArtery == 0){
+    cerr << "root was not drawn\n";
+    fail = 1;
+  }
+
+  return fail;
+}
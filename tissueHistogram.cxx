@@ -0,0 +1,105 @@
+/*! \file tissueHistogram.cxx
+ *  \brief breastPhantom tissueHistogram
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#include "tissueHistogram.hxx"
+
+#include <cstddef>
+
+using namespace std;
+
+// slots are tied to threads rather than omp_get_thread_num, which is not
+// unique when a nested region runs inside an outer parallel loop
+static int mySlot = -1;
+#pragma omp threadprivate(mySlot)
+static int nextSlot = 0;
+
+int tissueHistogram::threadSlot(void){
+  if(mySlot == -1){
+    int s;
+#pragma omp atomic capture
+    s = nextSlot++;
+    mySlot = s;
+  }
+  return mySlot;
+}
+
+tissueHistogram::tissueHistogram(){
+  // room for nested teams, threads beyond this fall back to atomics
+  numSlots = 4*omp_get_max_threads();
+  pending = new long long int[256*static_cast<size_t>(numSlots)];
+  for(size_t n=0; n<256*static_cast<size_t>(numSlots); n++){
+    pending[n] = 0;
+  }
+  for(int l=0; l<256; l++){
+    total[l] = 0;
+  }
+}
+
+tissueHistogram::~tissueHistogram(){
+  delete[] pending;
+}
+
+void tissueHistogram::add(unsigned char label, long long int n){
+  int s = threadSlot();
+  if(s < numSlots){
+    pending[256*static_cast<size_t>(s)+label] += n;
+  } else {
+#pragma omp atomic
+    total[label] += n;
+  }
+}
+
+void tissueHistogram::move(unsigned char from, unsigned char to){
+  if(from != to){
+    int s = threadSlot();
+    if(s < numSlots){
+      long long int* row = &pending[256*static_cast<size_t>(s)];
+      row[from] -= 1;
+      row[to] += 1;
+    } else {
+#pragma omp atomic
+      total[from] -= 1;
+#pragma omp atomic
+      total[to] += 1;
+    }
+  }
+}
+
+void tissueHistogram::flush(void){
+  for(int s=0; s<numSlots; s++){
+    long long int* row = &pending[256*static_cast<size_t>(s)];
+    for(int l=0; l<256; l++){
+      total[l] += row[l];
+      row[l] = 0;
+    }
+  }
+}
+
+long long int tissueHistogram::get(unsigned char label){
+  return total[label];
+}
+
+void tissueHistogram::set(unsigned char label, long long int n){
+  total[label] = n;
+}
+
+void tissueHistogram::clear(void){
+  for(int l=0; l<256; l++){
+    total[l] = 0;
+  }
+  for(size_t n=0; n<256*static_cast<size_t>(numSlots); n++){
+    pending[n] = 0;
+  }
+}
@@ -0,0 +1,62 @@
+/*! \file tissueHistogram.hxx
+ *  \brief breastPhantom tissue histogram header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ *
+ */
+
+#ifndef TISSUEHISTOGRAM_HXX_
+#define TISSUEHISTOGRAM_HXX_
+
+#ifndef __OMP__
+#define __OMP__
+#include <omp.h>
+#endif
+
+/**********************************************
+*
+* Voxel count of every label in the volume
+*
+**********************************************/
+
+class tissueHistogram{
+  // writers record label changes in a private row per thread, rows are
+  // summed into the totals by flush once the parallel loop is done, so no
+  // counter is shared between threads while voxels are written
+
+  // flushed voxel count of each label
+  long long int total[256];
+  // pending changes, 256 per thread slot
+  long long int* pending;
+  // number of thread slots
+  int numSlots;
+  // slot of calling thread, fixed on first use
+  static int threadSlot(void);
+public:
+  // add n voxels of a label, n may be negative
+  void add(unsigned char, long long int);
+  // record one voxel changing label, no-op if labels are equal
+  void move(unsigned char, unsigned char);
+  // fold pending changes of all threads into totals, call outside parallel regions
+  void flush(void);
+  // flushed voxel count of a label
+  long long int get(unsigned char);
+  // overwrite count of a label
+  void set(unsigned char, long long int);
+  // zero all counts
+  void clear(void);
+  // constructor
+  tissueHistogram();
+  // destructor
+  ~tissueHistogram();
+};
+
+#endif /* TISSUEHISTOGRAM_HXX_ */
@@ -0,0 +1,33 @@
+/*! \file vessel.cxx
+ *  \brief breastPhantom duct and vessel trees
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *  
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ * 
+ */
+
+#include "vessel.hxx"
+
+using namespace std;
+
+void bloodPolicy::fov(vtkImageData* breast, double* breastFOV){
+  double breastOrigin[3];
+  double breastSpacing[3];
+  int breastExtent[6];
+
+  breast->GetOrigin(breastOrigin);
+  breast->GetSpacing(breastSpacing);
+  breast->GetExtent(breastExtent);
+
+  for(int i=0; i<3; i++){
+    breastFOV[2*i] = breastOrigin[i]+(double)breastExtent[2*i]*breastSpacing[i]-breastSpacing[i]/2.0;
+    breastFOV[2*i+1] = breastOrigin[i]+(double)breastExtent[2*i+1]*breastSpacing[i]+breastSpacing[i]/2.0;
+  }
+}
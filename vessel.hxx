@@ -0,0 +1,447 @@
+/*! \file vessel.hxx
+ *  \brief breastPhantom duct and vessel tree header file
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *  
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ * 
+ */
+
+#ifndef VESSEL_HXX_
+#define VESSEL_HXX_
+
+#ifndef __CMATH__
+#define __CMATH__
+#include <cmath>
+#endif
+
+#ifndef __OMP__
+#define __OMP__
+#include <omp.h>
+#endif
+
+#ifndef __ALGORITHM__
+#define __ALGORITHM__
+#include <algorithm>
+#endif
+
+#ifndef __VTKIMAGEDATA__
+#define __VTKIMAGEDATA__
+#include <vtkImageData.h>
+#endif
+
+#ifndef __VTKPOINTS__
+#define __VTKPOINTS__
+#include <vtkPoints.h>
+#endif
+
+#ifndef __VTKDOUBLEARRAY__
+#define __VTKDOUBLEARRAY__
+#include <vtkDoubleArray.h>
+#endif
+
+#ifndef __VTKMATH__
+#define __VTKMATH__
+#include <vtkMath.h>
+#endif
+
+#ifndef __BOOST__
+#define __BOOST__
+#include <boost/random.hpp>
+#include <boost/math/distributions/beta.hpp>
+#include <boost/program_options.hpp>
+#endif
+
+#ifndef __TISSUESTRUCT__
+#define __TISSUESTRUCT__
+#include "tissueStruct.hxx"
+#endif
+
+#include "tissueHistogram.hxx"
+#include "fillMap.hxx"
+#include "nodePool.hxx"
+#include "betaTable.hxx"
+#include "arcTube.hxx"
+#include "roiMask.hxx"
+
+// forward declaration
+template <class P> class vesselSeg;
+template <class P> class vesselBr;
+
+/**********************************************
+*
+* structure for vesselTree initialization
+*
+**********************************************/
+struct vesselTreeInit{
+  // random number generator seed
+  int seed;
+  // pointer to bound box
+  int *boundBox;
+  // compartment id
+  unsigned char compartmentId;
+  // tissue values
+  tissueStruct* tissue;
+  // label histogram of breast
+  tissueHistogram* histogram;
+  // FOV
+  double startPos[3];
+  double endPos[3];
+  // preferential direction of growth (same as startDir)
+  double prefDir[3];
+  // nipple position, vessels grow towards it
+  double nipplePos[3];
+  // size of arrays
+  unsigned int nVox[3];
+  // pointer to breast
+  vtkImageData* breast;
+  // distance to boundary of roi
+  roiMask* roi;
+  // fill map of the tree or network
+  fillMap* fill;
+  // pointer to TDLU locations
+  vtkPoints* TDLUloc;
+  // pointer to TDLU attributes
+  vtkDoubleArray* TDLUattr;
+};
+
+
+/**********************************************
+*
+* Class for a duct or vessel tree
+*
+**********************************************/
+
+template <class P>
+class vesselTree {
+  // ducts, arteries and veins grow the same way, the policy P gives what
+  // differs through static members
+  //   bool rounds
+  //     grow a segment of every branch per round from per branch random
+  //     streams, else grow each branch fully from the tree stream and
+  //     retry failed child branches
+  //   const char* treeGroup(), brGroup(), segGroup()
+  //     option groups the parameters are read from
+  //   struct data, void readData(const variables_map&, data*)
+  //     options only the policy uses, read once per tree
+  //   unsigned char label(const tissueStruct*)
+  //     label written for tree voxels
+  //   int keep(const tissueStruct*, unsigned char*)
+  //     fills at most 4 labels the tree never overwrites, returns their number
+  //   int regionLabels(const tissueStruct*, unsigned char*)
+  //     fills at most 4 labels that join the compartment in the region,
+  //     returns their number
+  //   void fov(vtkImageData*, double*)
+  //     box segments must stay in
+  //   double maxCurv(double, unsigned int)
+  //     largest radius of curvature of a segment at a level
+  //   bool inROI(vesselTree<P>*, const double*)
+  //     true if a segment may pass the position
+  //   double cost(vesselTree<P>*, double, const double*, const double*)
+  //     cost of a segment from fill density, end position and end direction
+  //   void checkEnd(vesselTree<P>*, const double*, bool, bool, bool&, bool&)
+  //     sets failure and edge flags for a segment end, given whether the
+  //     branch is the root and the segment its first
+  //   double azimuth(vesselTree<P>*, vesselBr<P>*, double)
+  //     rotation of a second child given that of its sibling
+  //   void leaf(vesselTree<P>*, vesselBr<P>*, const double*, const double*, double)
+  //     called for a branch without children with its end position,
+  //     direction and length
+
+  friend class vesselBr<P>;
+  friend class vesselSeg<P>;
+
+  typedef boost::mt19937 rgenType;
+  // random number generator - constructor should set seed!!
+  rgenType randGen;
+public:
+  // pointer to configuration
+  boost::program_options::variables_map opt;
+  // pointer to breast bound box
+  int *boundBox;
+  // compartment id
+  unsigned char compartmentId;
+  // tissue values
+  tissueStruct* tissue;
+  // label histogram of breast, updated for every voxel written
+  tissueHistogram* histogram;
+  // maximum number of branches
+  unsigned int maxBranch;
+  // maximum generation
+  unsigned int maxGen;
+  // base length of initial branch
+  double baseLength;
+  // branch parameters
+  double lenShrink, lenRange, childMinRad, minRadFrac, maxRadFrac, rotateJitter;
+  // segment parameters
+  double segFrac, thinRad, maxCurvRad, maxCurvFrac, roiStep;
+  double densityWt, angleWt, dirWt, minEndRad, maxEndRad;
+  unsigned int numTry, maxTry, absMaxTry;
+  // voxel size (mm)
+  double imgRes;
+  // fill map giving distance to tree in roi, may be shared by the trees
+  // of a network
+  // initial value is distance to base of tree
+  fillMap* fill;
+  // distance to boundary of roi for quick segment checks
+  roiMask* roi;
+  // voxels of the compartment and of the region labels of the policy, the
+  // nipple connectors for ducts, before any tree grew, one bit per voxel of
+  // the bound box, for policies that keep the
+  // tree in a labeled region, cleared where the tree places a TDLU, so
+  // growth never depends on voxels written by other trees
+  unsigned char* region;
+  // voxels of the compartment alone at the same time, same layout, the
+  // fill map is built from it and it is freed then
+  unsigned char* fillRegion;
+  // voxels of bound box in each direction
+  int regionDim[3];
+  // take region and fill region from current breast labels
+  void buildRegion(void);
+  // true if voxel index is in region
+  bool inRegion(const int*);
+  // remove voxel index from region
+  void clearRegion(const int*);
+  // tree count of each tree type
+  static unsigned int num;
+  // uniform [0,1) distribution
+  boost::uniform_01<rgenType> u01;
+  // inverse CDF of beta distribution for radius of curvature
+  betaTable* radiusDist;
+  // tree id number
+  unsigned int id;
+  // keep track of number of branches in tree
+  unsigned int numBranch;
+  // storage for the branches and segments of the tree
+  nodePool<vesselBr<P>> brPool;
+  nodePool<vesselSeg<P>> segPool;
+  // pointer to main branch
+  vesselBr<P>* head;
+  // pointer to breast
+  vtkImageData* breast;
+  // pointer to TDLU locations
+  vtkPoints* TDLUloc;
+  // pointer to TDLU attributes
+  vtkDoubleArray* TDLUattr;
+  // labels the tree never overwrites
+  unsigned char keep[4];
+  int numKeep;
+  // preferential growth direction
+  double prefDir[3];
+  // nipple position
+  double nipplePos[3];
+  // box segments stay in
+  double fov[6];
+  // options of the policy
+  typename P::data policyData;
+  // grow all branches from head
+  void grow(void);
+  // constructor
+  vesselTree(boost::program_options::variables_map, vesselTreeInit*);
+  // destructor
+  ~vesselTree();
+};
+
+
+
+/**********************************************
+*
+* Class for a duct or vessel branch
+*
+**********************************************/
+
+template <class P>
+class vesselBr {
+  // this is one branch of a tree
+
+  friend class vesselSeg<P>;
+  friend class vesselTree<P>;
+
+  // start and end position of branch
+  double startPos[3];
+  double endPos[3];
+  // start and end radius (mm)
+  double startRad, endRad;
+  // start and end direction (unit vector)
+  double startDir[3];
+  double endDir[3];
+  // rotation angle from parent
+  double azimuth;
+  // length of branch and current length (mm)
+  double length, curLength;
+  // pointer to first segment of branch
+  vesselSeg<P>* firstSeg;
+  // pointer to last segment of branch
+  vesselSeg<P>* lastSeg;
+  // pointer to parent branch
+  vesselBr<P>* parent;
+  // pointer to first child branch
+  vesselBr<P>* firstChild;
+  // pointer to second child branch
+  vesselBr<P>* secondChild;
+  // pointer to sibling branch
+  vesselBr<P>* sibBranch;
+  // branch id number
+  unsigned int id;
+  // number of child branches (0 or 2)
+  unsigned int nChild;
+  // pointer to tree instance
+  vesselTree<P>* myTree;
+  // level in network, 0 == main branch
+  unsigned int level;
+  // generation of branch, 0 == root
+  unsigned int gen;
+  // uniform [0,1) distribution, when growing in rounds each branch draws
+  // from its own stream seeded by its parent so branches can grow
+  // concurrently
+  boost::uniform_01<typename vesselTree<P>::rgenType> u01;
+  // last segment could not be placed
+  bool failSeg;
+  // last segment ended at ROI boundary
+  bool edgeSeg;
+  // function to set length of branch
+  double setLength(void);
+  // function to set number of children
+  unsigned int setChild(void);
+  // function to pick starting radii of child branches
+  void setRadiiThetas(double*,double*);
+  // function to pick starting direction based on parent direction
+  void setDir(double*,double);
+  // propose next segment, reads shared state only
+  void addSeg(void);
+  // add length of last segment and check its end
+  void checkSeg(void);
+  // write proposed segment to breast and fill map
+  void commitSeg(void);
+  // true while branch is shorter than its length and unblocked
+  bool growing(void);
+  // set end of branch, call leaf or create children
+  void finish(void);
+  // grow branch with given polar angle, then its children
+  void growDepth(double);
+public:
+  // uniform [0,1) draw from the stream of the branch
+  double rand(void);
+  // constructor for first branch (the root)
+  vesselBr(double*, double*, double, vesselTree<P>*);
+  // constructor for first child branch of a parent branch
+  vesselBr(vesselBr<P>*, unsigned int, unsigned int, double, double);
+  // constructor for second child branch
+  vesselBr(vesselBr<P>*, vesselBr<P>*, unsigned int, unsigned int, double, double);
+};
+
+
+/**********************************************
+*
+* Class for a segment (of a duct or vessel branch)
+*
+**********************************************/
+
+template <class P>
+class vesselSeg {
+  // this is one segment of a branch
+
+  friend class vesselBr<P>;
+  friend class vesselTree<P>;
+
+  // start and end position of segment
+  double startPos[3];
+  double endPos[3];
+  // start and end radius rate of change
+  double startDeriv, endDeriv;
+  // center of curvature
+  double centerCurv[3];
+  // start and end direction (unit vector)
+  double startDir[3];
+  double endDir[3];
+  // radius of curvature
+  double radCurv;
+  // pointer to previous segment of branch
+  vesselSeg<P>* prevSeg;
+  // pointer to owning branch
+  vesselBr<P>* myBranch;
+  // cubic spline coefficients
+  double shape[4];
+public:
+  // start and end radius (mm)
+  double startRad, endRad;
+  // length of segment (mm)
+  double length;
+  // pointer to next segment of branch
+  vesselSeg<P>* nextSeg;
+  // make a first segment - determines endPos, endRad
+  // centerCurv, length, endDir
+  void makeSeg(void);
+  // make shape
+  void setShape(void);
+  // get segment radius
+  double getRadius(double);
+  // update voxel-based map of tree - this edits breast data
+  void updateMap(void);
+  // constructor for first segment
+  vesselSeg(vesselBr<P>*);
+  // constructor for subsequent segments
+  vesselSeg(vesselSeg<P>*);
+};
+
+
+/**********************************************
+*
+* Policy hooks shared by the blood vessel networks
+*
+**********************************************/
+
+struct bloodPolicy{
+  // each branch grows fully before the next
+  static const bool rounds = false;
+  // option groups
+  static const char* treeGroup(void){
+    return "vesselTree";
+  }
+  static const char* brGroup(void){
+    return "vesselBr";
+  }
+  static const char* segGroup(void){
+    return "vesselSeg";
+  }
+  // vessels read no options of their own
+  struct data{
+  };
+  static void readData(const boost::program_options::variables_map&, data*){
+  }
+  // extent of breast widened by half a voxel
+  static void fov(vtkImageData*, double*);
+  // curvature shrinks with level
+  static double maxCurv(double maxRad, unsigned int level){
+    return maxRad/(level+1.0);
+  }
+  // anywhere but skin and background
+  template <class P>
+  static bool inROI(vesselTree<P>*, const double*);
+  // fill density, direction to nipple and room ahead before the skin
+  template <class P>
+  static double cost(vesselTree<P>*, double, const double*, const double*);
+  // fail at the breast extent, stop next to skin or background and, past
+  // the root, muscle
+  template <class P>
+  static void checkEnd(vesselTree<P>*, const double*, bool, bool, bool&, bool&);
+  // random rotation away from sibling
+  template <class P>
+  static double azimuth(vesselTree<P>*, vesselBr<P>*, double);
+  // vessels take no region
+  static int regionLabels(const tissueStruct*, unsigned char*){
+    return 0;
+  }
+  // nothing at the end of a vessel
+  template <class P>
+  static void leaf(vesselTree<P>*, vesselBr<P>*, const double*, const double*, double){
+  }
+};
+
+#endif /* VESSEL_HXX_ */
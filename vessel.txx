@@ -0,0 +1,1142 @@
+/*! \file vessel.txx
+ *  \brief breastPhantom duct and vessel tree engine definitions
+ *  \author Christian G. Graff
+ *  \version 1.0
+ *  \date 2018
+ *  
+ *  \copyright To the extent possible under law, the author(s) have
+ *  dedicated all copyright and related and neighboring rights to this
+ *  software to the public domain worldwide. This software is
+ *  distributed without any warranty.  You should have received a copy
+ *  of the CC0 Public Domain Dedication along with this software.
+ *  If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ * 
+ */
+
+#ifndef VESSEL_TXX_
+#define VESSEL_TXX_
+
+#include "vessel.hxx"
+
+// included by the file instantiating the engine for each policy
+
+using namespace std;
+namespace po = boost::program_options;
+
+// tree count of each tree type
+template <class P>
+unsigned int vesselTree<P>::num = 0;
+
+// default constructor for vesselTree
+template <class P>
+vesselTree<P>::vesselTree(po::variables_map o, vesselTreeInit *init):
+  randGen(init->seed),
+  u01(randGen){
+
+  opt = o;
+
+  string treeOpt = string(P::treeGroup()) + ".";
+  string brOpt = string(P::brGroup()) + ".";
+  string segOpt = string(P::segGroup()) + ".";
+
+  radiusDist = betaTable::get(o[segOpt+"radiusBetaA"].as<double>(),o[segOpt+"radiusBetaB"].as<double>());
+
+  // assign id and update number of trees
+#pragma omp critical
+  {
+    id = num;
+    num += 1;
+  }
+
+  fill = init->fill;
+  roi = init->roi;
+
+  numBranch = 0;
+  maxBranch = o[treeOpt+"maxBranch"].as<uint>();
+  maxGen = o[treeOpt+"maxGen"].as<uint>();
+  baseLength = o[treeOpt+"baseLength"].as<double>();
+
+  lenShrink = o[brOpt+"lenShrink"].as<double>();
+  lenRange = o[brOpt+"lenRange"].as<double>();
+  childMinRad = o[brOpt+"childMinRad"].as<double>();
+  minRadFrac = o[brOpt+"minRadFrac"].as<double>();
+  maxRadFrac = o[brOpt+"maxRadFrac"].as<double>();
+  rotateJitter = o[brOpt+"rotateJitter"].as<double>();
+
+  // vessels have always taken the duct segment fraction
+  segFrac = o["ductSeg.segFrac"].as<double>();
+  numTry = o[segOpt+"numTry"].as<uint>();
+  maxTry = o[segOpt+"maxTry"].as<uint>();
+  absMaxTry = o[segOpt+"absMaxTry"].as<uint>();
+  imgRes = o["base.imgRes"].as<double>();
+  thinRad = o[segOpt+"thinFrac"].as<double>()*imgRes;
+  maxCurvRad = o[segOpt+"maxCurvRad"].as<double>();
+  maxCurvFrac = o[segOpt+"maxCurvFrac"].as<double>();
+  roiStep = o[segOpt+"roiStep"].as<double>();
+  densityWt = o[segOpt+"densityWt"].as<double>();
+  angleWt = o[segOpt+"angleWt"].as<double>();
+  // only vessels weigh the room ahead of a segment
+  dirWt = o.count(segOpt+"dirWt") ? o[segOpt+"dirWt"].as<double>() : 0.0;
+  minEndRad = o[segOpt+"minEndRad"].as<double>();
+  maxEndRad = o[segOpt+"maxEndRad"].as<double>();
+
+  boundBox = init->boundBox;
+  compartmentId = init->compartmentId;
+  tissue = init->tissue;
+  histogram = init->histogram;
+  for(int i=0; i<3; i++){
+    prefDir[i] = init->prefDir[i];
+    nipplePos[i] = init->nipplePos[i];
+  }
+  breast = init->breast;
+  TDLUloc = init->TDLUloc;
+  TDLUattr = init->TDLUattr;
+
+  // labels the tree leaves alone
+  numKeep = P::keep(tissue, keep);
+
+  P::fov(breast, fov);
+
+  P::readData(o, &policyData);
+
+  // temporarily set head branch pointer
+  head = nullptr;
+  region = nullptr;
+  fillRegion = nullptr;
+}
+
+// destructor, the pools free all branches and segments at once
+template <class P>
+vesselTree<P>::~vesselTree(){
+  delete[] region;
+  delete[] fillRegion;
+}
+
+template <class P>
+void vesselTree<P>::buildRegion(void){
+  for(int i=0; i<3; i++){
+    regionDim[i] = boundBox[2*i+1] - boundBox[2*i] + 1;
+  }
+  vtkIdType numVox = (vtkIdType)regionDim[0]*regionDim[1]*regionDim[2];
+  vtkIdType numBytes = (numVox+7)/8;
+  region = new unsigned char[numBytes];
+  fillRegion = new unsigned char[numBytes];
+
+  // labels besides the compartment the region takes
+  unsigned char extra[4];
+  int numExtra = P::regionLabels(tissue, extra);
+
+  // whole bytes per iteration so no two threads write the same byte
+#pragma omp parallel for schedule(static)
+  for(vtkIdType m=0; m<numBytes; m++){
+    unsigned char bits = 0;
+    unsigned char fillBits = 0;
+    for(int l=0; l<8; l++){
+      vtkIdType n = 8*m + l;
+      if(n >= numVox){
+	break;
+      }
+      int a = (int)(n % regionDim[0]);
+      int b = (int)((n / regionDim[0]) % regionDim[1]);
+      int c = (int)(n / ((vtkIdType)regionDim[0]*regionDim[1]));
+      unsigned char* p = static_cast<unsigned char*>(breast->GetScalarPointer(boundBox[0]+a, boundBox[2]+b, boundBox[4]+c));
+      bool found = (p[0] == compartmentId);
+      for(int k=0; k<numExtra; k++){
+	found = found || (p[0] == extra[k]);
+      }
+      if(found){
+	bits |= (unsigned char)(1 << l);
+      }
+      if(p[0] == compartmentId){
+	fillBits |= (unsigned char)(1 << l);
+      }
+    }
+    region[m] = bits;
+    fillRegion[m] = fillBits;
+  }
+}
+
+template <class P>
+bool vesselTree<P>::inRegion(const int* ijk){
+  int a = ijk[0] - boundBox[0];
+  int b = ijk[1] - boundBox[2];
+  int c = ijk[2] - boundBox[4];
+  if(a < 0 || b < 0 || c < 0 || a >= regionDim[0] || b >= regionDim[1] || c >= regionDim[2]){
+    return false;
+  }
+  vtkIdType n = ((vtkIdType)c*regionDim[1] + b)*regionDim[0] + a;
+  return (region[n >> 3] >> (n & 7)) & 1;
+}
+
+template <class P>
+void vesselTree<P>::clearRegion(const int* ijk){
+  int a = ijk[0] - boundBox[0];
+  int b = ijk[1] - boundBox[2];
+  int c = ijk[2] - boundBox[4];
+  if(a < 0 || b < 0 || c < 0 || a >= regionDim[0] || b >= regionDim[1] || c >= regionDim[2]){
+    return;
+  }
+  vtkIdType n = ((vtkIdType)c*regionDim[1] + b)*regionDim[0] + a;
+  unsigned char mask = (unsigned char)~(1 << (n & 7));
+  // neighbouring voxels share the byte
+#pragma omp atomic
+  region[n >> 3] &= mask;
+}
+
+template <class P>
+void vesselTree<P>::grow(void){
+  if(!P::rounds){
+    // each branch grows fully, then the subtree of its first child, then
+    // that of its second child
+    head->growDepth(0.0);
+    return;
+  }
+
+  // branches are grown a segment at a time in rounds, every growing branch
+  // proposes its next segment against the map left by the previous round,
+  // then the proposals are committed one branch at a time in id order,
+  // so sibling subtrees grow side by side and the tree does not depend on
+  // the number of threads
+  // at most maxBranch+1 branches exist
+  vesselBr<P>** active = new vesselBr<P>*[maxBranch+2];
+  vesselBr<P>** next = new vesselBr<P>*[maxBranch+2];
+  vesselBr<P>** born = new vesselBr<P>*[maxBranch+2];
+  int numActive = 1;
+  active[0] = head;
+
+  while(numActive > 0){
+    // proposals only read shared state, a lone branch leaves the threads
+    // to the fill map sweep
+#pragma omp parallel for schedule(dynamic,1) if(numActive > 1)
+    for(int n=0; n<numActive; n++){
+      active[n]->addSeg();
+    }
+
+    // commit in id order, new children follow the branches still growing
+    int numNext = 0;
+    int numBorn = 0;
+    for(int n=0; n<numActive; n++){
+      vesselBr<P>* br = active[n];
+      br->commitSeg();
+      if(br->growing()){
+	next[numNext] = br;
+	numNext++;
+      } else {
+	br->finish();
+	if(br->nChild > 0){
+	  born[numBorn] = br->firstChild;
+	  born[numBorn+1] = br->secondChild;
+	  numBorn += 2;
+	}
+      }
+    }
+    for(int n=0; n<numBorn; n++){
+      next[numNext] = born[n];
+      numNext++;
+    }
+
+    vesselBr<P>** swap = active;
+    active = next;
+    next = swap;
+    numActive = numNext;
+  }
+
+  delete[] active;
+  delete[] next;
+  delete[] born;
+}
+
+// constructor for first branch (the root)
+template <class P>
+vesselBr<P>::vesselBr(double* spos, double* sdir, double r, vesselTree<P> *owner):
+  u01(typename vesselTree<P>::rgenType(P::rounds ? static_cast<unsigned int>(owner->u01()*4294967296.0) : 0u)){
+
+  myTree = owner;
+
+  for(int i=0; i<3; i++){
+    startPos[i] = spos[i];
+    startDir[i] = sdir[i];
+  }
+  startRad = r;
+
+  // no parent or sibling branches
+  parent = nullptr;
+  sibBranch = nullptr;
+  firstChild = nullptr;
+  secondChild = nullptr;
+  nChild = 0;
+
+  // root branch has id 0 and level 0 and generation 0
+  id = 0;
+  level = 0;
+  gen = 0;
+
+  // increment tree branch count
+  myTree->numBranch += 1;
+
+  // determine length of branch
+  length = setLength();
+  curLength = 0.0;
+
+  // segments are added by vesselTree::grow
+  firstSeg = nullptr;
+  lastSeg = nullptr;
+  failSeg = false;
+  edgeSeg = false;
+}
+
+// constructor for first child branch of a parent branch
+template <class P>
+vesselBr<P>::vesselBr(vesselBr<P>* par, unsigned int lev, unsigned int g, double r, double theta):
+  u01(typename vesselTree<P>::rgenType(P::rounds ? static_cast<unsigned int>(par->rand()*4294967296.0) : 0u)){
+
+  // pointers
+  parent = par;
+  sibBranch = nullptr;
+  firstChild = nullptr;
+  secondChild = nullptr;
+  nChild = 0;
+
+  for(int i=0; i<3; i++){
+    startPos[i] = parent->endPos[i];
+  }
+  startRad = r;
+  level = lev;
+  gen = g;
+  myTree = parent->myTree;
+  id = myTree->numBranch;
+  myTree->numBranch += 1;
+
+  // growing depth first picks the direction anew for every try
+  if(P::rounds){
+    setDir(startDir,theta);
+  }
+
+  // determine length of branch
+  length = setLength();
+  curLength = 0.0;
+
+  // segments are added by vesselTree::grow
+  firstSeg = nullptr;
+  lastSeg = nullptr;
+  failSeg = false;
+  edgeSeg = false;
+}
+
+// constructor for subsequent children (not first child) of a parent branch
+template <class P>
+vesselBr<P>::vesselBr(vesselBr<P>* par, vesselBr<P>* par2, unsigned int lev, unsigned int g, double r, double theta):
+  u01(typename vesselTree<P>::rgenType(P::rounds ? static_cast<unsigned int>(par->rand()*4294967296.0) : 0u)){
+
+  // pointers
+  parent = par;
+  sibBranch = par2;
+  firstChild = nullptr;
+  secondChild = nullptr;
+  nChild = 0;
+
+  for(int i=0; i<3; i++){
+    startPos[i] = parent->endPos[i];
+  }
+  startRad = r;
+  level = lev;
+  gen = g;
+  myTree = parent->myTree;
+  id = myTree->numBranch;
+  myTree->numBranch += 1;
+
+  // growing depth first picks the direction anew for every try
+  if(P::rounds){
+    setDir(startDir,theta);
+  }
+
+  // determine length of branch
+  length = setLength();
+  curLength = 0.0;
+
+  // segments are added by vesselTree::grow
+  firstSeg = nullptr;
+  lastSeg = nullptr;
+  failSeg = false;
+  edgeSeg = false;
+}
+
+template <class P>
+double vesselBr<P>::rand(void){
+  if(P::rounds){
+    return u01();
+  }
+  return myTree->u01();
+}
+
+template <class P>
+void vesselBr<P>::addSeg(void){
+  // propose next segment against current fill map and breast labels,
+  // touches nothing outside this branch
+  if(lastSeg == nullptr){
+    firstSeg = new(myTree->segPool.alloc()) vesselSeg<P>(this);
+    lastSeg = firstSeg;
+  } else {
+    lastSeg->nextSeg = new(myTree->segPool.alloc()) vesselSeg<P>(lastSeg);
+    // the lastSeg in parenthesis is used to fill variables including prevSeg ptr
+    lastSeg = lastSeg->nextSeg;
+  }
+}
+
+template <class P>
+void vesselBr<P>::checkSeg(void){
+  // update length
+  curLength += lastSeg->length;
+
+  if(lastSeg->length == 0.0){
+    failSeg = true;
+  }
+
+  // check if at ROI boundary
+  P::checkEnd(myTree, lastSeg->endPos, parent == nullptr, lastSeg == firstSeg, failSeg, edgeSeg);
+}
+
+template <class P>
+void vesselBr<P>::commitSeg(void){
+  if(lastSeg->length != 0.0){
+    // update voxel-based visualization
+    lastSeg->updateMap();
+    // update fill
+    myTree->fill->update(lastSeg->endPos);
+  }
+  checkSeg();
+}
+
+template <class P>
+bool vesselBr<P>::growing(void){
+  return(curLength < length && !failSeg && !edgeSeg);
+}
+
+template <class P>
+void vesselBr<P>::growDepth(double theta){
+  // the root is grown once and keeps its segments, a child that fails or
+  // reaches the edge is grown again in a new direction, the flags carry
+  // over between tries
+  int maxSegTry = (parent == nullptr) ? 1 : 10;
+  int numSegTry = 0;
+  bool segSuccess = false;
+
+  do{
+    numSegTry++;
+    if(parent != nullptr){
+      setDir(startDir, theta);
+    }
+    curLength = 0.0;
+    firstSeg = nullptr;
+    lastSeg = nullptr;
+
+    // generate segments to fill branch
+    do{
+      addSeg();
+      checkSeg();
+    } while(growing());
+
+    if(!failSeg && !edgeSeg){
+      segSuccess = true;
+    } else if(parent != nullptr){
+      // delete current segments and try again
+      vesselSeg<P>* delSeg;
+      while(firstSeg != lastSeg){
+	delSeg = firstSeg;
+	firstSeg = firstSeg->nextSeg;
+	myTree->segPool.release(delSeg);
+      }
+      myTree->segPool.release(firstSeg);
+      firstSeg = nullptr;
+      lastSeg = nullptr;
+    }
+  } while(!segSuccess && numSegTry < maxSegTry);
+
+  // insert segments into phantom, makeSeg already updated the fill map
+  if(firstSeg != nullptr){
+    vesselSeg<P>* mySeg = firstSeg;
+    vesselSeg<P>* prevSeg;
+    do{
+      mySeg->updateMap();
+      prevSeg = mySeg;
+      mySeg = mySeg->nextSeg;
+    } while(prevSeg != mySeg);
+  }
+
+  finish();
+}
+
+template <class P>
+void vesselBr<P>::finish(void){
+  // fill in end of branch variables
+  if(lastSeg == nullptr){
+    // no try succeeded, the branch ends where it starts
+    for(int i=0; i<3; i++){
+      endPos[i] = startPos[i];
+      endDir[i] = startDir[i];
+    }
+    endRad = startRad;
+    curLength = 0.0;
+  } else {
+    for(int i=0; i<3; i++){
+      endPos[i] = lastSeg->endPos[i];
+      endDir[i] = lastSeg->endDir[i];
+    }
+    endRad = lastSeg->endRad;
+  }
+
+  length = curLength;
+
+  // set number of children and generate them
+  nChild = setChild();
+
+  if(failSeg){
+    nChild = 0;
+    if(parent == nullptr && P::rounds){
+      std::cout << "Segment generation failure for branch" << id << std::endl;
+    }
+  }
+
+  // a root growing in rounds keeps branching at the edge
+  if(edgeSeg){
+    if(parent == nullptr){
+      std::cout << "ROI edge collision for branch " << id << std::endl;
+    }
+    if(parent != nullptr || !P::rounds){
+      nChild = 0;
+    }
+  }
+
+  if (nChild == 0){
+    firstChild = nullptr;
+    secondChild = nullptr;
+    P::leaf(myTree, this, endPos, endDir, length);
+  } else {
+    // bifurcate
+    // pick radii
+    double radii[2];
+    double thetas[2];
+    setRadiiThetas(radii,thetas);
+    // setup first child with level equal to current level
+    firstChild = new(myTree->brPool.alloc()) vesselBr<P>(this,level,gen+1,radii[0],thetas[0]);
+    if(P::rounds){
+      firstChild->sibBranch = new(myTree->brPool.alloc()) vesselBr<P>(this,firstChild,level+1,gen+1,radii[1],thetas[1]);
+      secondChild = firstChild->sibBranch;
+    } else {
+      // the subtree of the first child grows before the second child exists
+      firstChild->growDepth(thetas[0]);
+      if(parent != nullptr && sibBranch == nullptr){
+	// children of a first child have always taken the second child as
+	// another first child at the radius as polar angle, kept so the
+	// networks do not change
+	secondChild = new(myTree->brPool.alloc()) vesselBr<P>(this,level+1,gen+1,radii[1],radii[1]);
+	secondChild->growDepth(radii[1]);
+      } else {
+	secondChild = new(myTree->brPool.alloc()) vesselBr<P>(this,firstChild,level+1,gen+1,radii[1],thetas[1]);
+	secondChild->growDepth(thetas[1]);
+      }
+      firstChild->sibBranch = secondChild;
+    }
+  }
+}
+
+template <class P>
+double vesselBr<P>::setLength(void){
+  // set length using random distribution and level
+  double len;
+  double randVal = rand();
+  double baseLen = myTree->baseLength;
+
+  len = baseLen*pow(myTree->lenShrink,level);
+
+  // add variability +/- lenRange fraction of len
+  len = len - myTree->lenRange*len + randVal*2*myTree->lenRange*len;
+  return(len);
+}
+
+template <class P>
+unsigned int vesselBr<P>::setChild(void){
+  // determine number of child branches
+  // if small enough, no children
+  if(endRad < myTree->childMinRad){
+    return(0);
+  }
+
+  // check for max number branches
+  if(myTree->numBranch >= myTree->maxBranch){
+    return(0);
+  }
+
+  // define maximum generation
+  if(gen > myTree->maxGen){
+    return(0);
+  }
+
+  // default 2 children
+  return(2);
+}
+
+template <class P>
+void vesselBr<P>::setRadiiThetas(double* radii, double* thetas){
+  // set radii and angles of child branches based on the parent
+
+  double minFrac = myTree->minRadFrac;
+  double maxFrac = myTree->maxRadFrac;
+
+  double randVal = rand();
+
+  // first child radius
+  double myFrac = minFrac + randVal*(maxFrac-minFrac);
+  radii[0] = myFrac*endRad;
+
+  // second child radius based on Murray's law
+  double b = 1.0/myFrac;
+  double a = pow(pow(b,3.0)-1.0,1.0/3.0);
+  radii[1] = a*radii[0];
+
+  // first child theta
+  double lBound = (pow(b,4.0)+1.0-pow(a,4.0))/(2.0*pow(b,2.0));
+  double uBound = (pow(b,2.0)+1.0-pow(a,2.0))/(2.0*b);
+  randVal = rand();
+  double ctheta = lBound + randVal*(uBound-lBound);
+  thetas[0] = acos(ctheta);
+
+  // second child theta
+  lBound = (pow(b,4.0)+pow(a,4.0)-1.0)/(2*pow(a,2.0)*pow(b,2.0));
+  uBound = (pow(b,2.0)+pow(a,2.0)-1.0)/(2*a*b);
+  randVal = rand();
+  ctheta = lBound + randVal*(uBound-lBound);
+  thetas[1] = acos(ctheta);
+}
+
+template <class P>
+void vesselBr<P>::setDir(double* sdir, double theta){
+
+  const double pi = boost::math::constants::pi<double>();
+
+  // set initial direction of branch
+  double tempV[3];
+  double basis1[3];
+  double basis2[3];
+
+  double rotate;
+
+  if(sibBranch == nullptr){
+    // this is the first child
+    // random rotation about parent direction
+    rotate = 2*pi*rand();
+  } else {
+    // this is the second child
+    rotate = P::azimuth(myTree, this, sibBranch->azimuth);
+  }
+  azimuth = rotate;
+
+  // project origin onto plane perpendicular parent endDir
+  double dotProd = 0.0;
+  for(int i=0; i<3; i++){
+    dotProd += parent->endDir[i]*startPos[i];
+  }
+  for(int i=0; i<3; i++){
+    tempV[i] = dotProd*parent->endDir[i];
+    basis1[i] = tempV[i] - startPos[i];
+  }
+
+  // normalize basis1
+  double norm = 0.0;
+  for(int i=0; i<3; i++){
+    norm += basis1[i]*basis1[i];
+  }
+  norm = sqrt(norm);
+  for(int i=0; i<3; i++){
+    basis1[i] = basis1[i]/norm;
+  }
+
+  // find second basis vector using cross product
+  basis2[0] = parent->endDir[1]*basis1[2] - parent->endDir[2]*basis1[1];
+  basis2[1] = parent->endDir[2]*basis1[0] - parent->endDir[0]*basis1[2];
+  basis2[2] = parent->endDir[0]*basis1[1] - parent->endDir[1]*basis1[0];
+
+  for(int i=0; i<3; i++){
+    sdir[i] = cos(theta)*parent->endDir[i] + sin(theta)*(cos(rotate)*basis1[i] + sin(rotate)*basis2[i]);
+  }
+}
+
+// constructor for first segment
+template <class P>
+vesselSeg<P>::vesselSeg(vesselBr<P>* br){
+  myBranch = br;
+  prevSeg = nullptr;
+  nextSeg = this;
+
+  for(int i=0; i<3; i++){
+    startPos[i] = myBranch->startPos[i];
+    startDir[i] = myBranch->startDir[i];
+  }
+  startRad = myBranch->startRad;
+
+  // keeping derivatives zero at nodes for now
+  startDeriv = 0.0;
+
+  // code to generate random segment
+  makeSeg();
+}
+
+// constructor for subsequent segments
+template <class P>
+vesselSeg<P>::vesselSeg(vesselSeg<P>* pr){
+  prevSeg = pr;
+  myBranch = prevSeg->myBranch;
+  nextSeg = this;
+
+  for(int i=0; i<3; i++){
+    startPos[i] = prevSeg->endPos[i];
+    startDir[i] = prevSeg->endDir[i];
+  }
+
+  startRad = prevSeg->endRad;
+  startDeriv = prevSeg->endDeriv;
+
+  // code to generate random segment
+  makeSeg();
+}
+
+template <class P>
+void vesselSeg<P>::makeSeg(){
+
+  const double pi = boost::math::constants::pi<double>();
+
+  vesselTree<P>* myTree = myBranch->myTree;
+
+  unsigned int numTry = myTree->numTry;
+  unsigned int maxTry = myTree->maxTry;
+  unsigned int absMaxTry = myTree->absMaxTry;
+  // segments much thinner than a voxel barely show in the image, they keep
+  // the first valid trial without scoring it, the tree keeps branching,
+  // filling and placing TDLUs as usual
+  bool thin = (startRad < myTree->thinRad);
+  if(thin){
+    numTry = 1;
+  }
+  double maxRad = P::maxCurv(myTree->maxCurvRad, myBranch->level);
+  double angleMax =  pi*myTree->maxCurvFrac;
+  double roiStep = myTree->roiStep;
+  double maxEndRad = myTree->maxEndRad;
+  double minEndRad = myTree->minEndRad;
+
+  unsigned int curTry;	// number of valid segments tested so far
+  unsigned int totalTry;	// number of test segments so far
+  unsigned int allTry;	// total number of test segments overall
+
+  double randVal, quantileVal;  // for length random generator
+
+  double theta;  	// rotation of segment
+  double radius; 	// segment radius of curvature
+  double radLB,radUB; 	// min and max radius of curvature
+
+  double curv[3];  	// point of rotation
+  double curvNorm;	// stores norm(startPos-curv)
+  double basis1[3];
+  double basis2[3]; 	// basis vectors
+  double tempV[3];
+  double checkPos[3];	// checking if segment position in ROI
+
+  double checkAngle;
+  double checkLength;
+  double angleStep; // angular step size for checking in ROI for segment
+
+  bool foundSeg = false;  // have we found a good segment yet?
+  bool inROI;	// is current test segment in ROI?
+  bool inFOV;	// is current segment in FOV?
+
+  // breast FOV for checking if segment in FOV
+  double* breastFOV = myTree->fov;
+
+  double bestCurv[3];	// best center of curvature found so far
+  double bestRadius;
+  double bestCost;  // best cost found so far
+  double cost;	// current cost
+
+  // determine proposed segment length
+  // default length
+  length = myBranch->length*myTree->segFrac;
+
+  if(length > (myBranch->length - myBranch->curLength)){
+    // truncate
+    length = myBranch->length - myBranch->curLength;
+  }
+
+  // valid candidates of current try, scored together in one fill sweep
+  int numCand;
+  double* candPos = new double[3*numTry];
+  double* candDensity = new double[numTry];
+  double* candRadius = new double[numTry];
+  double* candCurv = new double[3*numTry];
+
+  allTry = 0;
+
+  while (!foundSeg && allTry < absMaxTry){
+    curTry = 0;
+    numCand = 0;
+    while (curTry < numTry){
+      totalTry = 0;
+      inROI = false;
+      inFOV = false;
+      while (!inROI && !inFOV && totalTry < maxTry){
+	allTry++;
+	// generate random segment
+	theta = 2*pi*myBranch->rand();
+	radUB = maxRad;
+	radLB = length/angleMax;
+	// use beta distribution to pick radius
+	randVal = myBranch->rand();
+	quantileVal = myTree->radiusDist->quantile(randVal);
+	// scale to radius range
+	radius = quantileVal*(radUB-radLB) + radLB;
+	totalTry += 1;
+
+	// checking if in ROI
+	// need basis vectors in plane perpendicular to startDir
+
+	// project origin (0,0,0) onto plane perpendicular to startDir
+	vtkMath::ProjectVector(startPos, startDir, tempV);
+
+	vtkMath::Subtract(tempV, startPos, basis1);
+
+	// normalize it
+	vtkMath::Normalize(basis1);
+
+	// find second basis vector using cross product
+	vtkMath::Cross(startDir,basis1,basis2);
+
+	// calculate curvature
+	for(int i=0; i<3; i++){
+	  curv[i] = startPos[i] + radius*(basis1[i]*cos(theta) + basis2[i]*sin(theta));
+	}
+
+	// calculate norm(startPos-curv)
+	curvNorm = 0.0;
+	for(int i=0; i<3; i++){
+	  curvNorm += (startPos[i]-curv[i])*(startPos[i]-curv[i]);
+	}
+	curvNorm = sqrt(curvNorm);
+
+	// decide from the distance to the ROI boundary when the whole arc is
+	// clear of it or its end is deep outside, step along the arc only
+	// near the boundary
+	double midPos[3];
+	for(int i=0; i<3; i++){
+	  midPos[i] = curv[i] + radius*((startPos[i]-curv[i])/curvNorm*cos(length/radius/2.0)+startDir[i]*sin(length/radius/2.0));
+	  checkPos[i] = curv[i] + radius*((startPos[i]-curv[i])/curvNorm*cos(length/radius)+startDir[i]*sin(length/radius));
+	}
+	// every arc point is within length/2 of midPos
+	bool inBox = true;
+	for(int i=0; i<3; i++){
+	  inBox = inBox && midPos[i]-length/2.0 >= breastFOV[2*i] && midPos[i]+length/2.0 <= breastFOV[2*i+1];
+	}
+	int decided = 0;
+	if(myTree->roi->clearance(midPos) > length/2.0){
+	  decided = 1;
+	} else if(inBox && myTree->roi->outside(checkPos)){
+	  decided = -1;
+	}
+
+	if(decided != 0){
+	  inFOV = true;
+	  inROI = (decided > 0);
+	} else {
+	  // check if in ROI
+	  angleStep = roiStep/radius;
+	  checkAngle = 0.0;
+	  checkLength = 0.0;
+	  inROI = true;
+	  inFOV = true;
+	  while (checkLength < length && inROI && inFOV){
+	    for(int i=0; i<3; i++){
+	      checkPos[i] = curv[i] + radius*((startPos[i]-curv[i])/curvNorm*cos(checkAngle)+startDir[i]*sin(checkAngle));
+	    }
+
+	    // is point in FOV and in ROI?
+
+	    // check FOV first
+	    if(checkPos[0] < breastFOV[0] || checkPos[0] > breastFOV[1] ||
+	       checkPos[1] < breastFOV[2] || checkPos[1] > breastFOV[3] ||
+	       checkPos[2] < breastFOV[4] || checkPos[2] > breastFOV[5]){
+	      inFOV = false;
+	    }
+
+	    // check in ROI
+
+	    if(inFOV && !P::inROI(myTree, checkPos)){
+	      inROI = false;
+	    }
+
+	    checkAngle += angleStep;
+	    checkLength += angleStep*radius;
+	  }
+	  // check the end point
+	  for(int i=0; i<3; i++){
+	    checkPos[i] = curv[i] + radius*((startPos[i]-curv[i])/curvNorm*cos(length/radius)+startDir[i]*sin(length/radius));
+	  }
+	  // check FOV first
+	  if(checkPos[0] < breastFOV[0] || checkPos[0] > breastFOV[1] ||
+	     checkPos[1] < breastFOV[2] || checkPos[1] > breastFOV[3] ||
+	     checkPos[2] < breastFOV[4] || checkPos[2] > breastFOV[5]){
+	    inFOV = false;
+	  }
+
+	  // check in ROI
+
+	  if(inFOV && !P::inROI(myTree, checkPos)){
+	    inROI = false;
+	  }
+	}
+      }
+      curTry += 1;
+      // if valid, keep for scoring
+      if (inROI && inFOV){
+	candRadius[numCand] = radius;
+	for(int i=0; i<3; i++){
+	  candPos[3*numCand+i] = checkPos[i];
+	  candCurv[3*numCand+i] = curv[i];
+	}
+	numCand++;
+      }
+    }
+
+    if(numCand > 0 && thin){
+      foundSeg = true;
+      bestRadius = candRadius[0];
+      for(int i=0; i<3; i++){
+	bestCurv[i] = candCurv[i];
+      }
+    } else if(numCand > 0){
+      foundSeg = true;
+
+      // reduction in squared distance to tree in ROI
+      // only evaluate endPos, all candidates in one sweep over fill voxels
+      for(int n=0; n<numCand; n++){
+	candDensity[n] = 0.0;
+      }
+
+      myTree->fill->score(candPos, numCand, candDensity);
+
+      // first candidate with lowest cost wins
+      for(int n=0; n<numCand; n++){
+	radius = candRadius[n];
+	curvNorm = 0.0;
+	for(int i=0; i<3; i++){
+	  curv[i] = candCurv[3*n+i];
+	  curvNorm += (startPos[i]-curv[i])*(startPos[i]-curv[i]);
+	}
+	curvNorm = sqrt(curvNorm);
+
+	// endDir from derivative of position
+	for(int i=0; i<3; i++){
+	  endDir[i] = -1*(startPos[i]-curv[i])/curvNorm*sin(length/radius)+startDir[i]*cos(length/radius);
+	}
+	// normalize
+	vtkMath::Normalize(endDir);
+
+	// negative cost is good
+	cost = P::cost(myTree, candDensity[n], &candPos[3*n], endDir);
+	if (n == 0 || cost < bestCost){
+	  // found a new best segment
+	  bestCost = cost;
+	  bestRadius = radius;
+	  for(int i=0; i<3; i++){
+	    bestCurv[i] = curv[i];
+	  }
+	}
+      }
+    }
+    if(!foundSeg){
+      // couldn't find good segment, reduce length
+      length = length/10.0;  // could get into infinite loop
+    }
+  }
+
+  delete[] candPos;
+  delete[] candDensity;
+  delete[] candRadius;
+  delete[] candCurv;
+
+  if(!foundSeg){
+    // we have failed completely
+    length = 0.0;
+    for(int i=0; i<3; i++){
+      endPos[i] = startPos[i];
+      endDir[i] = startDir[i];
+    }
+    endRad = startRad;
+  } else {
+    // determined new segment, fill in variables
+    curvNorm = 0.0;
+    for(int i=0; i<3; i++){
+      curvNorm += (startPos[i]-bestCurv[i])*(startPos[i]-bestCurv[i]);
+    }
+    curvNorm = sqrt(curvNorm);
+
+    for(int i=0; i<3; i++){
+      centerCurv[i] = bestCurv[i];
+      endPos[i] = centerCurv[i] + bestRadius*((startPos[i]-bestCurv[i])/curvNorm*cos(length/bestRadius)+startDir[i]*sin(length/bestRadius));
+    }
+    radCurv = 0.0;
+    for(int i=0; i<3; i++){
+      radCurv += (centerCurv[i]-startPos[i])*(centerCurv[i]-startPos[i]);
+    }
+    radCurv = sqrt(radCurv);
+
+    // length already set
+    // endDir from derivative of position
+    for(int i=0; i<3; i++){
+      endDir[i] = -1*(startPos[i]-centerCurv[i])/radCurv*sin(length/bestRadius)+startDir[i]*cos(length/bestRadius);
+    }
+    // normalize
+    vtkMath::Normalize(endDir);
+
+    // keeping derivatives fixed to 0 for now
+    endDeriv = 0.0;
+    // end radius from uniform random variable
+    randVal = myBranch->rand();
+    endRad = minEndRad*startRad + randVal*(maxEndRad-minEndRad)*startRad;
+    // shape parameters
+    setShape();
+    if(!P::rounds){
+      // later segments of the branch and its retries avoid this one too
+      myTree->fill->update(endPos);
+    }
+  }
+}
+
+template <class P>
+void vesselSeg<P>::setShape(){
+  // cubic polynomial v(0)d^3+v(1)d^2+v(2)d+v(3)
+  // d = [0,length)
+  shape[3] = startRad;
+  shape[2] = startDeriv;
+  double c = endRad-shape[2]*length-shape[3];
+  shape[0] = (endDeriv-shape[2]-2*c/length)/length/length;
+  shape[1] = c/length/length-shape[0]*length;
+}
+
+template <class P>
+double vesselSeg<P>::getRadius(double t){
+  // return segment radius at position t (mm)
+  if(t>=0 && t<=length){
+    return(shape[0]*t*t*t+shape[1]*t*t+shape[2]*t+shape[3]);
+  } else {
+    return(0);
+  }
+}
+
+template <class P>
+void vesselSeg<P>::updateMap(){
+  // update voxelized map of tree
+  arcTube tube(startPos, startDir, centerCurv, length, shape);
+  tube.rasterize(myBranch->myTree->breast, myBranch->myTree->histogram, P::label(myBranch->myTree->tissue),
+		myBranch->myTree->keep, myBranch->myTree->numKeep);
+}
+
+template <class P>
+bool bloodPolicy::inROI(vesselTree<P>* t, const double* pos){
+  int myVoxel[3];
+  double pcoords[3];
+  if(!t->breast->ComputeStructuredCoordinates(const_cast<double*>(pos), myVoxel, pcoords)){
+    return true;
+  }
+  unsigned char* p = static_cast<unsigned char*>(t->breast->GetScalarPointer(myVoxel[0],myVoxel[1],myVoxel[2]));
+  return !(p[0] == t->tissue->skin || p[0] == t->tissue->bg);
+}
+
+template <class P>
+double bloodPolicy::cost(vesselTree<P>* t, double density, const double* pos, const double* dir){
+  int myVoxel[3];
+  double pcoords[3];
+
+  // test if heading for edge
+  double travelDist = 0.0;
+  // step size
+  double travelStep = 1.0;
+  bool inBreast = true;
+
+  while(inBreast){
+    double currPos[3];
+    for(int i=0; i<3; i++){
+      currPos[i] = pos[i] + travelDist*dir[i];
+    }
+    // skip steps that certainly stay clear of skin and background
+    int skip = t->roi->freeSteps(currPos, travelStep);
+    if(skip > 0){
+      travelDist += skip*travelStep;
+      continue;
+    }
+    if(t->breast->ComputeStructuredCoordinates(currPos, myVoxel, pcoords)){
+      unsigned char* p = static_cast<unsigned char*>(t->breast->GetScalarPointer(myVoxel[0],myVoxel[1],myVoxel[2]));
+      if(p[0] == t->tissue->skin || p[0] == t->tissue->bg){
+	inBreast = false;
+      } else {
+	travelDist += travelStep;
+      }
+    } else {
+      inBreast = false;
+    }
+  }
+
+  // prefDir towards nipple
+  double prefDir[3];
+  for(int i=0; i<3; i++){
+    prefDir[i] = t->nipplePos[i] - pos[i];
+  }
+  vtkMath::Normalize(prefDir);
+
+  // penalty includes direction of segment (away from nipple), dot product
+  // gives cosine of angle
+  return t->densityWt*density - t->angleWt*vtkMath::Dot(dir,prefDir) - t->dirWt*travelDist;
+}
+
+template <class P>
+void bloodPolicy::checkEnd(vesselTree<P>* t, const double* pos, bool root, bool first, bool& fail, bool& edge){
+  int invox[3];
+  double pcoords[3];
+  int breastExtent[6];
+  t->breast->GetExtent(breastExtent);
+
+  if(t->breast->ComputeStructuredCoordinates(const_cast<double*>(pos), invox, pcoords)){
+    // check if near phantom boundary
+    if(invox[0] <= breastExtent[0] || invox[0] >= breastExtent[1] ||
+       invox[1] <= breastExtent[2] || invox[1] >= breastExtent[3] ||
+       invox[2] <= breastExtent[4] || invox[2] >= breastExtent[5]){
+      fail = true;
+    }
+  } else {
+    fail = true;
+  }
+  if(!fail){
+    // check if at ROI boundary by seeing if any neighboring voxels are outside ROI
+    for(int a=-1; a<=1; a++){
+      for(int b=-1; b<=1; b++){
+	for(int c=-1; c<=1; c++){
+	  unsigned char* p =
+	    static_cast<unsigned char*>(t->breast->GetScalarPointer(invox[0]+a,invox[1]+b,invox[2]+c));
+	  if(p[0] == t->tissue->skin || p[0] == t->tissue->bg || (!root && p[0] == t->tissue->muscle)){
+	    edge = true;
+	  }
+	}
+      }
+    }
+  }
+}
+
+template <class P>
+double bloodPolicy::azimuth(vesselTree<P>* t, vesselBr<P>* br, double sibAzimuth){
+  const double pi = boost::math::constants::pi<double>();
+  // keep away from sibling
+  double minAngleSep = 0.1;
+  double rotate;
+  do{
+    rotate = 2*pi*br->rand();
+  } while(fabs(rotate-sibAzimuth) < minAngleSep);
+  return rotate;
+}
+
+#endif /* VESSEL_TXX_ */